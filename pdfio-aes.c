@@ -6,64 +6,37 @@
 // Licensed under Apache License v2.0.  See the file "LICENSE" for more
 // information.
 //
-// AES code is adapted from the "tiny-AES-c" project
-// (<https://github.com/kokke/tiny-AES-c>)
+// The portable AES code is bitsliced and processes four blocks at a time
+// without lookup tables or data-dependent branches, so its timing does not
+// depend on the key or data.  The S-box circuit is from Joan Boyar and René
+// Peralta, "A small depth-16 circuit for the AES S-box" (2011).
 //
 
 #include "pdfio-private.h"
-
-
-//
-// Local types...
-//
-
-typedef uint8_t state_t[4][4];		// 4x4 AES state table @private@
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  include <cpuid.h>
+#  include <immintrin.h>
+#  define _PDFIO_AESNI	1		// Use AES-NI instructions
+#  define _PDFIO_AESNI_TARGET __attribute__((target("aes,sse2")))
+#  if (defined(__clang__) && __clang_major__ >= 6) || (!defined(__clang__) && __GNUC__ >= 8)
+#    define _PDFIO_VAES	1		// Use VAES instructions
+#    define _PDFIO_VAES_TARGET __attribute__((target("aes,avx2,vaes")))
+#  endif // __clang__ || __GNUC__ >= 8
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h>
+#  include <wmmintrin.h>
+#  define _PDFIO_AESNI	1		// Use AES-NI instructions
+#  define _PDFIO_AESNI_TARGET
+#endif // (__x86_64__ || __i386__) && (__GNUC__ || __clang__)
+#ifndef _WIN32
+#  include <pthread.h>
+#endif // !_WIN32
 
 
 //
 // Local globals...
 //
 
-static const uint8_t sbox[256] =	// S-box lookup table
-{
-  //0     1    2      3     4    5     6     7      8    9     A      B    C     D     E     F
-  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
-  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
-  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
-  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
-  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
-  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
-  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
-  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
-  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
-  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
-  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
-  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
-  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
-  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
-  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
-  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
-};
-static const uint8_t rsbox[256] =	// Reverse S-box lookup table
-{
-  0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
-  0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
-  0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
-  0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
-  0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
-  0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
-  0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
-  0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
-  0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
-  0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
-  0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
-  0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
-  0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
-  0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
-  0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
-  0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
-};
-
 // The round constant word array, Rcon[i], contains the values given by
 // x to the power (i-1) being powers of x (x is denoted as {02}) in the field GF(2^8)
 static const uint8_t Rcon[11] =		// Round constants
@@ -71,23 +44,52 @@ static const uint8_t Rcon[11] =		// Round constants
   0x8d, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
 };
 
+static int	aes_accel = -1;		// Acceleration override, -1 for none
+static _pdfio_aes_accel_t aes_supported = _PDFIO_AES_ACCEL_NONE;
+					// Acceleration supported by the CPU
+#ifdef _WIN32
+static INIT_ONCE aes_once = INIT_ONCE_STATIC_INIT;
+					// Supported acceleration initialization
+#else
+static pthread_once_t aes_once = PTHREAD_ONCE_INIT;
+					// Supported acceleration initialization
+#endif // _WIN32
+
 
 //
 // Local functions...
 //
 
-static void	AddRoundKey(size_t round, state_t *state, const uint8_t *RoundKey);
-static void	SubBytes(state_t *state);
-static void	ShiftRows(state_t *state);
-static uint8_t	xtime(uint8_t x);
-static void	MixColumns(state_t *state);
-static uint8_t	Multiply(uint8_t x, uint8_t y);
-static void	InvMixColumns(state_t *state);
-static void	InvSubBytes(state_t *state);
-static void	InvShiftRows(state_t *state);
-static void	Cipher(state_t *state, const _pdfio_aes_t *ctx);
-static void	InvCipher(state_t *state, const _pdfio_aes_t *ctx);
-static void	XorWithIv(uint8_t *buf, const uint8_t *Iv);
+#ifdef _PDFIO_AESNI
+static size_t	aesni_decrypt(_pdfio_aes_t *ctx, uint8_t *outbuffer, const uint8_t *inbuffer, size_t len);
+static size_t	aesni_encrypt(_pdfio_aes_t *ctx, uint8_t *outbuffer, const uint8_t *inbuffer, size_t len);
+static void	aesni_init(_pdfio_aes_t *ctx);
+#endif // _PDFIO_AESNI
+static void	bitslice_add_key(uint64_t q[8], const uint64_t *key);
+static void	bitslice_decrypt(const _pdfio_aes_t *ctx, uint64_t q[8]);
+static void	bitslice_encrypt(const _pdfio_aes_t *ctx, uint64_t q[8]);
+static void	bitslice_inv_affine(uint64_t q[8]);
+static void	bitslice_inv_mix_columns(uint64_t q[8]);
+static void	bitslice_inv_sbox(uint64_t q[8]);
+static void	bitslice_inv_shift_rows(uint64_t q[8]);
+static void	bitslice_load(uint64_t q[8], const uint8_t *in);
+static void	bitslice_mix_columns(uint64_t q[8]);
+static uint64_t	bitslice_rotate(uint64_t x, int s);
+static void	bitslice_sbox(uint64_t q[8]);
+static void	bitslice_shift_rows(uint64_t q[8]);
+static void	bitslice_store(uint8_t *out, const uint64_t q[8]);
+static uint64_t	bitslice_transpose(uint64_t x);
+static void	bitslice_xtime(uint64_t q[8]);
+#ifdef _WIN32
+static BOOL CALLBACK detect_accel(PINIT_ONCE once, PVOID param, PVOID *context);
+#else
+static void	detect_accel(void);
+#endif // _WIN32
+static _pdfio_aes_accel_t get_accel(void);
+static void	sub_word(uint8_t w[4]);
+#ifdef _PDFIO_VAES
+static size_t	vaes_decrypt(_pdfio_aes_t *ctx, uint8_t *outbuffer, const uint8_t *inbuffer, size_t len);
+#endif // _PDFIO_VAES
 
 
 //
@@ -105,7 +107,8 @@ _pdfioCryptoAESInit(
   uint8_t	*rkptr0,		// Previous round_key values
 		*rkptr,			// Current round_key values
 		*rkend,			// End of round_key values
-		tempa[4];		// Used for the column/row operations
+		tempa[4],		// Used for the column/row operations
+		block[64];		// Round key for each bitsliced block
 //  size_t	roundlen = keylen + 24;	// Length of round_key
   size_t	nwords = keylen / 4;	// Number of 32-bit words in key
 
@@ -124,18 +127,23 @@ _pdfioCryptoAESInit(
     {
       // Shifts word left once - [a0,a1,a2,a3] becomes [a1,a2,a3,a0], then
       // apply the S-box to each of the four bytes to produce an output word.
-      tempa[0] = sbox[rkptr[-3]] ^ Rcon[i / nwords];
-      tempa[1] = sbox[rkptr[-2]];
-      tempa[2] = sbox[rkptr[-1]];
-      tempa[3] = sbox[rkptr[-4]];
+      tempa[0] = rkptr[-3];
+      tempa[1] = rkptr[-2];
+      tempa[2] = rkptr[-1];
+      tempa[3] = rkptr[-4];
+
+      sub_word(tempa);
+      tempa[0] ^= Rcon[i / nwords];
     }
     else if (keylen == 32 && (i % nwords) == 4)
     {
       // Apply the S-box to each of the four bytes to produce an output word.
-      tempa[0] = sbox[rkptr[-4]];
-      tempa[1] = sbox[rkptr[-3]];
-      tempa[2] = sbox[rkptr[-2]];
-      tempa[3] = sbox[rkptr[-1]];
+      tempa[0] = rkptr[-4];
+      tempa[1] = rkptr[-3];
+      tempa[2] = rkptr[-2];
+      tempa[3] = rkptr[-1];
+
+      sub_word(tempa);
     }
     else
     {
@@ -146,7 +154,7 @@ _pdfioCryptoAESInit(
       tempa[3] = rkptr[-1];
     }
 
-    // TODO: Optimize to incorporate this into previous steps
+    // XOR with the word from the previous round key...
     *rkptr++ = *rkptr0++ ^ tempa[0];
     *rkptr++ = *rkptr0++ ^ tempa[1];
     *rkptr++ = *rkptr0++ ^ tempa[2];
@@ -156,6 +164,26 @@ _pdfioCryptoAESInit(
   // Copy the initialization vector...
   if (iv)
     memcpy(ctx->iv, iv, sizeof(ctx->iv));
+
+  // Prepare the decryption round keys for AES-NI/VAES or the bitsliced round
+  // keys as needed...
+  ctx->accel = aes_accel < 0 ? get_accel() : (_pdfio_aes_accel_t)aes_accel;
+
+#ifdef _PDFIO_AESNI
+  if (ctx->accel != _PDFIO_AES_ACCEL_NONE)
+  {
+    aesni_init(ctx);
+    return;
+  }
+#endif // _PDFIO_AESNI
+
+  for (i = 0; i <= ctx->round_size; i ++)
+  {
+    memcpy(block, ctx->round_key + 16 * i, 16);
+    memcpy(block + 16, block, 16);
+    memcpy(block + 32, block, 32);
+    bitslice_load(ctx->sliced_key + 8 * i, block);
+  }
 }
 
 
@@ -165,6 +193,8 @@ _pdfioCryptoAESInit(
 // "inbuffer" and "outbuffer" can point to the same memory.  Length must be a
 // multiple of 16 bytes (excess is not decrypted).
 //
+// AES-NI or VAES instructions are used when the CPU supports them.
+//
 
 size_t					// O - Number of bytes in output buffer
 _pdfioCryptoAESDecrypt(
@@ -173,27 +203,49 @@ _pdfioCryptoAESDecrypt(
     const uint8_t *inbuffer,		// I - Input buffer
     size_t        len)			// I - Number of bytes to decrypt
 {
-  uint8_t	next_iv[16];		// Next IV value
-  size_t	outbytes = 0;		// Output bytes
+  size_t	i,			// Looping var
+		count,			// Bytes in current blocks
+		outbytes = 0;		// Output bytes
+  uint64_t	q[8];			// Bitsliced blocks
+  uint8_t	block[64],		// Current blocks
+		next_iv[16];		// IV for the next blocks
+
+
+#ifdef _PDFIO_VAES
+  if (ctx->accel == _PDFIO_AES_ACCEL_VAES)
+    return (vaes_decrypt(ctx, outbuffer, inbuffer, len));
+#endif // _PDFIO_VAES
+
+#ifdef _PDFIO_AESNI
+  if (ctx->accel != _PDFIO_AES_ACCEL_NONE)
+    return (aesni_decrypt(ctx, outbuffer, inbuffer, len));
+#endif // _PDFIO_AESNI
+
+  // CBC decryption does not depend on the previous plaintext, so up to four
+  // blocks are decrypted at once...
+  while (len > 15)
+  {
+    count = len > sizeof(block) ? sizeof(block) : len & (size_t)~15;
 
+    memcpy(block, inbuffer, count);
+    memcpy(next_iv, inbuffer + count - 16, 16);
 
-  if (inbuffer != outbuffer)
-  {
-    // Not the most efficient, but we can optimize later - the sample AES code
-    // manipulates the data directly in memory and doesn't support separate
-    // input and output buffers...
-    memcpy(outbuffer, inbuffer, len);
-  }
+    bitslice_load(q, block);
+    bitslice_decrypt(ctx, q);
+    bitslice_store(block, q);
 
-  while (len > 15)
-  {
-    memcpy(next_iv, outbuffer, 16);
-    InvCipher((state_t *)outbuffer, ctx);
-    XorWithIv(outbuffer, ctx->iv);
+    for (i = 0; i < 16; i ++)
+      block[i] ^= ctx->iv[i];
+    for (; i < count; i ++)
+      block[i] ^= inbuffer[i - 16];
+
+    memcpy(outbuffer, block, count);
     memcpy(ctx->iv, next_iv, 16);
-    outbuffer += 16;
-    len -= 16;
-    outbytes += 16;
+
+    inbuffer  += count;
+    outbuffer += count;
+    len       -= count;
+    outbytes  += count;
   }
 
   return (outbytes);
@@ -214,306 +266,909 @@ _pdfioCryptoAESEncrypt(
     const uint8_t *inbuffer,		// I - Input buffer
     size_t        len)			// I - Number of bytes to decrypt
 {
+  size_t	i;			// Looping var
   uint8_t	*iv = ctx->iv;		// Current IV for CBC
   size_t	outbytes = 0;		// Output bytes
+  uint64_t	q[8];			// Bitsliced block
+  uint8_t	block[64];		// Current block
 
 
   if (len == 0)
     return (0);
 
-  if (inbuffer != outbuffer)
-  {
-    // Not the most efficient, but we can optimize later - the sample AES code
-    // manipulates the data directly in memory and doesn't support separate
-    // input and output buffers...
-    memcpy(outbuffer, inbuffer, len);
-  }
+#ifdef _PDFIO_AESNI
+  if (ctx->accel != _PDFIO_AES_ACCEL_NONE)
+    return (aesni_encrypt(ctx, outbuffer, inbuffer, len));
+#endif // _PDFIO_AESNI
 
-  while (len > 15)
+  // CBC encryption depends on the previous ciphertext, so only the first of
+  // the four bitsliced blocks is used...
+  memset(block, 0, sizeof(block));
+
+  while (len > 0)
   {
-    XorWithIv(outbuffer, iv);
-    Cipher((state_t*)outbuffer, ctx);
+    if (len > 15)
+    {
+      for (i = 0; i < 16; i ++)
+        block[i] = inbuffer[i] ^ iv[i];
+    }
+    else
+    {
+      // Pad the final buffer with (16 - len)...
+      for (i = 0; i < len; i ++)
+        block[i] = inbuffer[i] ^ iv[i];
+      for (; i < 16; i ++)
+        block[i] = (uint8_t)(16 - len) ^ iv[i];
+    }
+
+    bitslice_load(q, block);
+    bitslice_encrypt(ctx, q);
+    bitslice_store(block, q);
+
+    memcpy(outbuffer, block, 16);
     iv = outbuffer;
+
+    if (len > 15)
+    {
+      inbuffer += 16;
+      len      -= 16;
+    }
+    else
+      len = 0;
+
     outbuffer += 16;
-    len -= 16;
-    outbytes += 16;
+    outbytes  += 16;
   }
 
-  if (len > 0)
+  /* store Iv in ctx for next call */
+  memcpy(ctx->iv, iv, 16);
+
+  return (outbytes);
+}
+
+
+//
+// '_pdfioCryptoAESSetAccel()' - Set the AES acceleration to use.
+//
+// The acceleration is limited to what the CPU supports and applies to contexts
+// that are initialized afterwards.  This is used by the unit tests to compare
+// the portable and accelerated code and must not be called while other threads
+// are initializing AES contexts.
+//
+
+_pdfio_aes_accel_t			// O - Acceleration that will be used
+_pdfioCryptoAESSetAccel(
+    _pdfio_aes_accel_t accel)		// I - Requested acceleration
+{
+  _pdfio_aes_accel_t supported = get_accel();
+					// Supported acceleration
+
+
+  if (accel > supported)
+    accel = supported;
+
+  aes_accel = (int)accel;
+
+  return (accel);
+}
+
+
+#ifdef _PDFIO_AESNI
+//
+// 'aesni_decrypt()' - Decrypt blocks with AES-NI instructions.
+//
+// CBC decryption does not depend on the previous plaintext, so eight blocks
+// are decrypted at a time to keep the AES unit busy.
+//
+
+_PDFIO_AESNI_TARGET
+static size_t				// O - Number of bytes in output buffer
+aesni_decrypt(
+    _pdfio_aes_t  *ctx,			// I - AES context
+    uint8_t       *outbuffer,		// I - Output buffer
+    const uint8_t *inbuffer,		// I - Input buffer
+    size_t        len)			// I - Number of bytes to decrypt
+{
+  size_t	i,			// Looping var
+		round,			// Current round
+		nrounds = ctx->round_size,
+					// Number of rounds
+		outbytes = len & (size_t)~15;
+					// Output bytes
+  __m128i	keys[15],		// Decryption round keys
+		iv,			// Current IV
+		c[8],			// Ciphertext blocks
+		b[8];			// Decrypted blocks
+
+
+  for (round = 0; round <= nrounds; round ++)
+    keys[round] = _mm_loadu_si128((const __m128i *)(ctx->inv_round_key + 16 * round));
+
+  iv = _mm_loadu_si128((const __m128i *)ctx->iv);
+
+  for (; len >= 128; inbuffer += 128, outbuffer += 128, len -= 128)
   {
-    // Pad the final buffer with (16 - len)...
-    memset(outbuffer + len, 16 - len, 16 - len);
+    for (i = 0; i < 8; i ++)
+    {
+      c[i] = _mm_loadu_si128((const __m128i *)(inbuffer + 16 * i));
+      b[i] = _mm_xor_si128(c[i], keys[0]);
+    }
 
-    XorWithIv(outbuffer, iv);
-    Cipher((state_t*)outbuffer, ctx);
-    iv = outbuffer;
-    outbytes += 16;
+    for (round = 1; round < nrounds; round ++)
+    {
+      for (i = 0; i < 8; i ++)
+        b[i] = _mm_aesdec_si128(b[i], keys[round]);
+    }
+
+    for (i = 0; i < 8; i ++)
+      b[i] = _mm_aesdeclast_si128(b[i], keys[nrounds]);
+
+    _mm_storeu_si128((__m128i *)outbuffer, _mm_xor_si128(b[0], iv));
+    for (i = 1; i < 8; i ++)
+      _mm_storeu_si128((__m128i *)(outbuffer + 16 * i), _mm_xor_si128(b[i], c[i - 1]));
+
+    iv = c[7];
   }
 
-  /* store Iv in ctx for next call */
-  memcpy(ctx->iv, iv, 16);
+  for (; len >= 16; inbuffer += 16, outbuffer += 16, len -= 16)
+  {
+    c[0] = _mm_loadu_si128((const __m128i *)inbuffer);
+    b[0] = _mm_xor_si128(c[0], keys[0]);
+
+    for (round = 1; round < nrounds; round ++)
+      b[0] = _mm_aesdec_si128(b[0], keys[round]);
+
+    b[0] = _mm_aesdeclast_si128(b[0], keys[nrounds]);
+
+    _mm_storeu_si128((__m128i *)outbuffer, _mm_xor_si128(b[0], iv));
+
+    iv = c[0];
+  }
+
+  _mm_storeu_si128((__m128i *)ctx->iv, iv);
 
   return (outbytes);
 }
 
 
-// This function adds the round key to state.
-// The round key is added to the state by an XOR function.
-static void
-AddRoundKey(size_t round, state_t *state, const uint8_t *RoundKey)
+//
+// 'aesni_encrypt()' - Encrypt blocks with AES-NI instructions.
+//
+
+_PDFIO_AESNI_TARGET
+static size_t				// O - Number of bytes in output buffer
+aesni_encrypt(
+    _pdfio_aes_t  *ctx,			// I - AES context
+    uint8_t       *outbuffer,		// I - Output buffer
+    const uint8_t *inbuffer,		// I - Input buffer
+    size_t        len)			// I - Number of bytes to encrypt
 {
-  unsigned	i;			// Looping var
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
+  size_t	round,			// Current round
+		nrounds = ctx->round_size,
+					// Number of rounds
+		outbytes = 0;		// Output bytes
+  __m128i	keys[15],		// Encryption round keys
+		b;			// Current block
+  uint8_t	temp[16];		// Padded final block
+
+
+  for (round = 0; round <= nrounds; round ++)
+    keys[round] = _mm_loadu_si128((const __m128i *)(ctx->round_key + 16 * round));
+
+  b = _mm_loadu_si128((const __m128i *)ctx->iv);
+
+  while (len > 0)
+  {
+    if (len < 16)
+    {
+      // Pad the final buffer with (16 - len)...
+      memcpy(temp, inbuffer, len);
+      memset(temp + len, (int)(16 - len), 16 - len);
+      inbuffer = temp;
+      len      = 16;
+    }
+
+    b = _mm_xor_si128(b, _mm_loadu_si128((const __m128i *)inbuffer));
+    b = _mm_xor_si128(b, keys[0]);
+
+    for (round = 1; round < nrounds; round ++)
+      b = _mm_aesenc_si128(b, keys[round]);
+
+    b = _mm_aesenclast_si128(b, keys[nrounds]);
 
+    _mm_storeu_si128((__m128i *)outbuffer, b);
 
-  for (RoundKey += round * 16, i = 16; i > 0; i --, sptr ++, RoundKey ++)
-    *sptr ^= *RoundKey;
+    inbuffer  += 16;
+    outbuffer += 16;
+    len       -= 16;
+    outbytes  += 16;
+  }
+
+  _mm_storeu_si128((__m128i *)ctx->iv, b);
+
+  return (outbytes);
 }
 
 
-// The SubBytes Function Substitutes the values in the
-// state matrix with values in an S-box.
+//
+// 'aesni_init()' - Compute the decryption round keys for AES-NI.
+//
+// AES-NI uses the "equivalent inverse cipher", which needs the encryption
+// round keys in reverse order with InvMixColumns applied to the middle ones.
+//
+
+_PDFIO_AESNI_TARGET
 static void
-SubBytes(state_t *state)
+aesni_init(_pdfio_aes_t *ctx)		// I - AES context
 {
-  unsigned	i;			// Looping var
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
+  size_t	round,			// Current round
+		nrounds = ctx->round_size;
+					// Number of rounds
+  __m128i	key;			// Current round key
+
 
+  for (round = 0; round <= nrounds; round ++)
+  {
+    key = _mm_loadu_si128((const __m128i *)(ctx->round_key + 16 * (nrounds - round)));
+
+    if (round > 0 && round < nrounds)
+      key = _mm_aesimc_si128(key);
 
-  for (i = 16; i > 0; i --, sptr ++)
-    *sptr = sbox[*sptr];
+    _mm_storeu_si128((__m128i *)(ctx->inv_round_key + 16 * round), key);
+  }
 }
+#endif // _PDFIO_AESNI
+
+
+//
+// 'bitslice_add_key()' - Add (XOR) a bitsliced round key to the state.
+//
 
-// The ShiftRows() function shifts the rows in the state to the left.
-// Each row is shifted with different offset.
-// Offset = Row number. So the first row is not shifted.
 static void
-ShiftRows(state_t *state)
+bitslice_add_key(uint64_t       q[8],	// IO - Bitsliced state
+                 const uint64_t *key)	// I  - Bitsliced round key
 {
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
-  uint8_t	temp;			// Temporary value
-
-
-  // Rotate first row 1 columns to left
-  temp     = sptr[1];
-  sptr[1]  = sptr[5];
-  sptr[5]  = sptr[9];
-  sptr[9]  = sptr[13];
-  sptr[13] = temp;
-
-  // Rotate second row 2 columns to left
-  temp     = sptr[2];
-  sptr[2]  = sptr[10];
-  sptr[10] = temp;
-
-  temp     = sptr[6];
-  sptr[6]  = sptr[14];
-  sptr[14] = temp;
-
-  // Rotate third row 3 columns to left
-  temp     = sptr[3];
-  sptr[3]  = sptr[15];
-  sptr[15] = sptr[11];
-  sptr[11] = sptr[7];
-  sptr[7]  = temp;
+  size_t	k;			// Looping var
+
+
+  for (k = 0; k < 8; k ++)
+    q[k] ^= key[k];
 }
 
 
-static uint8_t
-xtime(uint8_t x)
+//
+// 'bitslice_decrypt()' - Decrypt four bitsliced blocks.
+//
+// ShiftRows and SubBytes operate on different parts of each byte, so the
+// usual order of the inverse operations does not matter.
+//
+
+static void
+bitslice_decrypt(
+    const _pdfio_aes_t *ctx,		// I  - AES context
+    uint64_t           q[8])		// IO - Bitsliced state
 {
-  return ((uint8_t)((x << 1) ^ ((x >> 7) * 0x1b)));
+  size_t	round;			// Current round
+
+
+  bitslice_add_key(q, ctx->sliced_key + 8 * ctx->round_size);
+
+  for (round = ctx->round_size - 1; round > 0; round --)
+  {
+    bitslice_inv_shift_rows(q);
+    bitslice_inv_sbox(q);
+    bitslice_add_key(q, ctx->sliced_key + 8 * round);
+    bitslice_inv_mix_columns(q);
+  }
+
+  bitslice_inv_shift_rows(q);
+  bitslice_inv_sbox(q);
+  bitslice_add_key(q, ctx->sliced_key);
 }
 
 
-// MixColumns function mixes the columns of the state matrix
+//
+// 'bitslice_encrypt()' - Encrypt four bitsliced blocks.
+//
+
 static void
-MixColumns(state_t *state)
+bitslice_encrypt(
+    const _pdfio_aes_t *ctx,		// I  - AES context
+    uint64_t           q[8])		// IO - Bitsliced state
 {
-  unsigned	i;			// Looping var
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
-  uint8_t	Tmp, Tm, t;		// Temporary values
+  size_t	round;			// Current round
+
+
+  bitslice_add_key(q, ctx->sliced_key);
 
-  for (i = 4; i > 0; i --, sptr += 4)
+  for (round = 1; round < ctx->round_size; round ++)
   {
-    t       = sptr[0];
-    Tmp     = sptr[0] ^ sptr[1] ^ sptr[2] ^ sptr[3];
-    Tm      = sptr[0] ^ sptr[1];
-    Tm      = xtime(Tm);
-    sptr[0] ^= Tm ^ Tmp;
-
-    Tm      = sptr[1] ^ sptr[2];
-    Tm      = xtime(Tm);
-    sptr[1] ^= Tm ^ Tmp;
-
-    Tm      = sptr[2] ^ sptr[3];
-    Tm      = xtime(Tm);
-    sptr[2] ^= Tm ^ Tmp;
-
-    Tm      = sptr[3] ^ t;
-    Tm      = xtime(Tm);
-    sptr[3] ^= Tm ^ Tmp;
+    bitslice_sbox(q);
+    bitslice_shift_rows(q);
+    bitslice_mix_columns(q);
+    bitslice_add_key(q, ctx->sliced_key + 8 * round);
   }
+
+  bitslice_sbox(q);
+  bitslice_shift_rows(q);
+  bitslice_add_key(q, ctx->sliced_key + 8 * ctx->round_size);
 }
 
 
-// Multiply is used to multiply numbers in the field GF(2^8)
-// Note: The last call to xtime() is unneeded, but often ends up generating a smaller binary
-//       The compiler seems to be able to vectorize the operation better this way.
-//       See https://github.com/kokke/tiny-AES-c/pull/34
-static uint8_t Multiply(uint8_t x, uint8_t y)
+//
+// 'bitslice_inv_affine()' - Apply the inverse of the S-box affine transform.
+//
+
+static void
+bitslice_inv_affine(uint64_t q[8])	// IO - Bitsliced state
+{
+  uint64_t	q0 = ~q[0],		// Bits of (byte ^ 0x63)
+		q1 = ~q[1],
+		q2 = q[2],
+		q3 = q[3],
+		q4 = q[4],
+		q5 = ~q[5],
+		q6 = ~q[6],
+		q7 = q[7];
+
+
+  q[0] = q2 ^ q5 ^ q7;
+  q[1] = q3 ^ q6 ^ q0;
+  q[2] = q4 ^ q7 ^ q1;
+  q[3] = q5 ^ q0 ^ q2;
+  q[4] = q6 ^ q1 ^ q3;
+  q[5] = q7 ^ q2 ^ q4;
+  q[6] = q0 ^ q3 ^ q5;
+  q[7] = q1 ^ q4 ^ q6;
+}
+
+
+//
+// 'bitslice_inv_mix_columns()' - Apply the InvMixColumns transform.
+//
+// InvMixColumns is MixColumns after multiplying each pair of opposite bytes in
+// a column by {04}.
+//
+
+static void
+bitslice_inv_mix_columns(uint64_t q[8])	// IO - Bitsliced state
 {
-  return (((y & 1) * x) ^
-	  ((y>>1 & 1) * xtime(x)) ^
-	  ((y>>2 & 1) * xtime(xtime(x))) ^
-	  ((y>>3 & 1) * xtime(xtime(xtime(x)))) ^
-	  ((y>>4 & 1) * xtime(xtime(xtime(xtime(x)))))); /* this last call to xtime() can be omitted */
+  size_t	k;			// Looping var
+  uint64_t	t[8];			// Opposite bytes times {04}
+
+
+  for (k = 0; k < 8; k ++)
+    t[k] = q[k] ^ ((q[k] >> 2) & 0x3333333333333333) ^ ((q[k] << 2) & 0xcccccccccccccccc);
+
+  bitslice_xtime(t);
+  bitslice_xtime(t);
+
+  for (k = 0; k < 8; k ++)
+    q[k] ^= t[k];
+
+  bitslice_mix_columns(q);
 }
 
 
-// MixColumns function mixes the columns of the state matrix.
-// The method used to multiply may be difficult to understand for the inexperienced.
-// Please use the references to gain more information.
+//
+// 'bitslice_inv_sbox()' - Apply the inverse S-box.
+//
+// The inverse S-box is the forward S-box between two inverse affine
+// transforms.
+//
+
+static void
+bitslice_inv_sbox(uint64_t q[8])	// IO - Bitsliced state
+{
+  bitslice_inv_affine(q);
+  bitslice_sbox(q);
+  bitslice_inv_affine(q);
+}
+
+
+//
+// 'bitslice_inv_shift_rows()' - Apply the InvShiftRows transform.
+//
+
+static void
+bitslice_inv_shift_rows(uint64_t q[8])	// IO - Bitsliced state
+{
+  size_t	k;			// Looping var
+
+
+  for (k = 0; k < 8; k ++)
+    q[k] = (q[k] & 0x1111111111111111) | bitslice_rotate(q[k] & 0x2222222222222222, 12) | bitslice_rotate(q[k] & 0x4444444444444444, 8) | bitslice_rotate(q[k] & 0x8888888888888888, 4);
+}
+
+
+//
+// 'bitslice_load()' - Load four 16-byte blocks into a bitsliced state.
+//
+// Bit "16 * b + i" of "q[k]" is bit "k" of byte "i" of block "b".
+//
+
 static void
-InvMixColumns(state_t *state)
+bitslice_load(uint64_t      q[8],	// O - Bitsliced state
+              const uint8_t *in)	// I - 64 bytes of input
 {
-  unsigned	i;			// Looping var
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
-  uint8_t	a, b, c, d;		// Temporary values
+  size_t	j, k;			// Looping vars
+  uint64_t	w;			// Current word
 
 
-  for (i = 4; i > 0; i --)
+  memset(q, 0, 8 * sizeof(uint64_t));
+
+  for (j = 0; j < 8; j ++, in += 8)
   {
-    a = sptr[0];
-    b = sptr[1];
-    c = sptr[2];
-    d = sptr[3];
-
-    *sptr++ = Multiply(a, 0x0e) ^ Multiply(b, 0x0b) ^ Multiply(c, 0x0d) ^ Multiply(d, 0x09);
-    *sptr++ = Multiply(a, 0x09) ^ Multiply(b, 0x0e) ^ Multiply(c, 0x0b) ^ Multiply(d, 0x0d);
-    *sptr++ = Multiply(a, 0x0d) ^ Multiply(b, 0x09) ^ Multiply(c, 0x0e) ^ Multiply(d, 0x0b);
-    *sptr++ = Multiply(a, 0x0b) ^ Multiply(b, 0x0d) ^ Multiply(c, 0x09) ^ Multiply(d, 0x0e);
+    w = (uint64_t)in[0] | ((uint64_t)in[1] << 8) | ((uint64_t)in[2] << 16) | ((uint64_t)in[3] << 24) | ((uint64_t)in[4] << 32) | ((uint64_t)in[5] << 40) | ((uint64_t)in[6] << 48) | ((uint64_t)in[7] << 56);
+    w = bitslice_transpose(w);
+
+    for (k = 0; k < 8; k ++)
+      q[k] |= ((w >> (8 * k)) & 255) << (8 * j);
   }
 }
 
 
-// The SubBytes Function Substitutes the values in the
-// state matrix with values in an S-box.
+//
+// 'bitslice_mix_columns()' - Apply the MixColumns transform.
+//
+// Each column is a 4-bit group in the bitsliced state, so the byte rotations
+// within a column are bit rotations within each group:
+//
+//   out[r] = {02} * (a[r] ^ a[r+1]) ^ a[r+1] ^ a[r+2] ^ a[r+3]
+//
+
 static void
-InvSubBytes(state_t *state)
+bitslice_mix_columns(uint64_t q[8])	// IO - Bitsliced state
+{
+  size_t	k;			// Looping var
+  uint64_t	r,			// Column rotated by one byte
+		b[8];			// a[r] ^ a[r+1]
+
+
+  for (k = 0; k < 8; k ++)
+  {
+    r    = ((q[k] >> 1) & 0x7777777777777777) | ((q[k] << 3) & 0x8888888888888888);
+    b[k] = q[k] ^ r;
+    q[k] = r ^ ((b[k] >> 2) & 0x3333333333333333) ^ ((b[k] << 2) & 0xcccccccccccccccc);
+  }
+
+  bitslice_xtime(b);
+
+  for (k = 0; k < 8; k ++)
+    q[k] ^= b[k];
+}
+
+
+//
+// 'bitslice_rotate()' - Rotate each 16-bit lane right by "s" bits.
+//
+
+static uint64_t				// O - Rotated lanes
+bitslice_rotate(uint64_t x,		// I - Bitsliced value
+                int      s)		// I - Number of bits (1 to 15)
 {
-  unsigned	i;			// Looping var
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
+  uint64_t	lo = (uint64_t)(0xffff >> s) * 0x0001000100010001;
+					// Bits that stay in the lane
 
 
-  for (i = 16; i > 0; i --, sptr ++)
-    *sptr = rsbox[*sptr];
+  return (((x >> s) & lo) | ((x << (16 - s)) & ~lo));
 }
 
 
+//
+// 'bitslice_sbox()' - Apply the S-box.
+//
+// This is the 113 gate circuit from Joan Boyar and René Peralta, "A small
+// depth-16 circuit for the AES S-box" (2011), so no lookup tables or
+// data-dependent branches are used.
+//
+
 static void
-InvShiftRows(state_t *state)
+bitslice_sbox(uint64_t q[8])		// IO - Bitsliced state
 {
-  uint8_t	*sptr = (*state)[0];	// Pointer into state
-  uint8_t	temp;			// Temporary value
-
-
-  // Rotate first row 1 columns to right
-  temp     = sptr[13];
-  sptr[13] = sptr[9];
-  sptr[9]  = sptr[5];
-  sptr[5]  = sptr[1];
-  sptr[1]  = temp;
-
-  // Rotate second row 2 columns to right
-  temp     = sptr[2];
-  sptr[2]  = sptr[10];
-  sptr[10] = temp;
-
-  temp     = sptr[6];
-  sptr[6]  = sptr[14];
-  sptr[14] = temp;
-
-  // Rotate third row 3 columns to right
-  temp     = sptr[3];
-  sptr[3]  = sptr[7];
-  sptr[7]  = sptr[11];
-  sptr[11] = sptr[15];
-  sptr[15] = temp;
+  uint64_t	x0, x1, x2, x3, x4, x5, x6, x7;
+					// Input bits (x0 is the MSB)
+  uint64_t	y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11, y12, y13, y14, y15, y16, y17, y18, y19, y20, y21;
+					// Top linear transform
+  uint64_t	z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11, z12, z13, z14, z15, z16, z17;
+					// Bottom products
+  uint64_t	t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59, t60, t61, t62, t63, t64, t65, t66, t67;
+					// Temporaries
+
+
+  x0 = q[7];
+  x1 = q[6];
+  x2 = q[5];
+  x3 = q[4];
+  x4 = q[3];
+  x5 = q[2];
+  x6 = q[1];
+  x7 = q[0];
+
+  // Top linear transform...
+  y14 = x3 ^ x5;
+  y13 = x0 ^ x6;
+  y9  = x0 ^ x3;
+  y8  = x0 ^ x5;
+  t0  = x1 ^ x2;
+  y1  = t0 ^ x7;
+  y4  = y1 ^ x3;
+  y12 = y13 ^ y14;
+  y2  = y1 ^ x0;
+  y5  = y1 ^ x6;
+  y3  = y5 ^ y8;
+  t1  = x4 ^ y12;
+  y15 = t1 ^ x5;
+  y20 = t1 ^ x1;
+  y6  = y15 ^ x7;
+  y10 = y15 ^ t0;
+  y11 = y20 ^ y9;
+  y7  = x7 ^ y11;
+  y17 = y10 ^ y11;
+  y19 = y10 ^ y8;
+  y16 = t0 ^ y11;
+  y21 = y13 ^ y16;
+  y18 = x0 ^ y16;
+
+  // Inversion in GF(2^8)...
+  t2  = y12 & y15;
+  t3  = y3 & y6;
+  t4  = t3 ^ t2;
+  t5  = y4 & x7;
+  t6  = t5 ^ t2;
+  t7  = y13 & y16;
+  t8  = y5 & y1;
+  t9  = t8 ^ t7;
+  t10 = y2 & y7;
+  t11 = t10 ^ t7;
+  t12 = y9 & y11;
+  t13 = y14 & y17;
+  t14 = t13 ^ t12;
+  t15 = y8 & y10;
+  t16 = t15 ^ t12;
+  t17 = t4 ^ t14;
+  t18 = t6 ^ t16;
+  t19 = t9 ^ t14;
+  t20 = t11 ^ t16;
+  t21 = t17 ^ y20;
+  t22 = t18 ^ y19;
+  t23 = t19 ^ y21;
+  t24 = t20 ^ y18;
+
+  t25 = t21 ^ t22;
+  t26 = t21 & t23;
+  t27 = t24 ^ t26;
+  t28 = t25 & t27;
+  t29 = t28 ^ t22;
+  t30 = t23 ^ t24;
+  t31 = t22 ^ t26;
+  t32 = t31 & t30;
+  t33 = t32 ^ t24;
+  t34 = t23 ^ t33;
+  t35 = t27 ^ t33;
+  t36 = t24 & t35;
+  t37 = t36 ^ t34;
+  t38 = t27 ^ t36;
+  t39 = t29 & t38;
+  t40 = t25 ^ t39;
+
+  t41 = t40 ^ t37;
+  t42 = t29 ^ t33;
+  t43 = t29 ^ t40;
+  t44 = t33 ^ t37;
+  t45 = t42 ^ t41;
+  z0  = t44 & y15;
+  z1  = t37 & y6;
+  z2  = t33 & x7;
+  z3  = t43 & y16;
+  z4  = t40 & y1;
+  z5  = t29 & y7;
+  z6  = t42 & y11;
+  z7  = t45 & y17;
+  z8  = t41 & y10;
+  z9  = t44 & y12;
+  z10 = t37 & y3;
+  z11 = t33 & y4;
+  z12 = t43 & y13;
+  z13 = t40 & y5;
+  z14 = t29 & y2;
+  z15 = t42 & y9;
+  z16 = t45 & y14;
+  z17 = t41 & y8;
+
+  // Bottom linear transform...
+  t46 = z15 ^ z16;
+  t47 = z10 ^ z11;
+  t48 = z5 ^ z13;
+  t49 = z9 ^ z10;
+  t50 = z2 ^ z12;
+  t51 = z2 ^ z5;
+  t52 = z7 ^ z8;
+  t53 = z0 ^ z3;
+  t54 = z6 ^ z7;
+  t55 = z16 ^ z17;
+  t56 = z12 ^ t48;
+  t57 = t50 ^ t53;
+  t58 = z4 ^ t46;
+  t59 = z3 ^ t54;
+  t60 = t46 ^ t57;
+  t61 = z14 ^ t57;
+  t62 = t52 ^ t58;
+  t63 = t49 ^ t58;
+  t64 = z4 ^ t59;
+  t65 = t61 ^ t62;
+  t66 = z1 ^ t63;
+  t67 = t64 ^ t65;
+
+  q[7] = t59 ^ t63;
+  q[1] = t56 ^ ~t62;
+  q[0] = t48 ^ ~t60;
+  q[4] = t53 ^ t66;
+  q[3] = t51 ^ t66;
+  q[2] = t47 ^ t65;
+  q[6] = t64 ^ ~q[4];
+  q[5] = t55 ^ ~t67;
 }
 
 
-// Cipher is the main function that encrypts the PlainText.
+//
+// 'bitslice_shift_rows()' - Apply the ShiftRows transform.
+//
+// Row "r" of each block is rotated left by "r" bytes, which in the bitsliced
+// state is a rotation of the lane right by "4 * r" bits.
+//
+
 static void
-Cipher(state_t *state, const _pdfio_aes_t *ctx)
+bitslice_shift_rows(uint64_t q[8])	// IO - Bitsliced state
 {
-  size_t round = 0;
+  size_t	k;			// Looping var
 
-  // Add the First round key to the state before starting the rounds.
-  AddRoundKey(0, state, ctx->round_key);
 
-  // There will be Nr rounds.
-  // The first Nr-1 rounds are identical.
-  // These Nr rounds are executed in the loop below.
-  // Last one without MixColumns()
-  for (round = 1; round < ctx->round_size; round ++)
+  for (k = 0; k < 8; k ++)
+    q[k] = (q[k] & 0x1111111111111111) | bitslice_rotate(q[k] & 0x2222222222222222, 4) | bitslice_rotate(q[k] & 0x4444444444444444, 8) | bitslice_rotate(q[k] & 0x8888888888888888, 12);
+}
+
+
+//
+// 'bitslice_store()' - Store a bitsliced state as four 16-byte blocks.
+//
+
+static void
+bitslice_store(uint8_t        *out,	// O - 64 bytes of output
+               const uint64_t q[8])	// I - Bitsliced state
+{
+  size_t	j, k;			// Looping vars
+  uint64_t	w;			// Current word
+
+
+  for (j = 0; j < 8; j ++, out += 8)
   {
-    SubBytes(state);
-    ShiftRows(state);
-    MixColumns(state);
-    AddRoundKey(round, state, ctx->round_key);
+    for (w = 0, k = 0; k < 8; k ++)
+      w |= ((q[k] >> (8 * j)) & 255) << (8 * k);
+
+    w = bitslice_transpose(w);
+
+    out[0] = (uint8_t)w;
+    out[1] = (uint8_t)(w >> 8);
+    out[2] = (uint8_t)(w >> 16);
+    out[3] = (uint8_t)(w >> 24);
+    out[4] = (uint8_t)(w >> 32);
+    out[5] = (uint8_t)(w >> 40);
+    out[6] = (uint8_t)(w >> 48);
+    out[7] = (uint8_t)(w >> 56);
   }
-  // Add round key to last round
-  SubBytes(state);
-  ShiftRows(state);
-  AddRoundKey(ctx->round_size, state, ctx->round_key);
 }
 
 
+//
+// 'bitslice_transpose()' - Transpose an 8x8 bit matrix.
+//
+// Bit "j" of byte "k" in the result is bit "k" of byte "j" in the input.
+//
+
+static uint64_t				// O - Transposed matrix
+bitslice_transpose(uint64_t x)		// I - Matrix
+{
+  uint64_t	t;			// Swapped bits
+
+
+  t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aa;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000cccc0000cccc;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0;
+  x ^= t ^ (t << 28);
+
+  return (x);
+}
+
+
+//
+// 'bitslice_xtime()' - Multiply each byte by {02} in GF(2^8).
+//
+
 static void
-InvCipher(state_t *state, const _pdfio_aes_t *ctx)
+bitslice_xtime(uint64_t q[8])		// IO - Bitsliced state
 {
-  size_t round;
+  uint64_t	hi = q[7];		// High bit of each byte
+
+
+  q[7] = q[6];
+  q[6] = q[5];
+  q[5] = q[4];
+  q[4] = q[3] ^ hi;
+  q[3] = q[2] ^ hi;
+  q[2] = q[1];
+  q[1] = q[0] ^ hi;
+  q[0] = hi;
+}
+
 
-  // Add the First round key to the state before starting the rounds.
-  AddRoundKey(ctx->round_size, state, ctx->round_key);
 
-  // There will be Nr rounds.
-  // The first Nr-1 rounds are identical.
-  // These Nr rounds are executed in the loop below.
-  // Last one without InvMixColumn()
-  for (round = ctx->round_size - 1; ; round --)
+//
+// 'detect_accel()' - Detect the best AES acceleration supported by the CPU.
+//
+
+#ifdef _WIN32
+static BOOL CALLBACK			// O - `TRUE` to continue
+detect_accel(PINIT_ONCE once,		// I - Initialization state (unused)
+             PVOID      param,		// I - Parameter (unused)
+             PVOID      *context)	// O - Context (unused)
+#else
+static void
+detect_accel(void)
+#endif // _WIN32
+{
+  _pdfio_aes_accel_t accel = _PDFIO_AES_ACCEL_NONE;
+					// Acceleration
+#if defined(_PDFIO_AESNI) && defined(_MSC_VER)
+  int		regs[4];		// CPUID registers
+
+
+  __cpuid(regs, 1);
+  if (regs[2] & (1 << 25))
+    accel = _PDFIO_AES_ACCEL_AESNI;
+
+#elif defined(_PDFIO_AESNI)
+  unsigned	eax, ebx, ecx, edx;	// CPUID registers
+
+
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES))
   {
-    InvShiftRows(state);
-    InvSubBytes(state);
-    AddRoundKey(round, state, ctx->round_key);
+    accel = _PDFIO_AES_ACCEL_AESNI;
+
+#  ifdef _PDFIO_VAES
+    // VAES needs AVX2 and the OS saving the YMM registers...
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) && __get_cpuid_max(0, NULL) >= 7)
+    {
+      unsigned xcr0, xcr0_hi;		// Extended control register
 
-    if (round == 0)
-      break;
+      __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
 
-    InvMixColumns(state);
+      if ((xcr0 & 6) == 6 && (ebx & bit_AVX2) && (ecx & (1 << 9)))
+        accel = _PDFIO_AES_ACCEL_VAES;
+    }
+#  endif // _PDFIO_VAES
   }
+#endif // _PDFIO_AESNI && _MSC_VER
+
+  aes_supported = accel;
+
+#ifdef _WIN32
+  (void)once;
+  (void)param;
+  (void)context;
+
+  return (TRUE);
+#endif // _WIN32
+}
+
+
+//
+// 'get_accel()' - Get the best AES acceleration supported by the CPU.
+//
+
+static _pdfio_aes_accel_t		// O - Acceleration
+get_accel(void)
+{
+#ifdef _WIN32
+  InitOnceExecuteOnce(&aes_once, detect_accel, NULL, NULL);
+#else
+  pthread_once(&aes_once, detect_accel);
+#endif // _WIN32
+
+  return (aes_supported);
 }
 
 
+
+//
+// 'sub_word()' - Apply the S-box to a key schedule word.
+//
+
 static void
-XorWithIv(uint8_t *buf, const uint8_t *Iv)
+sub_word(uint8_t w[4])			// IO - Word
 {
-  // 16-byte block...
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
-  *buf++ ^= *Iv++;
+  uint64_t	q[8];			// Bitsliced word
+  uint8_t	block[64];		// Block containing the word
+
+
+  memset(block, 0, sizeof(block));
+  memcpy(block, w, 4);
+
+  bitslice_load(q, block);
+  bitslice_sbox(q);
+  bitslice_store(block, q);
+
+  memcpy(w, block, 4);
+}
+
+#ifdef _PDFIO_VAES
+//
+// 'vaes_decrypt()' - Decrypt blocks with VAES instructions.
+//
+// Each 256-bit register holds two blocks, and eight registers (16 blocks) are
+// decrypted at a time.  The previous ciphertext blocks for the CBC chaining are
+// loaded from the input buffer 16 bytes behind the current blocks, so all of
+// the loads are done before any stores for in-place decryption.  Any remaining
+// blocks are decrypted with AES-NI.
+//
+
+_PDFIO_VAES_TARGET
+static size_t				// O - Number of bytes in output buffer
+vaes_decrypt(
+    _pdfio_aes_t  *ctx,			// I - AES context
+    uint8_t       *outbuffer,		// I - Output buffer
+    const uint8_t *inbuffer,		// I - Input buffer
+    size_t        len)			// I - Number of bytes to decrypt
+{
+  size_t	i,			// Looping var
+		round,			// Current round
+		nrounds = ctx->round_size,
+					// Number of rounds
+		outbytes = 0;		// Output bytes
+  __m256i	keys[15],		// Decryption round keys
+		c[8],			// Ciphertext blocks
+		p[8],			// Previous ciphertext blocks
+		b[8];			// Decrypted blocks
+  __m128i	iv;			// Current IV
+
+
+  if (len < 256)
+    return (aesni_decrypt(ctx, outbuffer, inbuffer, len));
+
+  for (round = 0; round <= nrounds; round ++)
+    keys[round] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(ctx->inv_round_key + 16 * round)));
+
+  iv = _mm_loadu_si128((const __m128i *)ctx->iv);
+
+  for (; len >= 256; inbuffer += 256, outbuffer += 256, len -= 256, outbytes += 256)
+  {
+    p[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(iv), _mm_loadu_si128((const __m128i *)inbuffer), 1);
+
+    for (i = 0; i < 8; i ++)
+    {
+      c[i] = _mm256_loadu_si256((const __m256i *)(inbuffer + 32 * i));
+      if (i > 0)
+        p[i] = _mm256_loadu_si256((const __m256i *)(inbuffer + 32 * i - 16));
+      b[i] = _mm256_xor_si256(c[i], keys[0]);
+    }
+
+    iv = _mm_loadu_si128((const __m128i *)(inbuffer + 240));
+
+    for (round = 1; round < nrounds; round ++)
+    {
+      for (i = 0; i < 8; i ++)
+        b[i] = _mm256_aesdec_epi128(b[i], keys[round]);
+    }
+
+    for (i = 0; i < 8; i ++)
+      _mm256_storeu_si256((__m256i *)(outbuffer + 32 * i), _mm256_xor_si256(_mm256_aesdeclast_epi128(b[i], keys[nrounds]), p[i]));
+  }
+
+  _mm_storeu_si128((__m128i *)ctx->iv, iv);
+
+  return (outbytes + aesni_decrypt(ctx, outbuffer, inbuffer, len));
 }
+#endif // _PDFIO_VAES
@@ -15,6 +15,8 @@
 //
 
 static bool	append_value(pdfio_array_t *a, _pdfio_value_t *v);
+static void	decrypt_value(pdfio_array_t *a, size_t n);
+static void	decrypt_values(pdfio_array_t *a);
 
 
 //
@@ -264,6 +266,9 @@ pdfioArrayCopy(pdfio_file_t  *pdf,	// I - PDF file
 
   PDFIO_DEBUG("pdfioArrayCopy(pdf=%p, a=%p(%p))\n", pdf, a, a ? a->pdf : NULL);
 
+  if (a->decrypt_obj)
+    decrypt_values(a);
+
   // Create the new array...
   if ((na = pdfioArrayCreate(pdf)) == NULL)
     return (NULL);
@@ -328,7 +333,8 @@ pdfioArrayCreate(pdfio_file_t *pdf)	// I - PDF file
 
 
 //
-// '_pdfioArrayDecrypt()' - Decrypt values in an array.
+// '_pdfioArrayDecrypt()' - Mark the strings in an array for decryption on first
+//                          use.
 //
 
 bool					// O - `true` on success, `false` on error
@@ -341,9 +347,12 @@ _pdfioArrayDecrypt(pdfio_file_t  *pdf,	// I - PDF file
   _pdfio_value_t	*v;		// Current value
 
 
+  // Strings are decrypted by decrypt_values() when first accessed...
+  a->decrypt_obj = obj;
+
   for (i = a->num_values, v = a->values; i > 0; i --, v ++)
   {
-    if (!_pdfioValueDecrypt(pdf, obj, v, depth))
+    if ((v->type == PDFIO_VALTYPE_ARRAY || v->type == PDFIO_VALTYPE_DICT) && !_pdfioValueDecrypt(pdf, obj, v, depth))
       return (false);
   }
 
@@ -419,6 +428,8 @@ pdfioArrayGetBinary(
     size_t        n,			// I - Index
     size_t        *length)		// O - Length of string
 {
+  decrypt_value(a, n);
+
   if (!a || n >= a->num_values || (a->values[n].type != PDFIO_VALTYPE_BINARY && a->values[n].type != PDFIO_VALTYPE_STRING))
   {
     if (length)
@@ -466,6 +477,8 @@ time_t					// O - Value
 pdfioArrayGetDate(pdfio_array_t *a,	// I - Array
 		  size_t        n)	// I - Index
 {
+  decrypt_value(a, n);
+
   if (!a || n >= a->num_values || a->values[n].type != PDFIO_VALTYPE_DATE)
     return (0);
   else
@@ -552,6 +565,8 @@ const char *				// O - Value
 pdfioArrayGetString(pdfio_array_t *a,	// I - Array
                     size_t        n)	// I - Index
 {
+  decrypt_value(a, n);
+
   if (!a || n >= a->num_values || a->values[n].type != PDFIO_VALTYPE_STRING)
     return (NULL);
   else
@@ -567,6 +582,8 @@ pdfio_valtype_t				// O - Value type
 pdfioArrayGetType(pdfio_array_t *a,	// I - Array
                   size_t        n)	// I - Index
 {
+  decrypt_value(a, n);
+
   if (!a || n >= a->num_values)
     return (PDFIO_VALTYPE_NONE);
   else
@@ -582,6 +599,8 @@ _pdfio_value_t *			// O - Value
 _pdfioArrayGetValue(pdfio_array_t *a,	// I - Array
                     size_t        n)	// I - Index
 {
+  decrypt_value(a, n);
+
   if (!a || n >= a->num_values)
     return (NULL);
   else
@@ -650,6 +669,9 @@ _pdfioArrayWrite(pdfio_array_t *a,	// I - Array
   _pdfio_value_t *v;			// Current value
 
 
+  if (a->decrypt_obj)
+    decrypt_values(a);
+
   // Arrays are surrounded by square brackets ([ ... ])
   if (!_pdfioFilePuts(pdf, "["))
     return (false);
@@ -674,6 +696,9 @@ static bool				// O - `true` on success, `false` otherwise
 append_value(pdfio_array_t  *a,		// I - Array
              _pdfio_value_t *v)		// I - Value
 {
+  if (a->decrypt_obj)
+    decrypt_values(a);
+
   if (a->num_values >= a->alloc_values)
   {
     _pdfio_value_t *temp = (_pdfio_value_t *)realloc(a->values, (a->alloc_values + 16) * sizeof(_pdfio_value_t));
@@ -689,3 +714,46 @@ append_value(pdfio_array_t  *a,		// I - Array
 
   return (true);
 }
+
+
+//
+// 'decrypt_value()' - Decrypt the strings in an array when value "n" is a
+//                     string that has not been decrypted yet.
+//
+
+static void
+decrypt_value(pdfio_array_t *a,		// I - Array
+              size_t        n)		// I - Index
+{
+  if (a && a->decrypt_obj && n < a->num_values && (a->values[n].type == PDFIO_VALTYPE_BINARY || a->values[n].type == PDFIO_VALTYPE_STRING))
+    decrypt_values(a);
+}
+
+
+//
+// 'decrypt_values()' - Decrypt the strings in an array.
+//
+// Strings that cannot be decrypted are replaced with `null` values.
+//
+
+static void
+decrypt_values(pdfio_array_t *a)	// I - Array
+{
+  pdfio_obj_t	*obj = a->decrypt_obj;	// Object
+  size_t	i;			// Looping var
+  _pdfio_value_t *v;			// Current value
+
+
+  a->decrypt_obj = NULL;
+
+  for (i = a->num_values, v = a->values; i > 0; i --, v ++)
+  {
+    if ((v->type == PDFIO_VALTYPE_BINARY || v->type == PDFIO_VALTYPE_STRING) && !_pdfioValueDecrypt(a->pdf, obj, v, 0))
+    {
+      if (v->type == PDFIO_VALTYPE_BINARY)
+        free(v->value.binary.data);
+
+      v->type = PDFIO_VALTYPE_NULL;
+    }
+  }
+}
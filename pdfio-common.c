@@ -16,6 +16,7 @@
 
 static bool	fill_buffer(pdfio_file_t *pdf);
 static ssize_t	read_buffer(pdfio_file_t *pdf, char *buffer, size_t bytes);
+static bool	start_write(pdfio_file_t *pdf);
 static bool	write_buffer(pdfio_file_t *pdf, const void *buffer, size_t bytes);
 
 
@@ -93,6 +94,9 @@ _pdfioFileFlush(pdfio_file_t *pdf)	// I - PDF file
 {
   PDFIO_DEBUG("_pdfioFileFlush(pdf=%p)\n", pdf);
 
+  if (pdf->update_offset && pdf->update_mode != _PDFIO_MODE_WRITE)
+    return (true);			// Nothing to write for an update
+
   if (pdf->bufptr > pdf->buffer)
   {
     if (!write_buffer(pdf, pdf->buffer, (size_t)(pdf->bufptr - pdf->buffer)))
@@ -365,7 +369,7 @@ _pdfioFileSeek(pdfio_file_t *pdf,	// I - PDF file
     whence = SEEK_SET;
   }
 
-  if (pdf->mode == _PDFIO_MODE_READ)
+  if (pdf->mode == _PDFIO_MODE_READ || (pdf->update_offset && pdf->update_mode == _PDFIO_MODE_READ))
   {
     // Reading, see if we already have the data we need...
     if (whence != SEEK_END && offset >= pdf->bufpos && offset < (pdf->bufpos + pdf->bufend - pdf->buffer))
@@ -394,7 +398,16 @@ _pdfioFileSeek(pdfio_file_t *pdf,	// I - PDF file
 	return (-1);
     }
 
-    pdf->bufptr = pdf->buffer;
+    if (pdf->update_offset)
+    {
+      // Incremental updates only seek to read existing objects...
+      pdf->bufptr      = pdf->bufend = NULL;
+      pdf->update_mode = _PDFIO_MODE_READ;
+    }
+    else
+    {
+      pdf->bufptr = pdf->buffer;
+    }
   }
 
   // Seek within the file...
@@ -436,6 +449,9 @@ _pdfioFileWrite(pdfio_file_t *pdf,	// I - PDF file
                 const void   *buffer,	// I - Write buffer
                 size_t       bytes)	// I - Bytes to write
 {
+  if (!start_write(pdf))
+    return (false);
+
   // See if the data will fit in the write buffer...
   if (bytes > (size_t)(pdf->bufend - pdf->bufptr))
   {
@@ -463,6 +479,53 @@ _pdfioFileWrite(pdfio_file_t *pdf,	// I - PDF file
 }
 
 
+//
+// '_pdfioFileWriteCrypto()' - Encrypt and write to a PDF file.
+//
+// The data is encrypted directly into the write buffer in multiples of the
+// 16-byte AES block size.  Only the final call for a stream may pass a length
+// that is not a multiple of 16.
+//
+
+bool					// O - `true` on success and `false` on error
+_pdfioFileWriteCrypto(
+    pdfio_file_t        *pdf,		// I - PDF file
+    _pdfio_crypto_cb_t  cb,		// I - Encryption callback
+    _pdfio_crypto_ctx_t *ctx,		// I - Encryption context
+    const void          *buffer,	// I - Write buffer
+    size_t              bytes)		// I - Bytes to write
+{
+  const uint8_t	*bufptr = (const uint8_t *)buffer;
+					// Pointer into buffer
+  size_t	avail,			// Available bytes in write buffer
+		cbytes;			// Current bytes
+
+
+  if (!start_write(pdf))
+    return (false);
+
+  while (bytes > 0)
+  {
+    // Make room for at least one block...
+    if ((pdf->bufend - pdf->bufptr) < 16 && !_pdfioFileFlush(pdf))
+      return (false);
+
+    // Encrypt as many whole blocks as will fit - the encrypted form of the
+    // final partial block is padded to 16 bytes...
+    avail = (size_t)(pdf->bufend - pdf->bufptr) & (size_t)~15;
+
+    if ((cbytes = bytes) > avail)
+      cbytes = avail;
+
+    pdf->bufptr += (cb)(ctx, (uint8_t *)pdf->bufptr, bufptr, cbytes);
+    bufptr      += cbytes;
+    bytes       -= cbytes;
+  }
+
+  return (true);
+}
+
+
 //
 // 'fill_buffer()' - Fill the read buffer in a PDF file.
 //
@@ -524,6 +587,31 @@ read_buffer(pdfio_file_t *pdf,		// I - PDF file
 }
 
 
+//
+// 'start_write()' - Prepare to write to a PDF file.
+//
+
+static bool				// O - `true` on success and `false` on error
+start_write(pdfio_file_t *pdf)		// I - PDF file
+{
+  if (pdf->update_offset && pdf->update_mode != _PDFIO_MODE_WRITE)
+  {
+    // Switch from reading existing objects to appending the update...
+    if ((pdf->bufpos = lseek(pdf->fd, 0, SEEK_END)) < 0)
+    {
+      _pdfioFileError(pdf, "Unable to seek within file - %s", strerror(errno));
+      return (false);
+    }
+
+    pdf->bufptr      = pdf->buffer;
+    pdf->bufend      = pdf->buffer + sizeof(pdf->buffer);
+    pdf->update_mode = _PDFIO_MODE_WRITE;
+  }
+
+  return (true);
+}
+
+
 //
 // 'write_buffer()' - Write a buffer to a PDF file.
 //
@@ -11,6 +11,10 @@
 #include "pdfio-content.h"
 #include "ttf.h"
 #include <math.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#  include <pthread.h>
+#endif // !_WIN32
 #ifndef M_PI
 #  define M_PI	3.14159265358979323846264338327950288
 #endif // M_PI
@@ -34,6 +38,8 @@
 #define _PDFIO_PNG_TYPE_GRAYA	4	// Grayscale + alpha
 #define _PDFIO_PNG_TYPE_RGBA	6	// RGB + alpha
 
+#define _PDFIO_MAX_FCACHE	16	// Maximum number of unused cached fonts
+
 static int	_pdfio_cp1252[] =	// CP1252-specific character mapping
 {
   0x20AC,
@@ -70,11 +76,76 @@ static int	_pdfio_cp1252[] =	// CP1252-specific character mapping
   0x0178
 };
 
+static const unsigned short _pdfio_unicode_cp1252[][2] =
+{					// Unicode to CP1252 mapping, sorted by Unicode
+  { 0x0152, 0x8C },
+  { 0x0153, 0x9C },
+  { 0x0160, 0x8A },
+  { 0x0161, 0x9A },
+  { 0x0178, 0x9F },
+  { 0x017D, 0x8E },
+  { 0x017E, 0x9E },
+  { 0x0192, 0x83 },
+  { 0x02C6, 0x88 },
+  { 0x02DC, 0x98 },
+  { 0x2013, 0x96 },
+  { 0x2014, 0x97 },
+  { 0x2018, 0x91 },
+  { 0x2019, 0x92 },
+  { 0x201A, 0x82 },
+  { 0x201C, 0x93 },
+  { 0x201D, 0x94 },
+  { 0x201E, 0x84 },
+  { 0x2020, 0x86 },
+  { 0x2021, 0x87 },
+  { 0x2022, 0x95 },
+  { 0x2026, 0x85 },
+  { 0x2030, 0x89 },
+  { 0x2039, 0x8B },
+  { 0x203A, 0x9B },
+  { 0x20AC, 0x80 },
+  { 0x2122, 0x99 }
+};
+
 
 //
 // Local types...
 //
 
+typedef struct _pdfio_fcache_s		// Font cache entry
+{
+  struct _pdfio_fcache_s *next;		// Next (less recently used) entry
+  char		*filename;		// Font filename
+  time_t	mtime;			// Modification time of font file
+  off_t		size;			// Size of font file
+  size_t	refcount;		// Number of font objects using this entry
+#ifdef _WIN32
+  SRWLOCK	mutex;			// Mutex for TrueType functions
+#else
+  pthread_mutex_t mutex;		// Mutex for TrueType functions
+#endif // _WIN32
+  pdfio_file_t	*pdf;			// PDF file for TrueType errors
+  ttf_t		*ttf;			// TrueType font
+  unsigned char	*file_data;		// Compressed font file data, if loaded
+  size_t	file_size;		// Size of compressed font file data
+  unsigned char	*cid2gid_data;		// Compressed CIDToGIDMap data, if loaded
+  size_t	cid2gid_size;		// Size of compressed CIDToGIDMap data
+  unsigned char	*cff_data;		// Compressed CID-keyed CFF data, if loaded
+  size_t	cff_size;		// Size of compressed CID-keyed CFF data
+  int		*widths;		// Encoded W array values, if loaded
+  size_t	num_widths;		// Number of encoded W array values
+} _pdfio_fcache_t;
+
+typedef struct _pdfio_font_s		// Embedded font data
+{
+  _pdfio_fcache_t *fc;			// Font cache entry
+  ttf_t		*ttf;			// TrueType font
+  pdfio_obj_t	*file_obj,		// Font file object, if subsetting
+		*cid2gid_obj,		// CIDToGIDMap object, if subsetting TrueType outlines
+		*type2_obj;		// CIDFontType0/2 object, if subsetting
+  unsigned char	used[8192];		// Bitmap of used Unicode characters
+} _pdfio_font_t;
+
 typedef pdfio_obj_t *(*_pdfio_image_func_t)(pdfio_dict_t *dict, int fd);
 
 
@@ -82,18 +153,71 @@ typedef pdfio_obj_t *(*_pdfio_image_func_t)(pdfio_dict_t *dict, int fd);
 // Local functions...
 //
 
+static unsigned char	*compress_data(pdfio_file_t *pdf, const unsigned char *data, size_t datasize, size_t *compsize);
 static pdfio_obj_t	*copy_jpeg(pdfio_dict_t *dict, int fd);
 static pdfio_obj_t	*copy_png(pdfio_dict_t *dict, int fd);
 static bool		create_cp1252(pdfio_file_t *pdf);
-static void		ttf_error_cb(pdfio_file_t *pdf, const char *message);
+static void		fcache_delete(_pdfio_fcache_t *fc);
+static _pdfio_fcache_t	*fcache_find(const char *filename, struct stat *fileinfo);
+static _pdfio_fcache_t	*fcache_get(pdfio_file_t *pdf, const char *filename);
+static bool		fcache_load(pdfio_file_t *pdf, _pdfio_fcache_t *fc, bool subset, bool unicode);
+static void		fcache_lock(void);
+static void		fcache_lock_font(_pdfio_fcache_t *fc, pdfio_file_t *pdf);
+static void		fcache_release(_pdfio_fcache_t *fc);
+static void		fcache_unlock(void);
+static void		fcache_unlock_font(_pdfio_fcache_t *fc);
+static void		free_font(_pdfio_font_t *font);
+static int		get_char(const char **s, bool unicode);
+static const char	*layout_line(ttf_t *ttf, bool unicode, const char *s, int max_width, const char **line_end, int *line_width, bool *hard);
+static int		map_cp1252(int ch);
+static int		measure_string(ttf_t *ttf, bool unicode, const char *s, size_t len);
+static void		ttf_error_cb(void *data, const char *message);
 static unsigned		update_png_crc(unsigned crc, const unsigned char *buffer, size_t length);
-static bool		write_string(pdfio_stream_t *st, bool unicode, const char *s, bool *newline);
+static bool		write_cid_font(pdfio_file_t *pdf, _pdfio_font_t *font, const int *chars, size_t num_chars);
+static bool		write_string(pdfio_stream_t *st, bool unicode, const char *s, size_t slen, bool *newline);
 
 
 //
 // Local globals...
 //
 
+static _pdfio_fcache_t	*fcache = NULL;	// Font cache, most recently used first
+					// (entries are kept until the process exits)
+#ifdef _WIN32
+static SRWLOCK		fcache_mutex = SRWLOCK_INIT;
+					// Mutex for font cache
+#else
+static pthread_mutex_t	fcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+					// Mutex for font cache
+#endif // _WIN32
+static unsigned char	*fcache_to_unicode = NULL;
+					// Compressed ToUnicode CMap
+static size_t		fcache_to_unicode_size = 0;
+					// Size of compressed ToUnicode CMap
+static const char	to_unicode_cmap[] =
+					// ToUnicode CMap for CID fonts
+  "stream\n"
+  "/CIDInit /ProcSet findresource begin\n"
+  "12 dict begin\n"
+  "begincmap\n"
+  "/CIDSystemInfo<<\n"
+  "/Registry (Adobe)\n"
+  "/Ordering (UCS2)\n"
+  "/Supplement 0\n"
+  ">> def\n"
+  "/CMapName /Adobe-Identity-UCS2 def\n"
+  "/CMapType 2 def\n"
+  "1 begincodespacerange\n"
+  "<0000> <FFFF>\n"
+  "endcodespacerange\n"
+  "1 beginbfrange\n"
+  "<0000> <FFFF> <0000>\n"
+  "endbfrange\n"
+  "endcmap\n"
+  "CMapName currentdict /CMap defineresource pop\n"
+  "end\n"
+  "end\n";
+
 static unsigned png_crc_table[256] =	// CRC-32 table for PNG files
 {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -944,6 +1068,17 @@ pdfioContentSetTextFont(
     const char     *name,		// I - Font name
     double         size)		// I - Font size
 {
+  if (st)
+  {
+    // Track the current font so that kerning can be applied, paragraphs can
+    // be laid out, and the characters used can be recorded for subsetting...
+    pdfio_dict_t *resources = st->resources ? st->resources : pdfioDictGetDict(pdfioObjGetDict(st->obj), "Resources");
+					// Resource dictionary
+
+    st->font      = pdfioDictGetObj(pdfioDictGetDict(resources, "Font"), name);
+    st->font_size = size;
+  }
+
   return (pdfioStreamPrintf(st, "/%s %g Tf\n", name, size));
 }
 
@@ -1073,88 +1208,134 @@ pdfioContentTextMeasure(
     pdfio_obj_t *font,			// I - Font object created by @link pdfioFileCreateFontObjFromFile@
     const char  *s,			// I - UTF-8 string
     double      size)			// I - Font size/height
+{
+  return (s ? pdfioContentTextMeasureN(font, s, strlen(s), size) : 0.0);
+}
+
+
+//
+// 'pdfioContentTextMeasureKerned()' - Measure a text string with kerning.
+//
+// This function measures the given text string "s" like
+// @link pdfioContentTextMeasure@ and adds the kerning adjustments used by
+// @link pdfioContentTextShowKerned@.
+//
+
+double					// O - Width
+pdfioContentTextMeasureKerned(
+    pdfio_obj_t *font,			// I - Font object created by @link pdfioFileCreateFontObjFromFile@
+    const char  *s,			// I - UTF-8 string
+    double      size)			// I - Font size/height
 {
   const char	*subtype;		// Font sub-type
-  ttf_t		*ttf = (ttf_t *)_pdfioObjGetExtension(font);
-					// TrueType font data
-  ttf_rect_t	extents;		// Text extents
-  int		ch;			// Unicode character
-  char		temp[1024],		// Temporary string
-		*tempptr;		// Pointer into temporary string
+  _pdfio_font_t	*fdata = (_pdfio_font_t *)_pdfioObjGetExtension(font);
+					// Embedded font data
+  bool		unicode;		// Unicode font?
+  int		ch,			// Current character
+		prevch = 0,		// Previous character
+		kerning = 0;		// Total kerning in 1000ths
+  double	width;			// Width of text
+
+
+  width = pdfioContentTextMeasure(font, s, size);
 
+  if (!fdata || !s)
+    return (width);
 
-  if ((subtype = pdfioObjGetSubtype(font)) == NULL || strcmp(subtype, "Type0"))
+  unicode = (subtype = pdfioObjGetSubtype(font)) != NULL && !strcmp(subtype, "Type0");
+
+  while (*s)
   {
-    // Map non-CP1282 characters to '?', everything else as-is...
-    tempptr = temp;
+    if ((ch = get_char(&s, unicode)) < ' ')
+      ch = 0;				// Don't kern across control characters
+    else if (prevch)
+      kerning += ttfGetKerning(fdata->ttf, prevch, ch);
 
-    while (*s && tempptr < (temp + sizeof(temp) - 3))
-    {
-      if ((*s & 0xe0) == 0xc0)
-      {
-	// Two-byte UTF-8
-        ch = ((s[0] & 0x1f) << 6) | (s[1] & 0x3f);
-	s += 2;
-      }
-      else if ((*s & 0xf0) == 0xe0)
-      {
-	// Three-byte UTF-8
-        ch = ((s[0] & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
-	s += 3;
-      }
-      else if ((*s & 0xf8) == 0xf0)
-      {
-	// Four-byte UTF-8
-        ch = ((s[0] & 0x07) << 18) | ((s[1] & 0x3f) << 12) | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
-	s += 4;
-      }
-      else
-      {
-	ch = *s++;
-      }
+    prevch = ch;
+  }
 
-      if (ch > 255)
-      {
-	// Try mapping from Unicode to CP1252...
-	size_t i;			// Looping var
+  return (width + size * kerning / 1000.0);
+}
 
-	for (i = 0; i < (sizeof(_pdfio_cp1252) / sizeof(_pdfio_cp1252[0])); i ++)
-	{
-	  if (ch == _pdfio_cp1252[i])
-	    break;
-	}
 
-	if (i >= (sizeof(_pdfio_cp1252) / sizeof(_pdfio_cp1252[0])))
-	  ch = '?';			// Unsupported chars map to ?
-      }
+//
+// 'pdfioContentTextMeasureN()' - Measure a text string of a given length.
+//
+// This function measures the first "len" bytes of the text string "s" like
+// @link pdfioContentTextMeasure@.  The string does not need to be
+// nul-terminated.
+//
+
+double					// O - Width
+pdfioContentTextMeasureN(
+    pdfio_obj_t *font,			// I - Font object created by @link pdfioFileCreateFontObjFromFile@
+    const char  *s,			// I - UTF-8 string
+    size_t      len,			// I - Length of string in bytes
+    double      size)			// I - Font size/height
+{
+  const char	*subtype;		// Font sub-type
+  _pdfio_font_t	*fdata = (_pdfio_font_t *)_pdfioObjGetExtension(font);
+					// Embedded font data
+  int		units;			// Font units per em
 
-      if (ch < 128)
-      {
-        // ASCII
-	*tempptr++ = (char)ch;
-      }
-      else if (ch < 2048)
-      {
-        // 2-byte UTF-8
-        *tempptr++ = (char)(0xc0 | ((ch >> 6) & 0x1f));
-        *tempptr++ = (char)(0x80 | (ch & 0x3f));
-      }
-      else
-      {
-        // 3-byte UTF-8
-        *tempptr++ = (char)(0xe0 | ((ch >> 12) & 0x0f));
-        *tempptr++ = (char)(0x80 | ((ch >> 6) & 0x3f));
-        *tempptr++ = (char)(0x80 | (ch & 0x3f));
-      }
-    }
 
-    *tempptr = '\0';
-    s        = temp;
+  if (!fdata || !s || (units = ttfGetUnitsPerEm(fdata->ttf)) <= 0)
+    return (0.0);
+
+  subtype = pdfioObjGetSubtype(font);
+
+  return (size * measure_string(fdata->ttf, subtype && !strcmp(subtype, "Type0"), s, len) / units);
+}
+
+
+//
+// 'pdfioContentTextMeasureStrings()' - Measure multiple text strings.
+//
+// This function measures "num_strings" text strings like
+// @link pdfioContentTextMeasure@, storing the width of each string in the
+// "widths" array.  The "lengths" argument specifies the length of each string
+// in bytes, or `NULL` if the strings are nul-terminated.
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioContentTextMeasureStrings(
+    pdfio_obj_t        *font,		// I - Font object created by @link pdfioFileCreateFontObjFromFile@
+    size_t             num_strings,	// I - Number of strings
+    const char * const *strings,	// I - UTF-8 strings
+    const size_t       *lengths,	// I - Lengths of strings in bytes or `NULL`
+    double             size,		// I - Font size/height
+    double             *widths)		// O - Widths of strings
+{
+  size_t	i;			// Looping var
+  const char	*subtype;		// Font sub-type
+  _pdfio_font_t	*fdata = (_pdfio_font_t *)_pdfioObjGetExtension(font);
+					// Embedded font data
+  bool		unicode;		// Unicode font?
+  int		units;			// Font units per em
+  double	scale;			// Scaling from font units
+
+
+  if (!widths || (num_strings > 0 && !strings))
+    return (false);
+
+  if (!fdata || (units = ttfGetUnitsPerEm(fdata->ttf)) <= 0)
+  {
+    memset(widths, 0, num_strings * sizeof(double));
+    return (false);
   }
 
-  ttfGetExtents(ttf, (float)size, s, &extents);
+  unicode = (subtype = pdfioObjGetSubtype(font)) != NULL && !strcmp(subtype, "Type0");
+  scale   = size / units;
+
+  for (i = 0; i < num_strings; i ++)
+  {
+    if (strings[i])
+      widths[i] = scale * measure_string(fdata->ttf, unicode, strings[i], lengths ? lengths[i] : strlen(strings[i]));
+    else
+      widths[i] = 0.0;
+  }
 
-  return (extents.right - extents.left);
+  return (true);
 }
 
 
@@ -1249,7 +1430,7 @@ pdfioContentTextNewLineShow(
   }
 
   // Write the string...
-  if (!write_string(st, unicode, s, &newline))
+  if (!write_string(st, unicode, s, strlen(s), &newline))
     return (false);
 
   // Draw it...
@@ -1310,7 +1491,7 @@ pdfioContentTextShow(
 
 
   // Write the string...
-  if (!write_string(st, unicode, s, &newline))
+  if (!write_string(st, unicode, s, strlen(s), &newline))
     return (false);
 
   // Draw it...
@@ -1347,7 +1528,7 @@ pdfioContentTextShowf(
   va_end(ap);
 
   // Write the string...
-  if (!write_string(st, unicode, buffer, &newline))
+  if (!write_string(st, unicode, buffer, strlen(buffer), &newline))
     return (false);
 
   // Draw it...
@@ -1391,7 +1572,7 @@ pdfioContentTextShowJustified(
 
     if (fragments[i])
     {
-      if (!write_string(st, unicode, fragments[i], NULL))
+      if (!write_string(st, unicode, fragments[i], strlen(fragments[i]), NULL))
         return (false);
     }
   }
@@ -1400,6 +1581,299 @@ pdfioContentTextShowJustified(
 }
 
 
+//
+// 'pdfioContentTextShowKerned()' - Show text with kerning.
+//
+// This function shows some text in a PDF content stream like
+// @link pdfioContentTextShow@, using the kerning pairs from the current font to
+// adjust the spacing between characters.  The text is written as a single
+// array of strings and adjustments for the "TJ" operator.  Fonts without
+// kerning data show the text unchanged.
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioContentTextShowKerned(
+    pdfio_stream_t *st,			// I - Stream
+    bool           unicode,		// I - Unicode text?
+    const char     *s)			// I - String to show
+{
+  bool		newline = false;	// New line?
+  _pdfio_font_t	*fdata = st && st->font ? (_pdfio_font_t *)_pdfioObjGetExtension(st->font) : NULL;
+					// Embedded font data
+  const char	*start,			// Start of current string
+		*ptr,			// Pointer into string
+		*next;			// Next character
+  int		ch,			// Current character
+		prevch = 0,		// Previous character
+		kerning;		// Kerning adjustment
+
+
+  if (!s || !pdfioStreamPuts(st, "["))
+    return (false);
+
+  for (start = ptr = s; *ptr; ptr = next, prevch = ch)
+  {
+    if (*ptr == '\n')
+    {
+      newline = true;
+      break;
+    }
+
+    next = ptr;
+
+    if ((ch = get_char(&next, unicode)) < ' ')
+    {
+      ch = 0;				// Don't kern across control characters
+    }
+    else if (fdata && prevch && (kerning = ttfGetKerning(fdata->ttf, prevch, ch)) != 0)
+    {
+      // Write the characters before this one followed by the adjustment, which
+      // is subtracted from the current position...
+      if (!write_string(st, unicode, start, (size_t)(ptr - start), NULL) || !pdfioStreamPrintf(st, "%d", -kerning))
+        return (false);
+
+      start = ptr;
+    }
+  }
+
+  if (!write_string(st, unicode, start, (size_t)(ptr - start), NULL))
+    return (false);
+
+  // Draw it...
+  if (newline)
+    return (pdfioStreamPuts(st, "]TJ T*\n"));
+  else
+    return (pdfioStreamPuts(st, "]TJ\n"));
+}
+
+
+//
+// 'pdfioContentTextShowParagraph()' - Show a paragraph of text.
+//
+// This function breaks the text "s" into lines that fit in "width" and shows
+// them in a PDF content stream using the current font and leading, starting
+// at the current text position.  Lines are broken after spaces and newlines,
+// or within words that do not fit on a line by themselves.  Each line is
+// followed by a move to the next line ("T*"), so the text leading must be set
+// with @link pdfioContentSetTextLeading@ before calling this function.
+//
+// The "align" argument specifies the alignment of each line.  Justified text
+// aligns all but the last line of the paragraph (and lines ending with a
+// newline) to both the left and right margins by adding space between words.
+//
+// The "max_lines" argument specifies the maximum number of lines to show, or
+// `0` to show the entire paragraph.  On return "s" points to the remaining
+// text, which is an empty string once the paragraph has been shown, and
+// "num_lines" (if not `NULL`) contains the number of lines that were shown.
+//
+// The current font must be an embedded TrueType/OpenType font that was
+// selected with @link pdfioContentSetTextFont@.
+//
+
+bool					// O  - `true` on success, `false` on failure
+pdfioContentTextShowParagraph(
+    pdfio_stream_t    *st,		// I  - Stream
+    bool              unicode,		// I  - Unicode text?
+    double            width,		// I  - Line width
+    pdfio_textalign_t align,		// I  - Text alignment
+    size_t            max_lines,	// I  - Maximum number of lines or `0` for no limit
+    const char        **s,		// IO - Text to show
+    size_t            *num_lines)	// O  - Number of lines shown or `NULL`
+{
+  _pdfio_font_t	*fdata = st && st->font ? (_pdfio_font_t *)_pdfioObjGetExtension(st->font) : NULL;
+					// Embedded font data
+  int		units,			// Font units per em
+		max_width,		// Line width in font units
+		line_width,		// Width of current line in font units
+		spaces;			// Number of word breaks in line
+  const char	*line,			// Start of current line
+		*line_end,		// End of current line
+		*next,			// Start of next line
+		*first,			// First word in line
+		*ptr,			// Pointer into line
+		*start;			// Start of current word
+  bool		hard;			// Line ends with a newline or the end of the paragraph?
+  size_t	count = 0;		// Number of lines shown
+
+
+  if (num_lines)
+    *num_lines = 0;
+
+  if (!st || !s || !*s || width <= 0.0)
+    return (false);
+
+  if (!fdata || (units = ttfGetUnitsPerEm(fdata->ttf)) <= 0 || st->font_size <= 0.0)
+  {
+    _pdfioFileError(st->pdf, "Unable to lay out text without an embedded font.");
+    return (false);
+  }
+
+  max_width = (int)(width * units / st->font_size);
+
+  for (line = *s; *line && (max_lines == 0 || count < max_lines); line = next, count ++)
+  {
+    // Find the end of the line...
+    next = layout_line(fdata->ttf, unicode, line, max_width, &line_end, &line_width, &hard);
+
+    if (line_end == line)
+    {
+      // Blank line...
+      if (!pdfioStreamPuts(st, "T*\n"))
+        return (false);
+
+      continue;
+    }
+
+    if (align == PDFIO_TEXTALIGN_JUSTIFY && !hard && line_width < max_width)
+    {
+      // Count the word breaks in the line, ignoring any indentation...
+      for (first = line; *first == ' '; first ++);
+
+      for (ptr = first, spaces = 0; ptr < line_end; ptr ++)
+      {
+        if (*ptr == ' ' && ptr[1] != ' ')
+          spaces ++;
+      }
+    }
+    else
+    {
+      spaces = 0;
+    }
+
+    if (spaces > 0)
+    {
+      // Write each word followed by the extra space between words, which is
+      // subtracted from the current position in 1000ths of the font size...
+      double extra = -1000.0 * (max_width - line_width) / spaces / units;
+					// Extra space between words
+
+      if (!pdfioStreamPuts(st, "["))
+        return (false);
+
+      for (ptr = first, start = line; ptr < line_end; ptr ++)
+      {
+        if (*ptr == ' ' && ptr[1] != ' ')
+        {
+          if (!write_string(st, unicode, start, (size_t)(ptr - start + 1), NULL) || !pdfioStreamPrintf(st, "%.2f", extra))
+            return (false);
+
+          start = ptr + 1;
+        }
+      }
+
+      if (!write_string(st, unicode, start, (size_t)(line_end - start), NULL) || !pdfioStreamPuts(st, "]TJ T*\n"))
+        return (false);
+    }
+    else if (align == PDFIO_TEXTALIGN_CENTER || align == PDFIO_TEXTALIGN_RIGHT)
+    {
+      // Offset the line from the left margin...
+      int offset = align == PDFIO_TEXTALIGN_CENTER ? (max_width - line_width) / 2 : max_width - line_width;
+					// Offset in font units
+
+      if (!pdfioStreamPrintf(st, "[%.2f", -1000.0 * offset / units) || !write_string(st, unicode, line, (size_t)(line_end - line), NULL) || !pdfioStreamPuts(st, "]TJ T*\n"))
+        return (false);
+    }
+    else
+    {
+      // Left-aligned line...
+      if (!write_string(st, unicode, line, (size_t)(line_end - line), NULL) || !pdfioStreamPuts(st, "Tj T*\n"))
+        return (false);
+    }
+  }
+
+  *s = line;
+
+  if (num_lines)
+    *num_lines = count;
+
+  return (true);
+}
+
+
+//
+// '_pdfioContentWriteFonts()' - Write the subsets of embedded fonts.
+//
+// Subset fonts also get their CIDToGIDMap and widths written for only the
+// characters that were used.  Unicode fonts with CFF outlines are written as
+// CID-keyed CFF font programs containing only the used characters.
+//
+
+bool					// O - `true` on success, `false` on failure
+_pdfioContentWriteFonts(
+    pdfio_file_t *pdf)			// I - PDF file
+{
+  bool		ret = true;		// Return value
+  size_t	i;			// Looping var
+  _pdfio_font_t	*fdata;			// Embedded font data
+  int		*chars,			// Characters used
+		ch;			// Current character
+  size_t	num_chars;		// Number of characters used
+  unsigned char	*data;			// Font subset data
+  size_t	datasize;		// Size of font subset data
+  pdfio_stream_t *st;			// Font stream
+
+
+  if (pdf->num_fonts == 0)
+    return (true);
+
+  if ((chars = (int *)malloc(65536 * sizeof(int))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for font subset.");
+    return (false);
+  }
+
+  for (i = 0; i < pdf->num_fonts && ret; i ++)
+  {
+    fdata = (_pdfio_font_t *)_pdfioObjGetExtension(pdf->fonts[i]);
+
+    // Build a sorted list of the characters that were used...
+    for (ch = 0, num_chars = 0; ch < 65536; ch ++)
+    {
+      if (fdata->used[ch >> 3] & (1 << (ch & 7)))
+        chars[num_chars ++] = ch;
+    }
+
+    // Create the subset and write it to the font file object...
+    fcache_lock_font(fdata->fc, pdf);
+    if (fdata->type2_obj && ttfIsCFF(fdata->ttf))
+      data = ttfCreateCFF(fdata->ttf, num_chars, chars, &datasize);
+    else
+      data = ttfCreateSubset(fdata->ttf, num_chars, chars, &datasize);
+    fcache_unlock_font(fdata->fc);
+
+    if (!data)
+    {
+      ret = false;
+      break;
+    }
+
+    if ((st = pdfioObjCreateStream(fdata->file_obj, PDFIO_FILTER_FLATE)) == NULL)
+    {
+      ret = false;
+    }
+    else
+    {
+      if (!pdfioStreamWrite(st, data, datasize))
+        ret = false;
+
+      if (!pdfioStreamClose(st))
+        ret = false;
+    }
+
+    free(data);
+
+    if (ret && fdata->type2_obj && !write_cid_font(pdf, fdata, chars, num_chars))
+      ret = false;
+  }
+
+  free(chars);
+
+  pdf->num_fonts = 0;
+
+  return (ret);
+}
+
+
 //
 // 'pdfioFileCreateBaseFontObj()' - Create one of the base 14 PDF fonts.
 //
@@ -1465,6 +1939,10 @@ pdfioFileCreateFontObjFromBase(
 // or to only support the Windows CP1252 (ISO-8859-1 with additional
 // characters such as the Euro symbol) subset of Unicode.
 //
+// Fonts are cached for the life of the process so that embedding the same
+// font file in many PDF files only loads it once.  Up to 16 unused fonts are
+// kept in the cache, and cached fonts are not freed before the process exits.
+//
 
 pdfio_obj_t *				// O - Font object
 pdfioFileCreateFontObjFromFile(
@@ -1472,7 +1950,9 @@ pdfioFileCreateFontObjFromFile(
     const char   *filename,		// I - Filename
     bool         unicode)		// I - Force Unicode
 {
+  _pdfio_fcache_t *fc;			// Font cache entry
   ttf_t		*font;			// TrueType font
+  _pdfio_font_t	*fdata;			// Embedded font data
   ttf_rect_t	bounds;			// Font bounds
   pdfio_dict_t	*dict,			// Font dictionary
 		*desc,			// Font descriptor
@@ -1481,11 +1961,13 @@ pdfioFileCreateFontObjFromFile(
 		*desc_obj,		// Font descriptor object
 		*file_obj;		// Font file object
   const char	*basefont;		// Base font name
+  char		subname[256],		// Subset font name
+		*subptr;		// Pointer into subset font name
+  size_t	number;			// Number for subset font name
   pdfio_array_t	*bbox;			// Font bounding box array
   pdfio_stream_t *st;			// Font stream
-  int		fd = -1;		// File
-  unsigned char	buffer[16384];		// Read buffer
-  ssize_t	bytes;			// Bytes read
+  bool		cff,			// Font uses CFF outlines?
+		subset;			// Subset the font?
 
 
   // Range check input...
@@ -1498,62 +1980,113 @@ pdfioFileCreateFontObjFromFile(
     return (NULL);
   }
 
-  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+  // Get the font from the cache, loading any data we need...
+  if ((fc = fcache_get(pdf, filename)) == NULL)
+    return (NULL);
+
+  // Simple fonts with CFF outlines are always embedded whole...
+  cff    = ttfIsCFF(fc->ttf);
+  subset = pdf->subset_fonts && (unicode || !cff);
+
+  if (!fcache_load(pdf, fc, subset, unicode))
   {
-    _pdfioFileError(pdf, "Unable to open font file '%s': %s", filename, strerror(errno));
+    fcache_release(fc);
     return (NULL);
   }
 
-  if ((font = ttfCreate(filename, 0, (ttf_err_cb_t)ttf_error_cb, pdf)) == NULL)
+  if ((fdata = (_pdfio_font_t *)calloc(1, sizeof(_pdfio_font_t))) == NULL)
   {
-    close(fd);
+    _pdfioFileError(pdf, "Unable to allocate memory for font.");
+    fcache_release(fc);
     return (NULL);
   }
 
+  fdata->fc  = fc;
+  fdata->ttf = font = fc->ttf;
+
   // Create the font file dictionary and object...
   if ((file = pdfioDictCreate(pdf)) == NULL)
     goto done;
 
   pdfioDictSetName(file, "Filter", "FlateDecode");
 
-  if ((file_obj = pdfioFileCreateObj(pdf, file)) == NULL)
-    goto done;
+  // CFF outlines are embedded as a bare CID-keyed CFF font program for Unicode
+  // fonts and as the original OpenType font for simple fonts...
+  if (cff)
+    pdfioDictSetName(file, "Subtype", unicode ? "CIDFontType0C" : "OpenType");
 
-  if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_FLATE)) == NULL)
+  if ((file_obj = pdfioFileCreateObj(pdf, file)) == NULL)
     goto done;
 
-  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+  if (subset)
   {
-    if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
+    // Write the font subset when the PDF file is closed...
+    if (pdf->num_fonts >= pdf->alloc_fonts)
     {
-      pdfioStreamClose(st);
-      goto done;
-    }
-  }
+      pdfio_obj_t **temp = (pdfio_obj_t **)realloc(pdf->fonts, (pdf->alloc_fonts + 16) * sizeof(pdfio_obj_t *));
+					// Temporary font array
 
-  close(fd);
-  fd = -1;
-  pdfioStreamClose(st);
+      if (!temp)
+      {
+        _pdfioFileError(pdf, "Unable to allocate memory for font.");
+        goto done;
+      }
 
-  // Create the font descriptor dictionary and object...
-  if ((bbox = pdfioArrayCreate(pdf)) == NULL)
-    goto done;
+      pdf->fonts       = temp;
+      pdf->alloc_fonts += 16;
+    }
 
-  ttfGetBounds(font, &bounds);
+    fdata->file_obj = file_obj;
 
-  pdfioArrayAppendNumber(bbox, bounds.left);
-  pdfioArrayAppendNumber(bbox, bounds.bottom);
+    // Subset fonts use a unique "ABCDEF+" prefix for the font name...
+    for (subptr = subname, number = file_obj->number; subptr < (subname + 6); subptr ++, number /= 26)
+      *subptr = (char)('A' + number % 26);
+
+    snprintf(subptr, sizeof(subname) - 6, "+%s", ttfGetPostScriptName(font));
+    basefont = pdfioStringCreate(pdf, subname);
+  }
+  else
+  {
+    // Copy the cached, compressed font file now...
+    if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_NONE)) == NULL)
+      goto done;
+
+    if (cff && unicode)
+    {
+      if (!pdfioStreamWrite(st, fc->cff_data, fc->cff_size))
+      {
+	pdfioStreamClose(st);
+	goto done;
+      }
+    }
+    else if (!pdfioStreamWrite(st, fc->file_data, fc->file_size))
+    {
+      pdfioStreamClose(st);
+      goto done;
+    }
+
+    pdfioStreamClose(st);
+
+    basefont = pdfioStringCreate(pdf, ttfGetPostScriptName(font));
+  }
+
+  // Create the font descriptor dictionary and object...
+  if ((bbox = pdfioArrayCreate(pdf)) == NULL)
+    goto done;
+
+  ttfGetBounds(font, &bounds);
+
+  pdfioArrayAppendNumber(bbox, bounds.left);
+  pdfioArrayAppendNumber(bbox, bounds.bottom);
   pdfioArrayAppendNumber(bbox, bounds.right);
   pdfioArrayAppendNumber(bbox, bounds.top);
 
   if ((desc = pdfioDictCreate(pdf)) == NULL)
     goto done;
 
-  basefont = pdfioStringCreate(pdf, ttfGetPostScriptName(font));
-
   pdfioDictSetName(desc, "Type", "FontDescriptor");
   pdfioDictSetName(desc, "FontName", basefont);
-  pdfioDictSetObj(desc, "FontFile2", file_obj);
+  pdfioDictSetObj(desc, cff ? "FontFile3" : "FontFile2", file_obj);
   pdfioDictSetNumber(desc, "Flags", ttfIsFixedPitch(font) ? 0x21 : 0x20);
   pdfioDictSetArray(desc, "FontBBox", bbox);
   pdfioDictSetNumber(desc, "ItalicAngle", ttfGetItalicAngle(font));
@@ -1575,24 +2108,18 @@ pdfioFileCreateFontObjFromFile(
     // Unicode (CID) font...
     pdfio_dict_t	*cid2gid,	// CIDToGIDMap dictionary
 			*to_unicode;	// ToUnicode dictionary
-    pdfio_obj_t		*cid2gid_obj,	// CIDToGIDMap object
+    pdfio_obj_t		*cid2gid_obj = NULL,
+					// CIDToGIDMap object
 			*to_unicode_obj;// ToUnicode object
     size_t		i,		// Looping var
-			start,		// Start character
-			num_cmap;	// Number of CMap entries
-    const int		*cmap;		// CMap entries
-    int			min_glyph,	// First glyph
-			max_glyph;	// Last glyph
-    unsigned short	glyphs[65536];	// Glyph to Unicode mapping
-    unsigned char	*bufptr,	// Pointer into buffer
-			*bufend;	// End of buffer
-    pdfio_dict_t	*type2;		// CIDFontType2 font dictionary
-    pdfio_obj_t		*type2_obj;	// CIDFontType2 font object
+			j,		// Looping var
+			count;		// Number of widths
+    pdfio_dict_t	*type2;		// CIDFontType0/2 font dictionary
+    pdfio_obj_t		*type2_obj;	// CIDFontType0/2 font object
     pdfio_array_t	*descendants;	// Decendant font list
     pdfio_dict_t	*sidict;	// CIDSystemInfo dictionary
-    pdfio_array_t	*w_array,	// Width array
+    pdfio_array_t	*w_array = NULL,// Width array
 			*temp_array;	// Temporary width sub-array
-    int			w0, w1;		// Widths
 
     // Create a CIDSystemInfo mapping to Adobe UCS2 v0 (Unicode)
     if ((sidict = pdfioDictCreate(pdf)) == NULL)
@@ -1602,182 +2129,116 @@ pdfioFileCreateFontObjFromFile(
     pdfioDictSetString(sidict, "Ordering", "Identity");
     pdfioDictSetNumber(sidict, "Supplement", 0);
 
-    // Create a CIDToGIDMap object for the Unicode font...
-    if ((cid2gid = pdfioDictCreate(pdf)) == NULL)
-      goto done;
-
-#ifndef DEBUG
-    pdfioDictSetName(cid2gid, "Filter", "FlateDecode");
-#endif // !DEBUG
-
-    if ((cid2gid_obj = pdfioFileCreateObj(pdf, cid2gid)) == NULL)
-      goto done;
-
-#ifdef DEBUG
-    if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_NONE)) == NULL)
-#else
-    if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_FLATE)) == NULL)
-#endif // DEBUG
-      goto done;
+    // Create a CIDToGIDMap object for the Unicode font - CFF fonts map CIDs
+    // to glyphs using the charset in the font program instead...
+    if (!cff)
+    {
+      if ((cid2gid = pdfioDictCreate(pdf)) == NULL)
+	goto done;
 
-    cmap      = ttfGetCMap(font, &num_cmap);
-    min_glyph = 65536;
-    max_glyph = 0;
-    memset(glyphs, 0, sizeof(glyphs));
+      pdfioDictSetName(cid2gid, "Filter", "FlateDecode");
 
-    PDFIO_DEBUG("pdfioFileCreateFontObjFromFile: num_cmap=%u\n", (unsigned)num_cmap);
+      if ((cid2gid_obj = pdfioFileCreateObj(pdf, cid2gid)) == NULL)
+	goto done;
 
-    for (i = 0, bufptr = buffer, bufend = buffer + sizeof(buffer); i < num_cmap; i ++)
-    {
-      PDFIO_DEBUG("pdfioFileCreateFontObjFromFile: cmap[%u]=%d\n", (unsigned)i, cmap[i]);
-      if (cmap[i] < 0)
+      if (subset)
       {
-        // Map undefined glyph to .notdef...
-        *bufptr++ = 0;
-        *bufptr++ = 0;
+	// Only map the characters that are used when the PDF file is closed...
+	fdata->cid2gid_obj = cid2gid_obj;
       }
       else
       {
-        // Map to specified glyph...
-        *bufptr++ = (unsigned char)(cmap[i] >> 8);
-        *bufptr++ = (unsigned char)(cmap[i] & 255);
-
-        glyphs[cmap[i]] = (unsigned short)i;
-        if (cmap[i] < min_glyph)
-          min_glyph = cmap[i];
-        if (cmap[i] > max_glyph)
-          max_glyph = cmap[i];
-      }
+	// Map all characters in the font...
+	if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_NONE)) == NULL)
+	  goto done;
 
-      if (bufptr >= bufend)
-      {
-        // Flush buffer...
-        if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
-        {
+	if (!pdfioStreamWrite(st, fc->cid2gid_data, fc->cid2gid_size))
+	{
 	  pdfioStreamClose(st);
 	  goto done;
-        }
-
-        bufptr = buffer;
-      }
-    }
+	}
 
-    if (bufptr > buffer)
-    {
-      // Flush buffer...
-      if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
-      {
 	pdfioStreamClose(st);
-	goto done;
       }
     }
 
-    pdfioStreamClose(st);
-
     // ToUnicode mapping object
     to_unicode = pdfioDictCreate(pdf);
     pdfioDictSetName(to_unicode, "Type", "CMap");
     pdfioDictSetName(to_unicode, "CMapName", "Adobe-Identity-UCS2");
     pdfioDictSetDict(to_unicode, "CIDSystemInfo", sidict);
 
-#ifndef DEBUG
     pdfioDictSetName(to_unicode, "Filter", "FlateDecode");
-#endif // !DEBUG
 
     if ((to_unicode_obj = pdfioFileCreateObj(pdf, to_unicode)) == NULL)
       goto done;
 
-#ifdef DEBUG
     if ((st = pdfioObjCreateStream(to_unicode_obj, PDFIO_FILTER_NONE)) == NULL)
-#else
-    if ((st = pdfioObjCreateStream(to_unicode_obj, PDFIO_FILTER_FLATE)) == NULL)
-#endif // DEBUG
       goto done;
 
-    pdfioStreamPuts(st,
-		    "stream\n"
-		    "/CIDInit /ProcSet findresource begin\n"
-		    "12 dict begin\n"
-		    "begincmap\n"
-		    "/CIDSystemInfo<<\n"
-		    "/Registry (Adobe)\n"
-		    "/Ordering (UCS2)\n"
-		    "/Supplement 0\n"
-		    ">> def\n"
-		    "/CMapName /Adobe-Identity-UCS2 def\n"
-		    "/CMapType 2 def\n"
-		    "1 begincodespacerange\n"
-		    "<0000> <FFFF>\n"
-		    "endcodespacerange\n"
-		    "1 beginbfrange\n"
-		    "<0000> <FFFF> <0000>\n"
-                    "endbfrange\n"
-                    "endcmap\n"
-                    "CMapName currentdict /CMap defineresource pop\n"
-                    "end\n"
-                    "end\n");
+    if (!pdfioStreamWrite(st, fcache_to_unicode, fcache_to_unicode_size))
+    {
+      pdfioStreamClose(st);
+      goto done;
+    }
 
     pdfioStreamClose(st);
 
-    // Create a CIDFontType2 dictionary for the Unicode font...
+    // Create a CIDFontType0/2 dictionary for the Unicode font...
     if ((type2 = pdfioDictCreate(pdf)) == NULL)
       goto done;
 
-    // Width array
-    if ((w_array = pdfioArrayCreate(pdf)) == NULL)
-      goto done;
-
-    for (start = 0, w0 = ttfGetWidth(font, 0), w1 = 0, i = 1; i < 65536; start = i, w0 = w1, i ++)
+    // Width array for all characters, unless subsetting when it is written
+    // for the characters that are used when the PDF file is closed...
+    if (!subset)
     {
-      while (i < 65536 && (w1 = ttfGetWidth(font, (int)i)) == w0)
-        i ++;
+      if ((w_array = pdfioArrayCreate(pdf)) == NULL)
+        goto done;
 
-      if ((i - start) > 1)
-      {
-        // Encode a repeating sequence...
-        pdfioArrayAppendNumber(w_array, start);
-        pdfioArrayAppendNumber(w_array, i - 1);
-        pdfioArrayAppendNumber(w_array, w0);
-      }
-      else
+      for (i = 0; (i + 2) < fc->num_widths; )
       {
-        // Encode a non-repeating sequence...
-        pdfioArrayAppendNumber(w_array, start);
+        pdfioArrayAppendNumber(w_array, fc->widths[i]);
 
-        if ((temp_array = pdfioArrayCreate(pdf)) == NULL)
-	  goto done;
-
-        pdfioArrayAppendNumber(temp_array, w0);
-        for (w0 = w1, i ++; i < 65536; w0 = w1, i ++)
+        if (fc->widths[i + 1] >= 0)
         {
-          if ((w1 = ttfGetWidth(font, (int)i)) == w0 && i < 65535)
-            break;
-
-	  pdfioArrayAppendNumber(temp_array, w0);
+          // Repeating sequence...
+          pdfioArrayAppendNumber(w_array, fc->widths[i + 1]);
+          pdfioArrayAppendNumber(w_array, fc->widths[i + 2]);
+          i += 3;
         }
+        else
+        {
+          // Non-repeating sequence...
+          if ((temp_array = pdfioArrayCreate(pdf)) == NULL)
+	    goto done;
 
-        if (i == 65536)
-	  pdfioArrayAppendNumber(temp_array, w0);
-	else
-	  i --;
+          for (count = (size_t)-fc->widths[i + 1], i += 2, j = 0; j < count && i < fc->num_widths; i ++, j ++)
+	    pdfioArrayAppendNumber(temp_array, fc->widths[i]);
 
-        pdfioArrayAppendArray(w_array, temp_array);
+          pdfioArrayAppendArray(w_array, temp_array);
+        }
       }
     }
 
     // Then the dictionary for the CID base font...
     pdfioDictSetName(type2, "Type", "Font");
-    pdfioDictSetName(type2, "Subtype", "CIDFontType2");
+    pdfioDictSetName(type2, "Subtype", cff ? "CIDFontType0" : "CIDFontType2");
     pdfioDictSetName(type2, "BaseFont", basefont);
     pdfioDictSetDict(type2, "CIDSystemInfo", sidict);
-    pdfioDictSetObj(type2, "CIDToGIDMap", cid2gid_obj);
+    if (cid2gid_obj)
+      pdfioDictSetObj(type2, "CIDToGIDMap", cid2gid_obj);
     pdfioDictSetObj(type2, "FontDescriptor", desc_obj);
-    pdfioDictSetArray(type2, "W", w_array);
+
+    if (!subset)
+      pdfioDictSetArray(type2, "W", w_array);
 
     if ((type2_obj = pdfioFileCreateObj(pdf, type2)) == NULL)
       goto done;
 
-    pdfioObjClose(type2_obj);
+    if (subset)
+      fdata->type2_obj = type2_obj;
+    else
+      pdfioObjClose(type2_obj);
 
     // Create a Type 0 font object...
     if ((descendants = pdfioArrayCreate(pdf)) == NULL)
@@ -1804,12 +2265,12 @@ pdfioFileCreateFontObjFromFile(
     if (ttfGetMaxChar(font) >= 255 && !pdf->cp1252_obj && !create_cp1252(pdf))
       goto done;
 
-    // Create a TrueType font object...
+    // Create a TrueType or Type 1 (CFF outlines) font object...
     if ((dict = pdfioDictCreate(pdf)) == NULL)
       goto done;
 
     pdfioDictSetName(dict, "Type", "Font");
-    pdfioDictSetName(dict, "Subtype", "TrueType");
+    pdfioDictSetName(dict, "Subtype", cff ? "Type1" : "TrueType");
     pdfioDictSetName(dict, "BaseFont", basefont);
     if (ttfGetMaxChar(font) >= 255)
       pdfioDictSetObj(dict, "Encoding", pdf->cp1252_obj);
@@ -1822,10 +2283,17 @@ pdfioFileCreateFontObjFromFile(
 
   done:
 
-  if (fd >= 0)
-    close(fd);
+  if (obj)
+  {
+    _pdfioObjSetExtension(obj, fdata, (_pdfio_extfree_t)free_font);
 
-  _pdfioObjSetExtension(obj, font, (_pdfio_extfree_t)ttfDelete);
+    if (fdata->file_obj)
+      pdf->fonts[pdf->num_fonts ++] = obj;
+  }
+  else
+  {
+    free_font(fdata);
+  }
 
   return (obj);
 }
@@ -2206,6 +2674,30 @@ pdfioFileCreateImageObjFromFile(
 }
 
 
+//
+// 'pdfioFileSetSubsetFonts()' - Set whether to subset embedded fonts.
+//
+// This function enables or disables subsetting of fonts that are subsequently
+// embedded using @link pdfioFileCreateFontObjFromFile@.  When enabled, only
+// the glyphs for characters written with the `pdfioContentText` functions are
+// embedded, and the font data is written when the PDF file is closed.  Text
+// written to a content stream by other means is not tracked and may not
+// display correctly.  Non-Unicode fonts with CFF outlines are always embedded
+// whole.
+//
+// Subsetting is disabled by default.
+//
+
+void
+pdfioFileSetSubsetFonts(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to subset embedded fonts, `false` otherwise
+{
+  if (pdf)
+    pdf->subset_fonts = value;
+}
+
+
 //
 // 'pdfioImageGetBytesPerLine()' - Get the number of bytes to read for each line.
 //
@@ -2428,6 +2920,41 @@ pdfioPageDictAddImage(
 }
 
 
+//
+// 'compress_data()' - Compress data using the Flate algorithm.
+//
+
+static unsigned char *			// O - Compressed data or `NULL` on error
+compress_data(
+    pdfio_file_t        *pdf,		// I - PDF file
+    const unsigned char *data,		// I - Data to compress
+    size_t              datasize,	// I - Size of data
+    size_t              *compsize)	// O - Size of compressed data
+{
+  unsigned char	*comp;			// Compressed data
+  uLongf	complen = compressBound((uLong)datasize);
+					// Length of compressed data
+
+
+  if ((comp = (unsigned char *)malloc(complen)) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for compressed data.");
+    return (NULL);
+  }
+
+  if (compress2(comp, &complen, data, (uLong)datasize, 9) != Z_OK)
+  {
+    _pdfioFileError(pdf, "Unable to compress data.");
+    free(comp);
+    return (NULL);
+  }
+
+  *compsize = (size_t)complen;
+
+  return (comp);
+}
+
+
 //
 // 'copy_jpeg()' - Copy a JPEG image.
 //
@@ -3192,131 +3719,1094 @@ create_cp1252(pdfio_file_t *pdf)	// I - PDF file
 
 
 //
-// 'ttf_error_cb()' - Relay a message from the TTF functions.
+// 'fcache_delete()' - Free a font cache entry.
 //
 
 static void
-ttf_error_cb(pdfio_file_t *pdf,		// I - PDF file
-             const char   *message)	// I - Error message
+fcache_delete(_pdfio_fcache_t *fc)	// I - Font cache entry
 {
-  (pdf->error_cb)(pdf, message, pdf->error_data);
+  ttfDelete(fc->ttf);
+  free(fc->filename);
+  free(fc->file_data);
+  free(fc->cid2gid_data);
+  free(fc->cff_data);
+  free(fc->widths);
+#ifndef _WIN32
+  pthread_mutex_destroy(&fc->mutex);
+#endif // !_WIN32
+  free(fc);
 }
 
 
 //
-// 'update_png_crc()' - Update the CRC-32 value for a PNG chunk.
+// 'fcache_find()' - Find a font in the font cache.
+//
+// The font cache must be locked.  A matching entry is moved to the front of
+// the cache.
 //
 
-static unsigned				// O - CRC-32 value
-update_png_crc(
-    unsigned            crc,		// I - CRC-32 value
-    const unsigned char *buffer,	// I - Buffer
-    size_t              length)		// I - Length of buffer
+static _pdfio_fcache_t *		// O - Font cache entry or `NULL` if not found
+fcache_find(const char  *filename,	// I - Font filename
+            struct stat *fileinfo)	// I - Font file information
 {
-  while (length > 0)
+  _pdfio_fcache_t *fc,			// Current entry
+		*prev;			// Previous entry
+
+
+  for (prev = NULL, fc = fcache; fc; prev = fc, fc = fc->next)
   {
-    crc = png_crc_table[(crc ^ *buffer) & 0xff] ^ (crc >> 8);
-    buffer ++;
-    length --;
+    if (fc->mtime == fileinfo->st_mtime && fc->size == fileinfo->st_size && !strcmp(fc->filename, filename))
+      break;
   }
 
-  return (crc);
+  if (fc && prev)
+  {
+    // Found it, move it to the front of the cache...
+    prev->next = fc->next;
+    fc->next   = fcache;
+    fcache     = fc;
+  }
+
+  return (fc);
 }
 
 
 //
-// 'write_string()' - Write a PDF string.
+// 'fcache_get()' - Get a font from the font cache, loading it as needed.
+//
+// Fonts are cached by filename, modification time, and size so that the same
+// font can be embedded in many PDF files without reading and parsing it again.
+// New fonts are loaded without holding the cache lock; if another thread adds
+// the same font first, its entry is used instead.  The returned entry must be
+// released using @link fcache_release@.
 //
 
-static bool				// O - `true` on success, `false` otherwise
-write_string(pdfio_stream_t *st,	// I - Stream
-             bool           unicode,	// I - Unicode text?
-             const char     *s,		// I - String
-             bool           *newline)	// O - Ends with a newline?
+static _pdfio_fcache_t *		// O - Font cache entry or `NULL` on error
+fcache_get(pdfio_file_t *pdf,		// I - PDF file
+           const char   *filename)	// I - Font filename
 {
-  int		ch;			// Unicode character
-  const char	*ptr;			// Pointer into string
+  struct stat	fileinfo;		// Font file information
+  _pdfio_fcache_t *fc,			// Current entry
+		*newfc = NULL,		// New entry
+		*prev,			// Previous entry
+		*next;			// Next entry
+  size_t	count;			// Number of unused entries
 
 
-  // Start the string...
-  if (!pdfioStreamPuts(st, unicode ? "<" : "("))
-    return (false);
+  if (stat(filename, &fileinfo))
+  {
+    _pdfioFileError(pdf, "Unable to open font file '%s': %s", filename, strerror(errno));
+    return (NULL);
+  }
+
+  // Look for an existing entry for this file...
+  fcache_lock();
+  fc = fcache_find(filename, &fileinfo);
+  fcache_unlock();
 
-  // Loop through the string, handling UTF-8 as needed...
-  for (ptr = s; *ptr; ptr ++)
+  if (!fc)
   {
-    if ((*ptr & 0xe0) == 0xc0)
+    // Not found, load the font...
+    if ((newfc = (_pdfio_fcache_t *)calloc(1, sizeof(_pdfio_fcache_t))) == NULL)
     {
-      // Two-byte UTF-8
-      ch = ((ptr[0] & 0x1f) << 6) | (ptr[1] & 0x3f);
-      ptr ++;
+      _pdfioFileError(pdf, "Unable to allocate memory for font.");
+      return (NULL);
     }
-    else if ((*ptr & 0xf0) == 0xe0)
+
+#ifdef _WIN32
+    InitializeSRWLock(&newfc->mutex);
+#else
+    pthread_mutex_init(&newfc->mutex, NULL);
+#endif // _WIN32
+
+    if ((newfc->filename = strdup(filename)) == NULL)
     {
-      // Three-byte UTF-8
-      ch = ((ptr[0] & 0x0f) << 12) | ((ptr[1] & 0x3f) << 6) | (ptr[2] & 0x3f);
-      ptr += 2;
+      _pdfioFileError(pdf, "Unable to allocate memory for font.");
+      fcache_delete(newfc);
+      return (NULL);
     }
-    else if ((*ptr & 0xf8) == 0xf0)
+
+    // The new entry is not shared yet, so report errors to this PDF file...
+    newfc->pdf = pdf;
+    newfc->ttf = ttfCreate(filename, 0, ttf_error_cb, newfc);
+    newfc->pdf = NULL;
+
+    if (!newfc->ttf)
     {
-      // Four-byte UTF-8
-      ch = ((ptr[0] & 0x07) << 18) | ((ptr[1] & 0x3f) << 12) | ((ptr[2] & 0x3f) << 6) | (ptr[3] & 0x3f);
-      ptr += 3;
+      fcache_delete(newfc);
+      return (NULL);
     }
-    else if (*ptr == '\n' && newline)
+
+    newfc->mtime = fileinfo.st_mtime;
+    newfc->size  = fileinfo.st_size;
+  }
+
+  fcache_lock();
+
+  if (newfc && (fc = fcache_find(filename, &fileinfo)) == NULL)
+  {
+    // Add the new entry to the front of the cache...
+    fc          = newfc;
+    fc->next    = fcache;
+    fcache      = fc;
+    newfc       = NULL;
+  }
+
+  fc->refcount ++;
+
+  // Remove stale entries for the same file and limit the number of unused
+  // entries in the cache...
+  for (prev = fc, next = fc->next, count = 0; next; next = prev->next)
+  {
+    if (next->refcount == 0 && (!strcmp(next->filename, filename) || ++ count > _PDFIO_MAX_FCACHE))
     {
-      *newline = true;
-      break;
+      prev->next = next->next;
+      fcache_delete(next);
     }
     else
-      ch = *ptr & 255;
+    {
+      prev = next;
+    }
+  }
 
-    if (unicode)
+  fcache_unlock();
+
+  if (newfc)
+  {
+    // Another thread loaded the same font first...
+    fcache_delete(newfc);
+  }
+
+  return (fc);
+}
+
+
+//
+// 'fcache_load()' - Load the cached font data needed for embedding.
+//
+// The font file data is compressed once for all PDF files that embed the whole
+// font.  Unicode fonts also use a compressed CIDToGIDMap and an encoded W array
+// that are generated from the font's cmap and glyph metrics.  Unicode fonts
+// with CFF outlines use a compressed CID-keyed CFF font program instead of the
+// font file and CIDToGIDMap.  Subset fonts only need the ToUnicode CMap that
+// is shared by all Unicode fonts.
+//
+// The data is generated without holding the cache lock, which is only taken to
+// see what is missing and to store the results.  If another thread stores the
+// same data first, its copy is used and ours is discarded.
+//
+
+static bool				// O - `true` on success, `false` on error
+fcache_load(pdfio_file_t    *pdf,	// I - PDF file
+            _pdfio_fcache_t *fc,	// I - Font cache entry
+            bool            subset,	// I - Subset the font?
+            bool            unicode)	// I - Unicode font?
+{
+  bool		ret = false,		// Return value
+		cff = ttfIsCFF(fc->ttf),// CFF outlines?
+		need_cff,		// Need CID-keyed CFF data?
+		need_file,		// Need font file data?
+		need_cid2gid,		// Need CIDToGIDMap data?
+		need_widths,		// Need W array values?
+		need_to_unicode;	// Need ToUnicode CMap?
+  unsigned char	*data = NULL,		// Uncompressed data
+		*cff_data = NULL,	// Compressed CID-keyed CFF data
+		*file_data = NULL,	// Compressed font file data
+		*cid2gid_data = NULL,	// Compressed CIDToGIDMap data
+		*to_unicode = NULL;	// Compressed ToUnicode CMap
+  size_t	datasize,		// Size of uncompressed data
+		cff_size = 0,		// Size of compressed CID-keyed CFF data
+		file_size = 0,		// Size of compressed font file data
+		cid2gid_size = 0,	// Size of compressed CIDToGIDMap data
+		to_unicode_size = 0;	// Size of compressed ToUnicode CMap
+  int		*widths = NULL;		// Encoded W array values
+  size_t	num_widths = 0;		// Number of encoded W array values
+
+
+  // See what still needs to be loaded...
+  fcache_lock();
+
+  need_cff        = !subset && unicode && cff && !fc->cff_data;
+  need_file       = !subset && !(unicode && cff) && !fc->file_data;
+  need_cid2gid    = !subset && unicode && !cff && !fc->cid2gid_data;
+  need_widths     = !subset && unicode && !fc->widths;
+  need_to_unicode = unicode && !fcache_to_unicode;
+
+  fcache_unlock();
+
+  if (need_cff)
+  {
+    // Create and compress a CID-keyed CFF font program for all characters...
+    int		*chars,			// Characters in font
+		ch,			// Current character
+		max_char = ttfGetMaxChar(fc->ttf);
+					// Last character in font
+    size_t	num_chars;		// Number of characters
+
+    if (max_char > 65535)
+      max_char = 65535;
+
+    if ((chars = (int *)malloc((size_t)(max_char + 1) * sizeof(int))) == NULL)
     {
-      // Write a two-byte character...
-      if (!pdfioStreamPrintf(st, "%04X", ch))
-	return (false);
+      _pdfioFileError(pdf, "Unable to allocate memory for font file.");
+      goto done;
     }
-    else
+
+    for (ch = 0, num_chars = 0; ch <= max_char; ch ++)
     {
-      // Write a one-byte character...
-      if (ch == '\\' || ch == '(' || ch == ')' || ch < ' ')
+      if (ttfGetGlyph(fc->ttf, ch) > 0)
+	chars[num_chars ++] = ch;
+    }
+
+    fcache_lock_font(fc, pdf);
+    data = ttfCreateCFF(fc->ttf, num_chars, chars, &datasize);
+    fcache_unlock_font(fc);
+
+    free(chars);
+
+    if (!data)
+      goto done;
+
+    if ((cff_data = compress_data(pdf, data, datasize, &cff_size)) == NULL)
+      goto done;
+
+    free(data);
+    data = NULL;
+  }
+
+  if (need_file)
+  {
+    // Read and compress the font file...
+    int		fd;			// File descriptor
+    unsigned char *dataptr;		// Pointer into data
+    ssize_t	bytes;			// Bytes read
+
+    if ((fd = open(fc->filename, O_RDONLY | O_BINARY)) < 0)
+    {
+      _pdfioFileError(pdf, "Unable to open font file '%s': %s", fc->filename, strerror(errno));
+      goto done;
+    }
+
+    datasize = (size_t)fc->size;
+
+    if ((data = (unsigned char *)malloc(datasize > 0 ? datasize : 1)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for font file.");
+      close(fd);
+      goto done;
+    }
+
+    for (dataptr = data; dataptr < (data + datasize); dataptr += bytes)
+    {
+      if ((bytes = read(fd, dataptr, (size_t)(data + datasize - dataptr))) <= 0)
       {
-        // Escaped character...
-        if (ch < ' ')
-        {
-          if (!pdfioStreamPrintf(st, "\\%03o", ch))
-            return (false);
-        }
-        else if (!pdfioStreamPrintf(st, "\\%c", ch))
-          return (false);
+	_pdfioFileError(pdf, "Unable to read font file '%s'.", fc->filename);
+	close(fd);
+	goto done;
       }
-      else
-      {
-        // Non-escaped character...
-        if (ch > 255)
-	{
-	  // Try mapping from Unicode to CP1252...
-	  int i;				// Looping var
+    }
 
-	  for (i = 0; i < (int)(sizeof(_pdfio_cp1252) / sizeof(_pdfio_cp1252[0])); i ++)
-	  {
-	    if (ch == _pdfio_cp1252[i])
-	    {
-	      ch = i + 128;
-	      break;
-	    }
-	  }
+    close(fd);
 
-	  if (ch > 255)
-	    ch = '?';				// Unsupported chars map to ?
-	}
+    if ((file_data = compress_data(pdf, data, datasize, &file_size)) == NULL)
+      goto done;
 
-        // Write the character...
-        pdfioStreamPutChar(st, ch);
-      }
+    free(data);
+    data = NULL;
+  }
+
+  if (need_cid2gid)
+  {
+    // Map Unicode CIDs to glyphs...
+    int		i,			// Looping var
+		glyph,			// Glyph index
+		num_cids = ttfGetMaxChar(fc->ttf) + 1;
+					// Number of CIDs
+
+    datasize = 2 * (size_t)num_cids;
+
+    if ((data = (unsigned char *)malloc(datasize > 0 ? datasize : 1)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for CIDToGIDMap.");
+      goto done;
+    }
+
+    for (i = 0; i < num_cids; i ++)
+    {
+      // Map undefined glyphs to .notdef...
+      if ((glyph = ttfGetGlyph(fc->ttf, i)) < 0)
+        glyph = 0;
+
+      data[2 * i]     = (unsigned char)(glyph >> 8);
+      data[2 * i + 1] = (unsigned char)(glyph & 255);
     }
+
+    if ((cid2gid_data = compress_data(pdf, data, datasize, &cid2gid_size)) == NULL)
+      goto done;
+
+    free(data);
+    data = NULL;
   }
 
-  return (pdfioStreamPuts(st, unicode ? ">" : ")"));
+  if (need_widths)
+  {
+    // Encode the W array values as "first last width" for repeating widths
+    // and "first -count width ... width" for non-repeating widths...
+    size_t	i,			// Looping var
+		start,			// Start character
+		first;			// First value of sequence
+    int		w0, w1,			// Widths
+		*temp;			// Resized widths
+
+    if ((widths = (int *)malloc(3 * 65536 * sizeof(int))) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for font widths.");
+      goto done;
+    }
+
+    for (start = 0, w0 = ttfGetWidth(fc->ttf, 0), w1 = 0, i = 1; i < 65536; start = i, w0 = w1, i ++)
+    {
+      while (i < 65536 && (w1 = ttfGetWidth(fc->ttf, (int)i)) == w0)
+        i ++;
+
+      if ((i - start) > 1)
+      {
+        // Encode a repeating sequence...
+        widths[num_widths ++] = (int)start;
+        widths[num_widths ++] = (int)(i - 1);
+        widths[num_widths ++] = w0;
+      }
+      else
+      {
+        // Encode a non-repeating sequence...
+        widths[num_widths ++] = (int)start;
+        first = num_widths ++;
+
+        widths[num_widths ++] = w0;
+        for (w0 = w1, i ++; i < 65536; w0 = w1, i ++)
+        {
+          if ((w1 = ttfGetWidth(fc->ttf, (int)i)) == w0 && i < 65535)
+            break;
+
+	  widths[num_widths ++] = w0;
+        }
+
+        if (i == 65536)
+	  widths[num_widths ++] = w0;
+	else
+	  i --;
+
+        widths[first] = -(int)(num_widths - first - 1);
+      }
+    }
+
+    if ((temp = (int *)realloc(widths, num_widths * sizeof(int))) != NULL)
+      widths = temp;
+  }
+
+  if (need_to_unicode)
+  {
+    // Compress the ToUnicode CMap that is shared by all Unicode fonts...
+    if ((to_unicode = compress_data(pdf, (const unsigned char *)to_unicode_cmap, strlen(to_unicode_cmap), &to_unicode_size)) == NULL)
+      goto done;
+  }
+
+  // Store the new data unless another thread got there first...
+  fcache_lock();
+
+  if (cff_data && !fc->cff_data)
+  {
+    fc->cff_data = cff_data;
+    fc->cff_size = cff_size;
+    cff_data     = NULL;
+  }
+
+  if (file_data && !fc->file_data)
+  {
+    fc->file_data = file_data;
+    fc->file_size = file_size;
+    file_data     = NULL;
+  }
+
+  if (cid2gid_data && !fc->cid2gid_data)
+  {
+    fc->cid2gid_data = cid2gid_data;
+    fc->cid2gid_size = cid2gid_size;
+    cid2gid_data     = NULL;
+  }
+
+  if (widths && !fc->widths)
+  {
+    fc->widths     = widths;
+    fc->num_widths = num_widths;
+    widths         = NULL;
+  }
+
+  if (to_unicode && !fcache_to_unicode)
+  {
+    fcache_to_unicode      = to_unicode;
+    fcache_to_unicode_size = to_unicode_size;
+    to_unicode             = NULL;
+  }
+
+  fcache_unlock();
+
+  ret = true;
+
+  done:
+
+  free(data);
+  free(cff_data);
+  free(file_data);
+  free(cid2gid_data);
+  free(widths);
+  free(to_unicode);
+
+  return (ret);
+}
+
+
+//
+// 'fcache_lock()' - Lock the font cache.
+//
+
+static void
+fcache_lock(void)
+{
+#ifdef _WIN32
+  AcquireSRWLockExclusive(&fcache_mutex);
+#else
+  pthread_mutex_lock(&fcache_mutex);
+#endif // _WIN32
+}
+
+
+//
+// 'fcache_lock_font()' - Lock a cached font for TrueType functions that can
+//                        report errors or that are not thread-safe.
+//
+// Errors are reported to the PDF file until @link fcache_unlock_font@ is
+// called.
+//
+
+static void
+fcache_lock_font(_pdfio_fcache_t *fc,	// I - Font cache entry
+                 pdfio_file_t    *pdf)	// I - PDF file for errors
+{
+#ifdef _WIN32
+  AcquireSRWLockExclusive(&fc->mutex);
+#else
+  pthread_mutex_lock(&fc->mutex);
+#endif // _WIN32
+
+  fc->pdf = pdf;
+}
+
+
+//
+// 'fcache_release()' - Release a font cache entry.
+//
+// Unused entries remain in the cache so they can be used by later PDF files.
+//
+
+static void
+fcache_release(_pdfio_fcache_t *fc)	// I - Font cache entry
+{
+  fcache_lock();
+
+  if (fc->refcount > 0)
+    fc->refcount --;
+
+  fcache_unlock();
+}
+
+
+//
+// 'fcache_unlock()' - Unlock the font cache.
+//
+
+static void
+fcache_unlock(void)
+{
+#ifdef _WIN32
+  ReleaseSRWLockExclusive(&fcache_mutex);
+#else
+  pthread_mutex_unlock(&fcache_mutex);
+#endif // _WIN32
+}
+
+
+//
+// 'fcache_unlock_font()' - Unlock a cached font.
+//
+
+static void
+fcache_unlock_font(_pdfio_fcache_t *fc)	// I - Font cache entry
+{
+  fc->pdf = NULL;
+
+#ifdef _WIN32
+  ReleaseSRWLockExclusive(&fc->mutex);
+#else
+  pthread_mutex_unlock(&fc->mutex);
+#endif // _WIN32
+}
+
+
+//
+// 'free_font()' - Free embedded font data.
+//
+
+static void
+free_font(_pdfio_font_t *font)		// I - Font data
+{
+  fcache_release(font->fc);
+  free(font);
+}
+
+
+//
+// 'get_char()' - Get the next character from a UTF-8 string.
+//
+// Characters that cannot be shown with a CP1252 font are returned as '?'.
+//
+
+static int				// O - Unicode character
+get_char(const char **s,		// IO - Pointer into string
+         bool       unicode)		// I  - Unicode font?
+{
+  const char	*ptr = *s;		// Pointer into string
+  int		ch;			// Unicode character
+
+
+  if ((*ptr & 0xe0) == 0xc0 && ptr[1])
+  {
+    // Two-byte UTF-8
+    ch  = ((ptr[0] & 0x1f) << 6) | (ptr[1] & 0x3f);
+    ptr += 2;
+  }
+  else if ((*ptr & 0xf0) == 0xe0 && ptr[1] && ptr[2])
+  {
+    // Three-byte UTF-8
+    ch  = ((ptr[0] & 0x0f) << 12) | ((ptr[1] & 0x3f) << 6) | (ptr[2] & 0x3f);
+    ptr += 3;
+  }
+  else if ((*ptr & 0xf8) == 0xf0 && ptr[1] && ptr[2] && ptr[3])
+  {
+    // Four-byte UTF-8
+    ch  = ((ptr[0] & 0x07) << 18) | ((ptr[1] & 0x3f) << 12) | ((ptr[2] & 0x3f) << 6) | (ptr[3] & 0x3f);
+    ptr += 4;
+  }
+  else
+  {
+    ch = *ptr++ & 255;
+  }
+
+  *s = ptr;
+
+  if (!unicode && ch > 255 && map_cp1252(ch) == '?')
+    ch = '?';				// Unsupported chars map to ?
+
+  return (ch);
+}
+
+
+//
+// 'layout_line()' - Find the end of the next line of a paragraph.
+//
+// The line is broken after the last word that fits in "max_width", or before
+// the first character that does not fit when a single word is too long.
+// Spaces at the end of the line are not included in the line, and the spaces
+// after a soft line break are skipped.  Each character is measured once, and
+// the widths are summed so that the width at each word break is known without
+// measuring the line again.
+//
+
+static const char *			// O - Start of next line
+layout_line(ttf_t      *ttf,		// I - TrueType font
+            bool       unicode,		// I - Unicode font?
+            const char *s,		// I - Start of line
+            int        max_width,	// I - Maximum width in font units
+            const char **line_end,	// O - End of line
+            int        *line_width,	// O - Width of line in font units
+            bool       *hard)		// O - Line ends with a newline or the end of the text?
+{
+  const char	*ptr = s,		// Pointer into line
+		*next,			// Next character
+		*word_end = s,		// End of last word
+		*brk_end = NULL;	// End of line at last word break
+  int		ch,			// Current character
+		advance,		// Advance width of character
+		width = 0,		// Width up to current character
+		word_width = 0,		// Width up to end of last word
+		brk_width = 0;		// Width up to last word break
+
+
+  while (*ptr && *ptr != '\n')
+  {
+    next = ptr;
+
+    if ((ch = get_char(&next, unicode)) == ' ')
+    {
+      // Remember the word break but let spaces extend past the margin...
+      if (word_end > s)
+      {
+        brk_end   = word_end;
+        brk_width = word_width;
+      }
+
+      width += ttfGetAdvance(ttf, ' ');
+      ptr   = next;
+      continue;
+    }
+    else if (ch < ' ')
+    {
+      // Ignore control characters...
+      ptr = next;
+      continue;
+    }
+    else if (unicode && ch > 0xffff)
+    {
+      ch = '?';				// Characters outside the BMP map to ?
+    }
+
+    advance = ttfGetAdvance(ttf, ch);
+
+    if ((width + advance) > max_width && word_end > s)
+    {
+      // Soft line break...
+      *hard = false;
+
+      if (brk_end)
+      {
+        // Break after the last word that fits...
+        *line_end   = brk_end;
+        *line_width = brk_width;
+
+        // Skip the spaces after the break - the loop stops at newlines, so the
+        // next character is never a newline...
+        for (ptr = brk_end; *ptr == ' '; ptr ++);
+
+        return (ptr);
+      }
+      else
+      {
+        // Break the word...
+        *line_end   = ptr;
+        *line_width = width;
+
+        return (ptr);
+      }
+    }
+
+    width      += advance;
+    word_end   = ptr = next;
+    word_width = width;
+  }
+
+  // Hard line break...
+  *hard       = true;
+  *line_end   = word_end;
+  *line_width = word_width;
+
+  return (*ptr == '\n' ? ptr + 1 : ptr);
+}
+
+
+//
+// 'map_cp1252()' - Map a Unicode character to CP1252.
+//
+
+static int				// O - CP1252 character code or '?'
+map_cp1252(int ch)			// I - Unicode character
+{
+  size_t	left,			// Left side of search
+		right,			// Right side of search
+		current;		// Current entry
+
+
+  if (ch < 256)
+    return (ch);
+
+  // Binary search the sorted reverse mapping table...
+  for (left = 0, right = sizeof(_pdfio_unicode_cp1252) / sizeof(_pdfio_unicode_cp1252[0]); left < right;)
+  {
+    current = (left + right) / 2;
+
+    if (ch < _pdfio_unicode_cp1252[current][0])
+      right = current;
+    else if (ch > _pdfio_unicode_cp1252[current][0])
+      left = current + 1;
+    else
+      return (_pdfio_unicode_cp1252[current][1]);
+  }
+
+  return ('?');
+}
+
+
+//
+// 'measure_string()' - Measure a UTF-8 string in font units.
+//
+// Control characters are ignored.  Characters that cannot be shown with a
+// CP1252 font are measured as '?'.
+//
+
+static int				// O - Width in font units
+measure_string(ttf_t      *ttf,		// I - TrueType font
+               bool       unicode,	// I - Unicode font?
+               const char *s,		// I - UTF-8 string
+               size_t     len)		// I - Length of string
+{
+  int			ch,		// Unicode character
+			width = 0;	// Width of string
+  const unsigned char	*ptr = (const unsigned char *)s,
+					// Pointer into string
+			*end = ptr + len;
+					// End of string
+
+
+  while (ptr < end)
+  {
+    if (!(*ptr & 0x80))
+    {
+      // ASCII
+      ch = *ptr++;
+
+      if (ch < ' ' || ch == 0x7f)
+        continue;			// Skip control characters
+
+      width += ttfGetAdvance(ttf, ch);
+      continue;
+    }
+    else if ((*ptr & 0xe0) == 0xc0 && (ptr + 1) < end)
+    {
+      // Two-byte UTF-8
+      ch  = ((ptr[0] & 0x1f) << 6) | (ptr[1] & 0x3f);
+      ptr += 2;
+    }
+    else if ((*ptr & 0xf0) == 0xe0 && (ptr + 2) < end)
+    {
+      // Three-byte UTF-8
+      ch  = ((ptr[0] & 0x0f) << 12) | ((ptr[1] & 0x3f) << 6) | (ptr[2] & 0x3f);
+      ptr += 3;
+    }
+    else if ((*ptr & 0xf8) == 0xf0 && (ptr + 3) < end)
+    {
+      // Four-byte UTF-8
+      ch  = ((ptr[0] & 0x07) << 18) | ((ptr[1] & 0x3f) << 12) | ((ptr[2] & 0x3f) << 6) | (ptr[3] & 0x3f);
+      ptr += 4;
+    }
+    else
+    {
+      // Invalid UTF-8, use the byte as-is...
+      ch = *ptr++;
+    }
+
+    if (unicode ? ch > 0xffff : (ch > 255 && map_cp1252(ch) == '?'))
+      ch = '?';				// Unsupported chars map to ?
+
+    width += ttfGetAdvance(ttf, ch);
+  }
+
+  return (width);
+}
+
+
+//
+// 'ttf_error_cb()' - Relay a message from the TTF functions.
+//
+
+static void
+ttf_error_cb(void       *data,		// I - Font cache entry
+             const char *message)	// I - Error message
+{
+  _pdfio_fcache_t *fc = (_pdfio_fcache_t *)data;
+					// Font cache entry
+
+
+  // Fonts can be shared by multiple PDF files, so errors are reported to the
+  // PDF file that has locked the font (see fcache_lock_font)...
+  if (fc && fc->pdf)
+    (fc->pdf->error_cb)(fc->pdf, message, fc->pdf->error_data);
+}
+
+
+//
+// 'update_png_crc()' - Update the CRC-32 value for a PNG chunk.
+//
+
+static unsigned				// O - CRC-32 value
+update_png_crc(
+    unsigned            crc,		// I - CRC-32 value
+    const unsigned char *buffer,	// I - Buffer
+    size_t              length)		// I - Length of buffer
+{
+  while (length > 0)
+  {
+    crc = png_crc_table[(crc ^ *buffer) & 0xff] ^ (crc >> 8);
+    buffer ++;
+    length --;
+  }
+
+  return (crc);
+}
+
+
+//
+// 'write_cid_font()' - Write the widths and CID mapping for a subset font.
+//
+// The "W" array only lists the widths of the characters that were used, with
+// runs of the same width collapsed into a single range, and the CIDToGIDMap
+// stream (TrueType outlines only) ends with the last character that was used.
+//
+
+static bool				// O - `true` on success, `false` on failure
+write_cid_font(pdfio_file_t  *pdf,	// I - PDF file
+               _pdfio_font_t *font,	// I - Font data
+               const int     *chars,	// I - Characters used
+               size_t        num_chars)	// I - Number of characters used
+{
+  bool		ret = true;		// Return value
+  size_t	i,			// Looping var
+		j;			// End of current sequence
+  int		width,			// Width of character
+		glyph;			// Glyph index
+  pdfio_array_t	*w_array,		// Width array
+		*temp_array;		// Width sub-array
+  unsigned char	*data;			// CIDToGIDMap data
+  size_t	datasize;		// Size of CIDToGIDMap data
+  pdfio_stream_t *st;			// CIDToGIDMap stream
+
+
+  // Build the width array...
+  if ((w_array = pdfioArrayCreate(pdf)) == NULL)
+    return (false);
+
+  for (i = 0; i < num_chars; i = j)
+  {
+    width = ttfGetWidth(font->ttf, chars[i]);
+
+    for (j = i + 1; j < num_chars && chars[j] == (chars[j - 1] + 1) && ttfGetWidth(font->ttf, chars[j]) == width; j ++);
+
+    pdfioArrayAppendNumber(w_array, chars[i]);
+
+    if ((j - i) > 1)
+    {
+      // Encode a run of characters with the same width...
+      pdfioArrayAppendNumber(w_array, chars[j - 1]);
+      pdfioArrayAppendNumber(w_array, width);
+    }
+    else
+    {
+      // Encode consecutive characters with different widths, stopping at the
+      // start of a run with the same width...
+      for (j = i + 1; j < num_chars && chars[j] == (chars[j - 1] + 1); j ++)
+      {
+        if ((j + 1) < num_chars && chars[j + 1] == (chars[j] + 1) && ttfGetWidth(font->ttf, chars[j + 1]) == ttfGetWidth(font->ttf, chars[j]))
+          break;
+      }
+
+      if ((temp_array = pdfioArrayCreate(pdf)) == NULL)
+        return (false);
+
+      pdfioArrayAppendNumber(temp_array, width);
+      while (++ i < j)
+        pdfioArrayAppendNumber(temp_array, ttfGetWidth(font->ttf, chars[i]));
+
+      pdfioArrayAppendArray(w_array, temp_array);
+    }
+  }
+
+  pdfioDictSetArray(pdfioObjGetDict(font->type2_obj), "W", w_array);
+
+  // Build the CIDToGIDMap for the characters that are used...
+  if (!font->cid2gid_obj)
+    return (pdfioObjClose(font->type2_obj));
+
+  datasize = 2 * (num_chars > 0 ? (size_t)chars[num_chars - 1] + 1 : 1);
+
+  if ((data = (unsigned char *)calloc(1, datasize)) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for CIDToGIDMap.");
+    return (false);
+  }
+
+  for (i = 0; i < num_chars; i ++)
+  {
+    if ((glyph = ttfGetGlyph(font->ttf, chars[i])) > 0)
+    {
+      data[2 * chars[i]]     = (unsigned char)(glyph >> 8);
+      data[2 * chars[i] + 1] = (unsigned char)(glyph & 255);
+    }
+  }
+
+  if ((st = pdfioObjCreateStream(font->cid2gid_obj, PDFIO_FILTER_FLATE)) == NULL)
+  {
+    ret = false;
+  }
+  else
+  {
+    if (!pdfioStreamWrite(st, data, datasize))
+      ret = false;
+
+    if (!pdfioStreamClose(st))
+      ret = false;
+  }
+
+  free(data);
+
+  // Write the CIDFontType2 object...
+  if (ret && !pdfioObjClose(font->type2_obj))
+    ret = false;
+
+  return (ret);
+}
+
+
+//
+// 'write_string()' - Write a PDF string.
+//
+
+static bool				// O - `true` on success, `false` otherwise
+write_string(pdfio_stream_t *st,	// I - Stream
+             bool           unicode,	// I - Unicode text?
+             const char     *s,		// I - String
+             size_t         slen,	// I - Length of string
+             bool           *newline)	// O - Ends with a newline?
+{
+  int			ch,		// Unicode character
+			code;		// CP1252 character code
+  const unsigned char	*ptr = (const unsigned char *)s,
+					// Pointer into string
+			*end = ptr + slen;
+					// End of string
+  char			buffer[1024],	// Output buffer
+			*bufptr = buffer,
+					// Pointer into output buffer
+			*bufend = buffer + sizeof(buffer) - 4;
+					// End of output buffer with room for one character
+  _pdfio_font_t		*fdata = st->font ? (_pdfio_font_t *)_pdfioObjGetExtension(st->font) : NULL;
+					// Embedded font data
+  unsigned char		*used = fdata && fdata->file_obj ? fdata->used : NULL;
+					// Used characters bitmap, if subsetting
+  static const char	hexchars[] = "0123456789ABCDEF";
+					// Hex digits
+
+
+  // Start the string...
+  *bufptr++ = unicode ? '<' : '(';
+
+  // Loop through the string, encoding into the output buffer...
+  while (ptr < end)
+  {
+    if (bufptr >= bufend)
+    {
+      // Flush the output buffer...
+      if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
+        return (false);
+
+      bufptr = buffer;
+    }
+
+    if (!unicode && !used)
+    {
+      // Copy runs of ASCII characters that don't need escaping...
+      while (ptr < end && bufptr < bufend && *ptr >= ' ' && *ptr < 0x80 && *ptr != '(' && *ptr != ')' && *ptr != '\\')
+        *bufptr++ = (char)*ptr++;
+
+      if (ptr >= end || bufptr >= bufend)
+        continue;
+    }
+
+    // Decode the next character...
+    if (!(*ptr & 0x80))
+    {
+      // ASCII
+      if (*ptr == '\n' && newline)
+      {
+	*newline = true;
+	break;
+      }
+
+      ch = *ptr++;
+    }
+    else if ((*ptr & 0xe0) == 0xc0 && (ptr + 1) < end)
+    {
+      // Two-byte UTF-8
+      ch  = ((ptr[0] & 0x1f) << 6) | (ptr[1] & 0x3f);
+      ptr += 2;
+    }
+    else if ((*ptr & 0xf0) == 0xe0 && (ptr + 2) < end)
+    {
+      // Three-byte UTF-8
+      ch  = ((ptr[0] & 0x0f) << 12) | ((ptr[1] & 0x3f) << 6) | (ptr[2] & 0x3f);
+      ptr += 3;
+    }
+    else if ((*ptr & 0xf8) == 0xf0 && (ptr + 3) < end)
+    {
+      // Four-byte UTF-8
+      ch  = ((ptr[0] & 0x07) << 18) | ((ptr[1] & 0x3f) << 12) | ((ptr[2] & 0x3f) << 6) | (ptr[3] & 0x3f);
+      ptr += 4;
+    }
+    else
+    {
+      // Invalid UTF-8, use the byte as-is...
+      ch = *ptr++;
+    }
+
+    if (unicode)
+    {
+      // Write a two-byte character...
+      if (ch > 0xffff)
+        ch = '?';			// Characters outside the BMP map to ?
+
+      if (used)
+        used[ch >> 3] |= 1 << (ch & 7);
+
+      *bufptr++ = hexchars[(ch >> 12) & 15];
+      *bufptr++ = hexchars[(ch >> 8) & 15];
+      *bufptr++ = hexchars[(ch >> 4) & 15];
+      *bufptr++ = hexchars[ch & 15];
+    }
+    else
+    {
+      // Write a one-byte character...
+      code = ch > 255 ? map_cp1252(ch) : ch;
+
+      if (used)
+      {
+        // Record the Unicode character for the CP1252 code...
+        int uch = (code >= 128 && code < 160 && _pdfio_cp1252[code - 128]) ? _pdfio_cp1252[code - 128] : code;
+					// Unicode character
+
+	used[uch >> 3] |= 1 << (uch & 7);
+      }
+
+      if (code < ' ')
+      {
+        // Escaped control character...
+        *bufptr++ = '\\';
+        *bufptr++ = (char)('0' + ((code >> 6) & 7));
+        *bufptr++ = (char)('0' + ((code >> 3) & 7));
+        *bufptr++ = (char)('0' + (code & 7));
+      }
+      else if (code == '(' || code == ')' || code == '\\')
+      {
+        // Escaped delimiter...
+        *bufptr++ = '\\';
+        *bufptr++ = (char)code;
+      }
+      else
+      {
+        // Non-escaped character...
+        *bufptr++ = (char)code;
+      }
+    }
+  }
+
+  // End the string and write it...
+  *bufptr++ = unicode ? '>' : ')';
+
+  return (pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)));
 }
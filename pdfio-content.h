@@ -42,6 +42,14 @@ typedef enum pdfio_linejoin_e		// Line joining modes
 
 typedef double pdfio_matrix_t[3][2];	// Transform matrix
 
+typedef enum pdfio_textalign_e		// Text alignment for paragraphs
+{
+  PDFIO_TEXTALIGN_LEFT,			// Align text to the left margin
+  PDFIO_TEXTALIGN_CENTER,		// Center text between the margins
+  PDFIO_TEXTALIGN_RIGHT,		// Align text to the right margin
+  PDFIO_TEXTALIGN_JUSTIFY		// Align text to both margins
+} pdfio_textalign_t;
+
 typedef enum pdfio_textrendering_e	// Text rendering modes
 {
   PDFIO_TEXTRENDERING_FILL,		// Fill text
@@ -116,6 +124,9 @@ extern bool		pdfioContentStroke(pdfio_stream_t *st) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextBegin(pdfio_stream_t *st) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextEnd(pdfio_stream_t *st) _PDFIO_PUBLIC;
 extern double		pdfioContentTextMeasure(pdfio_obj_t *font, const char *s, double size) _PDFIO_PUBLIC;
+extern double		pdfioContentTextMeasureKerned(pdfio_obj_t *font, const char *s, double size) _PDFIO_PUBLIC;
+extern double		pdfioContentTextMeasureN(pdfio_obj_t *font, const char *s, size_t len, double size) _PDFIO_PUBLIC;
+extern bool		pdfioContentTextMeasureStrings(pdfio_obj_t *font, size_t num_strings, const char * const *strings, const size_t *lengths, double size, double *widths) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextMoveLine(pdfio_stream_t *st, double tx, double ty) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextMoveTo(pdfio_stream_t *st, double tx, double ty) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextNewLine(pdfio_stream_t *st) _PDFIO_PUBLIC;
@@ -125,6 +136,8 @@ extern bool		pdfioContentTextNextLine(pdfio_stream_t *st) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextShow(pdfio_stream_t *st, bool unicode, const char *s) _PDFIO_PUBLIC;
 extern bool		pdfioContentTextShowf(pdfio_stream_t *st, bool unicode, const char *format, ...) _PDFIO_PUBLIC _PDFIO_FORMAT(3,4);
 extern bool		pdfioContentTextShowJustified(pdfio_stream_t *st, bool unicode, size_t num_fragments, const double *offsets, const char * const *fragments) _PDFIO_PUBLIC;
+extern bool		pdfioContentTextShowKerned(pdfio_stream_t *st, bool unicode, const char *s) _PDFIO_PUBLIC;
+extern bool		pdfioContentTextShowParagraph(pdfio_stream_t *st, bool unicode, double width, pdfio_textalign_t align, size_t max_lines, const char **s, size_t *num_lines) _PDFIO_PUBLIC;
 
 // Resource helpers...
 extern pdfio_obj_t	*pdfioFileCreateFontObjFromBase(pdfio_file_t *pdf, const char *name) _PDFIO_PUBLIC;
@@ -132,6 +145,7 @@ extern pdfio_obj_t	*pdfioFileCreateFontObjFromFile(pdfio_file_t *pdf, const char
 extern pdfio_obj_t	*pdfioFileCreateICCObjFromFile(pdfio_file_t *pdf, const char *filename, size_t num_colors) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioFileCreateImageObjFromData(pdfio_file_t *pdf, const unsigned char *data, size_t width, size_t height, size_t num_colors, pdfio_array_t *color_data, bool alpha, bool interpolate) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioFileCreateImageObjFromFile(pdfio_file_t *pdf, const char *filename, bool interpolate) _PDFIO_PUBLIC;
+extern void		pdfioFileSetSubsetFonts(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
 
 // Image object helpers...
 extern size_t		pdfioImageGetBytesPerLine(pdfio_obj_t *obj) _PDFIO_PUBLIC;
@@ -99,6 +99,7 @@ static uint8_t pdf_passpad[32] =	// Padding for passwords
 static void	decrypt_user_key(pdfio_encryption_t encryption, const uint8_t *file_key, uint8_t user_key[32]);
 static void	encrypt_user_key(pdfio_encryption_t encryption, const uint8_t *file_key, uint8_t user_key[32]);
 static void	make_file_key(pdfio_encryption_t encryption, pdfio_permission_t permissions, const unsigned char *file_id, size_t file_idlen, const uint8_t *user_pad, const uint8_t *owner_key, uint8_t file_key[16]);
+static void	make_object_ctx(pdfio_file_t *pdf, pdfio_obj_t *obj, const uint8_t *file_key, _pdfio_crypto_ctx_t *ctx);
 static void	make_owner_key(pdfio_encryption_t encryption, const uint8_t *owner_pad, const uint8_t *user_pad, uint8_t owner_key[32]);
 static void	make_user_key(const unsigned char *file_id, size_t file_idlen, uint8_t user_key[32]);
 static void	pad_password(const char *password, uint8_t pad[32]);
@@ -161,6 +162,8 @@ _pdfioCryptoLock(
         make_file_key(encryption, permissions, file_id, file_idlen, user_pad, pdf->owner_key, pdf->file_key);
 	pdf->file_keylen = 16;
 
+	memset(pdf->crypto_cache, 0, sizeof(pdf->crypto_cache));
+
 	// Generate the user key...
 	make_user_key(file_id, file_idlen, pdf->user_key);
 	encrypt_user_key(encryption, pdf->file_key, pdf->user_key);
@@ -406,9 +409,6 @@ _pdfioCryptoMakeReader(
      uint8_t             *iv,		// I  - Buffer for initialization vector
      size_t              *ivlen)	// IO - Size of initialization vector
 {
-  uint8_t	data[21];		// Key data
-  _pdfio_md5_t	md5;			// MD5 state
-  uint8_t	digest[16];		// MD5 digest value
 #if PDFIO_OBJ_CRYPT
   pdfio_array_t	*id_array;		// Object ID array
   unsigned char	*id_value;		// Object ID value
@@ -487,21 +487,9 @@ _pdfioCryptoMakeReader(
         return (NULL);
 
     case PDFIO_ENCRYPTION_RC4_40 :
-	// Copy the key data for the MD5 hash.
-	memcpy(data, file_key, 16);
-	data[16] = (uint8_t)obj->number;
-	data[17] = (uint8_t)(obj->number >> 8);
-	data[18] = (uint8_t)(obj->number >> 16);
-	data[19] = (uint8_t)obj->generation;
-	data[20] = (uint8_t)(obj->generation >> 8);
-
-        // Hash it...
-        _pdfioCryptoMD5Init(&md5);
-	_pdfioCryptoMD5Append(&md5, data, sizeof(data));
-	_pdfioCryptoMD5Finish(&md5, digest);
-
-        // Initialize the RC4 context using 40 bits of the digest...
-	_pdfioCryptoRC4Init(&ctx->rc4, digest, 5);
+    case PDFIO_ENCRYPTION_RC4_128 :
+        // Initialize the RC4 context using the object key...
+        make_object_ctx(pdf, obj, file_key, ctx);
 	*ivlen = 0;
 	return ((_pdfio_crypto_cb_t)_pdfioCryptoRC4Crypt);
 
@@ -513,35 +501,11 @@ _pdfioCryptoMakeReader(
           return (NULL);
         }
 
-    case PDFIO_ENCRYPTION_RC4_128 :
-	// Copy the key data for the MD5 hash.
-	memcpy(data, file_key, 16);
-	data[16] = (uint8_t)obj->number;
-	data[17] = (uint8_t)(obj->number >> 8);
-	data[18] = (uint8_t)(obj->number >> 16);
-	data[19] = (uint8_t)obj->generation;
-	data[20] = (uint8_t)(obj->generation >> 8);
-
-        // Hash it...
-        _pdfioCryptoMD5Init(&md5);
-	_pdfioCryptoMD5Append(&md5, data, sizeof(data));
-	if (pdf->encryption == PDFIO_ENCRYPTION_AES_128)
-	  _pdfioCryptoMD5Append(&md5, (const uint8_t *)"sAlT", 4);
-	_pdfioCryptoMD5Finish(&md5, digest);
-
-        // Initialize the RC4/AES context using the digest...
-        if (pdf->encryption == PDFIO_ENCRYPTION_RC4_128)
-        {
-	  *ivlen = 0;
-          _pdfioCryptoRC4Init(&ctx->rc4, digest, sizeof(digest));
-          return ((_pdfio_crypto_cb_t)_pdfioCryptoRC4Crypt);
-	}
-	else
-	{
-	  *ivlen = 16;
-          _pdfioCryptoAESInit(&ctx->aes, digest, sizeof(digest), iv);
-          return ((_pdfio_crypto_cb_t)_pdfioCryptoAESDecrypt);
-	}
+        // Initialize the AES context using the object key...
+        make_object_ctx(pdf, obj, file_key, ctx);
+        memcpy(ctx->aes.iv, iv, 16);
+	*ivlen = 16;
+	return ((_pdfio_crypto_cb_t)_pdfioCryptoAESDecrypt);
   }
 }
 
@@ -558,11 +522,6 @@ _pdfioCryptoMakeWriter(
      uint8_t             *iv,		// I  - Buffer for initialization vector
      size_t              *ivlen)	// IO - Size of initialization vector
 {
-  uint8_t	data[21];		/* Key data */
-  _pdfio_md5_t	md5;			/* MD5 state */
-  uint8_t	digest[16];		/* MD5 digest value */
-
-
   PDFIO_DEBUG("_pdfioCryptoMakeWriter(pdf=%p, obj=%p(%d), ctx=%p, iv=%p, ivlen=%p(%d))\n", pdf, obj, (int)obj->number, ctx, iv, ivlen, (int)*ivlen);
 
   // Range check input...
@@ -579,36 +538,18 @@ _pdfioCryptoMakeWriter(
         return (NULL);
 
     case PDFIO_ENCRYPTION_RC4_128 :
+        // Initialize the RC4 context using the object key...
+        make_object_ctx(pdf, obj, pdf->file_key, ctx);
+	*ivlen = 0;
+	return ((_pdfio_crypto_cb_t)_pdfioCryptoRC4Crypt);
+
     case PDFIO_ENCRYPTION_AES_128 :
-	// Copy the key data for the MD5 hash.
-	memcpy(data, pdf->file_key, sizeof(pdf->file_key));
-	data[16] = (uint8_t)obj->number;
-	data[17] = (uint8_t)(obj->number >> 8);
-	data[18] = (uint8_t)(obj->number >> 16);
-	data[19] = (uint8_t)obj->generation;
-	data[20] = (uint8_t)(obj->generation >> 8);
-
-        // Hash it...
-        _pdfioCryptoMD5Init(&md5);
-	_pdfioCryptoMD5Append(&md5, data, sizeof(data));
-	if (pdf->encryption == PDFIO_ENCRYPTION_AES_128)
-	  _pdfioCryptoMD5Append(&md5, (const uint8_t *)"sAlT", 4);
-	_pdfioCryptoMD5Finish(&md5, digest);
-
-        // Initialize the RC4/AES context using the digest...
-        if (pdf->encryption == PDFIO_ENCRYPTION_RC4_128)
-        {
-	  *ivlen = 0;
-          _pdfioCryptoRC4Init(&ctx->rc4, digest, sizeof(digest));
-          return ((_pdfio_crypto_cb_t)_pdfioCryptoRC4Crypt);
-	}
-	else
-	{
-	  *ivlen = 16;
-	  _pdfioCryptoMakeRandom(iv, *ivlen);
-          _pdfioCryptoAESInit(&ctx->aes, digest, sizeof(digest), iv);
-          return ((_pdfio_crypto_cb_t)_pdfioCryptoAESEncrypt);
-	}
+        // Initialize the AES context using the object key and a random IV...
+        make_object_ctx(pdf, obj, pdf->file_key, ctx);
+	*ivlen = 16;
+	_pdfioCryptoMakeRandom(iv, *ivlen);
+        memcpy(ctx->aes.iv, iv, 16);
+	return ((_pdfio_crypto_cb_t)_pdfioCryptoAESEncrypt);
   }
 }
 
@@ -834,6 +775,7 @@ _pdfioCryptoUnlock(
         // Matches!
         memcpy(pdf->file_key, file_key, sizeof(pdf->file_key));
         memcpy(pdf->password, pad, sizeof(pdf->password));
+        memset(pdf->crypto_cache, 0, sizeof(pdf->crypto_cache));
 
         return (true);
       }
@@ -855,6 +797,7 @@ _pdfioCryptoUnlock(
         // Matches!
         memcpy(pdf->file_key, file_key, sizeof(pdf->file_key));
         memcpy(pdf->password, pad, sizeof(pdf->password));
+        memset(pdf->crypto_cache, 0, sizeof(pdf->crypto_cache));
 
         return (true);
       }
@@ -1006,6 +949,111 @@ make_file_key(
 }
 
 
+//
+// 'make_object_ctx()' - Make the encryption context for an object.
+//
+// The object key is the MD5 hash of the file key, the object number and
+// generation, and "sAlT" for AES.  The key is saved in the object and the
+// initialized RC4/AES context is cached in the PDF file so that the strings and
+// streams of an object do not repeat the key derivation and key schedule.
+// Objects with their own file key are not cached.
+//
+
+static void
+make_object_ctx(
+    pdfio_file_t        *pdf,		// I - PDF file
+    pdfio_obj_t         *obj,		// I - Object
+    const uint8_t       *file_key,	// I - File encryption key
+    _pdfio_crypto_ctx_t *ctx)		// O - Encryption context
+{
+  size_t		i;		// Looping var
+  _pdfio_crypto_cache_t	*cache,		// Current cache entry
+			*oldest = pdf->crypto_cache;
+					// Least recently used cache entry
+  uint8_t		data[21];	// Key data
+  _pdfio_md5_t		md5;		// MD5 state
+  uint8_t		digest[16];	// MD5 digest value
+  bool			use_cache = file_key == pdf->file_key;
+					// Use the cached key and context?
+
+
+  // See if the context is cached...
+  if (use_cache)
+  {
+    for (i = 0, cache = pdf->crypto_cache; i < _PDFIO_MAX_CRYPTO; i ++, cache ++)
+    {
+      if (cache->use && cache->number == obj->number && cache->generation == obj->generation)
+      {
+        PDFIO_DEBUG("make_object_ctx: Using cached context for %lu %u.\n", (unsigned long)obj->number, obj->generation);
+        cache->use = ++ pdf->crypto_use;
+        break;
+      }
+
+      if (cache->use < oldest->use)
+        oldest = cache;
+    }
+
+    if (i < _PDFIO_MAX_CRYPTO)
+    {
+      // Copy the cached context...
+      if (pdf->encryption == PDFIO_ENCRYPTION_AES_128)
+        memcpy(&ctx->aes, &cache->ctx.aes, sizeof(ctx->aes));
+      else
+        memcpy(&ctx->rc4, &cache->ctx.rc4, sizeof(ctx->rc4));
+      return;
+    }
+  }
+
+  if (!use_cache || !obj->crypto_keylen)
+  {
+    // Copy the key data for the MD5 hash.
+    memcpy(data, file_key, 16);
+    data[16] = (uint8_t)obj->number;
+    data[17] = (uint8_t)(obj->number >> 8);
+    data[18] = (uint8_t)(obj->number >> 16);
+    data[19] = (uint8_t)obj->generation;
+    data[20] = (uint8_t)(obj->generation >> 8);
+
+    // Hash it...
+    _pdfioCryptoMD5Init(&md5);
+    _pdfioCryptoMD5Append(&md5, data, sizeof(data));
+    if (pdf->encryption == PDFIO_ENCRYPTION_AES_128)
+      _pdfioCryptoMD5Append(&md5, (const uint8_t *)"sAlT", 4);
+    _pdfioCryptoMD5Finish(&md5, digest);
+
+    if (!use_cache)
+    {
+      // Initialize the context directly...
+      if (pdf->encryption == PDFIO_ENCRYPTION_AES_128)
+        _pdfioCryptoAESInit(&ctx->aes, digest, sizeof(digest), NULL);
+      else
+        _pdfioCryptoRC4Init(&ctx->rc4, digest, pdf->encryption == PDFIO_ENCRYPTION_RC4_40 ? 5 : sizeof(digest));
+      return;
+    }
+
+    // Save the key in the object, using 40 bits of the digest for 40-bit RC4...
+    memcpy(obj->crypto_key, digest, sizeof(obj->crypto_key));
+    obj->crypto_keylen = pdf->encryption == PDFIO_ENCRYPTION_RC4_40 ? 5 : sizeof(obj->crypto_key);
+  }
+
+  // Initialize the least recently used cache entry and copy it...
+  oldest->number     = obj->number;
+  oldest->generation = obj->generation;
+  oldest->use        = ++ pdf->crypto_use;
+
+  if (pdf->encryption == PDFIO_ENCRYPTION_AES_128)
+  {
+    _pdfioCryptoAESInit(&oldest->ctx.aes, obj->crypto_key, obj->crypto_keylen, NULL);
+    memcpy(&ctx->aes, &oldest->ctx.aes, sizeof(ctx->aes));
+  }
+  else
+  {
+    _pdfioCryptoRC4Init(&oldest->ctx.rc4, obj->crypto_key, obj->crypto_keylen);
+    memcpy(&ctx->rc4, &oldest->ctx.rc4, sizeof(ctx->rc4));
+  }
+}
+
+
 //
 // 'make_owner_key()' - Generate the (encrypted) owner key...
 //
@@ -15,6 +15,7 @@
 //
 
 static int	compare_pairs(_pdfio_pair_t *a, _pdfio_pair_t *b);
+static void	decrypt_values(pdfio_dict_t *dict);
 
 
 //
@@ -70,6 +71,9 @@ pdfioDictCopy(pdfio_file_t *pdf,	// I - PDF file
 
   PDFIO_DEBUG("pdfioDictCopy(pdf=%p, dict=%p(%p))\n", pdf, dict, dict ? dict->pdf : NULL);
 
+  if (dict->decrypt_obj)
+    decrypt_values(dict);
+
   // Create the new dictionary...
   if ((ndict = pdfioDictCreate(pdf)) == NULL)
     return (NULL);
@@ -159,7 +163,8 @@ pdfioDictCreate(pdfio_file_t *pdf)	// I - PDF file
 
 
 //
-// '_pdfioDictDecrypt()' - Decrypt the values in a dictionary.
+// '_pdfioDictDecrypt()' - Mark the strings in a dictionary for decryption on
+//                         first use.
 //
 
 bool					// O - `true` on success, `false` on error
@@ -172,9 +177,12 @@ _pdfioDictDecrypt(pdfio_file_t *pdf,	// I - PDF file
   _pdfio_pair_t	*pair;			// Current pair
 
 
+  // Strings are decrypted by decrypt_values() when first accessed...
+  dict->decrypt_obj = obj;
+
   for (i = dict->num_pairs, pair = dict->pairs; i > 0; i --, pair ++)
   {
-    if (strcmp(pair->key, "ID") && !_pdfioValueDecrypt(pdf, obj, &pair->value, depth + 1))
+    if ((pair->value.type == PDFIO_VALTYPE_ARRAY || pair->value.type == PDFIO_VALTYPE_DICT) && strcmp(pair->key, "ID") && !_pdfioValueDecrypt(pdf, obj, &pair->value, depth + 1))
       return (false);
   }
 
@@ -492,6 +500,9 @@ _pdfioDictGetValue(pdfio_dict_t *dict,	// I - Dictionary
 
   if ((match = bsearch(&temp, dict->pairs, dict->num_pairs, sizeof(_pdfio_pair_t), (int (*)(const void *, const void *))compare_pairs)) != NULL)
   {
+    if (dict->decrypt_obj && (match->value.type == PDFIO_VALTYPE_BINARY || match->value.type == PDFIO_VALTYPE_STRING))
+      decrypt_values(dict);
+
     PDFIO_DEBUG("_pdfioDictGetValue: Match, returning ");
     PDFIO_DEBUG_VALUE(&(match->value));
     PDFIO_DEBUG(".\n");
@@ -610,6 +621,35 @@ _pdfioDictRead(pdfio_file_t   *pdf,	// I - PDF file
 }
 
 
+//
+// '_pdfioDictRelease()' - Free the key/value pairs of a dictionary that has
+//                         been written.
+//
+// The dictionary itself stays allocated until the PDF file is closed, but is
+// empty afterwards.
+//
+
+void
+_pdfioDictRelease(pdfio_dict_t *dict)	// I - Dictionary
+{
+  size_t	i;			// Looping var
+  _pdfio_pair_t	*pair;			// Current pair
+
+
+  for (i = dict->num_pairs, pair = dict->pairs; i > 0; i --, pair ++)
+  {
+    if (pair->value.type == PDFIO_VALTYPE_BINARY)
+      free(pair->value.value.binary.data);
+  }
+
+  free(dict->pairs);
+
+  dict->pairs       = NULL;
+  dict->num_pairs   = 0;
+  dict->alloc_pairs = 0;
+}
+
+
 //
 // 'pdfioDictSetArray()' - Set a key array in a dictionary.
 //
@@ -935,6 +975,9 @@ _pdfioDictSetValue(
 
   PDFIO_DEBUG("_pdfioDictSetValue(dict=%p, key=\"%s\", value=%p)\n", dict, key, (void *)value);
 
+  if (dict->decrypt_obj)
+    decrypt_values(dict);
+
   // See if the key is already set...
   if (dict->num_pairs > 0)
   {
@@ -1007,6 +1050,9 @@ _pdfioDictWrite(pdfio_dict_t *dict,	// I - Dictionary
   if (length)
     *length = 0;
 
+  if (dict->decrypt_obj)
+    decrypt_values(dict);
+
   // Dictionaries are bounded by "<<" and ">>"...
   if (!_pdfioFilePuts(pdf, "<<"))
     return (false);
@@ -1043,3 +1089,33 @@ compare_pairs(_pdfio_pair_t *a,		// I - First pair
 {
   return (strcmp(a->key, b->key));
 }
+
+
+//
+// 'decrypt_values()' - Decrypt the strings in a dictionary.
+//
+// Strings that cannot be decrypted are replaced with `null` values.
+//
+
+static void
+decrypt_values(pdfio_dict_t *dict)	// I - Dictionary
+{
+  pdfio_obj_t	*obj = dict->decrypt_obj;
+					// Object
+  size_t	i;			// Looping var
+  _pdfio_pair_t	*pair;			// Current pair
+
+
+  dict->decrypt_obj = NULL;
+
+  for (i = dict->num_pairs, pair = dict->pairs; i > 0; i --, pair ++)
+  {
+    if ((pair->value.type == PDFIO_VALTYPE_BINARY || pair->value.type == PDFIO_VALTYPE_STRING) && strcmp(pair->key, "ID") && !_pdfioValueDecrypt(dict->pdf, obj, &pair->value, 0))
+    {
+      if (pair->value.type == PDFIO_VALTYPE_BINARY)
+        free(pair->value.value.binary.data);
+
+      pair->value.type = PDFIO_VALTYPE_NULL;
+    }
+  }
+}
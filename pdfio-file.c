@@ -13,24 +13,189 @@
 #endif // !O_BINARY
 
 
+//
+// Local constants...
+//
+
+#define _PDFIO_REPAIR_BLOCK	1048576	// Size of blocks read when repairing a file
+#define _PDFIO_REPAIR_LOOK	256	// Look-ahead/behind for object headers
+
+
+//
+// Local types...
+//
+
+typedef struct _pdfio_linobj_s		// Linearization object information
+{
+  size_t	index,			// Index in source objects array
+		group,			// First page using the object + 1, 0 if none
+		visit,			// Last page that scanned the object + 1
+		key,			// Sort key (page, shared, or other objects)
+		hint;			// Shared object hint table identifier
+  bool		is_page,		// Page object?
+		is_pages,		// Page tree node?
+		other,			// Used by the document and not a page?
+		shared;			// Used by more than one page?
+  pdfio_obj_t	*dst;			// Destination object
+} _pdfio_linobj_t;
+
+typedef struct _pdfio_linref_s		// Linearization page reference
+{
+  size_t	page,			// Page number
+		index;			// Index in source objects array
+} _pdfio_linref_t;
+
+typedef struct _pdfio_linear_s		// Linearization data
+{
+  pdfio_file_t	*pdf,			// Source PDF file
+		*dst;			// Linearized PDF file
+  size_t	num_pages;		// Number of pages
+  _pdfio_linobj_t *objs;		// Source object information
+  size_t	catalog;		// Index of catalog object
+  size_t	num_refs,		// Number of page references
+		alloc_refs;		// Allocated page references
+  _pdfio_linref_t *refs;		// Page references
+  size_t	num_stack,		// Number of objects to scan
+		alloc_stack,		// Allocated objects to scan
+		*stack;			// Objects to scan
+  size_t	num_order,		// Number of objects in file order
+		first_end,		// End of first page section
+		shared_start,		// Start of shared objects section
+		*page_start;		// Start of each page in file order
+  pdfio_obj_t	**order,		// Destination objects in file order
+		**srcs,			// Source objects in file order
+		*hint_obj,		// Primary hint stream object
+		*info_obj;		// Info object
+  pdfio_array_t	*id_array;		// File ID
+  off_t		*offsets,		// First pass object offsets
+		first_xref,		// Offset of first page xref table
+		main_xref,		// Offset of main xref table
+		length,			// Length of first pass file
+		hint_length,		// Length of hint stream object
+		prev,			// Final offset of main xref table
+		main_entry;		// Final offset before first main xref entry
+  bool		final;			// Writing the final file?
+  char		hint_header[256];	// Hint stream object header
+  unsigned char	*hint;			// Hint stream data
+  size_t	hint_used,		// Bytes of hint stream data
+		hint_alloc,		// Allocated hint stream data
+		hint_shared;		// Offset of shared object hint table
+  unsigned	hint_bits;		// Pending hint bits
+  int		hint_nbits;		// Number of pending hint bits
+} _pdfio_linear_t;
+
+
 //
 // Local functions...
 //
 
 static pdfio_obj_t	*add_obj(pdfio_file_t *pdf, size_t number, unsigned short generation, off_t offset);
-static int		compare_objmaps(_pdfio_objmap_t *a, _pdfio_objmap_t *b);
 static pdfio_file_t	*create_common(const char *filename, int fd, pdfio_output_cb_t output_cb, void *output_cbdata, const char *version, pdfio_rect_t *media_box, pdfio_rect_t *crop_box, pdfio_error_cb_t error_cb, void *error_cbdata);
+static bool		find_page(pdfio_file_t *pdf, size_t n);
+static bool		find_page_node(pdfio_file_t *pdf, pdfio_obj_t *obj, size_t first, size_t count);
+static void		free_page_nodes(pdfio_file_t *pdf);
 static const char	*get_info_string(pdfio_file_t *pdf, const char *key);
 static struct lconv	*get_lconv(void);
+static off_t		get_linearized(pdfio_file_t *pdf, size_t *num_pages, size_t *page_number);
+static size_t		hash_objhash(const uint8_t *digest);
+static size_t		hash_objmap(pdfio_file_t *src_pdf, size_t src_number);
+static int		linearize_compare(_pdfio_linobj_t **a, _pdfio_linobj_t **b);
+static ssize_t		linearize_count_cb(void *ctx, const void *data, size_t bytes);
+static bool		linearize_flush_bits(_pdfio_linear_t *lin);
+static bool		linearize_hints(_pdfio_linear_t *lin);
+static size_t		linearize_index(pdfio_file_t *pdf, size_t number);
+static _pdfio_value_t	*linearize_inherited(pdfio_obj_t *page, const char *key);
+static int		linearize_nbits(size_t value);
+static bool		linearize_put_bits(_pdfio_linear_t *lin, size_t value, int nbits);
+static bool		linearize_scan(_pdfio_linear_t *lin, size_t index, size_t page);
+static bool		linearize_scan_value(_pdfio_linear_t *lin, _pdfio_value_t *v, size_t page, size_t depth);
+static bool		linearize_write(_pdfio_linear_t *lin);
+static bool		linearize_write_obj(_pdfio_linear_t *lin, size_t i);
+static bool		load_deferred(pdfio_file_t *pdf);
 static bool		load_obj_stream(pdfio_obj_t *obj);
 static bool		load_pages(pdfio_file_t *pdf, pdfio_obj_t *obj, size_t depth);
-static bool		load_xref(pdfio_file_t *pdf, off_t xref_offset, pdfio_password_cb_t password_cb, void *password_data);
+static bool		load_root(pdfio_file_t *pdf);
+static bool		load_xref(pdfio_file_t *pdf, off_t xref_offset, pdfio_password_cb_t password_cb, void *password_data, bool first_only);
+static pdfio_file_t	*open_common(const char *filename, bool update, pdfio_password_cb_t password_cb, void *password_cbdata, pdfio_error_cb_t error_cb, void *error_cbdata);
+static bool		repair_has_name(const unsigned char *start, const unsigned char *end, const char *name);
+static bool		repair_xref(pdfio_file_t *pdf, pdfio_password_cb_t password_cb, void *password_data);
 static bool		write_pages(pdfio_file_t *pdf);
 static bool		write_trailer(pdfio_file_t *pdf);
 
 
 //
-// '_pdfioFileAddMappedObj()' - Add a mapped object.
+// '_pdfioFileAddHashedObj()' - Add the digest of a copied object.
+//
+
+bool					// O - `true` on success, `false` on failure
+_pdfioFileAddHashedObj(
+    pdfio_file_t  *pdf,			// I - Destination PDF file
+    pdfio_obj_t   *obj,			// I - Destination object
+    const uint8_t *digest)		// I - SHA-256 digest
+{
+  _pdfio_objhash_t	*hash,		// Object digest
+			*oldhashes;	// Old object digests
+  size_t		i,		// Looping var
+			j,		// Index into hash table
+			mask,		// Hash mask
+			alloc_oldhashes;// Number of old object digests
+
+
+  // The object digests are an open addressing hash table that is kept at most
+  // half full - grow it as needed...
+  if (pdf->num_objhashes >= pdf->alloc_objhashes / 2)
+  {
+    oldhashes       = pdf->objhashes;
+    alloc_oldhashes = pdf->alloc_objhashes;
+
+    if ((hash = calloc(alloc_oldhashes ? 2 * alloc_oldhashes : 256, sizeof(_pdfio_objhash_t))) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for object digests.");
+      return (false);
+    }
+
+    pdf->objhashes       = hash;
+    pdf->alloc_objhashes = alloc_oldhashes ? 2 * alloc_oldhashes : 256;
+    mask                 = pdf->alloc_objhashes - 1;
+
+    for (i = 0; i < alloc_oldhashes; i ++)
+    {
+      if (!oldhashes[i].obj)
+        continue;
+
+      j = hash_objhash(oldhashes[i].digest) & mask;
+      while (pdf->objhashes[j].obj)
+        j = (j + 1) & mask;
+
+      pdf->objhashes[j] = oldhashes[i];
+    }
+
+    free(oldhashes);
+  }
+
+  // Find the digest or an empty slot...
+  mask = pdf->alloc_objhashes - 1;
+
+  for (j = hash_objhash(digest) & mask; pdf->objhashes[j].obj; j = (j + 1) & mask)
+  {
+    if (!memcmp(pdf->objhashes[j].digest, digest, sizeof(pdf->objhashes[j].digest)))
+      return (true);			// Keep the first object with this digest
+  }
+
+  // Add the new digest...
+  hash = pdf->objhashes + j;
+
+  memcpy(hash->digest, digest, sizeof(hash->digest));
+  hash->obj = obj;
+
+  pdf->num_objhashes ++;
+
+  return (true);
+}
+
+
+//
+// '_pdfioFileAddMappedObj()' - Add or replace a mapped object.
 //
 
 bool					// O - `true` on success, `false` on failure
@@ -39,33 +204,66 @@ _pdfioFileAddMappedObj(
     pdfio_obj_t  *dst_obj,		// I - Destination object
     pdfio_obj_t  *src_obj)		// I - Source object
 {
-  _pdfio_objmap_t	*map;		// Object map
+  _pdfio_objmap_t	*map,		// Object map
+			*oldmaps;	// Old object maps
+  size_t		i,		// Looping var
+			j,		// Index into hash table
+			mask,		// Hash mask
+			alloc_oldmaps;	// Number of old object maps
 
 
-  // Allocate memory as needed...
-  if (pdf->num_objmaps >= pdf->alloc_objmaps)
+  // The object maps are an open addressing hash table that is kept at most
+  // half full - grow it as needed...
+  if (pdf->num_objmaps >= pdf->alloc_objmaps / 2)
   {
-    if ((map = realloc(pdf->objmaps, (pdf->alloc_objmaps + 16) * sizeof(_pdfio_objmap_t))) == NULL)
+    oldmaps       = pdf->objmaps;
+    alloc_oldmaps = pdf->alloc_objmaps;
+
+    if ((map = calloc(alloc_oldmaps ? 2 * alloc_oldmaps : 256, sizeof(_pdfio_objmap_t))) == NULL)
     {
       _pdfioFileError(pdf, "Unable to allocate memory for object map.");
       return (false);
     }
 
-    pdf->alloc_objmaps += 16;
     pdf->objmaps       = map;
+    pdf->alloc_objmaps = alloc_oldmaps ? 2 * alloc_oldmaps : 256;
+    mask               = pdf->alloc_objmaps - 1;
+
+    for (i = 0; i < alloc_oldmaps; i ++)
+    {
+      if (!oldmaps[i].obj)
+        continue;
+
+      j = hash_objmap(oldmaps[i].src_pdf, oldmaps[i].src_number) & mask;
+      while (pdf->objmaps[j].obj)
+        j = (j + 1) & mask;
+
+      pdf->objmaps[j] = oldmaps[i];
+    }
+
+    free(oldmaps);
   }
 
-  // Add an object to the end...
-  map = pdf->objmaps + pdf->num_objmaps;
-  pdf->num_objmaps ++;
+  // Find the source object or an empty slot...
+  mask = pdf->alloc_objmaps - 1;
+
+  for (j = hash_objmap(src_obj->pdf, src_obj->number) & mask; pdf->objmaps[j].obj; j = (j + 1) & mask)
+  {
+    if (pdf->objmaps[j].src_pdf == src_obj->pdf && pdf->objmaps[j].src_number == src_obj->number)
+    {
+      // Already mapped, replace the destination object...
+      pdf->objmaps[j].obj = dst_obj;
+      return (true);
+    }
+  }
 
+  // Add the new mapping...
+  map             = pdf->objmaps + j;
   map->obj        = dst_obj;
   map->src_pdf    = src_obj->pdf;
   map->src_number = src_obj->number;
 
-  // Sort as needed...
-  if (pdf->num_objmaps > 1 && compare_objmaps(map, pdf->objmaps + pdf->num_objmaps - 2) < 0)
-    qsort(pdf->objmaps, pdf->num_objmaps, sizeof(_pdfio_objmap_t), (int (*)(const void *, const void *))compare_objmaps);
+  pdf->num_objmaps ++;
 
   return (true);
 }
@@ -120,8 +318,16 @@ pdfioFileClose(pdfio_file_t *pdf)	// I - PDF file
   {
     ret = false;
 
-    if (pdfioObjClose(pdf->info_obj) && write_pages(pdf) && pdfioObjClose(pdf->root_obj) && write_trailer(pdf))
+    if (pdf->update_offset)
+    {
+      // Incremental update, the catalog only changes if the caller closes it
+      if (_pdfioContentWriteFonts(pdf) && pdfioObjClose(pdf->info_obj) && write_pages(pdf) && write_trailer(pdf))
+        ret = _pdfioFileFlush(pdf);
+    }
+    else if (_pdfioContentWriteFonts(pdf) && pdfioObjClose(pdf->info_obj) && write_pages(pdf) && pdfioObjClose(pdf->root_obj) && write_trailer(pdf))
+    {
       ret = _pdfioFileFlush(pdf);
+    }
   }
 
   if (pdf->fd >= 0 && close(pdf->fd) < 0)
@@ -144,8 +350,11 @@ pdfioFileClose(pdfio_file_t *pdf)	// I - PDF file
   free(pdf->objs);
 
   free(pdf->objmaps);
+  free(pdf->objhashes);
 
+  free(pdf->fonts);
   free(pdf->pages);
+  free_page_nodes(pdf);
 
   for (i = 0; i < pdf->num_strings; i ++)
     free(pdf->strings[i]);
@@ -304,6 +513,7 @@ _pdfioFileCreateObj(
     _pdfio_value_t *value)		// I - Object dictionary
 {
   pdfio_obj_t	*obj;			// New object
+  size_t	number;			// Object number
 
 
   // Range check input...
@@ -313,6 +523,13 @@ _pdfioFileCreateObj(
   if (pdf->mode != _PDFIO_MODE_WRITE)
     return (NULL);
 
+  // Use the next object number, skipping any (free) numbers from an existing
+  // file...
+  number = pdf->num_objs > 0 ? pdf->objs[pdf->num_objs - 1]->number + 1 : 1;
+
+  if (pdf->update_offset && number < (size_t)pdfioDictGetNumber(pdf->trailer_dict, "Size"))
+    number = (size_t)pdfioDictGetNumber(pdf->trailer_dict, "Size");
+
   // Allocate memory for the object...
   if ((obj = (pdfio_obj_t *)calloc(1, sizeof(pdfio_obj_t))) == NULL)
   {
@@ -340,7 +557,7 @@ _pdfioFileCreateObj(
 
   // Initialize the object...
   obj->pdf    = pdf;
-  obj->number = pdf->num_objs;
+  obj->number = number;
 
   if (value)
     _pdfioValueCopy(pdf, &obj->value, srcpdf, value);
@@ -377,6 +594,10 @@ _pdfioFileCreateObj(
 // and its data pointer - if `NULL` the default error handler is used that
 // writes error messages to `stderr`.
 //
+// Output is written strictly in order without seeking, so the callback can
+// write to a pipe or socket.  The dictionaries of pages created with
+// @link pdfioFileCreatePage@ are freed once the page has been written.
+//
 // > *Note*: Files created using this API are slightly larger than those
 // > created using the @link pdfioFileCreate@ function since stream lengths are
 // > stored as indirect object references.
@@ -409,6 +630,7 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
   pdfio_obj_t	*page,			// Page object
 		*contents;		// Contents object
   pdfio_dict_t	*contents_dict;		// Dictionary for Contents object
+  pdfio_stream_t *st;			// Contents stream
 
 
   // Range check input...
@@ -424,12 +646,35 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
   if (!dict)
     return (NULL);
 
-  // Make sure the page dictionary has all of the required keys...
+  // Make sure the page dictionary has all of the required keys, sharing the
+  // default CropBox and MediaBox arrays between pages...
   if (!_pdfioDictGetValue(dict, "CropBox"))
-    pdfioDictSetRect(dict, "CropBox", &pdf->crop_box);
+  {
+    if (!pdf->crop_array)
+    {
+      pdf->crop_array = pdfioArrayCreate(pdf);
+      pdfioArrayAppendNumber(pdf->crop_array, pdf->crop_box.x1);
+      pdfioArrayAppendNumber(pdf->crop_array, pdf->crop_box.y1);
+      pdfioArrayAppendNumber(pdf->crop_array, pdf->crop_box.x2);
+      pdfioArrayAppendNumber(pdf->crop_array, pdf->crop_box.y2);
+    }
+
+    pdfioDictSetArray(dict, "CropBox", pdf->crop_array);
+  }
 
   if (!_pdfioDictGetValue(dict, "MediaBox"))
-    pdfioDictSetRect(dict, "MediaBox", &pdf->media_box);
+  {
+    if (!pdf->media_array)
+    {
+      pdf->media_array = pdfioArrayCreate(pdf);
+      pdfioArrayAppendNumber(pdf->media_array, pdf->media_box.x1);
+      pdfioArrayAppendNumber(pdf->media_array, pdf->media_box.y1);
+      pdfioArrayAppendNumber(pdf->media_array, pdf->media_box.x2);
+      pdfioArrayAppendNumber(pdf->media_array, pdf->media_box.y2);
+    }
+
+    pdfioDictSetArray(dict, "MediaBox", pdf->media_array);
+  }
 
   pdfioDictSetObj(dict, "Parent", pdf->pages_obj);
 
@@ -464,10 +709,23 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
 
   // Create the contents stream...
 #ifdef DEBUG
-  return (pdfioObjCreateStream(contents, PDFIO_FILTER_NONE));
+  st = pdfioObjCreateStream(contents, PDFIO_FILTER_NONE);
 #else
-  return (pdfioObjCreateStream(contents, PDFIO_FILTER_FLATE));
+  st = pdfioObjCreateStream(contents, PDFIO_FILTER_FLATE);
 #endif // DEBUG
+
+  if (st)
+    st->resources = pdfioDictGetDict(dict, "Resources");
+
+  if (st && pdf->output_cb)
+  {
+    // When streaming, the page and contents dictionaries are never needed
+    // again once written so free them now to keep memory usage down...
+    _pdfioDictRelease(dict);
+    _pdfioDictRelease(contents_dict);
+  }
+
+  return (st);
 }
 
 
@@ -598,6 +856,36 @@ pdfioFileCreateTemporary(
 }
 
 
+//
+// '_pdfioFileFindHashedObj()' - Find a copied object using its digest.
+//
+
+pdfio_obj_t *				// O - Matching object or `NULL` if none
+_pdfioFileFindHashedObj(
+    pdfio_file_t  *pdf,			// I - Destination PDF file
+    const uint8_t *digest)		// I - SHA-256 digest
+{
+  size_t	i,			// Index into hash table
+		mask;			// Hash mask
+
+
+  // If we have no digests, return NULL immediately...
+  if (pdf->num_objhashes == 0)
+    return (NULL);
+
+  // Otherwise probe the hash table until we find a match or an empty slot...
+  mask = pdf->alloc_objhashes - 1;
+
+  for (i = hash_objhash(digest) & mask; pdf->objhashes[i].obj; i = (i + 1) & mask)
+  {
+    if (!memcmp(pdf->objhashes[i].digest, digest, sizeof(pdf->objhashes[i].digest)))
+      return (pdf->objhashes[i].obj);
+  }
+
+  return (NULL);
+}
+
+
 //
 // '_pdfioFileFindMappedObj()' - Find a mapped object.
 //
@@ -608,22 +896,24 @@ _pdfioFileFindMappedObj(
     pdfio_file_t *src_pdf,		// I - Source PDF file
     size_t       src_number)		// I - Source object number
 {
-  _pdfio_objmap_t	key,		// Search key
-			*match;		// Matching object map
+  size_t	i,			// Index into hash table
+		mask;			// Hash mask
 
 
   // If we have no mapped objects, return NULL immediately...
   if (pdf->num_objmaps == 0)
     return (NULL);
 
-  // Otherwise search for a match...
-  key.src_pdf    = src_pdf;
-  key.src_number = src_number;
+  // Otherwise probe the hash table until we find a match or an empty slot...
+  mask = pdf->alloc_objmaps - 1;
 
-  if ((match = (_pdfio_objmap_t *)bsearch(&key, pdf->objmaps, pdf->num_objmaps, sizeof(_pdfio_objmap_t), (int (*)(const void *, const void *))compare_objmaps)) != NULL)
-    return (match->obj);
-  else
-    return (NULL);
+  for (i = hash_objmap(src_pdf, src_number) & mask; pdf->objmaps[i].obj; i = (i + 1) & mask)
+  {
+    if (pdf->objmaps[i].src_pdf == src_pdf && pdf->objmaps[i].src_number == src_number)
+      return (pdf->objmaps[i].obj);
+  }
+
+  return (NULL);
 }
 
 
@@ -695,6 +985,11 @@ pdfioFileFindObj(
     PDFIO_DEBUG("pdfioFileFindObj: Returning %lu (%p)\n", (unsigned long)right, pdf->objs[right]);
     return (pdf->objs[right]);
   }
+  else if (pdf->lazy_xref && load_deferred(pdf))
+  {
+    // The object may be listed in the rest of a linearized file...
+    return (pdfioFileFindObj(pdf, number));
+  }
   else
   {
     PDFIO_DEBUG("pdfioFileFindObj: Returning NULL\n");
@@ -735,6 +1030,9 @@ time_t					// O - Creation date or `0` for none
 pdfioFileGetCreationDate(
     pdfio_file_t *pdf)			// I - PDF file
 {
+  if (pdf && pdf->lazy_xref)
+    load_deferred(pdf);
+
   return (pdf && pdf->info_obj ? pdfioDictGetDate(pdfioObjGetDict(pdf->info_obj), "CreationDate") : 0);
 }
 
@@ -791,6 +1089,9 @@ size_t					// O - Number of objects
 pdfioFileGetNumObjs(
     pdfio_file_t *pdf)			// I - PDF file
 {
+  if (pdf && pdf->lazy_xref)
+    load_deferred(pdf);
+
   return (pdf ? pdf->num_objs : 0);
 }
 
@@ -802,6 +1103,9 @@ pdfioFileGetNumObjs(
 size_t					// O - Number of pages
 pdfioFileGetNumPages(pdfio_file_t *pdf)	// I - PDF file
 {
+  if (pdf && pdf->lazy_xref)
+    return (pdf->lazy_pages);
+
   return (pdf ? pdf->num_pages : 0);
 }
 
@@ -814,6 +1118,9 @@ pdfio_obj_t *				// O - Object
 pdfioFileGetObj(pdfio_file_t *pdf,	// I - PDF file
                 size_t       n)		// I - Object index (starting at 0)
 {
+  if (pdf && pdf->lazy_xref)
+    load_deferred(pdf);
+
   if (!pdf || n >= pdf->num_objs)
     return (NULL);
   else
@@ -829,10 +1136,27 @@ pdfio_obj_t *				// O - Object
 pdfioFileGetPage(pdfio_file_t *pdf,	// I - PDF file
                  size_t       n)	// I - Page index (starting at 0)
 {
+  if (pdf && n >= pdf->num_pages && pdf->lazy_xref)
+    load_deferred(pdf);
+
   if (!pdf || n >= pdf->num_pages)
     return (NULL);
-  else
-    return (pdf->pages[n]);
+
+  if (!pdf->pages[n] && !find_page(pdf, n))
+  {
+    // The page counts in the page tree are wrong, so load all of the pages
+    // the old-fashioned way...
+    if (pdf->update_offset)
+      return (NULL);
+
+    pdf->num_pages = 0;
+    free_page_nodes(pdf);
+
+    if (!load_pages(pdf, pdf->pages_obj, 0) || n >= pdf->num_pages)
+      return (NULL);
+  }
+
+  return (pdf->pages[n]);
 }
 
 
@@ -911,163 +1235,525 @@ pdfioFileGetVersion(
 
 
 //
-// 'pdfioFileOpen()' - Open a PDF file for reading.
+// 'pdfioFileLinearize()' - Write a linearized copy of a PDF file.
 //
-// This function opens an existing PDF file.  The "filename" argument specifies
-// the name of the PDF file to create.
+// This function writes a linearized ("fast web view") copy of a PDF file
+// opened with @link pdfioFileOpen@.  The catalog and the objects used by the
+// first page are written first so that a viewer can display the first page
+// before the rest of the file has been received.  The remaining pages follow in
+// order, then the objects that are shared between pages, and finally any other
+// document objects.  A primary hint stream records where each page and shared
+// object is located.
 //
-// The "password_cb" and "password_cbdata" arguments specify a password callback
-// and its data pointer for PDF files that use one of the standard Adobe
-// "security" handlers.  The callback returns a password string or `NULL` to
-// cancel the open.  If `NULL` is specified for the callback function and the
-// PDF file requires a password, the open will always fail.
+// The page tree is flattened and any inherited page attributes are copied to
+// each page.  Encrypted PDF files cannot be linearized.
 //
-// The "error_cb" and "error_cbdata" arguments specify an error handler callback
-// and its data pointer - if `NULL` the default error handler is used that
-// writes error messages to `stderr`.
+// @since PDFio v1.4@
 //
 
-pdfio_file_t *				// O - PDF file
-pdfioFileOpen(
-    const char          *filename,	// I - Filename
-    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
-    void                *password_cbdata,
-					// I - Password callback data, if any
-    pdfio_error_cb_t    error_cb,	// I - Error callback or `NULL` for default
-    void                *error_cbdata)	// I - Error callback data, if any
+bool					// O - `true` on success, `false` on failure
+pdfioFileLinearize(
+    pdfio_file_t *pdf,			// I - PDF file
+    const char   *filename)		// I - Linearized PDF filename
 {
-  pdfio_file_t	*pdf;			// PDF file
-  char		line[1025],		// Line from file
-		*ptr,			// Pointer into line
-		*end;			// End of line
-  ssize_t	bytes;			// Bytes read
-  off_t		xref_offset;		// Offset to xref table
-
+  bool			ret = false;	// Return value
+  _pdfio_linear_t	lin;		// Linearization data
+  pdfio_file_t		*dst = NULL;	// Linearized PDF file
+  size_t		i,		// Looping var
+			num_sorted,	// Number of sorted objects
+			page;		// Current page
+  _pdfio_linobj_t	*lobj,		// Current object information
+			**sorted = NULL;// Sorted object information
+  pdfio_obj_t		*root = NULL,	// Root pages object
+			*catalog,	// Catalog object
+			*obj;		// Current object
+  pdfio_dict_t		*dict;		// Object dictionary
+  pdfio_array_t		*kids;		// Kids array
+  _pdfio_value_t	*v,		// Inherited value
+			value;		// Copied value
+  static const char * const inherited[] =
+  {					// Inherited page attributes
+    "CropBox",
+    "MediaBox",
+    "Resources",
+    "Rotate"
+  };
 
-  PDFIO_DEBUG("pdfioFileOpen(filename=\"%s\", password_cb=%p, password_cbdata=%p, error_cb=%p, error_cbdata=%p)\n", filename, (void *)password_cb, (void *)password_cbdata, (void *)error_cb, (void *)error_cbdata);
 
   // Range check input...
-  if (!filename)
-    return (NULL);
+  if (!pdf || !filename)
+    return (false);
 
-  if (!error_cb)
+  if (pdf->mode != _PDFIO_MODE_READ || pdf->encrypt_obj)
   {
-    error_cb     = _pdfioFileDefaultError;
-    error_cbdata = NULL;
+    _pdfioFileError(pdf, "Only unencrypted PDF files opened for reading can be linearized.");
+    return (false);
   }
 
-  // Allocate a PDF file structure...
-  if ((pdf = (pdfio_file_t *)calloc(1, sizeof(pdfio_file_t))) == NULL)
-  {
-    pdfio_file_t temp;			// Dummy file
-    char	message[8192];		// Message string
+  if (pdf->lazy_xref && !load_deferred(pdf))
+    return (false);
 
-    temp.filename = (char *)filename;
-    snprintf(message, sizeof(message), "Unable to allocate memory for PDF file - %s", strerror(errno));
-    (error_cb)(&temp, message, error_cbdata);
-    return (NULL);
+  if (pdf->num_pages == 0 || !pdf->root_obj)
+  {
+    _pdfioFileError(pdf, "Unable to linearize a PDF file without pages.");
+    return (false);
   }
 
-  pdf->loc         = get_lconv();
-  pdf->filename    = strdup(filename);
-  pdf->mode        = _PDFIO_MODE_READ;
-  pdf->error_cb    = error_cb;
-  pdf->error_data  = error_cbdata;
-  pdf->permissions = PDFIO_PERMISSION_ALL;
+  // Collect information about the objects used by each page...
+  memset(&lin, 0, sizeof(lin));
+  lin.pdf       = pdf;
+  lin.num_pages = pdf->num_pages;
+  lin.catalog   = linearize_index(pdf, pdf->root_obj->number);
 
-  // Open the file...
-  if ((pdf->fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+  if ((lin.objs = (_pdfio_linobj_t *)calloc(pdf->num_objs, sizeof(_pdfio_linobj_t))) == NULL || (lin.page_start = (size_t *)calloc(lin.num_pages + 1, sizeof(size_t))) == NULL)
   {
-    _pdfioFileError(pdf, "Unable to open file - %s", strerror(errno));
-    free(pdf->filename);
-    free(pdf);
-    return (NULL);
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
   }
 
-  // Read the header from the first line...
-  if (!_pdfioFileGets(pdf, line, sizeof(line)))
-    goto error;
+  for (i = 0; i < pdf->num_objs; i ++)
+    lin.objs[i].index = i;
 
-  if ((strncmp(line, "%PDF-1.", 7) && strncmp(line, "%PDF-2.", 7)) || !isdigit(line[7] & 255))
+  for (page = 0; page < lin.num_pages; page ++)
   {
-    // Bad header
-    _pdfioFileError(pdf, "Bad header '%s'.", line);
-    goto error;
-  }
+    if ((obj = pdfioFileGetPage(pdf, page)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to find page %lu.", (unsigned long)page + 1);
+      goto done;
+    }
 
-  // Copy the version number...
-  pdf->version = strdup(line + 5);
+    if ((i = linearize_index(pdf, obj->number)) >= pdf->num_objs || lin.objs[i].is_page)
+    {
+      _pdfioFileError(pdf, "Unable to linearize a PDF file with duplicate pages.");
+      goto done;
+    }
 
-  // Grab the last 1k of the file to find the start of the xref table...
-  if (_pdfioFileSeek(pdf, -1024, SEEK_END) < 0)
-  {
-    _pdfioFileError(pdf, "Unable to read startxref data.");
-    goto error;
+    lin.objs[i].is_page = true;
+    lin.objs[i].group   = page + 1;
   }
 
-  if ((bytes = _pdfioFileRead(pdf, line, sizeof(line) - 1)) < 1)
+  for (page = 0; page < lin.num_pages; page ++)
   {
-    _pdfioFileError(pdf, "Unable to read startxref data.");
-    goto error;
+    if (!linearize_scan(&lin, linearize_index(pdf, pdf->pages[page]->number), page + 1))
+      goto done;
   }
 
-  line[bytes] = '\0';
-  end = line + bytes - 9;
+  if (!linearize_scan(&lin, lin.catalog, lin.num_pages + 1))
+    goto done;
 
-  for (ptr = line; ptr < end; ptr ++)
+  if (pdf->info_obj && (i = linearize_index(pdf, pdf->info_obj->number)) < pdf->num_objs && i != lin.catalog)
   {
-    if (!memcmp(ptr, "startxref", 9))
-      break;
+    if (lin.objs[i].group == 0)
+      lin.objs[i].other = true;
+
+    if (!linearize_scan(&lin, i, lin.num_pages + 1))
+      goto done;
   }
 
-  if (ptr >= end)
+  // Sort the objects: the first page, each of the remaining pages, objects
+  // shared by the remaining pages, and then other document objects...
+  if ((sorted = (_pdfio_linobj_t **)calloc(pdf->num_objs, sizeof(_pdfio_linobj_t *))) == NULL)
   {
-    _pdfioFileError(pdf, "Unable to find start of xref table.");
-    goto error;
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
   }
 
-  xref_offset = (off_t)strtol(ptr + 9, NULL, 10);
+  for (i = 0, num_sorted = 0, lobj = lin.objs; i < pdf->num_objs; i ++, lobj ++)
+  {
+    if (i == lin.catalog || lobj->is_pages)
+      continue;
+    else if (lobj->group == 1 || lobj->is_page || (lobj->group > 1 && !lobj->shared))
+      lobj->key = lobj->group - 1;
+    else if (lobj->group > 1)
+      lobj->key = lin.num_pages;
+    else if (lobj->other)
+      lobj->key = lin.num_pages + 1;
+    else
+      continue;
 
-  if (!load_xref(pdf, xref_offset, password_cb, password_cbdata))
-    goto error;
+    sorted[num_sorted ++] = lobj;
+  }
 
-  return (pdf);
+  qsort(sorted, num_sorted, sizeof(_pdfio_linobj_t *), (int (*)(const void *, const void *))linearize_compare);
 
+  // Create the linearized PDF file, starting with a first pass that just
+  // computes the object offsets...
+  if ((dst = (pdfio_file_t *)calloc(1, sizeof(pdfio_file_t))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
+  }
 
-  // If we get here we had a fatal read error...
-  error:
+  lin.dst          = dst;
+  dst->loc         = get_lconv();
+  dst->fd          = -1;
+  dst->output_cb   = linearize_count_cb;
+  dst->filename    = strdup(filename);
+  dst->version     = strdup(pdf->version ? pdf->version : "1.7");
+  dst->mode        = _PDFIO_MODE_WRITE;
+  dst->error_cb    = pdf->error_cb;
+  dst->error_data  = pdf->error_data;
+  dst->permissions = PDFIO_PERMISSION_ALL;
+  dst->bufptr      = dst->buffer;
+  dst->bufend      = dst->buffer + sizeof(dst->buffer);
+
+  if (!dst->filename || !dst->version)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
+  }
 
-  pdfioFileClose(pdf);
+  if ((lin.order = (pdfio_obj_t **)calloc(num_sorted + 3, sizeof(pdfio_obj_t *))) == NULL || (lin.srcs = (pdfio_obj_t **)calloc(num_sorted + 3, sizeof(pdfio_obj_t *))) == NULL || (lin.offsets = (off_t *)calloc(num_sorted + 4, sizeof(off_t))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
+  }
 
-  return (NULL);
-}
+  // Number the objects after the first page first, so that the first page
+  // section uses the highest object numbers...
+  lin.num_order = 2;
+  lin.first_end = 2;
 
+  for (i = 0; i < num_sorted && sorted[i]->key == 0; i ++)
+    lin.first_end ++;
 
-//
-// 'pdfioFileSetAuthor()' - Set the author for a PDF file.
-//
+  lin.num_order = lin.first_end;
 
-void
-pdfioFileSetAuthor(pdfio_file_t *pdf,	// I - PDF file
-                   const char   *value)	// I - Value
-{
-  if (pdf && pdf->info_obj)
-    pdfioDictSetString(pdf->info_obj->value.value.dict, "Author", pdfioStringCreate(pdf, value));
-}
+  for (; i < num_sorted; i ++)
+  {
+    lobj = sorted[i];
 
+    if (lobj->key >= lin.num_pages && !lin.shared_start)
+      lin.shared_start = lin.num_order;
 
-//
-// 'pdfioFileSetCreationDate()' - Set the creation date for a PDF file.
-//
+    if (lobj->key > lin.num_pages && !root)
+    {
+      if ((root = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL)
+        goto done;
 
-void
-pdfioFileSetCreationDate(
-    pdfio_file_t *pdf,			// I - PDF file
-    time_t       value)			// I - Value
-{
-  if (pdf && pdf->info_obj)
-    pdfioDictSetDate(pdf->info_obj->value.value.dict, "CreationDate", value);
-}
+      lin.order[lin.num_order ++] = root;
+    }
+
+    if (lobj->is_page)
+      lin.page_start[lobj->key] = lin.num_order;
+
+    if ((lobj->dst = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL)
+      goto done;
+
+    if (lobj->key == lin.num_pages)
+      lobj->hint = lin.first_end - 2 + lin.num_order - lin.shared_start;
+
+    lin.order[lin.num_order]  = lobj->dst;
+    lin.srcs[lin.num_order ++] = pdf->objs[lobj->index];
+  }
+
+  if (!lin.shared_start)
+    lin.shared_start = lin.num_order;
+
+  if (!root)
+  {
+    if ((root = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL)
+      goto done;
+
+    lin.order[lin.num_order ++] = root;
+  }
+
+  lin.page_start[0]             = 2;
+  lin.page_start[lin.num_pages] = lin.shared_start;
+
+  // Then the linearization dictionary, catalog, first page, and hint stream...
+  if ((lin.order[0] = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL || (catalog = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL)
+    goto done;
+
+  lin.order[1]               = catalog;
+  lin.srcs[1]                = pdf->root_obj;
+  lin.objs[lin.catalog].dst = catalog;
+
+  for (i = 0; i < num_sorted && sorted[i]->key == 0; i ++)
+  {
+    lobj = sorted[i];
+
+    if ((lobj->dst = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL)
+      goto done;
+
+    lobj->hint = i;
+
+    lin.order[i + 2] = lobj->dst;
+    lin.srcs[i + 2]  = pdf->objs[lobj->index];
+  }
+
+  if ((lin.hint_obj = _pdfioFileCreateObj(dst, NULL, NULL)) == NULL)
+    goto done;
+
+  // Map the source objects to the new objects, with all of the page tree nodes
+  // being replaced by a single root pages object...
+  for (i = 0, lobj = lin.objs; i < pdf->num_objs; i ++, lobj ++)
+  {
+    if (lobj->dst)
+    {
+      if (!_pdfioFileAddMappedObj(dst, lobj->dst, pdf->objs[i]))
+        goto done;
+    }
+    else if (lobj->is_pages)
+    {
+      if (!_pdfioFileAddMappedObj(dst, root, pdf->objs[i]))
+        goto done;
+    }
+  }
+
+  if (pdf->info_obj)
+    lin.info_obj = _pdfioFileFindMappedObj(dst, pdf, pdf->info_obj->number);
+
+  if (pdf->id_array)
+  {
+    lin.id_array = pdfioArrayCopy(dst, pdf->id_array);
+  }
+  else if ((lin.id_array = pdfioArrayCreate(dst)) != NULL)
+  {
+    unsigned char id_value[16];		// File ID value
+
+    _pdfioCryptoMakeRandom(id_value, sizeof(id_value));
+    pdfioArrayAppendBinary(lin.id_array, id_value, sizeof(id_value));
+    pdfioArrayAppendBinary(lin.id_array, id_value, sizeof(id_value));
+  }
+
+  // Copy the object values...
+  for (i = 1; i < lin.num_order; i ++)
+  {
+    pdfio_obj_t *src = lin.srcs[i];	// Source object
+
+    if (!src)
+      continue;
+
+    obj = lin.order[i];
+
+    if (!_pdfioValueCopy(dst, &obj->value, pdf, &src->value))
+    {
+      _pdfioFileError(pdf, "Unable to copy object %lu.", (unsigned long)src->number);
+      goto done;
+    }
+
+  }
+
+  for (page = 0; page < lin.num_pages; page ++)
+  {
+    obj = lin.order[lin.page_start[page]];
+
+    if ((dict = pdfioObjGetDict(obj)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to copy page %lu.", (unsigned long)page + 1);
+      goto done;
+    }
+
+    pdfioDictSetObj(dict, "Parent", root);
+
+    for (i = 0; i < (sizeof(inherited) / sizeof(inherited[0])); i ++)
+    {
+      if ((v = linearize_inherited(pdf->pages[page], inherited[i])) != NULL)
+      {
+        if (!_pdfioValueCopy(dst, &value, pdf, v))
+        {
+          _pdfioFileError(pdf, "Unable to copy page %lu.", (unsigned long)page + 1);
+          goto done;
+        }
+
+        _pdfioDictSetValue(dict, inherited[i], &value);
+      }
+    }
+  }
+
+  if ((dict = pdfioDictCreate(dst)) == NULL || (kids = pdfioArrayCreate(dst)) == NULL)
+    goto done;
+
+  for (page = 0; page < lin.num_pages; page ++)
+    pdfioArrayAppendObj(kids, lin.order[lin.page_start[page]]);
+
+  pdfioDictSetName(dict, "Type", "Pages");
+  pdfioDictSetNumber(dict, "Count", (double)lin.num_pages);
+  pdfioDictSetArray(dict, "Kids", kids);
+
+  root->value.type       = PDFIO_VALTYPE_DICT;
+  root->value.value.dict = dict;
+
+  if ((dict = pdfioObjGetDict(catalog)) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to copy catalog object.");
+    goto done;
+  }
+
+  pdfioDictSetObj(dict, "Pages", root);
+
+  // Do a first pass to find the object offsets, then build the hint tables
+  // from them...
+  if (!linearize_write(&lin) || !_pdfioFileFlush(dst))
+    goto done;
+
+  for (i = 0; i < lin.num_order; i ++)
+    lin.offsets[i] = lin.order[i]->offset;
+
+  lin.offsets[lin.num_order] = lin.main_xref;
+  lin.length                 = _pdfioFileTell(dst);
+
+  if (!linearize_hints(&lin))
+    goto done;
+
+  // Then write the final file with the hint stream after the first page...
+  if ((dst->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666)) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to create \"%s\": %s", filename, strerror(errno));
+    goto done;
+  }
+
+  dst->output_cb = NULL;
+  dst->bufpos    = 0;
+  dst->bufptr    = dst->buffer;
+  lin.final      = true;
+
+  if (!linearize_write(&lin) || !_pdfioFileFlush(dst))
+    goto done;
+
+  if (lin.main_xref != lin.prev)
+  {
+    _pdfioFileError(pdf, "Unable to linearize PDF file.");
+    goto done;
+  }
+
+  ret = true;
+
+  // Free memory and return...
+  done:
+
+  if (dst)
+  {
+    // Close the linearized file without writing anything else...
+    dst->mode = _PDFIO_MODE_READ;
+
+    if (!pdfioFileClose(dst))
+      ret = false;
+  }
+
+  free(lin.objs);
+  free(lin.refs);
+  free(lin.stack);
+  free(lin.page_start);
+  free(lin.order);
+  free(lin.srcs);
+  free(lin.offsets);
+  free(lin.hint);
+  free(sorted);
+
+  return (ret);
+}
+
+
+//
+// 'pdfioFileOpen()' - Open a PDF file for reading.
+//
+// This function opens an existing PDF file.  The "filename" argument specifies
+// the name of the PDF file to create.
+//
+// The "password_cb" and "password_cbdata" arguments specify a password callback
+// and its data pointer for PDF files that use one of the standard Adobe
+// "security" handlers.  The callback returns a password string or `NULL` to
+// cancel the open.  If `NULL` is specified for the callback function and the
+// PDF file requires a password, the open will always fail.
+//
+// The "error_cb" and "error_cbdata" arguments specify an error handler callback
+// and its data pointer - if `NULL` the default error handler is used that
+// writes error messages to `stderr`.
+//
+// Linearized PDF files are opened using the first page cross-reference table,
+// so the first page is available without reading the rest of the file.  The
+// remaining cross-reference tables and pages are loaded when they are first
+// needed.
+//
+// If the cross-reference table is missing or damaged, the error callback is
+// called and, if it returns `true`, the cross-reference table is rebuilt by
+// scanning the file for objects.
+//
+
+pdfio_file_t *				// O - PDF file
+pdfioFileOpen(
+    const char          *filename,	// I - Filename
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_cbdata,
+					// I - Password callback data, if any
+    pdfio_error_cb_t    error_cb,	// I - Error callback or `NULL` for default
+    void                *error_cbdata)	// I - Error callback data, if any
+{
+  PDFIO_DEBUG("pdfioFileOpen(filename=\"%s\", password_cb=%p, password_cbdata=%p, error_cb=%p, error_cbdata=%p)\n", filename, (void *)password_cb, (void *)password_cbdata, (void *)error_cb, (void *)error_cbdata);
+
+  return (open_common(filename, false, password_cb, password_cbdata, error_cb, error_cbdata));
+}
+
+
+//
+// 'pdfioFileOpenUpdate()' - Open a PDF file for an incremental update.
+//
+// This function opens an existing PDF file so that changes can be appended to
+// it as an incremental update.  Only new and changed objects are written,
+// followed by a new cross-reference table and trailer that point back to the
+// original file's cross-reference table, so the cost of saving does not
+// depend on the size of the existing document.  The update always uses a
+// classic cross-reference table, even when the original file uses a
+// cross-reference stream.
+//
+// The "filename", "password_cb", "password_cbdata", "error_cb", and
+// "error_cbdata" arguments are the same as for @link pdfioFileOpen@.
+//
+// Existing objects and pages can be read as usual.  New objects, pages, and
+// streams are created with the normal PDFio functions.  To change an existing
+// object, update its value and then call @link pdfioObjClose@ to write the new
+// copy of the object - call @link pdfioObjCreateStream@ instead to replace the
+// stream data of an existing object.  The document information dictionary is
+// always written and any new pages are added to the root pages object when
+// @link pdfioFileClose@ is called.
+//
+// > *Note*: Existing stream data cannot be read while writing a new stream.
+//
+// @since PDFio v1.4@
+//
+
+pdfio_file_t *				// O - PDF file
+pdfioFileOpenUpdate(
+    const char          *filename,	// I - Filename
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_cbdata,
+					// I - Password callback data, if any
+    pdfio_error_cb_t    error_cb,	// I - Error callback or `NULL` for default
+    void                *error_cbdata)	// I - Error callback data, if any
+{
+  PDFIO_DEBUG("pdfioFileOpenUpdate(filename=\"%s\", password_cb=%p, password_cbdata=%p, error_cb=%p, error_cbdata=%p)\n", filename, (void *)password_cb, (void *)password_cbdata, (void *)error_cb, (void *)error_cbdata);
+
+  return (open_common(filename, true, password_cb, password_cbdata, error_cb, error_cbdata));
+}
+
+
+//
+// 'pdfioFileSetAuthor()' - Set the author for a PDF file.
+//
+
+void
+pdfioFileSetAuthor(pdfio_file_t *pdf,	// I - PDF file
+                   const char   *value)	// I - Value
+{
+  if (pdf && pdf->info_obj)
+    pdfioDictSetString(pdf->info_obj->value.value.dict, "Author", pdfioStringCreate(pdf, value));
+}
+
+
+//
+// 'pdfioFileSetCreationDate()' - Set the creation date for a PDF file.
+//
+
+void
+pdfioFileSetCreationDate(
+    pdfio_file_t *pdf,			// I - PDF file
+    time_t       value)			// I - Value
+{
+  if (pdf && pdf->info_obj)
+    pdfioDictSetDate(pdf->info_obj->value.value.dict, "CreationDate", value);
+}
 
 
 //
@@ -1083,6 +1769,29 @@ pdfioFileSetCreator(pdfio_file_t *pdf,	// I - PDF file
 }
 
 
+//
+// 'pdfioFileSetDeduplicate()' - Set whether to deduplicate copied objects.
+//
+// This function enables or disables deduplication of objects that are copied
+// to a PDF file using @link pdfioObjCopy@ and @link pdfioPageCopy@.  When
+// enabled, copied objects (other than pages and annotations) with the same
+// value and stream data as a previously copied object are replaced by a
+// reference to the first copy.  This is useful when merging many documents
+// that use the same fonts and images.
+//
+// Deduplication is disabled by default.
+//
+
+void
+pdfioFileSetDeduplicate(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to deduplicate copied objects, `false` otherwise
+{
+  if (pdf)
+    pdf->dedup = value;
+}
+
+
 //
 // 'pdfioFileSetKeywords()' - Set the keywords string for a PDF file.
 //
@@ -1261,27 +1970,6 @@ add_obj(pdfio_file_t   *pdf,		// I - PDF file
 }
 
 
-//
-// 'compare_objmaps()' - Compare two object maps...
-//
-
-static int				// O - Result of comparison
-compare_objmaps(_pdfio_objmap_t *a,	// I - First object map
-                _pdfio_objmap_t *b)	// I - Second object map
-{
-  if (a->src_pdf < b->src_pdf)
-    return (-1);
-  else if (a->src_pdf > b->src_pdf)
-    return (1);
-  else if (a->src_number < b->src_number)
-    return (-1);
-  else if (a->src_number > b->src_number)
-    return (1);
-  else
-    return (0);
-}
-
-
 //
 // 'create_common()' - Allocate and initialize a pdfio_file_t object for writing.
 //
@@ -1421,688 +2109,2283 @@ create_common(
 
 
 //
-// 'get_info_string()' - Get a string value from the Info dictionary.
+// 'find_page()' - Find a page using the page counts in the page tree.
 //
-// This function also handles converting binary strings to C strings, which
-// occur in encrypted PDF files.
+// Pages are found by descending from the root of the page tree using the
+// "Count" values of the intermediate nodes.  Each node that is visited is
+// cached along with the first page index of each kid that has been scanned, so
+// later lookups descend through the scanned kids using a binary search and
+// resume scanning where the last lookup stopped.  Any pages that are passed
+// along the way are remembered for later lookups.
 //
 
-static const char *			// O - String or `NULL` if not found
-get_info_string(pdfio_file_t *pdf,	// I - PDF file
-                const char   *key)	// I - Dictionary key
+static bool				// O - `true` if found, `false` otherwise
+find_page(pdfio_file_t *pdf,		// I - PDF file
+          size_t       n)		// I - Page index (starting at 0)
 {
-  pdfio_dict_t	*dict;			// Info dictionary
+  size_t	depth,			// Depth of page tree
+		node = 0,		// Current node
+		first,			// Index of first page in kid
+		left,			// Left side of binary search
+		right,			// Right side of binary search
+		center;			// Center of binary search
+  _pdfio_pnode_t *pn;			// Current node data
+  pdfio_obj_t	*kid;			// Current kid
+  pdfio_dict_t	*dict;			// Node/kid dictionary
+  pdfio_array_t	*kids;			// Kids array
+  double	count;			// Number of pages in kid
 
 
-  // Range check input...
-  if (!pdf || !pdf->info_obj || (dict = pdfioObjGetDict(pdf->info_obj)) == NULL)
-    return (NULL);
-  else
-    return (pdfioDictGetString(dict, key));
-}
+  PDFIO_DEBUG("find_page(pdf=%p, n=%lu)\n", (void *)pdf, (unsigned long)n);
 
+  // Start with the root of the page tree...
+  if (pdf->num_pnodes == 0 && !find_page_node(pdf, pdf->pages_obj, 0, pdf->num_pages))
+    return (false);
 
-//
-// 'get_lconv()' - Get any locale-specific numeric information.
-//
+  for (depth = 0; depth < PDFIO_MAX_DEPTH; depth ++)
+  {
+    pn = pdf->pnodes + node;
 
-static struct lconv *			// O - Locale information or `NULL`
-get_lconv(void)
-{
-  struct lconv	*loc;			// Locale information
+    if (n < pn->next_page)
+    {
+      // The page is in a kid that has already been scanned...
+      for (left = 0, right = pn->num_kids - 1; left < right;)
+      {
+        center = (left + right + 1) / 2;
 
+        if (pn->kids[center].first <= n)
+          left = center;
+        else
+          right = center - 1;
+      }
 
-  if ((loc = localeconv()) != NULL)
-  {
-    PDFIO_DEBUG("get_lconv: loc=%p, loc->decimal_point=\"%s\"\n", loc, loc->decimal_point);
+      if (pn->kids[left].node == SIZE_MAX)
+        return (false);			// Pages that were scanned are already cached
 
-    if (!loc->decimal_point || !strcmp(loc->decimal_point, "."))
-      loc = NULL;
-  }
+      node = pn->kids[left].node;
+      continue;
+    }
 
-  return (loc);
-}
+    // Scan more kids until we find the one containing the page...
+    if ((dict = pdfioObjGetDict(pn->obj)) == NULL || (kids = pdfioDictGetArray(dict, "Kids")) == NULL)
+      return (false);
 
+    if (!pn->kids && (pn->kids = (_pdfio_pkid_t *)calloc(pdfioArrayGetSize(kids) + 1, sizeof(_pdfio_pkid_t))) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for pages.");
+      return (false);
+    }
 
-//
-// 'load_obj_stream()' - Load an object stream.
-//
-// Object streams are Adobe's complicated solution for saving a few
-// kilobytes in an average PDF file at the expense of massively more
-// complicated reader applications.
-//
-// Each object stream starts with pairs of object numbers and offsets,
-// followed by the object values (typically dictionaries).  For
-// simplicity pdfio loads all of these values into memory so that we
-// don't later have to randomly access compressed stream data to get
-// a dictionary.
-//
+    while (n >= pn->next_page && pn->num_kids < pdfioArrayGetSize(kids))
+    {
+      if ((kid = pdfioArrayGetObj(kids, pn->num_kids)) == NULL || (dict = pdfioObjGetDict(kid)) == NULL)
+        return (false);
 
-static bool				// O - `true` on success, `false` on error
-load_obj_stream(pdfio_obj_t *obj)	// I - Object to load
-{
-  pdfio_stream_t	*st;		// Stream
-  _pdfio_token_t	tb;		// Token buffer/stack
-  char			buffer[32];	// Token
-  size_t		number,		// Object number
-			cur_obj,	// Current object
-			num_objs = 0;	// Number of objects
-  pdfio_obj_t		*objs[16384];	// Objects
+      first = pn->next_page;
 
+      if (pdfioDictGetArray(dict, "Kids"))
+      {
+        // Intermediate node, which must fit within the current node...
+        if ((count = pdfioDictGetNumber(dict, "Count")) < 0.0 || count > (double)(pn->first + pn->count - first))
+          return (false);
 
-  PDFIO_DEBUG("load_obj_stream(obj=%p(%d))\n", obj, (int)obj->number);
+        if (!find_page_node(pdf, kid, first, (size_t)count))
+          return (false);
 
-  // Open the object stream...
-  if ((st = pdfioObjOpenStream(obj, true)) == NULL)
-  {
-    _pdfioFileError(obj->pdf, "Unable to open compressed object stream %lu.", (unsigned long)obj->number);
-    return (false);
-  }
+        pn = pdf->pnodes + node;	// Nodes may have moved in memory
 
-  _pdfioTokenInit(&tb, obj->pdf, (_pdfio_tconsume_cb_t)pdfioStreamConsume, (_pdfio_tpeek_cb_t)pdfioStreamPeek, st);
+        pn->kids[pn->num_kids].first  = first;
+        pn->kids[pn->num_kids].node   = pdf->num_pnodes - 1;
+        pn->num_kids ++;
+        pn->next_page += (size_t)count;
+      }
+      else
+      {
+        // Page...
+        if (first >= (pn->first + pn->count))
+          return (false);
 
-  // Read the object numbers from the beginning of the stream...
-  while (_pdfioTokenGet(&tb, buffer, sizeof(buffer)))
-  {
-    // Stop if this isn't an object number...
-    if (!isdigit(buffer[0] & 255))
-      break;
+        pdf->pages[first] = kid;
 
-    // Stop if we have too many objects...
-    if (num_objs >= (sizeof(objs) / sizeof(objs[0])))
-    {
-      _pdfioFileError(obj->pdf, "Too many compressed objects in one stream.");
-      pdfioStreamClose(st);
-      return (false);
+        pn->kids[pn->num_kids].first  = first;
+        pn->kids[pn->num_kids].node   = SIZE_MAX;
+        pn->num_kids ++;
+        pn->next_page ++;
+
+        if (first == n)
+          return (true);
+      }
     }
 
-    // Add the object in memory...
-    number = (size_t)strtoimax(buffer, NULL, 10);
+    if (n >= pn->next_page || pn->kids[pn->num_kids - 1].node == SIZE_MAX)
+      return (false);
 
-    if ((objs[num_objs] = pdfioFileFindObj(obj->pdf, number)) == NULL)
-      objs[num_objs] = add_obj(obj->pdf, number, 0, 0);
+    node = pn->kids[pn->num_kids - 1].node;
+  }
 
-    num_objs ++;
+  return (false);
+}
 
-    // Skip offset
-    _pdfioTokenGet(&tb, buffer, sizeof(buffer));
-    PDFIO_DEBUG("load_obj_stream: %ld at offset %s\n", (long)number, buffer);
-  }
 
-  if (!buffer[0])
-  {
-    pdfioStreamClose(st);
-    return (false);
-  }
+//
+// 'find_page_node()' - Add a node to the page tree cache.
+//
 
-  _pdfioTokenPush(&tb, buffer);
+static bool				// O - `true` on success, `false` on failure
+find_page_node(pdfio_file_t *pdf,	// I - PDF file
+               pdfio_obj_t  *obj,	// I - Pages object
+               size_t       first,	// I - Index of first page in node
+               size_t       count)	// I - Number of pages in node
+{
+  _pdfio_pnode_t	*pn;		// New node
 
-  // Read the objects themselves...
-  for (cur_obj = 0; cur_obj < num_objs; cur_obj ++)
+
+  if (pdf->num_pnodes >= pdf->alloc_pnodes)
   {
-    if (!_pdfioValueRead(obj->pdf, obj, &tb, &(objs[cur_obj]->value), 0))
+    _pdfio_pnode_t *temp = (_pdfio_pnode_t *)realloc(pdf->pnodes, (pdf->alloc_pnodes + 32) * sizeof(_pdfio_pnode_t));
+
+    if (!temp)
     {
-      pdfioStreamClose(st);
+      _pdfioFileError(pdf, "Unable to allocate memory for pages.");
       return (false);
     }
+
+    pdf->alloc_pnodes += 32;
+    pdf->pnodes       = temp;
   }
 
-  // Close the stream and return
-  pdfioStreamClose(st);
+  pn = pdf->pnodes + pdf->num_pnodes ++;
+
+  memset(pn, 0, sizeof(_pdfio_pnode_t));
+  pn->obj       = obj;
+  pn->first     = first;
+  pn->count     = count;
+  pn->next_page = first;
 
   return (true);
 }
 
 
 //
-// 'load_pages()' - Load pages in the document.
+// 'free_page_nodes()' - Free the page tree cache.
 //
 
-static bool				// O - `true` on success, `false` on error
-load_pages(pdfio_file_t *pdf,		// I - PDF file
-           pdfio_obj_t  *obj,		// I - Page object
-           size_t       depth)		// I - Depth of page tree
+static void
+free_page_nodes(pdfio_file_t *pdf)	// I - PDF file
 {
-  pdfio_dict_t	*dict;			// Page object dictionary
-  const char	*type;			// Node type
-  pdfio_array_t	*kids;			// Kids array
+  size_t	i;			// Looping var
 
 
-  // Range check input...
-  if (!obj)
-  {
-    _pdfioFileError(pdf, "Unable to find pages object.");
-    return (false);
-  }
+  for (i = 0; i < pdf->num_pnodes; i ++)
+    free(pdf->pnodes[i].kids);
 
-  // Get the object dictionary and make sure this is a Pages or Page object...
-  if ((dict = pdfioObjGetDict(obj)) == NULL)
-  {
-    _pdfioFileError(pdf, "No dictionary for pages object.");
-    return (false);
-  }
+  free(pdf->pnodes);
 
-  if ((type = pdfioDictGetName(dict, "Type")) == NULL || (strcmp(type, "Pages") && strcmp(type, "Page")))
-    return (false);
+  pdf->num_pnodes   = 0;
+  pdf->alloc_pnodes = 0;
+  pdf->pnodes       = NULL;
+}
 
-  // If there is a Kids array, then this is a parent node and we have to look
-  // at the child objects...
-  if ((kids = pdfioDictGetArray(dict, "Kids")) != NULL)
-  {
-    // Load the child objects...
-    size_t	i,			// Looping var
-		num_kids;		// Number of elements in array
 
-    if (depth >= PDFIO_MAX_DEPTH)
-    {
-      _pdfioFileError(pdf, "Depth of pages objects too great to load.");
-      return (false);
-    }
+//
+// 'get_info_string()' - Get a string value from the Info dictionary.
+//
+// This function also handles converting binary strings to C strings, which
+// occur in encrypted PDF files.
+//
 
-    for (i = 0, num_kids = pdfioArrayGetSize(kids); i < num_kids; i ++)
-    {
-      if (!load_pages(pdf, pdfioArrayGetObj(kids, i), depth + 1))
-        return (false);
-    }
-  }
+static const char *			// O - String or `NULL` if not found
+get_info_string(pdfio_file_t *pdf,	// I - PDF file
+                const char   *key)	// I - Dictionary key
+{
+  pdfio_dict_t	*dict;			// Info dictionary
+
+
+  // Range check input...
+  if (pdf && pdf->lazy_xref)
+    load_deferred(pdf);
+
+  if (!pdf || !pdf->info_obj || (dict = pdfioObjGetDict(pdf->info_obj)) == NULL)
+    return (NULL);
   else
-  {
-    // Add this page...
-    if (pdf->num_pages >= pdf->alloc_pages)
-    {
-      pdfio_obj_t **temp = (pdfio_obj_t **)realloc(pdf->pages, (pdf->alloc_pages + 32) * sizeof(pdfio_obj_t *));
+    return (pdfioDictGetString(dict, key));
+}
 
-      if (!temp)
-      {
-        _pdfioFileError(pdf, "Unable to allocate memory for pages.");
-        return (false);
-      }
 
-      pdf->alloc_pages += 32;
-      pdf->pages       = temp;
-    }
+//
+// 'get_lconv()' - Get any locale-specific numeric information.
+//
 
-    pdf->pages[pdf->num_pages ++] = obj;
+static struct lconv *			// O - Locale information or `NULL`
+get_lconv(void)
+{
+  struct lconv	*loc;			// Locale information
+
+
+  if ((loc = localeconv()) != NULL)
+  {
+    PDFIO_DEBUG("get_lconv: loc=%p, loc->decimal_point=\"%s\"\n", loc, loc->decimal_point);
+
+    if (!loc->decimal_point || !strcmp(loc->decimal_point, "."))
+      loc = NULL;
   }
 
-  return (true);
+  return (loc);
 }
 
 
 //
-// 'load_xref()' - Load an XREF table...
+// 'get_linearized()' - Get the first page xref table of a linearized PDF file.
+//
+// The linearization dictionary must be the first object in the file and its
+// file length must match the actual length - otherwise the file has been
+// changed by an incremental update and the first page xref table cannot be
+// trusted.
 //
 
-static bool				// O - `true` on success, `false` on failure
-load_xref(
-    pdfio_file_t        *pdf,		// I - PDF file
-    off_t               xref_offset,	// I - Offset to xref
-    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
-    void                *password_data)	// I - Password callback data, if any
+static off_t				// O - Offset of first page xref table or 0 if not linearized
+get_linearized(pdfio_file_t *pdf,	// I - PDF file
+               size_t       *num_pages,	// O - Number of pages
+               size_t       *page_number)
+					// O - Object number of first page
 {
-  bool		done = false;		// Are we done?
-  char		line[1024],		// Line from file
-		*ptr;			// Pointer into line
-  _pdfio_value_t trailer;		// Trailer dictionary
-  intmax_t	number,			// Object number
-		num_objects,		// Number of objects
-		offset;			// Offset in file
-  int		generation;		// Generation number
   _pdfio_token_t tb;			// Token buffer/stack
-  off_t		line_offset;		// Offset to start of line
+  char		token[256];		// Token from file
+  _pdfio_value_t value;			// Linearization dictionary
+  off_t		offset,			// Offset of first page xref table
+		length;			// Length of file
 
 
-  while (!done)
-  {
-    if (_pdfioFileSeek(pdf, xref_offset, SEEK_SET) != xref_offset)
-    {
-      _pdfioFileError(pdf, "Unable to seek to start of xref table.");
-      return (false);
-    }
+  // Read the "N G obj" header...
+  _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
 
-    do
-    {
-      line_offset = _pdfioFileTell(pdf);
+  if (!_pdfioTokenGet(&tb, token, sizeof(token)) || !isdigit(token[0] & 255) || !_pdfioTokenGet(&tb, token, sizeof(token)) || !isdigit(token[0] & 255) || !_pdfioTokenGet(&tb, token, sizeof(token)) || strcmp(token, "obj"))
+    return (0);
 
-      if (!_pdfioFileGets(pdf, line, sizeof(line)))
-      {
-	_pdfioFileError(pdf, "Unable to read start of xref table.");
-	return (false);
-      }
-    }
-    while (!line[0]);
+  // Then the dictionary...
+  if (!_pdfioTokenGet(&tb, token, sizeof(token)) || strcmp(token, "<<"))
+    return (0);
 
-    PDFIO_DEBUG("load_xref: line_offset=%lu, line='%s'\n", (unsigned long)line_offset, line);
+  _pdfioTokenPush(&tb, token);
 
-    if (isdigit(line[0] & 255) && strlen(line) > 4 && (!strcmp(line + strlen(line) - 4, " obj") || ((ptr = strstr(line, " obj")) != NULL && ptr[4] == '<')))
-    {
-      // Cross-reference stream
-      pdfio_obj_t	*obj;		// Object
-      size_t		i;		// Looping var
-      pdfio_array_t	*index_array;	// Index array
-      size_t		index_n,	// Current element in array
-			index_count,	// Number of values in index array
-			count;		// Number of objects in current pairing
-      pdfio_array_t	*w_array;	// W array
-      size_t		w[3];		// Size of each cross-reference field
-      size_t		w_2,		// Offset to second field
-			w_3;		// Offset to third field
-      size_t		w_total;	// Total length
-      pdfio_stream_t	*st;		// Stream
-      unsigned char	buffer[32];	// Read buffer
-      size_t		num_sobjs = 0,	// Number of object streams
-			sobjs[8192];	// Object streams to load
-      pdfio_obj_t	*current;	// Current object
+  if (!_pdfioValueRead(pdf, NULL, &tb, &value, 0) || value.type != PDFIO_VALTYPE_DICT || pdfioDictGetNumber(value.value.dict, "Linearized") <= 0.0)
+    return (0);
 
-      if ((number = strtoimax(line, &ptr, 10)) < 1)
-      {
-	_pdfioFileError(pdf, "Bad xref table header '%s'.", line);
-	return (false);
-      }
+  if (!_pdfioTokenGet(&tb, token, sizeof(token)) || strcmp(token, "endobj"))
+    return (0);
 
-      if ((generation = (int)strtol(ptr, &ptr, 10)) < 0 || (generation > 65535 && number != 0))
-      {
-	_pdfioFileError(pdf, "Bad xref table header '%s'.", line);
-	return (false);
-      }
+  _pdfioTokenFlush(&tb);
 
-      while (isspace(*ptr & 255))
-	ptr ++;
+  // The first page xref table follows the linearization dictionary...
+  if ((offset = _pdfioFileTell(pdf)) <= 0 || (length = _pdfioFileSeek(pdf, 0, SEEK_END)) <= 0 || (off_t)pdfioDictGetNumber(value.value.dict, "L") != length)
+    return (0);
 
-      if (strncmp(ptr, "obj", 3))
-      {
-	_pdfioFileError(pdf, "Bad xref table header '%s'.", line);
-	return (false);
-      }
+  if ((*num_pages = (size_t)pdfioDictGetNumber(value.value.dict, "N")) == 0 || (*page_number = (size_t)pdfioDictGetNumber(value.value.dict, "O")) == 0)
+    return (0);
 
-      if (_pdfioFileSeek(pdf, line_offset + ptr + 3 - line, SEEK_SET) < 0)
-      {
-        _pdfioFileError(pdf, "Unable to seek to xref object %lu %u.", (unsigned long)number, (unsigned)generation);
-        return (false);
-      }
+  return (offset);
+}
 
-      PDFIO_DEBUG("load_xref: Loading object %lu %u.\n", (unsigned long)number, (unsigned)generation);
 
-      if ((obj = add_obj(pdf, (size_t)number, (unsigned short)generation, xref_offset)) == NULL)
+//
+// 'hash_objhash()' - Compute the hash for an object digest.
+//
+
+static size_t				// O - Hash value
+hash_objhash(const uint8_t *digest)	// I - SHA-256 digest
+{
+  size_t	i,			// Looping var
+		hash;			// Hash value
+
+
+  // SHA-256 digests are already well mixed, so just use the first bytes...
+  for (i = 0, hash = 0; i < sizeof(size_t); i ++)
+    hash = (hash << 8) | digest[i];
+
+  return (hash);
+}
+
+
+//
+// 'hash_objmap()' - Compute the hash for an object map.
+//
+
+static size_t				// O - Hash value
+hash_objmap(pdfio_file_t *src_pdf,	// I - Source PDF file
+            size_t       src_number)	// I - Source object number
+{
+  uint64_t	hash;			// Hash value
+
+
+  // Mix the file pointer and object number (Fibonacci hashing)...
+  hash = ((uint64_t)(uintptr_t)src_pdf >> 4) * 0x9e3779b97f4a7c15ULL;
+  hash ^= (uint64_t)src_number * 0xc2b2ae3d27d4eb4fULL;
+
+  return ((size_t)(hash ^ (hash >> 32)));
+}
+
+
+//
+// 'linearize_compare()' - Compare two objects for linearization.
+//
+
+static int				// O - Result of comparison
+linearize_compare(_pdfio_linobj_t **a,	// I - First object
+                  _pdfio_linobj_t **b)	// I - Second object
+{
+  if ((*a)->key < (*b)->key)
+    return (-1);
+  else if ((*a)->key > (*b)->key)
+    return (1);
+  else if ((*a)->is_page != (*b)->is_page)
+    return ((*a)->is_page ? -1 : 1);
+  else if ((*a)->index < (*b)->index)
+    return (-1);
+  else if ((*a)->index > (*b)->index)
+    return (1);
+  else
+    return (0);
+}
+
+
+//
+// 'linearize_count_cb()' - Count the bytes written during the first pass.
+//
+
+static ssize_t				// O - Number of bytes "written"
+linearize_count_cb(void       *ctx,	// I - Context (unused)
+                   const void *data,	// I - Data (unused)
+                   size_t     bytes)	// I - Number of bytes
+{
+  (void)ctx;
+  (void)data;
+
+  return ((ssize_t)bytes);
+}
+
+
+//
+// 'linearize_flush_bits()' - Pad the hint stream data to a byte boundary.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_flush_bits(
+    _pdfio_linear_t *lin)		// I - Linearization data
+{
+  if (lin->hint_nbits > 0)
+    return (linearize_put_bits(lin, 0, 8 - lin->hint_nbits));
+  else
+    return (true);
+}
+
+
+//
+// 'linearize_hints()' - Create the primary hint stream data.
+//
+// The page offset and shared object hint tables use the offsets from the first
+// pass, which are the offsets "as if" the hint stream was not present.  Content
+// stream offsets are not tracked, so each page's content stream is reported as
+// starting with the page and having the length of the page.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_hints(_pdfio_linear_t *lin)	// I - Linearization data
+{
+  size_t	i,			// Looping var
+		page,			// Current page
+		start,			// Start of page
+		end,			// End of page
+		nobjs,			// Number of objects in page
+		min_nobjs = SIZE_MAX,	// Least number of objects in a page
+		max_nobjs = 0,		// Greatest number of objects in a page
+		min_length = SIZE_MAX,	// Least length of a page
+		max_length = 0,		// Greatest length of a page
+		*nshared,		// Number of shared objects for each page
+		max_nshared = 0,	// Greatest number of shared objects
+		max_id = 0,		// Greatest shared object identifier
+		length,			// Length of page or object
+		nfirst,			// Number of first page objects
+		nother;			// Number of shared objects
+  off_t		*offsets = lin->offsets;// First pass offsets
+  int		bits_nobjs,		// Bits for number of objects
+		bits_length,		// Bits for page length
+		bits_nshared,		// Bits for number of shared objects
+		bits_id;		// Bits for shared object identifiers
+  _pdfio_linref_t *ref;			// Current page reference
+  _pdfio_linobj_t *lobj;		// Current object information
+
+
+  // Count the number of objects and references for each page...
+  if ((nshared = (size_t *)calloc(lin->num_pages, sizeof(size_t))) == NULL)
+  {
+    _pdfioFileError(lin->pdf, "Unable to allocate memory for linearization.");
+    return (false);
+  }
+
+  for (i = lin->num_refs, ref = lin->refs; i > 0; i --, ref ++)
+  {
+    lobj = lin->objs + ref->index;
+
+    if (ref->page > 0 && lobj->shared)
+    {
+      nshared[ref->page] ++;
+
+      if (lobj->hint > max_id)
+        max_id = lobj->hint;
+    }
+  }
+
+  for (page = 0; page < lin->num_pages; page ++)
+  {
+    start = lin->page_start[page];
+    end   = page ? lin->page_start[page + 1] : lin->first_end;
+
+    nobjs  = end - start;
+    length = (size_t)(offsets[end] - offsets[start]);
+
+    if (nobjs < min_nobjs)
+      min_nobjs = nobjs;
+    if (nobjs > max_nobjs)
+      max_nobjs = nobjs;
+    if (length < min_length)
+      min_length = length;
+    if (length > max_length)
+      max_length = length;
+    if (nshared[page] > max_nshared)
+      max_nshared = nshared[page];
+  }
+
+  bits_nobjs   = linearize_nbits(max_nobjs - min_nobjs);
+  bits_length  = linearize_nbits(max_length - min_length);
+  bits_nshared = linearize_nbits(max_nshared);
+  bits_id      = linearize_nbits(max_id);
+
+  // Page offset hint table header...
+  if (!linearize_put_bits(lin, min_nobjs, 32) || !linearize_put_bits(lin, (size_t)offsets[2], 32) || !linearize_put_bits(lin, (size_t)bits_nobjs, 16) || !linearize_put_bits(lin, min_length, 32) || !linearize_put_bits(lin, (size_t)bits_length, 16) || !linearize_put_bits(lin, 0, 32) || !linearize_put_bits(lin, 0, 16) || !linearize_put_bits(lin, min_length, 32) || !linearize_put_bits(lin, (size_t)bits_length, 16) || !linearize_put_bits(lin, (size_t)bits_nshared, 16) || !linearize_put_bits(lin, (size_t)bits_id, 16) || !linearize_put_bits(lin, 0, 16) || !linearize_put_bits(lin, 1, 16))
+    goto error;
+
+  // Page offset hint table entries, each item starting on a byte boundary...
+  for (page = 0; page < lin->num_pages; page ++)
+  {
+    start = lin->page_start[page];
+    end   = page ? lin->page_start[page + 1] : lin->first_end;
+
+    if (!linearize_put_bits(lin, end - start - min_nobjs, bits_nobjs))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  for (page = 0; page < lin->num_pages; page ++)
+  {
+    start = lin->page_start[page];
+    end   = page ? lin->page_start[page + 1] : lin->first_end;
+
+    if (!linearize_put_bits(lin, (size_t)(offsets[end] - offsets[start]) - min_length, bits_length))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  for (page = 0; page < lin->num_pages; page ++)
+  {
+    if (!linearize_put_bits(lin, nshared[page], bits_nshared))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  for (i = lin->num_refs, ref = lin->refs; i > 0; i --, ref ++)
+  {
+    lobj = lin->objs + ref->index;
+
+    if (ref->page > 0 && lobj->shared && !linearize_put_bits(lin, lobj->hint, bits_id))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  for (page = 0; page < lin->num_pages; page ++)
+  {
+    start = lin->page_start[page];
+    end   = page ? lin->page_start[page + 1] : lin->first_end;
+
+    if (!linearize_put_bits(lin, (size_t)(offsets[end] - offsets[start]) - min_length, bits_length))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  // Shared object hint table, starting with the objects in the first page
+  // followed by the shared objects section...
+  lin->hint_shared = lin->hint_used;
+
+  nfirst = lin->first_end - 2;
+  for (nother = 0; lin->srcs[lin->shared_start + nother]; nother ++);
+
+  min_length = SIZE_MAX;
+  max_length = 0;
+
+  for (i = 2; i < (lin->shared_start + nother); i ++)
+  {
+    if (i == lin->first_end)
+      i = lin->shared_start;
+
+    if (i >= (lin->shared_start + nother))
+      break;
+
+    length = (size_t)(offsets[i + 1] - offsets[i]);
+
+    if (length < min_length)
+      min_length = length;
+    if (length > max_length)
+      max_length = length;
+  }
+
+  bits_length = linearize_nbits(max_length - min_length);
+
+  if (!linearize_put_bits(lin, nother ? lin->order[lin->shared_start]->number : 0, 32) || !linearize_put_bits(lin, nother ? (size_t)offsets[lin->shared_start] : 0, 32) || !linearize_put_bits(lin, nfirst, 32) || !linearize_put_bits(lin, nfirst + nother, 32) || !linearize_put_bits(lin, 0, 16) || !linearize_put_bits(lin, min_length, 32) || !linearize_put_bits(lin, (size_t)bits_length, 16))
+    goto error;
+
+  for (i = 2; i < (lin->shared_start + nother); i ++)
+  {
+    if (i == lin->first_end)
+      i = lin->shared_start;
+
+    if (i >= (lin->shared_start + nother))
+      break;
+
+    if (!linearize_put_bits(lin, (size_t)(offsets[i + 1] - offsets[i]) - min_length, bits_length))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  for (i = nfirst + nother; i > 0; i --)
+  {
+    // No MD5 signatures...
+    if (!linearize_put_bits(lin, 0, 1))
+      goto error;
+  }
+
+  if (!linearize_flush_bits(lin))
+    goto error;
+
+  // Build the hint stream object header...
+  snprintf(lin->hint_header, sizeof(lin->hint_header), "%lu 0 obj\n<</Length %lu/S %lu>>\nstream\n", (unsigned long)lin->hint_obj->number, (unsigned long)lin->hint_used, (unsigned long)lin->hint_shared);
+
+  lin->hint_length = (off_t)(strlen(lin->hint_header) + lin->hint_used + 18);
+					// 18 = strlen("\nendstream\nendobj\n")
+  free(nshared);
+
+  return (true);
+
+  // If we get here there was a memory allocation error...
+  error:
+
+  free(nshared);
+
+  return (false);
+}
+
+
+//
+// 'linearize_index()' - Find the index of a source object.
+//
+
+static size_t				// O - Index or number of objects if not found
+linearize_index(pdfio_file_t *pdf,	// I - PDF file
+                size_t       number)	// I - Object number
+{
+  size_t	left,			// Left side of binary search
+		center,			// Center of binary search
+		right;			// Right side of binary search
+
+
+  if (pdf->num_objs == 0)
+    return (0);
+
+  left  = 0;
+  right = pdf->num_objs - 1;
+
+  while (left <= right)
+  {
+    center = (left + right) / 2;
+
+    if (pdf->objs[center]->number == number)
+      return (center);
+    else if (pdf->objs[center]->number < number)
+      left = center + 1;
+    else if (center == 0)
+      break;
+    else
+      right = center - 1;
+  }
+
+  return (pdf->num_objs);
+}
+
+
+//
+// 'linearize_inherited()' - Get an inherited page attribute.
+//
+// Returns `NULL` if the page has its own value or none of its parents define
+// one.
+//
+
+static _pdfio_value_t *			// O - Inherited value or `NULL`
+linearize_inherited(pdfio_obj_t *page,	// I - Page object
+                    const char  *key)	// I - Attribute key
+{
+  pdfio_dict_t	*dict;			// Current dictionary
+  _pdfio_value_t *v;			// Value
+  size_t	depth;			// Depth of page tree
+
+
+  if ((dict = pdfioObjGetDict(page)) == NULL || _pdfioDictGetValue(dict, key))
+    return (NULL);
+
+  for (depth = 0; depth < PDFIO_MAX_DEPTH; depth ++)
+  {
+    if ((dict = pdfioDictGetDict(dict, "Parent")) == NULL)
+      break;
+
+    if ((v = _pdfioDictGetValue(dict, key)) != NULL)
+      return (v);
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'linearize_nbits()' - Get the number of bits needed for a value.
+//
+
+static int				// O - Number of bits
+linearize_nbits(size_t value)		// I - Value
+{
+  int	nbits;				// Number of bits
+
+
+  for (nbits = 0; value > 0; nbits ++, value >>= 1);
+
+  return (nbits);
+}
+
+
+//
+// 'linearize_put_bits()' - Add bits to the hint stream data.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_put_bits(
+    _pdfio_linear_t *lin,		// I - Linearization data
+    size_t          value,		// I - Value
+    int             nbits)		// I - Number of bits
+{
+  while (nbits > 0)
+  {
+    nbits --;
+
+    lin->hint_bits = (lin->hint_bits << 1) | ((value >> nbits) & 1);
+    lin->hint_nbits ++;
+
+    if (lin->hint_nbits == 8)
+    {
+      if (lin->hint_used >= lin->hint_alloc)
+      {
+        unsigned char *temp;		// New hint data
+
+        if ((temp = (unsigned char *)realloc(lin->hint, lin->hint_alloc + 1024)) == NULL)
+        {
+	  _pdfioFileError(lin->pdf, "Unable to allocate memory for linearization.");
+	  return (false);
+        }
+
+        lin->hint       = temp;
+        lin->hint_alloc += 1024;
+      }
+
+      lin->hint[lin->hint_used ++] = (unsigned char)lin->hint_bits;
+      lin->hint_bits  = 0;
+      lin->hint_nbits = 0;
+    }
+  }
+
+  return (true);
+}
+
+
+//
+// 'linearize_scan()' - Scan the objects used by a page or the document.
+//
+// The "page" argument is the page number + 1, or the number of pages + 1 for
+// the document objects.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_scan(_pdfio_linear_t *lin,	// I - Linearization data
+               size_t          index,	// I - Index of starting object
+               size_t          page)	// I - Page number + 1
+{
+  pdfio_obj_t	*obj;			// Current object
+  _pdfio_value_t *v;			// Inherited value
+  static const char * const keys[] =	// Inherited page attributes
+  { "CropBox", "MediaBox", "Resources", "Rotate" };
+  size_t	i;			// Looping var
+
+
+  if (index >= lin->pdf->num_objs)
+    return (true);
+
+  lin->objs[index].visit = page;
+  lin->num_stack         = 0;
+
+  if (page <= lin->num_pages)
+  {
+    // Scan any inherited page attributes...
+    for (i = 0; i < (sizeof(keys) / sizeof(keys[0])); i ++)
+    {
+      if ((v = linearize_inherited(lin->pdf->objs[index], keys[i])) != NULL && !linearize_scan_value(lin, v, page, 0))
+        return (false);
+    }
+  }
+
+  // Then all of the objects used by the starting object...
+  for (i = index;;)
+  {
+    obj = lin->pdf->objs[i];
+
+    if (obj->value.type == PDFIO_VALTYPE_NONE)
+      _pdfioObjLoad(obj);
+
+    if (!linearize_scan_value(lin, &obj->value, page, 0))
+      return (false);
+
+    if (lin->num_stack == 0)
+      break;
+
+    i = lin->stack[-- lin->num_stack];
+  }
+
+  return (true);
+}
+
+
+//
+// 'linearize_scan_value()' - Scan the objects used by a value.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_scan_value(
+    _pdfio_linear_t *lin,		// I - Linearization data
+    _pdfio_value_t  *v,			// I - Value
+    size_t          page,		// I - Page number + 1
+    size_t          depth)		// I - Depth of value
+{
+  size_t	i;			// Looping var
+  _pdfio_linobj_t *lobj;		// Object information
+  pdfio_obj_t	*obj;			// Object
+  const char	*type;			// Object type
+
+
+  if (depth >= PDFIO_MAX_DEPTH)
+    return (true);
+
+  switch (v->type)
+  {
+    case PDFIO_VALTYPE_ARRAY :
+        for (i = 0; i < v->value.array->num_values; i ++)
+        {
+          if (!linearize_scan_value(lin, _pdfioArrayGetValue(v->value.array, i), page, depth + 1))
+            return (false);
+        }
+        break;
+
+    case PDFIO_VALTYPE_DICT :
+        for (i = 0; i < v->value.dict->num_pairs; i ++)
+        {
+          // Indirect stream lengths are not copied...
+          if (!strcmp(v->value.dict->pairs[i].key, "Length") && v->value.dict->pairs[i].value.type == PDFIO_VALTYPE_INDIRECT)
+            continue;
+
+          if (!linearize_scan_value(lin, _pdfioDictGetValue(v->value.dict, v->value.dict->pairs[i].key), page, depth + 1))
+            return (false);
+        }
+        break;
+
+    case PDFIO_VALTYPE_INDIRECT :
+        if ((i = linearize_index(lin->pdf, v->value.indirect.number)) >= lin->pdf->num_objs || i == lin->catalog)
+          break;
+
+        lobj = lin->objs + i;
+
+        // Stop at other pages and at nodes in the page tree...
+        if (lobj->visit == page || lobj->is_page || lobj->is_pages)
+          break;
+
+        lobj->visit = page;
+        obj         = lin->pdf->objs[i];
+
+        if ((type = pdfioObjGetType(obj)) != NULL && !strcmp(type, "Pages"))
+        {
+          lobj->is_pages = true;
+          break;
+        }
+
+        if (page <= lin->num_pages)
+        {
+          // Object used by a page...
+          if (lin->num_refs >= lin->alloc_refs)
+          {
+            _pdfio_linref_t *temp;	// New references
+
+            if ((temp = (_pdfio_linref_t *)realloc(lin->refs, (lin->alloc_refs + 1024) * sizeof(_pdfio_linref_t))) == NULL)
+            {
+	      _pdfioFileError(lin->pdf, "Unable to allocate memory for linearization.");
+	      return (false);
+            }
+
+            lin->refs       = temp;
+            lin->alloc_refs += 1024;
+          }
+
+          lin->refs[lin->num_refs].page  = page - 1;
+          lin->refs[lin->num_refs].index = i;
+          lin->num_refs ++;
+
+          if (lobj->group == 0)
+            lobj->group = page;
+          else if (lobj->group != page)
+            lobj->shared = true;
+        }
+        else if (lobj->group == 0)
+        {
+          // Object only used by the document...
+          lobj->other = true;
+        }
+
+        // Scan the object's value later...
+        if (lin->num_stack >= lin->alloc_stack)
+        {
+          size_t *temp;			// New stack
+
+          if ((temp = (size_t *)realloc(lin->stack, (lin->alloc_stack + 1024) * sizeof(size_t))) == NULL)
+          {
+	    _pdfioFileError(lin->pdf, "Unable to allocate memory for linearization.");
+	    return (false);
+          }
+
+          lin->stack       = temp;
+          lin->alloc_stack += 1024;
+        }
+
+        lin->stack[lin->num_stack ++] = i;
+        break;
+
+    default :
+        break;
+  }
+
+  return (true);
+}
+
+
+//
+// 'linearize_write()' - Write a linearized PDF file.
+//
+// The first pass writes the file without the hint stream to get the object
+// offsets.  The final pass uses those offsets to write the linearization
+// dictionary, first page cross-reference table, and hint stream.  Fixed-width
+// numbers are used for the values that change so that both passes produce the
+// same offsets for everything before the hint stream.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_write(_pdfio_linear_t *lin)	// I - Linearization data
+{
+  pdfio_file_t	*dst = lin->dst;	// Linearized PDF file
+  size_t	i;			// Looping var
+  off_t		end = 0,		// Offset of the end of the first page
+		length = 0,		// Length of file
+		hint = 0,		// Offset of hint stream
+		main_entry = 0;		// Offset before first main xref entry
+  char		main_header[64];	// Main xref table header
+  size_t	first = lin->order[0]->number;
+					// First object number in first page
+
+
+  snprintf(main_header, sizeof(main_header), "xref\n0 %lu \n", (unsigned long)first);
+
+  if (lin->final)
+  {
+    end        = lin->offsets[lin->first_end];
+    hint       = end;
+    length     = lin->length + lin->hint_length;
+    lin->prev  = lin->main_xref + lin->hint_length;
+    main_entry = lin->prev + (off_t)strlen(main_header) - 1;
+  }
+
+  // Header and linearization dictionary...
+  if (!_pdfioFilePrintf(dst, "%%PDF-%s\n%%\342\343\317\323\n", dst->version))
+    return (false);
+
+  lin->order[0]->offset = _pdfioFileTell(dst);
+
+  if (!_pdfioFilePrintf(dst, "%lu 0 obj\n<</Linearized 1/L %-10lu/H[%-10lu %-10lu]/O %lu/E %-10lu/N %lu/T %-10lu>>\nendobj\n", (unsigned long)first, (unsigned long)length, (unsigned long)hint, (unsigned long)(lin->final ? lin->hint_length : 0), (unsigned long)lin->order[2]->number, (unsigned long)end, (unsigned long)lin->num_pages, (unsigned long)main_entry))
+    return (false);
+
+  // First page cross-reference table and trailer...
+  lin->first_xref = _pdfioFileTell(dst);
+
+  if (!_pdfioFilePrintf(dst, "xref\n%lu %lu \n", (unsigned long)first, (unsigned long)lin->first_end + 1))
+    return (false);
+
+  for (i = 0; i < lin->first_end; i ++)
+  {
+    if (!_pdfioFilePrintf(dst, "%010lu 00000 n \n", lin->final ? (unsigned long)lin->offsets[i] : 0UL))
+      return (false);
+  }
+
+  if (!_pdfioFilePrintf(dst, "%010lu 00000 n \ntrailer\n<<", (unsigned long)hint))
+    return (false);
+
+  if (lin->id_array && (!_pdfioFilePuts(dst, "/ID") || !_pdfioArrayWrite(lin->id_array, NULL)))
+    return (false);
+
+  if (lin->info_obj && !_pdfioFilePrintf(dst, "/Info %lu 0 R", (unsigned long)lin->info_obj->number))
+    return (false);
+
+  if (!_pdfioFilePrintf(dst, "/Prev %-10lu/Root %lu 0 R/Size %lu>>\nstartxref\n0\n%%%%EOF\n", (unsigned long)lin->prev, (unsigned long)lin->order[1]->number, (unsigned long)lin->hint_obj->number + 1))
+    return (false);
+
+  // Catalog and first page...
+  for (i = 1; i < lin->first_end; i ++)
+  {
+    if (!linearize_write_obj(lin, i))
+      return (false);
+  }
+
+  // Primary hint stream...
+  if (lin->final)
+  {
+    lin->hint_obj->offset = _pdfioFileTell(dst);
+
+    if (!_pdfioFilePuts(dst, lin->hint_header) || !_pdfioFileWrite(dst, lin->hint, lin->hint_used) || !_pdfioFilePuts(dst, "\nendstream\nendobj\n"))
+      return (false);
+  }
+
+  // Remaining pages, shared objects, and other objects...
+  for (i = lin->first_end; i < lin->num_order; i ++)
+  {
+    if (!linearize_write_obj(lin, i))
+      return (false);
+  }
+
+  // Main cross-reference table and trailer...
+  lin->main_xref = _pdfioFileTell(dst);
+
+  if (!_pdfioFilePrintf(dst, "%s0000000000 65535 f \n", main_header))
+    return (false);
+
+  for (i = lin->first_end; i < lin->num_order; i ++)
+  {
+    if (!_pdfioFilePrintf(dst, "%010lu %05u n \n", (unsigned long)lin->order[i]->offset, lin->order[i]->generation))
+      return (false);
+  }
+
+  if (!_pdfioFilePrintf(dst, "trailer\n<</Size %lu>>\nstartxref\n%lu\n%%%%EOF\n", (unsigned long)first, (unsigned long)lin->first_xref))
+    return (false);
+
+  return (true);
+}
+
+
+//
+// 'linearize_write_obj()' - Write an object to a linearized PDF file.
+//
+
+static bool				// O - `true` on success, `false` on failure
+linearize_write_obj(
+    _pdfio_linear_t *lin,		// I - Linearization data
+    size_t          i)			// I - Index in file order
+{
+  pdfio_file_t	*dst = lin->dst;	// Linearized PDF file
+  pdfio_obj_t	*obj = lin->order[i],	// Object
+		*src = lin->srcs[i];	// Source object
+  pdfio_stream_t *st;			// Source stream
+  ssize_t	bytes;			// Bytes read
+  char		buffer[8192];		// Copy buffer
+
+
+  obj->offset = _pdfioFileTell(dst);
+
+  if (!_pdfioFilePrintf(dst, "%lu %u obj\n", (unsigned long)obj->number, obj->generation) || !_pdfioValueWrite(dst, obj, &obj->value, NULL))
+    return (false);
+
+  if (!src || !src->stream_offset)
+    return (_pdfioFilePuts(dst, "\nendobj\n"));
+
+  // Copy the raw stream data...
+  if (!_pdfioFilePuts(dst, "\nstream\n"))
+    return (false);
+
+  if ((st = pdfioObjOpenStream(src, false)) == NULL)
+    return (false);
+
+  while ((bytes = pdfioStreamRead(st, buffer, sizeof(buffer))) > 0)
+  {
+    if (!_pdfioFileWrite(dst, buffer, (size_t)bytes))
+    {
+      pdfioStreamClose(st);
+      return (false);
+    }
+  }
+
+  pdfioStreamClose(st);
+
+  return (_pdfioFilePuts(dst, "\nendstream\nendobj\n"));
+}
+
+
+//
+// 'load_deferred()' - Load the rest of a linearized PDF file.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_deferred(pdfio_file_t *pdf)	// I - PDF file
+{
+  off_t	xref_offset = pdf->lazy_xref;	// Offset of remaining xref tables
+
+
+  PDFIO_DEBUG("load_deferred(pdf=%p) xref_offset=%lu\n", (void *)pdf, (unsigned long)xref_offset);
+
+  // Load the remaining xref tables and the full page tree...
+  pdf->lazy_xref = 0;
+  pdf->num_pages = 0;
+
+  return (load_xref(pdf, xref_offset, NULL, NULL, false));
+}
+
+
+//
+// 'load_obj_stream()' - Load an object stream.
+//
+// Object streams are Adobe's complicated solution for saving a few
+// kilobytes in an average PDF file at the expense of massively more
+// complicated reader applications.
+//
+// Each object stream starts with pairs of object numbers and offsets,
+// followed by the object values (typically dictionaries).  For
+// simplicity pdfio loads all of these values into memory so that we
+// don't later have to randomly access compressed stream data to get
+// a dictionary.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_obj_stream(pdfio_obj_t *obj)	// I - Object to load
+{
+  pdfio_stream_t	*st;		// Stream
+  _pdfio_token_t	tb;		// Token buffer/stack
+  char			buffer[32];	// Token
+  size_t		number,		// Object number
+			cur_obj,	// Current object
+			num_objs = 0;	// Number of objects
+  pdfio_obj_t		*objs[16384];	// Objects
+
+
+  PDFIO_DEBUG("load_obj_stream(obj=%p(%d))\n", obj, (int)obj->number);
+
+  // Open the object stream...
+  if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+  {
+    _pdfioFileError(obj->pdf, "Unable to open compressed object stream %lu.", (unsigned long)obj->number);
+    return (false);
+  }
+
+  _pdfioTokenInit(&tb, obj->pdf, (_pdfio_tconsume_cb_t)pdfioStreamConsume, (_pdfio_tpeek_cb_t)pdfioStreamPeek, st);
+
+  // Read the object numbers from the beginning of the stream...
+  while (_pdfioTokenGet(&tb, buffer, sizeof(buffer)))
+  {
+    // Stop if this isn't an object number...
+    if (!isdigit(buffer[0] & 255))
+      break;
+
+    // Stop if we have too many objects...
+    if (num_objs >= (sizeof(objs) / sizeof(objs[0])))
+    {
+      _pdfioFileError(obj->pdf, "Too many compressed objects in one stream.");
+      pdfioStreamClose(st);
+      return (false);
+    }
+
+    // Add the object in memory...
+    number = (size_t)strtoimax(buffer, NULL, 10);
+
+    if ((objs[num_objs] = pdfioFileFindObj(obj->pdf, number)) == NULL)
+      objs[num_objs] = add_obj(obj->pdf, number, 0, 0);
+
+    num_objs ++;
+
+    // Skip offset
+    _pdfioTokenGet(&tb, buffer, sizeof(buffer));
+    PDFIO_DEBUG("load_obj_stream: %ld at offset %s\n", (long)number, buffer);
+  }
+
+  if (!buffer[0])
+  {
+    pdfioStreamClose(st);
+    return (false);
+  }
+
+  _pdfioTokenPush(&tb, buffer);
+
+  // Read the objects themselves...
+  for (cur_obj = 0; cur_obj < num_objs; cur_obj ++)
+  {
+    if (!_pdfioValueRead(obj->pdf, obj, &tb, &(objs[cur_obj]->value), 0))
+    {
+      pdfioStreamClose(st);
+      return (false);
+    }
+  }
+
+  // Close the stream and return
+  pdfioStreamClose(st);
+
+  return (true);
+}
+
+
+//
+// 'load_pages()' - Load pages in the document.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_pages(pdfio_file_t *pdf,		// I - PDF file
+           pdfio_obj_t  *obj,		// I - Page object
+           size_t       depth)		// I - Depth of page tree
+{
+  pdfio_dict_t	*dict;			// Page object dictionary
+  const char	*type;			// Node type
+  pdfio_array_t	*kids;			// Kids array
+
+
+  // Range check input...
+  if (!obj)
+  {
+    _pdfioFileError(pdf, "Unable to find pages object.");
+    return (false);
+  }
+
+  // Get the object dictionary and make sure this is a Pages or Page object...
+  if ((dict = pdfioObjGetDict(obj)) == NULL)
+  {
+    _pdfioFileError(pdf, "No dictionary for pages object.");
+    return (false);
+  }
+
+  if ((type = pdfioDictGetName(dict, "Type")) == NULL || (strcmp(type, "Pages") && strcmp(type, "Page")))
+    return (false);
+
+  // If there is a Kids array, then this is a parent node and we have to look
+  // at the child objects...
+  if ((kids = pdfioDictGetArray(dict, "Kids")) != NULL)
+  {
+    // Load the child objects...
+    size_t	i,			// Looping var
+		num_kids;		// Number of elements in array
+
+    if (depth >= PDFIO_MAX_DEPTH)
+    {
+      _pdfioFileError(pdf, "Depth of pages objects too great to load.");
+      return (false);
+    }
+
+    for (i = 0, num_kids = pdfioArrayGetSize(kids); i < num_kids; i ++)
+    {
+      if (!load_pages(pdf, pdfioArrayGetObj(kids, i), depth + 1))
+        return (false);
+    }
+  }
+  else
+  {
+    // Add this page...
+    if (pdf->num_pages >= pdf->alloc_pages)
+    {
+      pdfio_obj_t **temp = (pdfio_obj_t **)realloc(pdf->pages, (pdf->alloc_pages + 32) * sizeof(pdfio_obj_t *));
+
+      if (!temp)
+      {
+        _pdfioFileError(pdf, "Unable to allocate memory for pages.");
+        return (false);
+      }
+
+      pdf->alloc_pages += 32;
+      pdf->pages       = temp;
+    }
+
+    pdf->pages[pdf->num_pages ++] = obj;
+  }
+
+  return (true);
+}
+
+
+//
+// 'load_root()' - Load the Root and Info objects and the page tree.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_root(pdfio_file_t *pdf)		// I - PDF file
+{
+  pdf->info_obj = pdfioDictGetObj(pdf->trailer_dict, "Info");
+
+  if ((pdf->root_obj = pdfioDictGetObj(pdf->trailer_dict, "Root")) == NULL)
+  {
+    _pdfioFileError(pdf, "Missing Root object.");
+    return (false);
+  }
+
+  PDFIO_DEBUG("load_root: Root=%p(%lu)\n", pdf->root_obj, (unsigned long)pdf->root_obj->number);
+
+  if ((pdf->pages_obj = pdfioDictGetObj(pdfioObjGetDict(pdf->root_obj), "Pages")) != NULL)
+  {
+    // Use the page count from the root of the page tree and look up pages as
+    // they are needed...
+    pdfio_dict_t *pages_dict = pdfioObjGetDict(pdf->pages_obj);
+					// Pages dictionary
+    const char	*type = pdfioDictGetName(pages_dict, "Type");
+					// Pages type
+    double	count = pdfioDictGetNumber(pages_dict, "Count");
+					// Number of pages
+
+    if (type && !strcmp(type, "Pages") && pdfioDictGetArray(pages_dict, "Kids") && count > 0.0 && count <= (double)pdf->num_objs)
+    {
+      free(pdf->pages);
+      free_page_nodes(pdf);
+
+      if ((pdf->pages = (pdfio_obj_t **)calloc((size_t)count, sizeof(pdfio_obj_t *))) == NULL)
+      {
+        _pdfioFileError(pdf, "Unable to allocate memory for pages.");
+        pdf->alloc_pages = pdf->num_pages = 0;
+        return (false);
+      }
+
+      pdf->alloc_pages = pdf->num_pages = (size_t)count;
+
+      return (true);
+    }
+  }
+
+  return (load_pages(pdf, pdf->pages_obj, 0));
+}
+
+
+//
+// 'load_xref()' - Load an XREF table...
+//
+
+static bool				// O - `true` on success, `false` on failure
+load_xref(
+    pdfio_file_t        *pdf,		// I - PDF file
+    off_t               xref_offset,	// I - Offset to xref
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_data,	// I - Password callback data, if any
+    bool                first_only)	// I - Only load the first xref table?
+{
+  bool		done = false;		// Are we done?
+  char		line[1024],		// Line from file
+		*ptr;			// Pointer into line
+  _pdfio_value_t trailer;		// Trailer dictionary
+  intmax_t	number,			// Object number
+		num_objects,		// Number of objects
+		offset;			// Offset in file
+  int		generation;		// Generation number
+  _pdfio_token_t tb;			// Token buffer/stack
+  off_t		line_offset;		// Offset to start of line
+
+
+  while (!done)
+  {
+    if (_pdfioFileSeek(pdf, xref_offset, SEEK_SET) != xref_offset)
+    {
+      _pdfioFileError(pdf, "Unable to seek to start of xref table.");
+      return (false);
+    }
+
+    do
+    {
+      line_offset = _pdfioFileTell(pdf);
+
+      if (!_pdfioFileGets(pdf, line, sizeof(line)))
+      {
+	_pdfioFileError(pdf, "Unable to read start of xref table.");
+	return (false);
+      }
+    }
+    while (!line[0]);
+
+    PDFIO_DEBUG("load_xref: line_offset=%lu, line='%s'\n", (unsigned long)line_offset, line);
+
+    if (isdigit(line[0] & 255) && strlen(line) > 4 && (!strcmp(line + strlen(line) - 4, " obj") || ((ptr = strstr(line, " obj")) != NULL && ptr[4] == '<')))
+    {
+      // Cross-reference stream
+      pdfio_obj_t	*obj;		// Object
+      size_t		i;		// Looping var
+      pdfio_array_t	*index_array;	// Index array
+      size_t		index_n,	// Current element in array
+			index_count,	// Number of values in index array
+			count;		// Number of objects in current pairing
+      pdfio_array_t	*w_array;	// W array
+      size_t		w[3];		// Size of each cross-reference field
+      size_t		w_2,		// Offset to second field
+			w_3;		// Offset to third field
+      size_t		w_total;	// Total length
+      pdfio_stream_t	*st;		// Stream
+      unsigned char	buffer[32];	// Read buffer
+      size_t		num_sobjs = 0,	// Number of object streams
+			sobjs[8192];	// Object streams to load
+      pdfio_obj_t	*current;	// Current object
+
+      if ((number = strtoimax(line, &ptr, 10)) < 1)
+      {
+	_pdfioFileError(pdf, "Bad xref table header '%s'.", line);
+	return (false);
+      }
+
+      if ((generation = (int)strtol(ptr, &ptr, 10)) < 0 || (generation > 65535 && number != 0))
+      {
+	_pdfioFileError(pdf, "Bad xref table header '%s'.", line);
+	return (false);
+      }
+
+      while (isspace(*ptr & 255))
+	ptr ++;
+
+      if (strncmp(ptr, "obj", 3))
+      {
+	_pdfioFileError(pdf, "Bad xref table header '%s'.", line);
+	return (false);
+      }
+
+      if (_pdfioFileSeek(pdf, line_offset + ptr + 3 - line, SEEK_SET) < 0)
+      {
+        _pdfioFileError(pdf, "Unable to seek to xref object %lu %u.", (unsigned long)number, (unsigned)generation);
+        return (false);
+      }
+
+      PDFIO_DEBUG("load_xref: Loading object %lu %u.\n", (unsigned long)number, (unsigned)generation);
+
+      if ((obj = add_obj(pdf, (size_t)number, (unsigned short)generation, xref_offset)) == NULL)
+      {
+        _pdfioFileError(pdf, "Unable to allocate memory for object.");
+        return (false);
+      }
+
+      _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
+
+      if (!_pdfioValueRead(pdf, obj, &tb, &trailer, 0))
+      {
+        _pdfioFileError(pdf, "Unable to read cross-reference stream dictionary.");
+        return (false);
+      }
+      else if (trailer.type != PDFIO_VALTYPE_DICT)
+      {
+	_pdfioFileError(pdf, "Cross-reference stream does not have a dictionary.");
+	return (false);
+      }
+
+      obj->value = trailer;
+
+      if (!_pdfioTokenGet(&tb, line, sizeof(line)) || strcmp(line, "stream"))
+      {
+        _pdfioFileError(pdf, "Unable to get stream after xref dictionary.");
+        return (false);
+      }
+
+      PDFIO_DEBUG("load_xref: tb.bufptr=%p, tb.bufend=%p, tb.bufptr[0]=0x%02x, tb.bufptr[0]=0x%02x\n", tb.bufptr, tb.bufend, tb.bufptr[0], tb.bufptr[1]);
+      if (tb.bufptr && tb.bufptr < tb.bufend && (tb.bufptr[0] == 0x0d || tb.bufptr[0] == 0x0a))
+	tb.bufptr ++;			// Skip trailing CR or LF after token
+
+      _pdfioTokenFlush(&tb);
+
+      obj->stream_offset = _pdfioFileTell(pdf);
+
+      if ((index_array = pdfioDictGetArray(trailer.value.dict, "Index")) != NULL)
+        index_count = index_array->num_values;
+      else
+        index_count = 1;
+
+      if ((w_array = pdfioDictGetArray(trailer.value.dict, "W")) == NULL)
+      {
+	_pdfioFileError(pdf, "Cross-reference stream does not have required W key.");
+	return (false);
+      }
+
+      w[0]    = (size_t)pdfioArrayGetNumber(w_array, 0);
+      w[1]    = (size_t)pdfioArrayGetNumber(w_array, 1);
+      w[2]    = (size_t)pdfioArrayGetNumber(w_array, 2);
+      w_total = w[0] + w[1] + w[2];
+      w_2     = w[0];
+      w_3     = w[0] + w[1];
+
+      if (w[1] == 0 || w[2] > 4 || w[0] > sizeof(buffer) || w[1] > sizeof(buffer) || w[2] > sizeof(buffer) || w_total > sizeof(buffer))
+      {
+	_pdfioFileError(pdf, "Cross-reference stream has invalid W key [%u %u %u].", (unsigned)w[0], (unsigned)w[1], (unsigned)w[2]);
+	return (false);
+      }
+
+      if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+      {
+	_pdfioFileError(pdf, "Unable to open cross-reference stream.");
+	return (false);
+      }
+
+      for (index_n = 0; index_n < index_count; index_n += 2)
+      {
+        if (index_count == 1)
+        {
+          number = 0;
+          count  = 999999999;
+	}
+	else
+	{
+          number = (intmax_t)pdfioArrayGetNumber(index_array, index_n);
+          count  = (size_t)pdfioArrayGetNumber(index_array, index_n + 1);
+	}
+
+	while (count > 0 && pdfioStreamRead(st, buffer, w_total) > 0)
+	{
+	  count --;
+
+	  PDFIO_DEBUG("load_xref: number=%u %02X%02X%02X%02X%02X\n", (unsigned)number, buffer[0], buffer[1], buffer[2], buffer[3], buffer[4]);
+
+	  // Check whether this is an object definition...
+	  if (w[0] > 0)
+	  {
+	    if (buffer[0] == 0)
+	    {
+	      // Ignore free objects...
+	      number ++;
+	      continue;
+	    }
+	  }
+
+          // Offset
+	  for (i = 1, offset = buffer[w_2]; i < w[1]; i ++)
+	    offset = (offset << 8) | buffer[w_2 + i];
+
+          // Generation number
+	  switch (w[2])
+	  {
+	    default :
+		generation = 0;
+		break;
+	    case 1 :
+		generation = buffer[w_3];
+		break;
+	    case 2 :
+		generation = (buffer[w_3] << 8) | buffer[w_3 + 1];
+		break;
+	    case 3 :
+	        // Issue #46: Stupid Microsoft PDF generator using 3 bytes to
+	        // encode 16-bit generation numbers == 0 (probably a lazy coder
+	        // stuffing things into an array of 64-bit unsigned integers)
+		generation = (buffer[w_3] << 16) | (buffer[w_3 + 1] << 8) | buffer[w_3 + 2];
+		if (generation > 65535)
+		  generation = 65535;
+		break;
+	    case 4 : // Even stupider :)
+		generation = (buffer[w_3] << 24) | (buffer[w_3 + 1] << 16) | (buffer[w_3 + 2] << 8) | buffer[w_3 + 3];
+		if (generation > 65535)
+		  generation = 65535;
+		break;
+	  }
+
+	  // Create a placeholder for the object in memory...
+	  if ((current = pdfioFileFindObj(pdf, (size_t)number)) != NULL)
+	  {
+	    PDFIO_DEBUG("load_xref: existing object, prev offset=%u\n", (unsigned)current->offset);
+
+            if (w[0] == 0 || buffer[0] == 1)
+            {
+              // Location of object...
+	      current->offset = offset;
+	    }
+	    else if (number != offset)
+	    {
+	      // Object is part of a stream, offset is the object number...
+	      current->offset = 0;
+	    }
+
+	    PDFIO_DEBUG("load_xref: new offset=%u\n", (unsigned)current->offset);
+	  }
+
+	  if (w[0] > 0 && buffer[0] == 2)
+	  {
+	    // Object streams need to be loaded into memory, so add them
+	    // to the list of objects to load later as needed...
+	    for (i = 0; i < num_sobjs; i ++)
+	    {
+	      if (sobjs[i] == (size_t)offset)
+		break;
+	    }
+
+	    if (i >= num_sobjs)
+	    {
+	      if (num_sobjs < (sizeof(sobjs) / sizeof(sobjs[0])))
+	      {
+		sobjs[num_sobjs ++] = (size_t)offset;
+	      }
+	      else
+	      {
+		_pdfioFileError(pdf, "Too many object streams.");
+	        return (false);
+	      }
+	    }
+	  }
+	  else if (!current)
+	  {
+	    // Add this object...
+	    if (!add_obj(pdf, (size_t)number, (unsigned short)generation, offset))
+	      return (false);
+	  }
+
+	  number ++;
+	}
+      }
+
+      pdfioStreamClose(st);
+
+      if (!pdf->trailer_dict)
       {
-        _pdfioFileError(pdf, "Unable to allocate memory for object.");
-        return (false);
+	// Save the trailer dictionary and ID...
+	pdf->trailer_dict = trailer.value.dict;
+	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
+      }
+
+      // If the trailer contains an Encrypt key, try unlocking the file once
+      // the encryption object is known (it may be in an older xref table after
+      // an incremental update)...
+      if (!pdf->encrypt_obj && (pdf->encrypt_obj = pdfioDictGetObj(pdf->trailer_dict, "Encrypt")) != NULL && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
+	return (false);
+
+      // Load any object streams that are left...
+      PDFIO_DEBUG("load_xref: %lu compressed object streams to load.\n", (unsigned long)num_sobjs);
+
+      for (i = 0; i < num_sobjs; i ++)
+      {
+        if ((obj = pdfioFileFindObj(pdf, sobjs[i])) != NULL)
+        {
+	  PDFIO_DEBUG("load_xref: Loading compressed object stream %lu (pdf=%p, obj->pdf=%p).\n", (unsigned long)sobjs[i], pdf, obj->pdf);
+
+          if (!load_obj_stream(obj))
+            return (false);
+	}
+	else
+	{
+	  _pdfioFileError(pdf, "Unable to find compressed object stream %lu.", (unsigned long)sobjs[i]);
+	  return (false);
+	}
+      }
+    }
+    else if (!strncmp(line, "xref", 4) && (!line[4] || isspace(line[4] & 255)))
+    {
+      // Read the xref tables
+      off_t trailer_offset = _pdfioFileTell(pdf);
+					// Offset of current line
+
+      PDFIO_DEBUG("load_xref: Reading xref table starting at offset %lu\n", (unsigned long)trailer_offset);
+      while (_pdfioFileGets(pdf, line, sizeof(line)))
+      {
+        PDFIO_DEBUG("load_xref: '%s' at offset %lu\n", line, (unsigned long)trailer_offset);
+
+	if (!strncmp(line, "trailer", 7) && (!line[7] || isspace(line[7] & 255)))
+	{
+	  if (line[7])
+	  {
+	    // Probably the start of the trailer dictionary, rewind the file so
+	    // we can read it...
+	    _pdfioFileSeek(pdf, trailer_offset + 7, SEEK_SET);
+	  }
+
+	  break;
+	}
+	else
+	{
+	  trailer_offset = _pdfioFileTell(pdf);
+
+          if (!line[0])
+	    continue;
+	}
+
+	if (sscanf(line, "%jd%jd", &number, &num_objects) != 2)
+	{
+	  _pdfioFileError(pdf, "Malformed xref table section '%s'.", line);
+	  return (false);
+	}
+
+	// Read this group of objects...
+	for (; num_objects > 0; num_objects --, number ++)
+	{
+	  // Read a line from the file and validate it...
+	  if (_pdfioFileRead(pdf, line, 20) != 20)
+	    return (false);
+
+	  line[20] = '\0';
+
+	  if (strcmp(line + 18, "\r\n") && strcmp(line + 18, " \n") && strcmp(line + 18, " \r"))
+	  {
+	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
+	    return (false);
+	  }
+	  line[18] = '\0';
+
+	  // Parse the line
+	  if ((offset = strtoimax(line, &ptr, 10)) < 0)
+	  {
+	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
+	    return (false);
+	  }
+
+	  if ((generation = (int)strtol(ptr, &ptr, 10)) < 0 || (generation > 65535 && offset != 0))
+	  {
+	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
+	    return (false);
+	  }
+
+	  if (*ptr != ' ')
+	  {
+	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
+	    return (false);
+	  }
+
+	  ptr ++;
+	  if (*ptr != 'f' && *ptr != 'n')
+	  {
+	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
+	    return (false);
+	  }
+
+	  if (*ptr == 'f')
+	    continue;			// Don't care about free objects...
+
+	  // Create a placeholder for the object in memory...
+	  if (pdfioFileFindObj(pdf, (size_t)number))
+	    continue;			// Don't replace newer object...
+
+	  if (!add_obj(pdf, (size_t)number, (unsigned short)generation, offset))
+	    return (false);
+	}
+
+	trailer_offset = _pdfioFileTell(pdf);
+      }
+
+      if (strncmp(line, "trailer", 7))
+      {
+	_pdfioFileError(pdf, "Missing trailer.");
+	return (false);
+      }
+
+      _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
+
+      if (!_pdfioValueRead(pdf, NULL, &tb, &trailer, 0))
+      {
+	_pdfioFileError(pdf, "Unable to read trailer dictionary.");
+	return (false);
+      }
+      else if (trailer.type != PDFIO_VALTYPE_DICT)
+      {
+	_pdfioFileError(pdf, "Trailer is not a dictionary.");
+	return (false);
+      }
+
+      PDFIO_DEBUG("load_xref: Got trailer dict.\n");
+
+      _pdfioTokenFlush(&tb);
+
+      if (!pdf->trailer_dict)
+      {
+	// Save the trailer dictionary and ID...
+	pdf->trailer_dict = trailer.value.dict;
+	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
       }
 
-      _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
+      // If the trailer contains an Encrypt key, try unlocking the file once
+      // the encryption object is known (it may be in an older xref table after
+      // an incremental update)...
+      if (!pdf->encrypt_obj && (pdf->encrypt_obj = pdfioDictGetObj(pdf->trailer_dict, "Encrypt")) != NULL && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
+	return (false);
+    }
+    else
+    {
+      _pdfioFileError(pdf, "Bad xref table header '%s'.", line);
+      return (false);
+    }
+
+    PDFIO_DEBUG("load_xref: Contents of trailer dictionary:\n");
+    PDFIO_DEBUG("load_xref: ");
+    PDFIO_DEBUG_VALUE(&trailer);
+    PDFIO_DEBUG("\n");
+
+    off_t new_offset = (off_t)pdfioDictGetNumber(trailer.value.dict, "Prev");
+
+    if (new_offset <= 0)
+    {
+      done = true;
+    }
+    else if (first_only)
+    {
+      // Load the remaining xref tables later...
+      pdf->lazy_xref = new_offset;
+      done           = true;
+    }
+    else if (new_offset == xref_offset)
+    {
+      _pdfioFileError(pdf, "Recursive xref table.");
+      return (false);
+    }
+
+    xref_offset = new_offset;
+  }
+
+  // Once we have all of the xref tables loaded, get the important objects and
+  // build the pages array...
+  if (pdf->lazy_xref)
+    return (true);
+  else
+    return (load_root(pdf));
+}
+
+
+//
+// 'open_common()' - Open an existing PDF file for reading or updating.
+//
 
-      if (!_pdfioValueRead(pdf, obj, &tb, &trailer, 0))
-      {
-        _pdfioFileError(pdf, "Unable to read cross-reference stream dictionary.");
-        return (false);
-      }
-      else if (trailer.type != PDFIO_VALTYPE_DICT)
-      {
-	_pdfioFileError(pdf, "Cross-reference stream does not have a dictionary.");
-	return (false);
-      }
+static pdfio_file_t *			// O - PDF file
+open_common(
+    const char          *filename,	// I - Filename
+    bool                update,		// I - Open for an incremental update?
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_cbdata,
+					// I - Password callback data, if any
+    pdfio_error_cb_t    error_cb,	// I - Error callback or `NULL` for default
+    void                *error_cbdata)	// I - Error callback data, if any
+{
+  pdfio_file_t	*pdf;			// PDF file
+  char		line[1025],		// Line from file
+		*ptr,			// Pointer into line
+		*end;			// End of line
+  ssize_t	bytes;			// Bytes read
+  off_t		xref_offset;		// Offset to xref table
 
-      obj->value = trailer;
 
-      if (!_pdfioTokenGet(&tb, line, sizeof(line)) || strcmp(line, "stream"))
-      {
-        _pdfioFileError(pdf, "Unable to get stream after xref dictionary.");
-        return (false);
-      }
+  // Range check input...
+  if (!filename)
+    return (NULL);
 
-      PDFIO_DEBUG("load_xref: tb.bufptr=%p, tb.bufend=%p, tb.bufptr[0]=0x%02x, tb.bufptr[0]=0x%02x\n", tb.bufptr, tb.bufend, tb.bufptr[0], tb.bufptr[1]);
-      if (tb.bufptr && tb.bufptr < tb.bufend && (tb.bufptr[0] == 0x0d || tb.bufptr[0] == 0x0a))
-	tb.bufptr ++;			// Skip trailing CR or LF after token
+  if (!error_cb)
+  {
+    error_cb     = _pdfioFileDefaultError;
+    error_cbdata = NULL;
+  }
 
-      _pdfioTokenFlush(&tb);
+  // Allocate a PDF file structure...
+  if ((pdf = (pdfio_file_t *)calloc(1, sizeof(pdfio_file_t))) == NULL)
+  {
+    pdfio_file_t temp;			// Dummy file
+    char	message[8192];		// Message string
 
-      obj->stream_offset = _pdfioFileTell(pdf);
+    temp.filename = (char *)filename;
+    snprintf(message, sizeof(message), "Unable to allocate memory for PDF file - %s", strerror(errno));
+    (error_cb)(&temp, message, error_cbdata);
+    return (NULL);
+  }
 
-      if ((index_array = pdfioDictGetArray(trailer.value.dict, "Index")) != NULL)
-        index_count = index_array->num_values;
-      else
-        index_count = 1;
+  pdf->loc         = get_lconv();
+  pdf->filename    = strdup(filename);
+  pdf->mode        = _PDFIO_MODE_READ;
+  pdf->error_cb    = error_cb;
+  pdf->error_data  = error_cbdata;
+  pdf->permissions = PDFIO_PERMISSION_ALL;
 
-      if ((w_array = pdfioDictGetArray(trailer.value.dict, "W")) == NULL)
-      {
-	_pdfioFileError(pdf, "Cross-reference stream does not have required W key.");
-	return (false);
-      }
+  // Open the file...
+  if ((pdf->fd = open(filename, (update ? O_RDWR : O_RDONLY) | O_BINARY)) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to open file - %s", strerror(errno));
+    free(pdf->filename);
+    free(pdf);
+    return (NULL);
+  }
 
-      w[0]    = (size_t)pdfioArrayGetNumber(w_array, 0);
-      w[1]    = (size_t)pdfioArrayGetNumber(w_array, 1);
-      w[2]    = (size_t)pdfioArrayGetNumber(w_array, 2);
-      w_total = w[0] + w[1] + w[2];
-      w_2     = w[0];
-      w_3     = w[0] + w[1];
+  // Read the header from the first line...
+  if (!_pdfioFileGets(pdf, line, sizeof(line)))
+    goto error;
 
-      if (w[1] == 0 || w[2] > 4 || w[0] > sizeof(buffer) || w[1] > sizeof(buffer) || w[2] > sizeof(buffer) || w_total > sizeof(buffer))
+  if ((strncmp(line, "%PDF-1.", 7) && strncmp(line, "%PDF-2.", 7)) || !isdigit(line[7] & 255))
+  {
+    // Bad header
+    _pdfioFileError(pdf, "Bad header '%s'.", line);
+    goto error;
+  }
+
+  // Copy the version number...
+  pdf->version = strdup(line + 5);
+
+  // See if this is a linearized file...
+  if (!update)
+  {
+    size_t	num_pages,		// Number of pages
+		page_number;		// Object number of first page
+
+    if ((xref_offset = get_linearized(pdf, &num_pages, &page_number)) > 0)
+    {
+      // Yes, just load the first page xref table for now...
+      pdfio_obj_t *page;		// First page object
+
+      if (!load_xref(pdf, xref_offset, password_cb, password_cbdata, true))
       {
-	_pdfioFileError(pdf, "Cross-reference stream has invalid W key [%u %u %u].", (unsigned)w[0], (unsigned)w[1], (unsigned)w[2]);
-	return (false);
+        // Damaged xref table, try to repair the file...
+        if (!_pdfioFileError(pdf, "Unable to load xref table.") || !repair_xref(pdf, password_cb, password_cbdata))
+          goto error;
+
+        return (pdf);
       }
 
-      if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+      if (pdf->lazy_xref && !pdf->encrypt_obj && pdfioDictGetObj(pdf->trailer_dict, "Encrypt"))
       {
-	_pdfioFileError(pdf, "Unable to open cross-reference stream.");
-	return (false);
+        // Encryption dictionary is not in the first page section, load
+        // everything now so we can unlock the file...
+        xref_offset    = pdf->lazy_xref;
+        pdf->lazy_xref = 0;
+
+	if (!load_xref(pdf, xref_offset, password_cb, password_cbdata, false))
+	  goto error;
       }
 
-      for (index_n = 0; index_n < index_count; index_n += 2)
+      if (pdf->lazy_xref)
       {
-        if (index_count == 1)
+        // Use the first page until the rest of the file is needed...
+        const char *type;		// Object type
+
+	if ((pdf->root_obj = pdfioDictGetObj(pdf->trailer_dict, "Root")) == NULL)
+	{
+	  _pdfioFileError(pdf, "Missing Root object.");
+	  goto error;
+	}
+
+        if ((page = pdfioFileFindObj(pdf, page_number)) != NULL && pdf->lazy_xref && (type = pdfioObjGetType(page)) != NULL && !strcmp(type, "Page"))
         {
-          number = 0;
-          count  = 999999999;
+          if (!_pdfioFileAddPage(pdf, page))
+            goto error;
+
+	  pdf->lazy_pages = num_pages;
 	}
-	else
+	else if (pdf->lazy_xref && !load_deferred(pdf))
 	{
-          number = (intmax_t)pdfioArrayGetNumber(index_array, index_n);
-          count  = (size_t)pdfioArrayGetNumber(index_array, index_n + 1);
+	  goto error;
 	}
+      }
 
-	while (count > 0 && pdfioStreamRead(st, buffer, w_total) > 0)
-	{
-	  count --;
+      return (pdf);
+    }
+  }
 
-	  PDFIO_DEBUG("load_xref: number=%u %02X%02X%02X%02X%02X\n", (unsigned)number, buffer[0], buffer[1], buffer[2], buffer[3], buffer[4]);
+  // Grab the last 1k of the file to find the start of the xref table...
+  if (_pdfioFileSeek(pdf, -1024, SEEK_END) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to read startxref data.");
+    goto error;
+  }
 
-	  // Check whether this is an object definition...
-	  if (w[0] > 0)
-	  {
-	    if (buffer[0] == 0)
-	    {
-	      // Ignore free objects...
-	      number ++;
-	      continue;
-	    }
-	  }
+  if ((bytes = _pdfioFileRead(pdf, line, sizeof(line) - 1)) < 1)
+  {
+    _pdfioFileError(pdf, "Unable to read startxref data.");
+    goto error;
+  }
 
-          // Offset
-	  for (i = 1, offset = buffer[w_2]; i < w[1]; i ++)
-	    offset = (offset << 8) | buffer[w_2 + i];
+  line[bytes] = '\0';
 
-          // Generation number
-	  switch (w[2])
-	  {
-	    default :
-		generation = 0;
-		break;
-	    case 1 :
-		generation = buffer[w_3];
-		break;
-	    case 2 :
-		generation = (buffer[w_3] << 8) | buffer[w_3 + 1];
-		break;
-	    case 3 :
-	        // Issue #46: Stupid Microsoft PDF generator using 3 bytes to
-	        // encode 16-bit generation numbers == 0 (probably a lazy coder
-	        // stuffing things into an array of 64-bit unsigned integers)
-		generation = (buffer[w_3] << 16) | (buffer[w_3 + 1] << 8) | buffer[w_3 + 2];
-		if (generation > 65535)
-		  generation = 65535;
-		break;
-	    case 4 : // Even stupider :)
-		generation = (buffer[w_3] << 24) | (buffer[w_3 + 1] << 16) | (buffer[w_3 + 2] << 8) | buffer[w_3 + 3];
-		if (generation > 65535)
-		  generation = 65535;
-		break;
-	  }
+  // Use the last startxref since incremental updates can be small...
+  for (ptr = NULL, end = line + bytes; !ptr && (end - line) >= 9; end --)
+  {
+    if (!memcmp(end - 9, "startxref", 9))
+      ptr = end - 9;
+  }
 
-	  // Create a placeholder for the object in memory...
-	  if ((current = pdfioFileFindObj(pdf, (size_t)number)) != NULL)
-	  {
-	    PDFIO_DEBUG("load_xref: existing object, prev offset=%u\n", (unsigned)current->offset);
+  if (!ptr)
+  {
+    // No startxref, try to repair the file...
+    if (!_pdfioFileError(pdf, "Unable to find start of xref table.") || update || !repair_xref(pdf, password_cb, password_cbdata))
+      goto error;
+  }
+  else
+  {
+    xref_offset = (off_t)strtol(ptr + 9, NULL, 10);
 
-            if (w[0] == 0 || buffer[0] == 1)
-            {
-              // Location of object...
-	      current->offset = offset;
-	    }
-	    else if (number != offset)
-	    {
-	      // Object is part of a stream, offset is the object number...
-	      current->offset = 0;
-	    }
+    if (!load_xref(pdf, xref_offset, password_cb, password_cbdata, false))
+    {
+      // Damaged xref table, try to repair the file...
+      if (update || !_pdfioFileError(pdf, "Unable to load xref table.") || !repair_xref(pdf, password_cb, password_cbdata))
+        goto error;
+    }
+  }
 
-	    PDFIO_DEBUG("load_xref: new offset=%u\n", (unsigned)current->offset);
-	  }
+  if (update)
+  {
+    // Prepare to append an incremental update to the end of the file...
+    pdfio_dict_t *dict;			// Info dictionary
 
-	  if (w[0] > 0 && buffer[0] == 2)
-	  {
-	    // Object streams need to be loaded into memory, so add them
-	    // to the list of objects to load later as needed...
-	    for (i = 0; i < num_sobjs; i ++)
-	    {
-	      if (sobjs[i] == (size_t)offset)
-		break;
-	    }
+    pdf->update_pages = pdf->num_pages;
+    pdf->update_xref  = xref_offset;
+    pdf->update_mode  = _PDFIO_MODE_READ;
 
-	    if (i >= num_sobjs)
-	    {
-	      if (num_sobjs < (sizeof(sobjs) / sizeof(sobjs[0])))
-	      {
-		sobjs[num_sobjs ++] = (size_t)offset;
-	      }
-	      else
-	      {
-		_pdfioFileError(pdf, "Too many object streams.");
-	        return (false);
-	      }
-	    }
-	  }
-	  else if (!current)
-	  {
-	    // Add this object...
-	    if (!add_obj(pdf, (size_t)number, (unsigned short)generation, offset))
-	      return (false);
-	  }
+    if (pdf->info_obj && !pdfioObjGetDict(pdf->info_obj))
+    {
+      _pdfioFileError(pdf, "Info object is not a dictionary.");
+      goto error;
+    }
+
+    if ((pdf->update_offset = _pdfioFileSeek(pdf, 0, SEEK_END)) <= 0)
+      goto error;
+
+    pdf->mode = _PDFIO_MODE_WRITE;
+
+    // Default to "universal" size (intersection of A4 and US Letter) for new
+    // pages...
+    pdf->media_box.x2 = pdf->crop_box.x2 = 210.0 * 72.0f / 25.4f;
+    pdf->media_box.y2 = pdf->crop_box.y2 = 11.0f * 72.0f;
+
+    if (!pdf->info_obj)
+    {
+      // Add an Info object...
+      if ((dict = pdfioDictCreate(pdf)) == NULL || (pdf->info_obj = pdfioFileCreateObj(pdf, dict)) == NULL)
+        goto error;
+    }
+
+    // Start the update on a new line as needed...
+    if (line[bytes - 1] != '\n' && line[bytes - 1] != '\r' && !_pdfioFilePuts(pdf, "\n"))
+      goto error;
+  }
+
+  return (pdf);
+
+
+  // If we get here we had a fatal read error...
+  error:
+
+  pdf->mode = _PDFIO_MODE_READ;		// Don't write a partial update
+
+  pdfioFileClose(pdf);
+
+  return (NULL);
+}
+
+//
+// 'repair_has_name()' - Check whether an object header is followed by a name.
+//
+// Only the bytes up to the end of the object's dictionary ("stream" or
+// "endobj") are checked.
+//
 
-	  number ++;
-	}
-      }
+static bool				// O - `true` if the name is present, `false` otherwise
+repair_has_name(
+    const unsigned char *start,		// I - Start of object value
+    const unsigned char *end,		// I - End of buffer
+    const char          *name)		// I - Name to look for (without slash)
+{
+  size_t	namelen = strlen(name);	// Length of name
 
-      pdfioStreamClose(st);
 
-      if (!pdf->trailer_dict)
-      {
-	// Save the trailer dictionary and grab the root (catalog) and info
-	// objects...
-	pdf->trailer_dict = trailer.value.dict;
-	pdf->info_obj     = pdfioDictGetObj(pdf->trailer_dict, "Info");
-	pdf->encrypt_obj  = pdfioDictGetObj(pdf->trailer_dict, "Encrypt");
-	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
+  if ((end - start) > _PDFIO_REPAIR_LOOK)
+    end = start + _PDFIO_REPAIR_LOOK;
 
-	// If the trailer contains an Encrypt key, try unlocking the file...
-	if (pdf->encrypt_obj && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
-	  return (false);
-      }
+  for (; start < end; start ++)
+  {
+    if ((end - start) >= 6 && (!memcmp(start, "stream", 6) || !memcmp(start, "endobj", 6)))
+      break;
+    else if (*start == '/' && (size_t)(end - start) > (namelen + 1) && !memcmp(start + 1, name, namelen) && !isalnum(start[namelen + 1]))
+      return (true);
+  }
 
-      // Load any object streams that are left...
-      PDFIO_DEBUG("load_xref: %lu compressed object streams to load.\n", (unsigned long)num_sobjs);
+  return (false);
+}
 
-      for (i = 0; i < num_sobjs; i ++)
-      {
-        if ((obj = pdfioFileFindObj(pdf, sobjs[i])) != NULL)
-        {
-	  PDFIO_DEBUG("load_xref: Loading compressed object stream %lu (pdf=%p, obj->pdf=%p).\n", (unsigned long)sobjs[i], pdf, obj->pdf);
 
-          if (!load_obj_stream(obj))
-            return (false);
-	}
-	else
-	{
-	  _pdfioFileError(pdf, "Unable to find compressed object stream %lu.", (unsigned long)sobjs[i]);
-	  return (false);
-	}
-      }
-    }
-    else if (!strncmp(line, "xref", 4) && (!line[4] || isspace(line[4] & 255)))
-    {
-      // Read the xref tables
-      off_t trailer_offset = _pdfioFileTell(pdf);
-					// Offset of current line
+//
+// 'repair_xref()' - Rebuild the object table by scanning the file for objects.
+//
+// The file is read once from start to finish, looking for "N G obj" headers
+// and "trailer" keywords.  Objects that appear later in the file replace
+// earlier ones, just like an incremental update.  The trailer dictionary comes
+// from the last "trailer" keyword with a Root object, the last cross-reference
+// stream, or the last Catalog object in the file, in that order.
+//
 
-      PDFIO_DEBUG("load_xref: Reading xref table starting at offset %lu\n", (unsigned long)trailer_offset);
-      while (_pdfioFileGets(pdf, line, sizeof(line)))
-      {
-        PDFIO_DEBUG("load_xref: '%s' at offset %lu\n", line, (unsigned long)trailer_offset);
+static bool				// O - `true` on success, `false` on failure
+repair_xref(
+    pdfio_file_t        *pdf,		// I - PDF file
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_data)	// I - Password callback data, if any
+{
+  bool		ret = false;		// Return value
+  unsigned char	*buffer,		// Read buffer
+		*bufptr,		// Pointer into buffer
+		*bufend,		// End of data in buffer
+		*buflimit,		// End of search area in buffer
+		*ptr,			// Pointer to "obj" or "trailer"
+		*start,			// Start of object number
+		*gstart,		// Start of generation number
+		*nend,			// End of object number
+		*gend,			// End of generation number
+		*dptr;			// Pointer to digits
+  size_t	carry = 0;		// Bytes carried over from previous block
+  ssize_t	bytes;			// Bytes read
+  bool		eof = false;		// At end of file?
+  off_t		bufpos = 0,		// Offset of buffer in file
+		*trailers = NULL;	// Offsets of trailer dictionaries
+  size_t	i,			// Looping var
+		number,			// Object number
+		generation,		// Generation number
+		num_sobjs = 0,		// Number of object streams
+		alloc_sobjs = 0,	// Allocated object streams
+		*sobjs = NULL,		// Object streams
+		num_trailers = 0,	// Number of trailer dictionaries
+		alloc_trailers = 0;	// Allocated trailer dictionaries
+  pdfio_obj_t	*obj,			// Current object
+		*xref_obj = NULL;	// Last cross-reference stream
+  pdfio_dict_t	*dict;			// Trailer dictionary
+  const char	*type;			// Object type
+  _pdfio_value_t trailer;		// Trailer dictionary
+  _pdfio_token_t tb;			// Token buffer/stack
 
-	if (!strncmp(line, "trailer", 7) && (!line[7] || isspace(line[7] & 255)))
-	{
-	  if (line[7])
-	  {
-	    // Probably the start of the trailer dictionary, rewind the file so
-	    // we can read it...
-	    _pdfioFileSeek(pdf, trailer_offset + 7, SEEK_SET);
-	  }
 
-	  break;
-	}
-	else
-	{
-	  trailer_offset = _pdfioFileTell(pdf);
+  PDFIO_DEBUG("repair_xref(pdf=%p)\n", (void *)pdf);
 
-          if (!line[0])
-	    continue;
-	}
+  // Forget anything that was loaded from the damaged xref tables...
+  for (i = 0; i < pdf->num_objs; i ++)
+    _pdfioObjDelete(pdf->objs[i]);
 
-	if (sscanf(line, "%jd%jd", &number, &num_objects) != 2)
-	{
-	  _pdfioFileError(pdf, "Malformed xref table section '%s'.", line);
-	  return (false);
-	}
+  free_page_nodes(pdf);
+
+  pdf->num_objs     = 0;
+  pdf->last_obj     = 0;
+  pdf->num_pages    = 0;
+  pdf->lazy_xref    = 0;
+  pdf->lazy_pages   = 0;
+  pdf->trailer_dict = NULL;
+  pdf->id_array     = NULL;
+  pdf->root_obj     = NULL;
+  pdf->info_obj     = NULL;
+  pdf->pages_obj    = NULL;
+  pdf->encrypt_obj  = NULL;
+  pdf->encryption   = PDFIO_ENCRYPTION_NONE;
+
+  // Scan the file in large blocks, carrying over the end of each block so that
+  // object headers that span two blocks are found...
+  if ((buffer = (unsigned char *)malloc(_PDFIO_REPAIR_BLOCK + 2 * _PDFIO_REPAIR_LOOK)) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for repair buffer.");
+    return (false);
+  }
 
-	// Read this group of objects...
-	for (; num_objects > 0; num_objects --, number ++)
-	{
-	  // Read a line from the file and validate it...
-	  if (_pdfioFileRead(pdf, line, 20) != 20)
-	    return (false);
+  if (_pdfioFileSeek(pdf, 0, SEEK_SET) != 0)
+  {
+    _pdfioFileError(pdf, "Unable to seek to start of file.");
+    goto done;
+  }
 
-	  line[20] = '\0';
+  while (!eof)
+  {
+    if ((bytes = _pdfioFileRead(pdf, buffer + carry, _PDFIO_REPAIR_BLOCK)) < 0)
+    {
+      _pdfioFileError(pdf, "Unable to read file - %s", strerror(errno));
+      goto done;
+    }
 
-	  if (strcmp(line + 18, "\r\n") && strcmp(line + 18, " \n") && strcmp(line + 18, " \r"))
-	  {
-	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
-	    return (false);
-	  }
-	  line[18] = '\0';
+    eof      = bytes < _PDFIO_REPAIR_BLOCK;
+    bufend   = buffer + carry + bytes;
+    buflimit = eof ? bufend : bufend - _PDFIO_REPAIR_LOOK;
 
-	  // Parse the line
-	  if ((offset = strtoimax(line, &ptr, 10)) < 0)
-	  {
-	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
-	    return (false);
-	  }
+    // Look for "obj" keywords and then work backwards to the object and
+    // generation numbers...
+    for (bufptr = carry ? buffer + carry - _PDFIO_REPAIR_LOOK : buffer; bufptr < buflimit && (ptr = memchr(bufptr, 'j', (size_t)(buflimit - bufptr))) != NULL; bufptr = ptr + 1)
+    {
+      if ((ptr - buffer) < 7 || ptr[-1] != 'b' || ptr[-2] != 'o' || !isspace(ptr[-3]))
+        continue;
 
-	  if ((generation = (int)strtol(ptr, &ptr, 10)) < 0 || (generation > 65535 && offset != 0))
-	  {
-	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
-	    return (false);
-	  }
+      if ((ptr + 1) < bufend && !isspace(ptr[1]) && !strchr("<[(/%", ptr[1]))
+        continue;
 
-	  if (*ptr != ' ')
-	  {
-	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
-	    return (false);
-	  }
+      for (gend = ptr - 3; gend > buffer && isspace(gend[-1]); gend --);
+      for (gstart = gend; gstart > buffer && isdigit(gstart[-1]); gstart --);
 
-	  ptr ++;
-	  if (*ptr != 'f' && *ptr != 'n')
-	  {
-	    _pdfioFileError(pdf, "Malformed xref table entry '%s'.", line);
-	    return (false);
-	  }
+      if (gstart == gend || (gend - gstart) > 5 || gstart == buffer || !isspace(gstart[-1]))
+        continue;
 
-	  if (*ptr == 'f')
-	    continue;			// Don't care about free objects...
+      for (nend = gstart - 1; nend > buffer && isspace(nend[-1]); nend --);
+      for (start = nend; start > buffer && isdigit(start[-1]); start --);
 
-	  // Create a placeholder for the object in memory...
-	  if (pdfioFileFindObj(pdf, (size_t)number))
-	    continue;			// Don't replace newer object...
+      if (start == nend || (nend - start) > 10 || (start == buffer && bufpos > 0) || (start > buffer && !isspace(start[-1])))
+        continue;
 
-	  if (!add_obj(pdf, (size_t)number, (unsigned short)generation, offset))
-	    return (false);
-	}
+      for (number = 0, dptr = start; dptr < nend; dptr ++)
+        number = number * 10 + (size_t)(*dptr - '0');
+      for (generation = 0, dptr = gstart; dptr < gend; dptr ++)
+        generation = generation * 10 + (size_t)(*dptr - '0');
 
-	trailer_offset = _pdfioFileTell(pdf);
-      }
+      if (number == 0 || generation > 65535)
+        continue;
 
-      if (strncmp(line, "trailer", 7))
+      // Add or replace the object...
+      PDFIO_DEBUG("repair_xref: Found object %lu %lu at offset %lu.\n", (unsigned long)number, (unsigned long)generation, (unsigned long)(bufpos + (start - buffer)));
+
+      if ((obj = pdfioFileFindObj(pdf, number)) != NULL)
       {
-	_pdfioFileError(pdf, "Missing trailer.");
-	return (false);
+        obj->generation = (unsigned short)generation;
+        obj->offset     = bufpos + (start - buffer);
+      }
+      else if ((obj = add_obj(pdf, number, (unsigned short)generation, bufpos + (start - buffer))) == NULL)
+      {
+        goto done;
       }
 
-      _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
-
-      if (!_pdfioValueRead(pdf, NULL, &tb, &trailer, 0))
+      if (repair_has_name(ptr + 1, bufend, "ObjStm"))
       {
-	_pdfioFileError(pdf, "Unable to read trailer dictionary.");
-	return (false);
+        // Remember object streams so we can load the compressed objects...
+        if (num_sobjs >= alloc_sobjs)
+        {
+          size_t *temp = (size_t *)realloc(sobjs, (alloc_sobjs + 32) * sizeof(size_t));
+					// New object streams array
+
+          if (!temp)
+          {
+            _pdfioFileError(pdf, "Unable to allocate memory for object streams.");
+            goto done;
+          }
+
+          sobjs       = temp;
+          alloc_sobjs += 32;
+        }
+
+        sobjs[num_sobjs ++] = number;
       }
-      else if (trailer.type != PDFIO_VALTYPE_DICT)
+      else if (repair_has_name(ptr + 1, bufend, "XRef"))
       {
-	_pdfioFileError(pdf, "Trailer is not a dictionary.");
-	return (false);
+        xref_obj = obj;
       }
+    }
 
-      PDFIO_DEBUG("load_xref: Got trailer dict.\n");
-
-      _pdfioTokenFlush(&tb);
+    // Look for "trailer" keywords...
+    for (bufptr = carry ? buffer + carry - _PDFIO_REPAIR_LOOK : buffer; bufptr < buflimit && (ptr = memchr(bufptr, 't', (size_t)(buflimit - bufptr))) != NULL; bufptr = ptr + 1)
+    {
+      if ((bufend - ptr) <= 7 || memcmp(ptr, "trailer", 7) || (!isspace(ptr[7]) && ptr[7] != '<'))
+        continue;
 
-      if (!pdf->trailer_dict)
+      if (num_trailers >= alloc_trailers)
       {
-	// Save the trailer dictionary and grab the root (catalog) and info
-	// objects...
-	pdf->trailer_dict = trailer.value.dict;
-	pdf->info_obj     = pdfioDictGetObj(pdf->trailer_dict, "Info");
-	pdf->encrypt_obj  = pdfioDictGetObj(pdf->trailer_dict, "Encrypt");
-	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
+        off_t *temp = (off_t *)realloc(trailers, (alloc_trailers + 8) * sizeof(off_t));
+					// New trailers array
 
-	// If the trailer contains an Encrypt key, try unlocking the file...
-	if (pdf->encrypt_obj && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
-	  return (false);
+        if (!temp)
+        {
+          _pdfioFileError(pdf, "Unable to allocate memory for trailers.");
+          goto done;
+        }
+
+        trailers       = temp;
+        alloc_trailers += 8;
       }
+
+      trailers[num_trailers ++] = bufpos + (ptr + 7 - buffer);
     }
-    else
+
+    // Carry the end of this block over to the next one...
+    if (!eof)
     {
-      _pdfioFileError(pdf, "Bad xref table header '%s'.", line);
-      return (false);
+      carry  = 2 * _PDFIO_REPAIR_LOOK;
+      bufpos += bufend - buffer - (off_t)carry;
+
+      memmove(buffer, bufend - carry, carry);
     }
+  }
 
-    PDFIO_DEBUG("load_xref: Contents of trailer dictionary:\n");
-    PDFIO_DEBUG("load_xref: ");
-    PDFIO_DEBUG_VALUE(&trailer);
-    PDFIO_DEBUG("\n");
+  PDFIO_DEBUG("repair_xref: Found %lu objects, %lu object streams, %lu trailers.\n", (unsigned long)pdf->num_objs, (unsigned long)num_sobjs, (unsigned long)num_trailers);
 
-    off_t new_offset = (off_t)pdfioDictGetNumber(trailer.value.dict, "Prev");
+  if (pdf->num_objs == 0)
+  {
+    _pdfioFileError(pdf, "Unable to find any objects.");
+    goto done;
+  }
 
-    if (new_offset <= 0)
+  // Find the trailer dictionary, skipping any without a Root object such as
+  // the main trailer of a linearized file...
+  for (i = num_trailers; i > 0 && !pdf->trailer_dict; i --)
+  {
+    if (_pdfioFileSeek(pdf, trailers[i - 1], SEEK_SET) != trailers[i - 1])
+      continue;
+
+    _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
+
+    if (_pdfioValueRead(pdf, NULL, &tb, &trailer, 0) && trailer.type == PDFIO_VALTYPE_DICT && pdfioDictGetType(trailer.value.dict, "Root") == PDFIO_VALTYPE_INDIRECT)
+      pdf->trailer_dict = trailer.value.dict;
+  }
+
+  if (!pdf->trailer_dict && xref_obj && (type = pdfioObjGetType(xref_obj)) != NULL && !strcmp(type, "XRef") && (dict = pdfioObjGetDict(xref_obj)) != NULL && pdfioDictGetType(dict, "Root") == PDFIO_VALTYPE_INDIRECT)
+    pdf->trailer_dict = dict;
+
+  if (pdf->trailer_dict)
+  {
+    pdf->id_array = pdfioDictGetArray(pdf->trailer_dict, "ID");
+
+    if ((pdf->encrypt_obj = pdfioDictGetObj(pdf->trailer_dict, "Encrypt")) != NULL && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
+      goto done;
+  }
+
+  // Load any compressed objects...
+  for (i = 0; i < num_sobjs; i ++)
+  {
+    if ((obj = pdfioFileFindObj(pdf, sobjs[i])) != NULL && (type = pdfioObjGetType(obj)) != NULL && !strcmp(type, "ObjStm") && !load_obj_stream(obj))
+      goto done;
+  }
+
+  if (!pdf->trailer_dict)
+  {
+    // No trailer, use the last Catalog object...
+    for (i = pdf->num_objs; i > 0; i --)
     {
-      done = true;
+      if ((type = pdfioObjGetType(pdf->objs[i - 1])) != NULL && !strcmp(type, "Catalog"))
+        break;
     }
-    else if (new_offset == xref_offset)
+
+    if (i == 0 || (dict = pdfioDictCreate(pdf)) == NULL || !pdfioDictSetObj(dict, "Root", pdf->objs[i - 1]))
     {
-      _pdfioFileError(pdf, "Recursive xref table.");
-      return (false);
+      _pdfioFileError(pdf, "Unable to find trailer dictionary.");
+      goto done;
     }
 
-    xref_offset = new_offset;
+    pdf->trailer_dict = dict;
   }
 
-  // Once we have all of the xref tables loaded, get the important objects and
-  // build the pages array...
-  if ((pdf->root_obj = pdfioDictGetObj(pdf->trailer_dict, "Root")) == NULL)
-  {
-    _pdfioFileError(pdf, "Missing Root object.");
-    return (false);
-  }
+  // Get the important objects and the pages...
+  ret = load_root(pdf);
 
-  PDFIO_DEBUG("load_xref: Root=%p(%lu)\n", pdf->root_obj, (unsigned long)pdf->root_obj->number);
+  done:
+
+  free(buffer);
+  free(sobjs);
+  free(trailers);
 
-  return (load_pages(pdf, pdfioDictGetObj(pdfioObjGetDict(pdf->root_obj), "Pages"), 0));
+  return (ret);
 }
 
 
@@ -2117,6 +4400,29 @@ write_pages(pdfio_file_t *pdf)		// I - PDF file
   size_t	i;			// Looping var
 
 
+  if (pdf->update_offset)
+  {
+    // Add any new pages to the existing root pages object...
+    pdfio_dict_t *dict;			// Pages dictionary
+
+    if (pdf->num_pages == pdf->update_pages)
+      return (true);
+
+    if ((dict = pdfioObjGetDict(pdf->pages_obj)) == NULL || (kids = pdfioDictGetArray(dict, "Kids")) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to add pages to the root pages object.");
+      return (false);
+    }
+
+    for (i = pdf->update_pages; i < pdf->num_pages; i ++)
+      pdfioArrayAppendObj(kids, pdf->pages[i]);
+
+    pdfioDictSetNumber(dict, "Count", pdfioDictGetNumber(dict, "Count") + (double)(pdf->num_pages - pdf->update_pages));
+    pdfioDictSetArray(dict, "Kids", kids);
+
+    return (pdfioObjClose(pdf->pages_obj));
+  }
+
   // Build the "Kids" array pointing to each page...
   if ((kids = pdfioArrayCreate(pdf)) == NULL)
     return (false);
@@ -2141,30 +4447,79 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
 {
   bool		ret = true;		// Return value
   off_t		xref_offset;		// Offset to xref table
-  size_t	i;			// Looping var
+  size_t	i,			// Looping var
+		size;			// Number of object entries
 
 
   // Write the xref table...
   // TODO: Look at adding support for xref streams...
   xref_offset = _pdfioFileTell(pdf);
+  size        = pdf->num_objs > 0 ? pdf->objs[pdf->num_objs - 1]->number + 1 : 1;
 
-  if (!_pdfioFilePrintf(pdf, "xref\n0 %lu \n0000000000 65535 f \n", (unsigned long)pdf->num_objs + 1))
+  if (pdf->update_offset)
   {
-    _pdfioFileError(pdf, "Unable to write cross-reference table.");
-    ret = false;
-    goto done;
-  }
+    // Only list the objects that were written for the incremental update,
+    // grouping consecutive object numbers into subsections...
+    size_t	j;			// Looping var
 
-  for (i = 0; i < pdf->num_objs; i ++)
-  {
-    pdfio_obj_t	*obj = pdf->objs[i];	// Current object
+    if (size < (size_t)pdfioDictGetNumber(pdf->trailer_dict, "Size"))
+      size = (size_t)pdfioDictGetNumber(pdf->trailer_dict, "Size");
+
+    if (!_pdfioFilePuts(pdf, "xref\n"))
+    {
+      _pdfioFileError(pdf, "Unable to write cross-reference table.");
+      ret = false;
+      goto done;
+    }
+
+    for (i = 0; i < pdf->num_objs; i = j)
+    {
+      if (pdf->objs[i]->offset < pdf->update_offset)
+      {
+        j = i + 1;
+        continue;
+      }
+
+      for (j = i + 1; j < pdf->num_objs && pdf->objs[j]->offset >= pdf->update_offset && pdf->objs[j]->number == (pdf->objs[j - 1]->number + 1); j ++);
+
+      if (!_pdfioFilePrintf(pdf, "%lu %lu \n", (unsigned long)pdf->objs[i]->number, (unsigned long)(j - i)))
+      {
+	_pdfioFileError(pdf, "Unable to write cross-reference table.");
+	ret = false;
+	goto done;
+      }
 
-    if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)obj->offset, obj->generation))
+      for (; i < j; i ++)
+      {
+        if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)pdf->objs[i]->offset, pdf->objs[i]->generation))
+	{
+	  _pdfioFileError(pdf, "Unable to write cross-reference table.");
+	  ret = false;
+	  goto done;
+	}
+      }
+    }
+  }
+  else
+  {
+    if (!_pdfioFilePrintf(pdf, "xref\n0 %lu \n0000000000 65535 f \n", (unsigned long)pdf->num_objs + 1))
     {
       _pdfioFileError(pdf, "Unable to write cross-reference table.");
       ret = false;
       goto done;
     }
+
+    for (i = 0; i < pdf->num_objs; i ++)
+    {
+      pdfio_obj_t	*obj = pdf->objs[i];	// Current object
+
+      if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)obj->offset, obj->generation))
+      {
+	_pdfioFileError(pdf, "Unable to write cross-reference table.");
+	ret = false;
+	goto done;
+      }
+    }
   }
 
   // Write the trailer...
@@ -2187,8 +4542,10 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
   if (pdf->id_array)
     pdfioDictSetArray(pdf->trailer_dict, "ID", pdf->id_array);
   pdfioDictSetObj(pdf->trailer_dict, "Info", pdf->info_obj);
+  if (pdf->update_offset)
+    pdfioDictSetNumber(pdf->trailer_dict, "Prev", (double)pdf->update_xref);
   pdfioDictSetObj(pdf->trailer_dict, "Root", pdf->root_obj);
-  pdfioDictSetNumber(pdf->trailer_dict, "Size", pdf->num_objs + 1);
+  pdfioDictSetNumber(pdf->trailer_dict, "Size", (double)size);
 
   if (!_pdfioDictWrite(pdf->trailer_dict, NULL, NULL))
   {
@@ -14,7 +14,9 @@
 // Local functions...
 //
 
+static pdfio_obj_t *dedup_obj(pdfio_file_t *pdf, pdfio_obj_t *dstobj, pdfio_obj_t *srcobj, uint8_t **data, size_t *datalen);
 static bool	write_obj_header(pdfio_obj_t *obj);
+static bool	write_obj_update(pdfio_obj_t *obj);
 
 
 //
@@ -53,6 +55,11 @@ pdfioObjClose(pdfio_obj_t *obj)		// I - Object
     // Close the stream...
     return (pdfioStreamClose(obj->stream));
   }
+  else if (obj->offset < obj->pdf->update_offset)
+  {
+    // Write a new copy of an existing object to the incremental update...
+    return (write_obj_update(obj));
+  }
   else
   {
     // Already closed
@@ -74,6 +81,8 @@ pdfioObjCopy(pdfio_file_t *pdf,		// I - PDF file
 		*dstst;			// Destination stream
   char		buffer[32768];		// Copy buffer
   ssize_t	bytes;			// Bytes read
+  uint8_t	*data = NULL;		// Stream data read by dedup_obj()
+  size_t	datalen = 0;		// Length of stream data
 
 
   PDFIO_DEBUG("pdfioObjCopy(pdf=%p, srcobj=%p(%p))\n", pdf, srcobj, srcobj ? srcobj->pdf : NULL);
@@ -101,7 +110,43 @@ pdfioObjCopy(pdfio_file_t *pdf,		// I - PDF file
   if (dstobj->value.type == PDFIO_VALTYPE_DICT)
     _pdfioDictClear(dstobj->value.value.dict, "Length");
 
-  if (srcobj->stream_offset)
+  if (pdf->dedup && srcobj->pdf != pdf)
+  {
+    // See if we already have a copy of this object.  A duplicate is only
+    // discarded when it is still the last object created, i.e., when copying
+    // its value did not copy any other objects that might refer to it.
+    // Otherwise the duplicate is kept since deleting it would leave a hole in
+    // the object numbers.  Stream data is read once into "data" for both the
+    // digest and the copy below...
+    pdfio_obj_t *match = dedup_obj(pdf, dstobj, srcobj, &data, &datalen);
+					// Matching object
+
+    if (match != dstobj)
+    {
+      free(data);
+      return (match);
+    }
+  }
+
+  if (data)
+  {
+    // Copy stream data read by dedup_obj()...
+    if ((dstst = pdfioObjCreateStream(dstobj, PDFIO_FILTER_NONE)) == NULL)
+    {
+      free(data);
+      pdfioObjClose(dstobj);
+      return (NULL);
+    }
+
+    bytes = (datalen == 0 || pdfioStreamWrite(dstst, data, datalen)) ? 0 : -1;
+
+    free(data);
+    pdfioStreamClose(dstst);
+
+    if (bytes < 0)
+      return (NULL);
+  }
+  else if (srcobj->stream_offset)
   {
     // Copy stream data...
     if ((srcst = pdfioObjOpenStream(srcobj, false)) == NULL)
@@ -155,7 +200,7 @@ pdfioObjCreateStream(
   if (!obj || obj->pdf->mode != _PDFIO_MODE_WRITE || obj->value.type != PDFIO_VALTYPE_DICT)
     return (NULL);
 
-  if (obj->offset)
+  if (obj->offset && obj->offset >= obj->pdf->update_offset)
   {
     _pdfioFileError(obj->pdf, "Object has already been written.");
     return (NULL);
@@ -173,12 +218,17 @@ pdfioObjCreateStream(
     return (NULL);
   }
 
+  // Replace the stream of an existing object in an incremental update...
+  if (obj->offset)
+    _pdfioDictClear(obj->value.value.dict, "Length");
+
   // Write the header...
   if (!_pdfioDictGetValue(obj->value.value.dict, "Length"))
   {
-    if (obj->pdf->output_cb)
+    if (obj->pdf->output_cb || obj->pdf->update_offset)
     {
-      // Streaming via an output callback, so add a placeholder length object
+      // Streaming via an output callback or appending an incremental update,
+      // so add a placeholder length object
       _pdfio_value_t	length_value;	// Length value
 
       length_value.type         = PDFIO_VALTYPE_NUMBER;
@@ -228,6 +278,93 @@ _pdfioObjDelete(pdfio_obj_t *obj)	// I - Object
 }
 
 
+//
+// 'pdfioObjDigest()' - Compute a digest of an object's (data) stream.
+//
+// This function computes a MD5 or SHA-256 digest of the raw (`decode` is
+// `false`) or decoded (`decode` is `true`) data of an object's stream in a
+// single pass.  The "digest" buffer must be at least 16 bytes for MD5 and 32
+// bytes for SHA-256.
+//
+// Objects without a stream, such as plain dictionaries, have no digest and
+// `0` is returned for them.
+//
+// @since PDFio v1.4@
+//
+
+size_t					// O - Number of bytes in digest or `0` on error/no stream
+pdfioObjDigest(
+    pdfio_obj_t    *obj,		// I - Object
+    pdfio_digest_t algorithm,		// I - Digest algorithm
+    bool           decode,		// I - Decode/decompress data?
+    unsigned char  *digest,		// I - Digest buffer
+    size_t         digestsize)		// I - Size of digest buffer
+{
+  pdfio_stream_t	*st;		// Stream
+  union
+  {
+    _pdfio_md5_t	md5;		// MD5 context
+    _pdfio_sha256_t	sha256;		// SHA-256 context
+  }			ctx;		// Digest context
+  size_t		ctxsize;	// Size of digest
+  uint8_t		buffer[8192];	// Read buffer
+  ssize_t		bytes;		// Bytes read
+
+
+  // Range check input...
+  if (!obj || !digest)
+    return (0);
+
+  switch (algorithm)
+  {
+    case PDFIO_DIGEST_MD5 :
+        ctxsize = 16;
+        break;
+    case PDFIO_DIGEST_SHA256 :
+        ctxsize = 32;
+        break;
+    default :
+        _pdfioFileError(obj->pdf, "Unknown digest algorithm %d.", (int)algorithm);
+        return (0);
+  }
+
+  if (digestsize < ctxsize)
+  {
+    _pdfioFileError(obj->pdf, "Digest buffer too small.");
+    return (0);
+  }
+
+  // Open the stream and hash its data...
+  if ((st = pdfioObjOpenStream(obj, decode)) == NULL)
+    return (0);
+
+  if (algorithm == PDFIO_DIGEST_MD5)
+    _pdfioCryptoMD5Init(&ctx.md5);
+  else
+    _pdfioCryptoSHA256Init(&ctx.sha256);
+
+  while ((bytes = pdfioStreamRead(st, buffer, sizeof(buffer))) > 0)
+  {
+    if (algorithm == PDFIO_DIGEST_MD5)
+      _pdfioCryptoMD5Append(&ctx.md5, buffer, (size_t)bytes);
+    else
+      _pdfioCryptoSHA256Append(&ctx.sha256, buffer, (size_t)bytes);
+  }
+
+  pdfioStreamClose(st);
+
+  if (bytes < 0)
+    return (0);
+
+  if (algorithm == PDFIO_DIGEST_MD5)
+    _pdfioCryptoMD5Finish(&ctx.md5, digest);
+  else
+    _pdfioCryptoSHA256Finish(&ctx.sha256, digest);
+
+  return (ctxsize);
+}
+
+
 //
 // 'pdfioObjGetArray()' - Get the array associated with an object.
 //
@@ -480,6 +617,10 @@ _pdfioObjLoad(pdfio_obj_t *obj)		// I - Object
   PDFIO_DEBUG_VALUE(&obj->value);
   PDFIO_DEBUG("\n");
 
+  // Go back to the end of the file when writing an incremental update...
+  if (obj->pdf->update_offset && _pdfioFileSeek(obj->pdf, 0, SEEK_END) < 0)
+    return (false);
+
   return (true);
 }
 
@@ -513,6 +654,13 @@ pdfioObjOpenStream(pdfio_obj_t *obj,	// I - Object
   if (obj->value.type != PDFIO_VALTYPE_DICT || !obj->stream_offset)
     return (NULL);
 
+  // Only existing streams can be read when writing...
+  if (obj->pdf->mode == _PDFIO_MODE_WRITE && obj->offset >= obj->pdf->update_offset)
+  {
+    _pdfioFileError(obj->pdf, "Unable to read stream for object %lu.", (unsigned long)obj->number);
+    return (NULL);
+  }
+
   // Open the stream...
   obj->pdf->current_obj = obj;
 
@@ -535,6 +683,117 @@ _pdfioObjSetExtension(
 }
 
 
+//
+// 'dedup_obj()' - Find an identical copy of an object.
+//
+// If a previously copied object has the same value and stream data, the new
+// object is deleted and the existing object is returned.  Otherwise the digest
+// of the new object is recorded and the new object is returned.
+//
+// The raw stream data of the source object, if any, is returned in "data" so
+// that the caller can copy it without reading the stream again.  The caller
+// must free it.
+//
+
+static pdfio_obj_t *			// O - Object to use or `NULL` on error
+dedup_obj(pdfio_file_t *pdf,		// I - Destination PDF file
+          pdfio_obj_t  *dstobj,		// I - New destination object
+          pdfio_obj_t  *srcobj,		// I - Source object
+          uint8_t      **data,		// O - Raw stream data or `NULL`
+          size_t       *datalen)	// O - Length of stream data
+{
+  pdfio_obj_t		*match;		// Matching object
+  const char		*type;		// Object type
+  _pdfio_sha256_t	ctx;		// SHA-256 context
+  uint8_t		digest[32],	// Object digest
+			*temp;		// Temporary pointer
+  size_t		alloc;		// Allocated stream data
+  pdfio_stream_t	*st;		// Source stream
+  ssize_t		bytes;		// Bytes read
+
+
+  *data    = NULL;
+  *datalen = 0;
+
+  // Pages and annotations must not be shared...
+  if (dstobj->value.type == PDFIO_VALTYPE_DICT)
+  {
+    if ((type = pdfioDictGetName(dstobj->value.value.dict, "Type")) != NULL && (!strcmp(type, "Annot") || !strcmp(type, "Page") || !strcmp(type, "Pages")))
+      return (dstobj);
+
+    if (_pdfioDictGetValue(dstobj->value.value.dict, "Rect"))
+      return (dstobj);			// Annotations don't always have a Type
+  }
+
+  // Compute the digest of the copied value and the raw stream data...
+  _pdfioCryptoSHA256Init(&ctx);
+  _pdfioValueHash(&dstobj->value, &ctx);
+
+  if (srcobj->stream_offset)
+  {
+    if ((st = pdfioObjOpenStream(srcobj, false)) == NULL)
+      return (NULL);
+
+    for (alloc = 0;;)
+    {
+      if (*datalen >= alloc)
+      {
+        alloc = alloc ? 2 * alloc : 32768;
+
+        if ((temp = (uint8_t *)realloc(*data, alloc)) == NULL)
+        {
+          _pdfioFileError(pdf, "Unable to allocate memory for stream data.");
+          bytes = -1;
+          break;
+        }
+
+        *data = temp;
+      }
+
+      if ((bytes = pdfioStreamRead(st, *data + *datalen, alloc - *datalen)) <= 0)
+        break;
+
+      _pdfioCryptoSHA256Append(&ctx, *data + *datalen, (size_t)bytes);
+      *datalen += (size_t)bytes;
+    }
+
+    pdfioStreamClose(st);
+
+    if (bytes < 0)
+    {
+      free(*data);
+      *data    = NULL;
+      *datalen = 0;
+      return (NULL);
+    }
+  }
+
+  _pdfioCryptoSHA256Finish(&ctx, digest);
+
+  if ((match = _pdfioFileFindHashedObj(pdf, digest)) == NULL)
+  {
+    // New object, remember it for later...
+    if (!_pdfioFileAddHashedObj(pdf, dstobj, digest))
+      return (NULL);
+
+    return (dstobj);
+  }
+
+  // Only use the existing object if nothing has been created (and thus nothing
+  // can reference the new object) since the new object...
+  if (pdf->objs[pdf->num_objs - 1] != dstobj)
+    return (dstobj);
+
+  if (!_pdfioFileAddMappedObj(pdf, match, srcobj))
+    return (NULL);
+
+  pdf->num_objs --;
+  _pdfioObjDelete(dstobj);
+
+  return (match);
+}
+
+
 //
 // 'write_obj_header()' - Write the object header...
 //
@@ -552,3 +811,65 @@ write_obj_header(pdfio_obj_t *obj)	// I - Object
 
   return (_pdfioFilePuts(obj->pdf, "\n"));
 }
+
+
+//
+// 'write_obj_update()' - Write a new copy of an existing object for an
+//                        incremental update.
+//
+
+static bool				// O - `true` on success, `false` on failure
+write_obj_update(pdfio_obj_t *obj)	// I - Object
+{
+  off_t		offset;			// Offset of existing stream data
+  size_t	length,			// Length of existing stream data
+		bytes;			// Bytes to copy
+  char		buffer[32768];		// Copy buffer
+
+
+  // Load the existing value as needed...
+  if (obj->value.type == PDFIO_VALTYPE_NONE && !_pdfioObjLoad(obj))
+    return (false);
+
+  if (!obj->stream_offset)
+  {
+    // No stream, just write the object value...
+    if (!write_obj_header(obj))
+      return (false);
+
+    return (_pdfioFilePuts(obj->pdf, "endobj\n"));
+  }
+
+  // Copy the raw (filtered and encrypted) stream data as-is since the object
+  // number and generation are unchanged...
+  offset = obj->stream_offset;
+  length = pdfioObjGetLength(obj);
+
+  pdfioDictSetNumber(obj->value.value.dict, "Length", (double)length);
+
+  if (!write_obj_header(obj) || !_pdfioFilePuts(obj->pdf, "stream\n"))
+    return (false);
+
+  obj->stream_offset = _pdfioFileTell(obj->pdf);
+  obj->stream_length = length;
+
+  while (length > 0)
+  {
+    if ((bytes = length) > sizeof(buffer))
+      bytes = sizeof(buffer);
+
+    if (_pdfioFileSeek(obj->pdf, offset, SEEK_SET) != offset || _pdfioFileRead(obj->pdf, buffer, bytes) != (ssize_t)bytes)
+    {
+      _pdfioFileError(obj->pdf, "Unable to read stream for object %lu.", (unsigned long)obj->number);
+      return (false);
+    }
+
+    if (!_pdfioFileWrite(obj->pdf, buffer, bytes))
+      return (false);
+
+    offset += (off_t)bytes;
+    length -= bytes;
+  }
+
+  return (_pdfioFilePuts(obj->pdf, "\nendstream\nendobj\n"));
+}
@@ -94,6 +94,7 @@
 //
 
 #  define PDFIO_MAX_DEPTH	32	// Maximum nesting depth for values
+#  define _PDFIO_MAX_CRYPTO	4	// Maximum number of cached encryption contexts
 
 typedef void (*_pdfio_extfree_t)(void *);
 					// Extension data free function
@@ -157,11 +158,21 @@ typedef struct _pdfio_value_s		// Value structure
   }		value;			// Value union
 } _pdfio_value_t;
 
+typedef enum _pdfio_aes_accel_e		// AES acceleration
+{
+  _PDFIO_AES_ACCEL_NONE,		// Portable C code
+  _PDFIO_AES_ACCEL_AESNI,		// AES-NI instructions
+  _PDFIO_AES_ACCEL_VAES			// VAES (AVX2) instructions
+} _pdfio_aes_accel_t;
+
 typedef struct _pdfio_aes_s		// AES encryption state
 {
   size_t	round_size;		// Size of round key
+  _pdfio_aes_accel_t accel;		// Acceleration to use
   uint8_t	round_key[240],		// Round key
+		inv_round_key[240],	// Decryption round key (AES-NI)
 		iv[16];			// Initialization vector
+  uint64_t	sliced_key[120];	// Bitsliced round keys (portable code)
 } _pdfio_aes_t;
 
 typedef struct _pdfio_md5_s		// MD5 hash state
@@ -179,13 +190,10 @@ typedef struct _pdfio_rc4_s		// RC4 encryption state
 
 typedef struct _pdfio_sha265_s		// SHA-256 hash state
 {
-  uint32_t	Intermediate_Hash[8];	// Message Digest
-  uint32_t	Length_High;		// Message length in bits
-  uint32_t	Length_Low;		// Message length in bits
-  int		Message_Block_Index;	// Message_Block array index
-  uint8_t	Message_Block[64];	// 512-bit message blocks
-  int		Computed;		// Is the hash computed?
-  int		Corrupted;		// Cumulative corruption code
+  uint32_t	hash[8];		// Intermediate hash value
+  uint64_t	length;			// Message length in bytes
+  size_t	used;			// Number of bytes in block
+  uint8_t	block[64];		// Current 512-bit message block
 } _pdfio_sha256_t;
 
 typedef union _pdfio_crypto_ctx_u	// Cryptographic contexts
@@ -193,6 +201,14 @@ typedef union _pdfio_crypto_ctx_u	// Cryptographic contexts
   _pdfio_aes_t	aes;			// AES-128/256 context
   _pdfio_rc4_t	rc4;			// RC4-40/128 context
 } _pdfio_crypto_ctx_t;
+typedef struct _pdfio_crypto_cache_s	// Cached per-object encryption context
+{
+  size_t	number;			// Object number
+  unsigned short generation;		// Generation number
+  size_t	use;			// Use counter value or 0 if unused
+  _pdfio_crypto_ctx_t ctx;		// Initialized context
+} _pdfio_crypto_cache_t;
+
 typedef size_t (*_pdfio_crypto_cb_t)(_pdfio_crypto_ctx_t *ctx, uint8_t *outbuffer, const uint8_t *inbuffer, size_t len);
 
 struct _pdfio_array_s
@@ -201,6 +217,7 @@ struct _pdfio_array_s
   size_t	num_values,		// Number of values in use
 		alloc_values;		// Number of allocated values
   _pdfio_value_t *values;		// Array of values
+  pdfio_obj_t	*decrypt_obj;		// Object for decrypting strings on first use, if any
 };
 
 typedef struct _pdfio_pair_s		// Key/value pair
@@ -215,8 +232,31 @@ struct _pdfio_dict_s			// Dictionary
   size_t	num_pairs,		// Number of pairs in use
 		alloc_pairs;		// Number of allocated pairs
   _pdfio_pair_t *pairs;			// Array of pairs
+  pdfio_obj_t	*decrypt_obj;		// Object for decrypting strings on first use, if any
 };
 
+typedef struct _pdfio_objhash_s	// PDF object digest
+{
+  uint8_t	digest[32];		// SHA-256 digest of value and stream data
+  pdfio_obj_t	*obj;			// Object
+} _pdfio_objhash_t;
+
+typedef struct _pdfio_pkid_s		// Scanned kid of a page tree node
+{
+  size_t	first,			// Index of first page in kid
+		node;			// Page tree node index or `SIZE_MAX` for a page
+} _pdfio_pkid_t;
+
+typedef struct _pdfio_pnode_s		// Page tree node for page lookups
+{
+  pdfio_obj_t	*obj;			// Pages object
+  size_t	first,			// Index of first page in node
+		count,			// Number of pages in node ("Count" value)
+		num_kids,		// Number of kids scanned so far
+		next_page;		// Index of first page after scanned kids
+  _pdfio_pkid_t	*kids;			// Scanned kids
+} _pdfio_pnode_t;
+
 typedef struct _pdfio_objmap_s		// PDF object map
 {
   pdfio_obj_t	*obj;			// Object for this file
@@ -236,6 +276,12 @@ struct _pdfio_file_s			// PDF file structure
   void		*output_ctx;		// Context for output callback
   pdfio_error_cb_t error_cb;		// Error callback
   void		*error_data;		// Data for error callback
+  off_t		update_offset,		// Start of incremental update, if any
+		update_xref;		// Offset of previous xref table
+  _pdfio_mode_t	update_mode;		// Current I/O mode for incremental update
+  size_t	update_pages;		// Number of pages before incremental update
+  off_t		lazy_xref;		// Offset of xref tables that are not loaded yet
+  size_t	lazy_pages;		// Number of pages in a linearized file
 
   pdfio_encryption_t encryption;	// Encryption mode
   pdfio_permission_t permissions;	// Access permissions (encrypted PDF files)
@@ -246,6 +292,9 @@ struct _pdfio_file_s			// PDF file structure
   size_t	file_keylen,		// Length of file encryption key
 		owner_keylen,		// Length of owner encryption key
 		user_keylen;		// Length of user encryption key
+  size_t	crypto_use;		// Use counter for crypto_cache
+  _pdfio_crypto_cache_t crypto_cache[_PDFIO_MAX_CRYPTO];
+					// Recently used object encryption contexts
 
   // Active file data
   int		fd;			// File descriptor
@@ -261,6 +310,8 @@ struct _pdfio_file_s			// PDF file structure
   pdfio_obj_t	*cp1252_obj,		// CP1252 font encoding object
 		*unicode_obj;		// Unicode font encoding object
   pdfio_array_t	*id_array;		// ID array
+  pdfio_array_t	*media_array,		// Default MediaBox array, if any
+		*crop_array;		// Default CropBox array, if any
 
   // Allocated data elements
   size_t	num_arrays,		// Number of arrays
@@ -277,9 +328,20 @@ struct _pdfio_file_s			// PDF file structure
   size_t	num_objmaps,		// Number of object maps
 		alloc_objmaps;		// Allocated object maps
   _pdfio_objmap_t *objmaps;		// Object maps
+  bool		dedup;			// Deduplicate copied objects?
+  size_t	num_objhashes,		// Number of object digests
+		alloc_objhashes;	// Allocated object digests
+  _pdfio_objhash_t *objhashes;		// Object digest hash table for deduplication
+  bool		subset_fonts;		// Subset embedded fonts?
+  size_t	num_fonts,		// Number of fonts to subset
+		alloc_fonts;		// Allocated fonts
+  pdfio_obj_t	**fonts;		// Fonts to subset when closing
   size_t	num_pages,		// Number of pages
 		alloc_pages;		// Allocated pages
   pdfio_obj_t	**pages;		// Pages
+  size_t	num_pnodes,		// Number of page tree nodes
+		alloc_pnodes;		// Allocated page tree nodes
+  _pdfio_pnode_t *pnodes;		// Page tree nodes for page lookups
   size_t	num_strings,		// Number of strings
 		alloc_strings;		// Allocated strings
   char		**strings;		// Nul-terminated strings
@@ -298,6 +360,8 @@ struct _pdfio_obj_s			// Object
   pdfio_stream_t *stream;		// Open stream, if any
   void		*data;			// Extension data, if any
   _pdfio_extfree_t datafree;		// Free callback for extension data
+  uint8_t	crypto_key[16];		// Object encryption key
+  size_t	crypto_keylen;		// Length of object encryption key or 0 if not computed
 };
 
 struct _pdfio_stream_s			// Stream
@@ -305,6 +369,7 @@ struct _pdfio_stream_s			// Stream
   pdfio_file_t	*pdf;			// PDF file
   pdfio_obj_t	*obj;			// Object
   pdfio_obj_t	*length_obj;		// Length object, if any
+  _pdfio_mode_t	mode;			// Read/write mode
   pdfio_filter_t filter;		// Compression/decompression filter
   size_t	remaining;		// Remaining bytes in stream
   char		buffer[8192],		// Read/write buffer
@@ -319,6 +384,9 @@ struct _pdfio_stream_s			// Stream
 		*psbuffer;		// PNG filter buffer, as needed
   _pdfio_crypto_cb_t crypto_cb;		// Encryption/descryption callback, if any
   _pdfio_crypto_ctx_t crypto_ctx;	// Cryptographic context
+  pdfio_dict_t	*resources;		// Page resources, if any
+  pdfio_obj_t	*font;			// Current text font, if any
+  double	font_size;		// Current text font size
 };
 
 
@@ -336,9 +404,12 @@ extern _pdfio_value_t	*_pdfioArrayGetValue(pdfio_array_t *a, size_t n) _PDFIO_IN
 extern pdfio_array_t	*_pdfioArrayRead(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_token_t *ts, size_t depth) _PDFIO_INTERNAL;
 extern bool		_pdfioArrayWrite(pdfio_array_t *a, pdfio_obj_t *obj) _PDFIO_INTERNAL;
 
+extern bool		_pdfioContentWriteFonts(pdfio_file_t *pdf) _PDFIO_INTERNAL;
+
 extern void		_pdfioCryptoAESInit(_pdfio_aes_t *ctx, const uint8_t *key, size_t keylen, const uint8_t *iv) _PDFIO_INTERNAL;
 extern size_t		_pdfioCryptoAESDecrypt(_pdfio_aes_t *ctx, uint8_t *outbuffer, const uint8_t *inbuffer, size_t len) _PDFIO_INTERNAL;
 extern size_t		_pdfioCryptoAESEncrypt(_pdfio_aes_t *ctx, uint8_t *outbuffer, const uint8_t *inbuffer, size_t len) _PDFIO_INTERNAL;
+extern _pdfio_aes_accel_t _pdfioCryptoAESSetAccel(_pdfio_aes_accel_t accel) _PDFIO_INTERNAL;
 extern bool		_pdfioCryptoLock(pdfio_file_t *pdf, pdfio_permission_t permissions, pdfio_encryption_t encryption, const char *owner_password, const char *user_password) _PDFIO_INTERNAL;
 extern void		_pdfioCryptoMakeRandom(uint8_t *buffer, size_t bytes) _PDFIO_INTERNAL;
 extern _pdfio_crypto_cb_t _pdfioCryptoMakeReader(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_crypto_ctx_t *ctx, uint8_t *iv, size_t *ivlen) _PDFIO_INTERNAL;
@@ -351,6 +422,7 @@ extern size_t		_pdfioCryptoRC4Crypt(_pdfio_rc4_t *ctx, uint8_t *outbuffer, const
 extern void		_pdfioCryptoSHA256Append(_pdfio_sha256_t *, const uint8_t *bytes, size_t bytecount) _PDFIO_INTERNAL;
 extern void		_pdfioCryptoSHA256Init(_pdfio_sha256_t *ctx) _PDFIO_INTERNAL;
 extern void		_pdfioCryptoSHA256Finish(_pdfio_sha256_t *ctx, uint8_t *Message_Digest) _PDFIO_INTERNAL;
+extern bool		_pdfioCryptoSHA256SetAccel(bool accel) _PDFIO_INTERNAL;
 extern bool		_pdfioCryptoUnlock(pdfio_file_t *pdf, pdfio_password_cb_t password_cb, void *password_data) _PDFIO_INTERNAL;
 
 extern void		_pdfioDictClear(pdfio_dict_t *dict, const char *key) _PDFIO_INTERNAL;
@@ -359,15 +431,18 @@ extern void		_pdfioDictDebug(pdfio_dict_t *dict, FILE *fp) _PDFIO_INTERNAL;
 extern void		_pdfioDictDelete(pdfio_dict_t *dict) _PDFIO_INTERNAL;
 extern _pdfio_value_t	*_pdfioDictGetValue(pdfio_dict_t *dict, const char *key) _PDFIO_INTERNAL;
 extern pdfio_dict_t	*_pdfioDictRead(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_token_t *ts, size_t depth) _PDFIO_INTERNAL;
+extern void		_pdfioDictRelease(pdfio_dict_t *dict) _PDFIO_INTERNAL;
 extern bool		_pdfioDictSetValue(pdfio_dict_t *dict, const char *key, _pdfio_value_t *value) _PDFIO_INTERNAL;
 extern bool		_pdfioDictWrite(pdfio_dict_t *dict, pdfio_obj_t *obj, off_t *length) _PDFIO_INTERNAL;
 
+extern bool		_pdfioFileAddHashedObj(pdfio_file_t *pdf, pdfio_obj_t *obj, const uint8_t *digest) _PDFIO_INTERNAL;
 extern bool		_pdfioFileAddMappedObj(pdfio_file_t *pdf, pdfio_obj_t *dst_obj, pdfio_obj_t *src_obj) _PDFIO_INTERNAL;
 extern bool		_pdfioFileAddPage(pdfio_file_t *pdf, pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern bool		_pdfioFileConsume(pdfio_file_t *pdf, size_t bytes) _PDFIO_INTERNAL;
 extern pdfio_obj_t	*_pdfioFileCreateObj(pdfio_file_t *pdf, pdfio_file_t *srcpdf, _pdfio_value_t *value) _PDFIO_INTERNAL;
 extern bool		_pdfioFileDefaultError(pdfio_file_t *pdf, const char *message, void *data) _PDFIO_INTERNAL;
 extern bool		_pdfioFileError(pdfio_file_t *pdf, const char *format, ...) _PDFIO_FORMAT(2,3) _PDFIO_INTERNAL;
+extern pdfio_obj_t	*_pdfioFileFindHashedObj(pdfio_file_t *pdf, const uint8_t *digest) _PDFIO_INTERNAL;
 extern pdfio_obj_t	*_pdfioFileFindMappedObj(pdfio_file_t *pdf, pdfio_file_t *src_pdf, size_t src_number) _PDFIO_INTERNAL;
 extern bool		_pdfioFileFlush(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 extern int		_pdfioFileGetChar(pdfio_file_t *pdf) _PDFIO_INTERNAL;
@@ -379,6 +454,7 @@ extern ssize_t		_pdfioFileRead(pdfio_file_t *pdf, void *buffer, size_t bytes) _P
 extern off_t		_pdfioFileSeek(pdfio_file_t *pdf, off_t offset, int whence) _PDFIO_INTERNAL;
 extern off_t		_pdfioFileTell(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 extern bool		_pdfioFileWrite(pdfio_file_t *pdf, const void *buffer, size_t bytes) _PDFIO_INTERNAL;
+extern bool		_pdfioFileWriteCrypto(pdfio_file_t *pdf, _pdfio_crypto_cb_t cb, _pdfio_crypto_ctx_t *ctx, const void *buffer, size_t bytes) _PDFIO_INTERNAL;
 
 extern void		_pdfioObjDelete(pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern void		*_pdfioObjGetExtension(pdfio_obj_t *obj) _PDFIO_INTERNAL;
@@ -401,6 +477,7 @@ extern _pdfio_value_t	*_pdfioValueCopy(pdfio_file_t *pdfdst, _pdfio_value_t *vds
 extern bool		_pdfioValueDecrypt(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_value_t *v, size_t depth) _PDFIO_INTERNAL;
 extern void		_pdfioValueDebug(_pdfio_value_t *v, FILE *fp) _PDFIO_INTERNAL;
 extern void		_pdfioValueDelete(_pdfio_value_t *v) _PDFIO_INTERNAL;
+extern void		_pdfioValueHash(_pdfio_value_t *v, _pdfio_sha256_t *ctx) _PDFIO_INTERNAL;
 extern _pdfio_value_t	*_pdfioValueRead(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_token_t *ts, _pdfio_value_t *v, size_t depth) _PDFIO_INTERNAL;
 extern bool		_pdfioValueWrite(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_value_t *v, off_t *length) _PDFIO_INTERNAL;
 
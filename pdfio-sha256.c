@@ -38,443 +38,417 @@
 // EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
-/*
- * Description:
- *   This file implements the Secure Hash Algorithms SHA-224 and
- *   SHA-256 as defined in the U.S. National Institute of Standards
- *   and Technology Federal Information Processing Standards
- *   Publication (FIPS PUB) 180-3 published in October 2008
- *   and formerly defined in its predecessors, FIPS PUB 180-1
- *   and FIP PUB 180-2.
- *
- *   A combined document showing all algorithms is available at
- *       http://csrc.nist.gov/publications/fips/
- *              fips180-3/fips180-3_final.pdf
- *
- *   The SHA-224 and SHA-256 algorithms produce 224-bit and 256-bit
- *   message digests for a given data stream.  It should take about
- *   2**n steps to find a message with the same digest as a given
- *   message and 2**(n/2) to find any two messages with the same
- *   digest, when n is the digest size in bits.  Therefore, this
- *   algorithm can serve as a means of providing a
- *   "fingerprint" for a message.
- *
- * Portability Issues:
- *   SHA-224 and SHA-256 are defined in terms of 32-bit "words".
- *   This code uses <stdint.h> (included via "sha.h") to define 32-
- *   and 8-bit unsigned integer types.  If your C compiler does not
- *   support 32-bit unsigned integers, this code is not
- *   appropriate.
- *
- * Caveats:
- *   SHA-224 and SHA-256 are designed to work with messages less
- *   than 2^64 bits long.  This implementation uses SHA224/256Input()
- *   to hash the bits that are a multiple of the size of an 8-bit
- *   octet, and then optionally uses SHA224/256FinalBits()
- *   to hash the final few bits of the input.
- */
-
 #include "pdfio-private.h"
+#if (defined(__x86_64__) || defined(__i386__)) && ((defined(__clang__) && __clang_major__ >= 4) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 5))
+#  include <cpuid.h>
+#  include <immintrin.h>
+#  define _PDFIO_SHANI	1		// Use SHA-NI instructions
+#  define _PDFIO_SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h>
+#  include <immintrin.h>
+#  define _PDFIO_SHANI	1		// Use SHA-NI instructions
+#  define _PDFIO_SHANI_TARGET
+#endif // (__x86_64__ || __i386__) && (__clang__ || __GNUC__)
+#ifndef _WIN32
+#  include <pthread.h>
+#endif // !_WIN32
 
-/* Constants from sha.h */
-enum {
-    SHA256_Message_Block_Size = 64,
-    SHA256HashSize = 32,
-    SHA256HashSizeBits = 256
-};
 
-enum {
-    shaSuccess = 0,
-    shaNull,            /* Null pointer parameter */
-    shaInputTooLong,    /* input data too long */
-    shaStateError,      /* called Input after FinalBits or Result */
-    shaBadParam         /* passed a bad parameter */
+//
+// Local macros...
+//
+
+#define SHA256_ROTR(bits,word)	(((word) >> (bits)) | ((word) << (32 - (bits))))
+#define SHA256_Ch(x,y,z)	(((x) & ((y) ^ (z))) ^ (z))
+#define SHA256_Maj(x,y,z)	(((x) & ((y) | (z))) | ((y) & (z)))
+#define SHA256_SIGMA0(word)	(SHA256_ROTR(2, word) ^ SHA256_ROTR(13, word) ^ SHA256_ROTR(22, word))
+#define SHA256_SIGMA1(word)	(SHA256_ROTR(6, word) ^ SHA256_ROTR(11, word) ^ SHA256_ROTR(25, word))
+#define SHA256_sigma0(word)	(SHA256_ROTR(7, word) ^ SHA256_ROTR(18, word) ^ ((word) >> 3))
+#define SHA256_sigma1(word)	(SHA256_ROTR(17, word) ^ SHA256_ROTR(19, word) ^ ((word) >> 10))
+
+
+//
+// Local globals...
+//
+
+static const uint32_t sha256_h0[8] =	// Initial hash value (FIPS 180-4 section 5.3.3)
+{
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
 };
 
-/* Macros from sha-private.h */
-#define SHA_Ch(x, y, z)      (((x) & ((y) ^ (z))) ^ (z))
-#define SHA_Maj(x, y, z)     (((x) & ((y) | (z))) | ((y) & (z)))
-#define SHA_Parity(x, y, z)  ((x) ^ (y) ^ (z))
-
-/* Define the SHA shift, rotate left, and rotate right macros */
-#define SHA256_SHR(bits,word)      ((word) >> (bits))
-#define SHA256_ROTL(bits,word)                         \
-  (((word) << (bits)) | ((word) >> (32-(bits))))
-#define SHA256_ROTR(bits,word)                         \
-  (((word) >> (bits)) | ((word) << (32-(bits))))
-
-/* Define the SHA SIGMA and sigma macros */
-#define SHA256_SIGMA0(word)   \
-  (SHA256_ROTR( 2,word) ^ SHA256_ROTR(13,word) ^ SHA256_ROTR(22,word))
-#define SHA256_SIGMA1(word)   \
-  (SHA256_ROTR( 6,word) ^ SHA256_ROTR(11,word) ^ SHA256_ROTR(25,word))
-#define SHA256_sigma0(word)   \
-  (SHA256_ROTR( 7,word) ^ SHA256_ROTR(18,word) ^ SHA256_SHR( 3,word))
-#define SHA256_sigma1(word)   \
-  (SHA256_ROTR(17,word) ^ SHA256_ROTR(19,word) ^ SHA256_SHR(10,word))
-
-/*
- * Add "length" to the length.
- * Set Corrupted when overflow has occurred.
- */
-static uint32_t addTemp;
-#define SHA224_256AddLength(context, length)               \
-  (addTemp = (context)->Length_Low, (context)->Corrupted = \
-    (((context)->Length_Low += (length)) < addTemp) &&     \
-    (++(context)->Length_High == 0) ? shaInputTooLong :    \
-                                      (context)->Corrupted )
-
-/* Local Function Prototypes */
-static int SHA224_256Reset(_pdfio_sha256_t *context, uint32_t *H0);
-static void SHA224_256ProcessMessageBlock(_pdfio_sha256_t *context);
-static void SHA224_256Finalize(_pdfio_sha256_t *context,
-  uint8_t Pad_Byte);
-static void SHA224_256PadMessage(_pdfio_sha256_t *context,
-  uint8_t Pad_Byte);
-static int SHA224_256ResultN(_pdfio_sha256_t *context,
-  uint8_t Message_Digest[ ], int HashSize);
-
-/* Initial Hash Values: FIPS 180-3 section 5.3.3 */
-static uint32_t SHA256_H0[SHA256HashSize/4] = {
-  0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
-  0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+static const uint32_t sha256_k[64] =	// Round constants (FIPS 180-4 section 4.2.2)
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
-/*
- * _pdfioCryptoSHA256Init
- *
- * Description:
- *   This function will initialize the _pdfio_sha256_t in preparation
- *   for computing a new SHA256 message digest.
- *
- * Parameters:
- *   context: [in/out]
- *     The context to reset.
- *
- * Returns:
- *   sha Error Code.
- */
-void _pdfioCryptoSHA256Init(_pdfio_sha256_t *context)
+static int	sha256_accel = -1;	// Use SHA-NI instructions override, -1 for none
+static bool	sha256_supported = false;
+					// SHA-NI supported by the CPU?
+#ifdef _WIN32
+static INIT_ONCE sha256_once = INIT_ONCE_STATIC_INIT;
+					// Supported acceleration initialization
+#else
+static pthread_once_t sha256_once = PTHREAD_ONCE_INIT;
+					// Supported acceleration initialization
+#endif // _WIN32
+
+
+//
+// Local functions...
+//
+
+#ifdef _WIN32
+static BOOL CALLBACK detect_accel(PINIT_ONCE once, PVOID param, PVOID *context);
+#else
+static void	detect_accel(void);
+#endif // _WIN32
+static bool	get_accel(void);
+static void	process_blocks(uint32_t hash[8], const uint8_t *data, size_t nblocks);
+#ifdef _PDFIO_SHANI
+static void	shani_blocks(uint32_t hash[8], const uint8_t *data, size_t nblocks);
+#endif // _PDFIO_SHANI
+
+
+//
+// '_pdfioCryptoSHA256Append()' - Append bytes to the SHA-256 hash.
+//
+// Whole 64-byte blocks are hashed directly from the input buffer, only partial
+// blocks are copied into the context.
+//
+
+void
+_pdfioCryptoSHA256Append(
+    _pdfio_sha256_t *ctx,		// I - SHA-256 context
+    const uint8_t   *bytes,		// I - Bytes to hash
+    size_t          bytecount)		// I - Number of bytes
 {
-  SHA224_256Reset(context, SHA256_H0);
+  size_t	count;			// Number of bytes to copy
+
+
+  ctx->length += bytecount;
+
+  if (ctx->used > 0)
+  {
+    // Fill the partial block...
+    if ((count = 64 - ctx->used) > bytecount)
+      count = bytecount;
+
+    memcpy(ctx->block + ctx->used, bytes, count);
+    ctx->used += count;
+    bytes     += count;
+    bytecount -= count;
+
+    if (ctx->used < 64)
+      return;
+
+    process_blocks(ctx->hash, ctx->block, 1);
+    ctx->used = 0;
+  }
+
+  if (bytecount >= 64)
+  {
+    // Hash whole blocks...
+    count = bytecount / 64;
+
+    process_blocks(ctx->hash, bytes, count);
+    bytes     += 64 * count;
+    bytecount -= 64 * count;
+  }
+
+  if (bytecount > 0)
+  {
+    // Save the remaining bytes...
+    memcpy(ctx->block, bytes, bytecount);
+    ctx->used = bytecount;
+  }
 }
 
-/*
- * _pdfioCryptoSHA256Append
- *
- * Description:
- *   This function accepts an array of octets as the next portion
- *   of the message.
- *
- * Parameters:
- *   context: [in/out]
- *     The SHA context to update.
- *   message_array[ ]: [in]
- *     An array of octets representing the next portion of
- *     the message.
- *   length: [in]
- *     The length of the message in message_array.
- *
- * Returns:
- *   sha Error Code.
- */
+
+//
+// '_pdfioCryptoSHA256Finish()' - Finish the SHA-256 hash.
+//
+
 void
-_pdfioCryptoSHA256Append(_pdfio_sha256_t *context, const uint8_t *message_array,
-    size_t length)
+_pdfioCryptoSHA256Finish(
+    _pdfio_sha256_t *ctx,		// I - SHA-256 context
+    uint8_t         *Message_Digest)	// O - 32-byte message digest
 {
-  if (!length) return;
+  size_t	i;			// Looping var
+  uint64_t	bits = 8 * ctx->length;	// Message length in bits
 
-  while (length--) {
-    context->Message_Block[context->Message_Block_Index++] =
-            *message_array;
 
-    if ((SHA224_256AddLength(context, 8) == shaSuccess) &&
-      (context->Message_Block_Index == SHA256_Message_Block_Size))
-      SHA224_256ProcessMessageBlock(context);
+  // Pad the message with a 1 bit, zeros, and the 64-bit message length...
+  ctx->block[ctx->used ++] = 0x80;
 
-    message_array++;
+  if (ctx->used > 56)
+  {
+    memset(ctx->block + ctx->used, 0, 64 - ctx->used);
+    process_blocks(ctx->hash, ctx->block, 1);
+    ctx->used = 0;
   }
+
+  memset(ctx->block + ctx->used, 0, 56 - ctx->used);
+
+  for (i = 0; i < 8; i ++)
+    ctx->block[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+
+  process_blocks(ctx->hash, ctx->block, 1);
+
+  // Return the digest...
+  for (i = 0; i < 32; i ++)
+    Message_Digest[i] = (uint8_t)(ctx->hash[i / 4] >> (24 - 8 * (i & 3)));
+
+  // The message may be sensitive, so clear it out...
+  memset(ctx, 0, sizeof(_pdfio_sha256_t));
 }
 
-/*
- * _pdfioCryptoSHA256Finish
- *
- * Description:
- *   This function will return the 256-bit message digest
- *   into the Message_Digest array provided by the caller.
- *   NOTE:
- *    The first octet of hash is stored in the element with index 0,
- *    the last octet of hash in the element with index 31.
- *
- * Parameters:
- *   context: [in/out]
- *     The context to use to calculate the SHA hash.
- *   Message_Digest[ ]: [out]
- *     Where the digest is returned.
- *
- * Returns:
- *   sha Error Code.
- */
+
+//
+// '_pdfioCryptoSHA256Init()' - Initialize a SHA-256 hash.
+//
+
 void
-_pdfioCryptoSHA256Finish(_pdfio_sha256_t *context,
-                 uint8_t *Message_Digest)
+_pdfioCryptoSHA256Init(
+    _pdfio_sha256_t *ctx)		// I - SHA-256 context
 {
-  SHA224_256ResultN(context, Message_Digest, SHA256HashSize);
+  memcpy(ctx->hash, sha256_h0, sizeof(ctx->hash));
+  ctx->length = 0;
+  ctx->used   = 0;
 }
 
-/*
- * SHA224_256Reset
- *
- * Description:
- *   This helper function will initialize the _pdfio_sha256_t in
- *   preparation for computing a new SHA-224 or SHA-256 message digest.
- *
- * Parameters:
- *   context: [in/out]
- *     The context to reset.
- *   H0[ ]: [in]
- *     The initial hash value array to use.
- *
- * Returns:
- *   sha Error Code.
- */
-static int SHA224_256Reset(_pdfio_sha256_t *context, uint32_t *H0)
-{
-  if (!context) return shaNull;
 
-  context->Length_High = context->Length_Low = 0;
-  context->Message_Block_Index  = 0;
+//
+// '_pdfioCryptoSHA256SetAccel()' - Set whether to use SHA-NI instructions.
+//
+// SHA-NI instructions are only used when the CPU supports them.  This is used
+// by the unit tests to compare the portable and accelerated code and must not
+// be called while other threads are hashing.
+//
 
-  context->Intermediate_Hash[0] = H0[0];
-  context->Intermediate_Hash[1] = H0[1];
-  context->Intermediate_Hash[2] = H0[2];
-  context->Intermediate_Hash[3] = H0[3];
-  context->Intermediate_Hash[4] = H0[4];
-  context->Intermediate_Hash[5] = H0[5];
-  context->Intermediate_Hash[6] = H0[6];
-  context->Intermediate_Hash[7] = H0[7];
+bool					// O - `true` if SHA-NI will be used
+_pdfioCryptoSHA256SetAccel(bool accel)	// I - `true` to use SHA-NI when available
+{
+  if (accel)
+    accel = get_accel();
 
-  context->Computed  = 0;
-  context->Corrupted = shaSuccess;
+  sha256_accel = accel ? 1 : 0;
 
-  return shaSuccess;
+  return (accel);
 }
 
-/*
- * SHA224_256ProcessMessageBlock
- *
- * Description:
- *   This helper function will process the next 512 bits of the
- *   message stored in the Message_Block array.
- *
- * Parameters:
- *   context: [in/out]
- *     The SHA context to update.
- *
- * Returns:
- *   Nothing.
- *
- * Comments:
- *   Many of the variable names in this code, especially the
- *   single character names, were used because those were the
- *   names used in the Secure Hash Standard.
- */
-static void SHA224_256ProcessMessageBlock(_pdfio_sha256_t *context)
+
+//
+// 'detect_accel()' - Detect whether the CPU supports SHA-NI instructions.
+//
+
+#ifdef _WIN32
+static BOOL CALLBACK			// O - `TRUE` to continue
+detect_accel(PINIT_ONCE once,		// I - Initialization state (unused)
+             PVOID      param,		// I - Parameter (unused)
+             PVOID      *context)	// O - Context (unused)
+#else
+static void
+detect_accel(void)
+#endif // _WIN32
 {
-  /* Constants defined in FIPS 180-3, section 4.2.2 */
-  static const uint32_t K[64] = {
-      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
-      0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
-      0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
-      0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-      0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
-      0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
-      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
-      0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
-      0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
-      0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
-      0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-  };
-  int        t, t4;                   /* Loop counter */
-  uint32_t   temp1, temp2;            /* Temporary word value */
-  uint32_t   W[64];                   /* Word sequence */
-  uint32_t   A, B, C, D, E, F, G, H;  /* Word buffers */
-
-  /*
-   * Initialize the first 16 words in the array W
-   */
-  for (t = t4 = 0; t < 16; t++, t4 += 4)
-    W[t] = (((uint32_t)context->Message_Block[t4]) << 24) |
-           (((uint32_t)context->Message_Block[t4 + 1]) << 16) |
-           (((uint32_t)context->Message_Block[t4 + 2]) << 8) |
-           (((uint32_t)context->Message_Block[t4 + 3]));
-
-  for (t = 16; t < 64; t++)
-    W[t] = SHA256_sigma1(W[t-2]) + W[t-7] +
-        SHA256_sigma0(W[t-15]) + W[t-16];
-
-  A = context->Intermediate_Hash[0];
-  B = context->Intermediate_Hash[1];
-  C = context->Intermediate_Hash[2];
-  D = context->Intermediate_Hash[3];
-  E = context->Intermediate_Hash[4];
-  F = context->Intermediate_Hash[5];
-  G = context->Intermediate_Hash[6];
-  H = context->Intermediate_Hash[7];
-
-  for (t = 0; t < 64; t++) {
-    temp1 = H + SHA256_SIGMA1(E) + SHA_Ch(E,F,G) + K[t] + W[t];
-    temp2 = SHA256_SIGMA0(A) + SHA_Maj(A,B,C);
-    H = G;
-    G = F;
-    F = E;
-    E = D + temp1;
-    D = C;
-    C = B;
-    B = A;
-    A = temp1 + temp2;
+  bool		accel = false;		// Use SHA-NI?
+#if defined(_PDFIO_SHANI) && defined(_MSC_VER)
+  int		regs[4];		// CPUID registers
+
+
+  __cpuid(regs, 0);
+  if (regs[0] >= 7)
+  {
+    __cpuid(regs, 1);
+    if ((regs[2] & (1 << 9)) && (regs[2] & (1 << 19)))
+    {
+      __cpuidex(regs, 7, 0);
+      accel = (regs[1] & (1 << 29)) != 0;
+    }
+  }
+
+#elif defined(_PDFIO_SHANI)
+  unsigned	eax, ebx, ecx, edx;	// CPUID registers
+
+
+  // SHA-NI needs SSSE3 and SSE4.1 for the byte swapping and blending...
+  if (__get_cpuid_max(0, NULL) >= 7 && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3) && (ecx & bit_SSE4_1))
+  {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    accel = (ebx & (1 << 29)) != 0;
   }
+#endif // _PDFIO_SHANI && _MSC_VER
 
-  context->Intermediate_Hash[0] += A;
-  context->Intermediate_Hash[1] += B;
-  context->Intermediate_Hash[2] += C;
-  context->Intermediate_Hash[3] += D;
-  context->Intermediate_Hash[4] += E;
-  context->Intermediate_Hash[5] += F;
-  context->Intermediate_Hash[6] += G;
-  context->Intermediate_Hash[7] += H;
+  sha256_supported = accel;
 
-  context->Message_Block_Index = 0;
+#ifdef _WIN32
+  (void)once;
+  (void)param;
+  (void)context;
+
+  return (TRUE);
+#endif // _WIN32
 }
 
-/*
- * SHA224_256Finalize
- *
- * Description:
- *   This helper function finishes off the digest calculations.
- *
- * Parameters:
- *   context: [in/out]
- *     The SHA context to update.
- *   Pad_Byte: [in]
- *     The last byte to add to the message block before the 0-padding
- *     and length.  This will contain the last bits of the message
- *     followed by another single bit.  If the message was an
- *     exact multiple of 8-bits long, Pad_Byte will be 0x80.
- *
- * Returns:
- *   sha Error Code.
- */
-static void SHA224_256Finalize(_pdfio_sha256_t *context,
-    uint8_t Pad_Byte)
+
+//
+// 'get_accel()' - Determine whether the CPU supports SHA-NI instructions.
+//
+
+static bool				// O - `true` if supported
+get_accel(void)
 {
-  int i;
-  SHA224_256PadMessage(context, Pad_Byte);
-  /* message may be sensitive, so clear it out */
-  for (i = 0; i < SHA256_Message_Block_Size; ++i)
-    context->Message_Block[i] = 0;
-  context->Length_High = 0;     /* and clear length */
-  context->Length_Low = 0;
-  context->Computed = 1;
+#ifdef _WIN32
+  InitOnceExecuteOnce(&sha256_once, detect_accel, NULL, NULL);
+#else
+  pthread_once(&sha256_once, detect_accel);
+#endif // _WIN32
+
+  return (sha256_supported);
 }
 
-/*
- * SHA224_256PadMessage
- *
- * Description:
- *   According to the standard, the message must be padded to the next
- *   even multiple of 512 bits.  The first padding bit must be a '1'.
- *   The last 64 bits represent the length of the original message.
- *   All bits in between should be 0.  This helper function will pad
- *   the message according to those rules by filling the
- *   Message_Block array accordingly.  When it returns, it can be
- *   assumed that the message digest has been computed.
- *
- * Parameters:
- *   context: [in/out]
- *     The context to pad.
- *   Pad_Byte: [in]
- *     The last byte to add to the message block before the 0-padding
- *     and length.  This will contain the last bits of the message
- *     followed by another single bit.  If the message was an
- *     exact multiple of 8-bits long, Pad_Byte will be 0x80.
- *
- * Returns:
- *   Nothing.
- */
-static void SHA224_256PadMessage(_pdfio_sha256_t *context,
-    uint8_t Pad_Byte)
+
+//
+// 'process_blocks()' - Hash one or more 64-byte blocks.
+//
+
+static void
+process_blocks(uint32_t      hash[8],	// IO - Intermediate hash value
+               const uint8_t *data,	// I  - Message blocks
+               size_t        nblocks)	// I  - Number of blocks
 {
-  /*
-   * Check to see if the current message block is too small to hold
-   * the initial padding bits and length.  If so, we will pad the
-   * block, process it, and then continue padding into a second
-   * block.
-   */
-  if (context->Message_Block_Index >= (SHA256_Message_Block_Size-8)) {
-    context->Message_Block[context->Message_Block_Index++] = Pad_Byte;
-    while (context->Message_Block_Index < SHA256_Message_Block_Size)
-      context->Message_Block[context->Message_Block_Index++] = 0;
-    SHA224_256ProcessMessageBlock(context);
-  } else
-    context->Message_Block[context->Message_Block_Index++] = Pad_Byte;
-
-  while (context->Message_Block_Index < (SHA256_Message_Block_Size-8))
-    context->Message_Block[context->Message_Block_Index++] = 0;
-
-  /*
-   * Store the message length as the last 8 octets
-   */
-  context->Message_Block[56] = (uint8_t)(context->Length_High >> 24);
-  context->Message_Block[57] = (uint8_t)(context->Length_High >> 16);
-  context->Message_Block[58] = (uint8_t)(context->Length_High >> 8);
-  context->Message_Block[59] = (uint8_t)(context->Length_High);
-  context->Message_Block[60] = (uint8_t)(context->Length_Low >> 24);
-  context->Message_Block[61] = (uint8_t)(context->Length_Low >> 16);
-  context->Message_Block[62] = (uint8_t)(context->Length_Low >> 8);
-  context->Message_Block[63] = (uint8_t)(context->Length_Low);
-
-  SHA224_256ProcessMessageBlock(context);
+  size_t	t;			// Current round
+  uint32_t	W[64];			// Message schedule
+  uint32_t	A, B, C, D, E, F, G, H,	// Working variables
+		temp1, temp2;		// Temporary values
+
+
+#ifdef _PDFIO_SHANI
+  if (sha256_accel < 0 ? get_accel() : sha256_accel)
+  {
+    shani_blocks(hash, data, nblocks);
+    return;
+  }
+#endif // _PDFIO_SHANI
+
+  for (; nblocks > 0; nblocks --, data += 64)
+  {
+    for (t = 0; t < 16; t ++)
+      W[t] = ((uint32_t)data[4 * t] << 24) | ((uint32_t)data[4 * t + 1] << 16) | ((uint32_t)data[4 * t + 2] << 8) | (uint32_t)data[4 * t + 3];
+
+    for (; t < 64; t ++)
+      W[t] = SHA256_sigma1(W[t - 2]) + W[t - 7] + SHA256_sigma0(W[t - 15]) + W[t - 16];
+
+    A = hash[0];
+    B = hash[1];
+    C = hash[2];
+    D = hash[3];
+    E = hash[4];
+    F = hash[5];
+    G = hash[6];
+    H = hash[7];
+
+    for (t = 0; t < 64; t ++)
+    {
+      temp1 = H + SHA256_SIGMA1(E) + SHA256_Ch(E, F, G) + sha256_k[t] + W[t];
+      temp2 = SHA256_SIGMA0(A) + SHA256_Maj(A, B, C);
+      H     = G;
+      G     = F;
+      F     = E;
+      E     = D + temp1;
+      D     = C;
+      C     = B;
+      B     = A;
+      A     = temp1 + temp2;
+    }
+
+    hash[0] += A;
+    hash[1] += B;
+    hash[2] += C;
+    hash[3] += D;
+    hash[4] += E;
+    hash[5] += F;
+    hash[6] += G;
+    hash[7] += H;
+  }
 }
 
-/*
- * SHA224_256ResultN
- *
- * Description:
- *   This helper function will return the 224-bit or 256-bit message
- *   digest into the Message_Digest array provided by the caller.
- *   NOTE:
- *    The first octet of hash is stored in the element with index 0,
- *    the last octet of hash in the element with index 27/31.
- *
- * Parameters:
- *   context: [in/out]
- *     The context to use to calculate the SHA hash.
- *   Message_Digest[ ]: [out]
- *     Where the digest is returned.
- *   HashSize: [in]
- *     The size of the hash, either 28 or 32.
- *
- * Returns:
- *   sha Error Code.
- */
-static int SHA224_256ResultN(_pdfio_sha256_t *context,
-    uint8_t Message_Digest[ ], int HashSize)
-{
-  int i;
 
-  if (!context) return shaNull;
-  if (!Message_Digest) return shaNull;
-  if (context->Corrupted) return context->Corrupted;
+#ifdef _PDFIO_SHANI
+//
+// 'shani_blocks()' - Hash one or more 64-byte blocks with SHA-NI instructions.
+//
+// The SHA256RNDS2 instruction does two rounds using the state in "ABEF" and
+// "CDGH" order, and SHA256MSG1/SHA256MSG2 compute the message schedule four
+// words at a time.
+//
 
-  if (!context->Computed)
-    SHA224_256Finalize(context, 0x80);
+_PDFIO_SHANI_TARGET
+static void
+shani_blocks(uint32_t      hash[8],	// IO - Intermediate hash value
+             const uint8_t *data,	// I  - Message blocks
+             size_t        nblocks)	// I  - Number of blocks
+{
+  size_t	i;			// Looping var
+  __m128i	state0,			// ABEF state
+		state1,			// CDGH state
+		save0,			// Saved ABEF state
+		save1,			// Saved CDGH state
+		msg[4],			// Message schedule words
+		temp;			// Temporary value
+  const __m128i	mask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+					// Big-endian byte swap
+
+
+  // Load the state and reorder it for SHA256RNDS2...
+  temp   = _mm_loadu_si128((const __m128i *)hash);
+  state1 = _mm_loadu_si128((const __m128i *)(hash + 4));
+  temp   = _mm_shuffle_epi32(temp, 0xb1);	// CDAB
+  state1 = _mm_shuffle_epi32(state1, 0x1b);	// EFGH
+  state0 = _mm_alignr_epi8(temp, state1, 8);	// ABEF
+  state1 = _mm_blend_epi16(state1, temp, 0xf0);	// CDGH
+
+  for (; nblocks > 0; nblocks --, data += 64)
+  {
+    save0 = state0;
+    save1 = state1;
+
+    for (i = 0; i < 4; i ++)
+      msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), mask);
+
+    for (i = 0; i < 16; i ++)
+    {
+      // Four rounds...
+      temp   = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i *)(sha256_k + 4 * i)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, temp);
+      temp   = _mm_shuffle_epi32(temp, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, temp);
+
+      // Compute the words for the rounds 16 ahead...
+      if (i < 12)
+        msg[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]), _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4)), msg[(i + 3) & 3]);
+    }
+
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+  }
 
-  for (i = 0; i < HashSize; ++i)
-    Message_Digest[i] = (uint8_t)
-      (context->Intermediate_Hash[i>>2] >> 8 * ( 3 - ( i & 0x03 ) ));
+  // Restore the state order and save it...
+  temp   = _mm_shuffle_epi32(state0, 0x1b);	// FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xb1);	// DCHG
+  state0 = _mm_blend_epi16(temp, state1, 0xf0);	// DCBA
+  state1 = _mm_alignr_epi8(state1, temp, 8);	// HGFE
 
-  return shaSuccess;
+  _mm_storeu_si128((__m128i *)hash, state0);
+  _mm_storeu_si128((__m128i *)(hash + 4), state1);
 }
+#endif // _PDFIO_SHANI
@@ -35,10 +35,14 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
     return (false);
 
   // Finish reads/writes and free memory...
-  if (st->pdf->mode == _PDFIO_MODE_READ)
+  if (st->mode == _PDFIO_MODE_READ)
   {
     if (st->filter == PDFIO_FILTER_FLATE)
       inflateEnd(&(st->flate));
+
+    // Go back to the end of the file when writing an incremental update...
+    if (st->pdf->update_offset && _pdfioFileSeek(st->pdf, 0, SEEK_END) < 0)
+      ret = false;
   }
   else
   {
@@ -63,19 +67,25 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 
 	if (st->crypto_cb)
 	{
-	  // Encrypt it first...
-	  outbytes = (st->crypto_cb)(&st->crypto_ctx, st->cbuffer, st->cbuffer, bytes & (size_t)~15);
+	  // Encrypt whole blocks into the file buffer...
+	  outbytes = bytes & (size_t)~15;
+
+	  if (!_pdfioFileWriteCrypto(st->pdf, st->crypto_cb, &st->crypto_ctx, st->cbuffer, outbytes))
+	  {
+	    ret = false;
+	    goto done;
+	  }
 	}
 	else
 	{
 	  // No encryption
 	  outbytes = bytes;
-	}
 
-	if (!_pdfioFileWrite(st->pdf, st->cbuffer, outbytes))
-	{
-	  ret = false;
-	  goto done;
+	  if (!_pdfioFileWrite(st->pdf, st->cbuffer, outbytes))
+	  {
+	    ret = false;
+	    goto done;
+	  }
 	}
 
         if (bytes > outbytes)
@@ -101,10 +111,13 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 	if (st->crypto_cb)
 	{
 	  // Encrypt it first...
-	  bytes = (st->crypto_cb)(&st->crypto_ctx, st->cbuffer, st->cbuffer, bytes);
+	  if (!_pdfioFileWriteCrypto(st->pdf, st->crypto_cb, &st->crypto_ctx, st->cbuffer, bytes))
+	  {
+	    ret = false;
+	    goto done;
+	  }
 	}
-
-	if (!_pdfioFileWrite(st->pdf, st->cbuffer, bytes))
+	else if (!_pdfioFileWrite(st->pdf, st->cbuffer, bytes))
 	{
 	  ret = false;
 	  goto done;
@@ -116,11 +129,7 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
     else if (st->crypto_cb && st->bufptr > st->buffer)
     {
       // Encrypt and flush
-      uint8_t	temp[8192];		// Temporary buffer
-      size_t	outbytes;		// Output bytes
-
-      outbytes = (st->crypto_cb)(&st->crypto_ctx, temp, (uint8_t *)st->buffer, (size_t)(st->bufptr - st->buffer));
-      if (!_pdfioFileWrite(st->pdf, temp, outbytes))
+      if (!_pdfioFileWriteCrypto(st->pdf, st->crypto_cb, &st->crypto_ctx, st->buffer, (size_t)(st->bufptr - st->buffer)))
       {
         ret = false;
         goto done;
@@ -205,6 +214,7 @@ _pdfioStreamCreate(
   st->pdf        = obj->pdf;
   st->obj        = obj;
   st->length_obj = length_obj;
+  st->mode       = _PDFIO_MODE_WRITE;
   st->filter     = compression;
   st->bufptr     = st->buffer;
   st->bufend     = st->buffer + sizeof(st->buffer);
@@ -332,7 +342,7 @@ pdfioStreamConsume(pdfio_stream_t *st,	// I - Stream
 
 
   // Range check input...
-  if (!st || st->pdf->mode != _PDFIO_MODE_READ || !bytes)
+  if (!st || st->mode != _PDFIO_MODE_READ || !bytes)
     return (false);
 
   // Skip bytes in the stream buffer until we've consumed the requested number
@@ -381,7 +391,7 @@ pdfioStreamGetToken(
 
 
   // Range check input...
-  if (!st || st->pdf->mode != _PDFIO_MODE_READ || !buffer || !bufsize)
+  if (!st || st->mode != _PDFIO_MODE_READ || !buffer || !bufsize)
     return (false);
 
   // Read using the token engine...
@@ -420,8 +430,9 @@ _pdfioStreamOpen(pdfio_obj_t *obj,	// I - Object
     return (NULL);
   }
 
-  st->pdf = obj->pdf;
-  st->obj = obj;
+  st->pdf  = obj->pdf;
+  st->obj  = obj;
+  st->mode = _PDFIO_MODE_READ;
 
   if ((st->remaining = pdfioObjGetLength(obj)) == 0)
   {
@@ -637,7 +648,7 @@ pdfioStreamPeek(pdfio_stream_t *st,	// I - Stream
 
 
   // Range check input...
-  if (!st || st->pdf->mode != _PDFIO_MODE_READ || !buffer || !bytes)
+  if (!st || st->mode != _PDFIO_MODE_READ || !buffer || !bytes)
     return (-1);
 
   // See if we have enough bytes in the buffer...
@@ -685,7 +696,7 @@ pdfioStreamPrintf(
 
 
   // Range check input...
-  if (!st || st->pdf->mode != _PDFIO_MODE_WRITE || !format)
+  if (!st || st->mode != _PDFIO_MODE_WRITE || !format)
     return (false);
 
   // Format the string...
@@ -709,7 +720,7 @@ pdfioStreamPutChar(pdfio_stream_t *st,	// I - Stream
   char	buffer[1];			// Write buffer
 
 
-  if (!st || st->pdf->mode != _PDFIO_MODE_WRITE)
+  if (!st || st->mode != _PDFIO_MODE_WRITE)
     return (false);
 
   buffer[0] = (char)ch;
@@ -726,7 +737,7 @@ bool					// O - `true` on success, `false` on failure
 pdfioStreamPuts(pdfio_stream_t *st,	// I - Stream
                 const char     *s)	// I - Literal string
 {
-  if (!st || st->pdf->mode != _PDFIO_MODE_WRITE || !s)
+  if (!st || st->mode != _PDFIO_MODE_WRITE || !s)
     return (false);
   else
     return (pdfioStreamWrite(st, s, strlen(s)));
@@ -755,7 +766,7 @@ pdfioStreamRead(
 
 
   // Range check input...
-  if (!st || st->pdf->mode != _PDFIO_MODE_READ || !buffer || !bytes)
+  if (!st || st->mode != _PDFIO_MODE_READ || !buffer || !bytes)
     return (-1);
 
   // Loop until we have the requested bytes or hit the end of the stream...
@@ -823,7 +834,7 @@ pdfioStreamWrite(
   PDFIO_DEBUG("pdfioStreamWrite(st=%p, buffer=%p, bytes=%lu)\n", st, buffer, (unsigned long)bytes);
 
   // Range check input...
-  if (!st || st->pdf->mode != _PDFIO_MODE_WRITE || !buffer || !bytes)
+  if (!st || st->mode != _PDFIO_MODE_WRITE || !buffer || !bytes)
     return (false);
 
   // Write it...
@@ -833,9 +844,7 @@ pdfioStreamWrite(
     if (st->crypto_cb)
     {
       // Encrypt data before writing...
-      uint8_t	temp[8192];		// Temporary buffer
-      size_t	cbytes,			// Current bytes
-		outbytes;		// Output bytes
+      size_t	cbytes;			// Current bytes
 
       bufptr = (const unsigned char *)buffer;
 
@@ -852,8 +861,7 @@ pdfioStreamWrite(
           if (st->bufptr >= st->bufend)
           {
             // Encrypt and flush
-	    outbytes = (st->crypto_cb)(&st->crypto_ctx, temp, (uint8_t *)st->buffer, sizeof(st->buffer));
-	    if (!_pdfioFileWrite(st->pdf, temp, outbytes))
+	    if (!_pdfioFileWriteCrypto(st->pdf, st->crypto_cb, &st->crypto_ctx, st->buffer, sizeof(st->buffer)))
 	      return (false);
 
 	    st->bufptr = st->buffer;
@@ -861,17 +869,11 @@ pdfioStreamWrite(
         }
         else
         {
-          // Write directly up to sizeof(temp) bytes...
-          if ((cbytes = bytes) > sizeof(temp))
-            cbytes = sizeof(temp);
-          if (cbytes & 15)
-          {
-            // AES has a 16-byte block size, so save the last few bytes...
-            cbytes &= (size_t)~15;
-          }
+          // Encrypt whole blocks directly into the file buffer - AES has a
+          // 16-byte block size, so save the last few bytes...
+          cbytes = bytes & (size_t)~15;
 
-	  outbytes = (st->crypto_cb)(&st->crypto_ctx, temp, bufptr, cbytes);
-	  if (!_pdfioFileWrite(st->pdf, temp, outbytes))
+	  if (!_pdfioFileWriteCrypto(st->pdf, st->crypto_cb, &st->crypto_ctx, bufptr, cbytes))
 	    return (false);
         }
 
@@ -1289,19 +1291,22 @@ stream_write(pdfio_stream_t *st,	// I - Stream
 
       if (st->crypto_cb)
       {
-        // Encrypt it first...
-        outbytes = (st->crypto_cb)(&st->crypto_ctx, st->cbuffer, st->cbuffer, cbytes & (size_t)~15);
+        // Encrypt whole blocks into the file buffer...
+        outbytes = cbytes & (size_t)~15;
+
+        if (!_pdfioFileWriteCrypto(st->pdf, st->crypto_cb, &st->crypto_ctx, st->cbuffer, outbytes))
+          return (false);
       }
       else
       {
         outbytes = cbytes;
+
+        if (!_pdfioFileWrite(st->pdf, st->cbuffer, outbytes))
+          return (false);
       }
 
 //      fprintf(stderr, "stream_write: bytes=%u, outbytes=%u\n", (unsigned)bytes, (unsigned)outbytes);
 
-      if (!_pdfioFileWrite(st->pdf, st->cbuffer, outbytes))
-        return (false);
-
       if (cbytes > outbytes)
       {
         cbytes -= outbytes;
@@ -8,6 +8,7 @@
 //
 
 #include "pdfio-private.h"
+#include <math.h>
 
 
 //
@@ -289,6 +290,83 @@ _pdfioValueDelete(_pdfio_value_t *v)	// I - Value
 }
 
 
+//
+// '_pdfioValueHash()' - Add a value to a SHA-256 digest.
+//
+// Dictionary keys are hashed in sorted order and indirect references are
+// hashed using their object numbers, so equal values in the same file have the
+// same digest.  Values are read with the array and dictionary accessors so that
+// strings are decrypted before they are hashed.
+//
+
+void
+_pdfioValueHash(_pdfio_value_t  *v,	// I - Value
+                _pdfio_sha256_t *ctx)	// I - SHA-256 context
+{
+  uint8_t	type = (uint8_t)v->type;// Value type
+  uint64_t	count;			// Count/length/number
+  size_t	i;			// Looping var
+
+
+  _pdfioCryptoSHA256Append(ctx, &type, 1);
+
+  switch (v->type)
+  {
+    default :
+        break;
+
+    case PDFIO_VALTYPE_ARRAY :
+        count = v->value.array->num_values;
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)&count, sizeof(count));
+
+        for (i = 0; i < v->value.array->num_values; i ++)
+          _pdfioValueHash(_pdfioArrayGetValue(v->value.array, i), ctx);
+        break;
+
+    case PDFIO_VALTYPE_BINARY :
+        count = v->value.binary.datalen;
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)&count, sizeof(count));
+        _pdfioCryptoSHA256Append(ctx, v->value.binary.data, v->value.binary.datalen);
+        break;
+
+    case PDFIO_VALTYPE_BOOLEAN :
+        type = v->value.boolean ? 1 : 0;
+        _pdfioCryptoSHA256Append(ctx, &type, 1);
+        break;
+
+    case PDFIO_VALTYPE_DATE :
+        count = (uint64_t)v->value.date;
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)&count, sizeof(count));
+        break;
+
+    case PDFIO_VALTYPE_DICT :
+        count = v->value.dict->num_pairs;
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)&count, sizeof(count));
+
+        for (i = 0; i < v->value.dict->num_pairs; i ++)
+        {
+          _pdfioCryptoSHA256Append(ctx, (uint8_t *)v->value.dict->pairs[i].key, strlen(v->value.dict->pairs[i].key) + 1);
+          _pdfioValueHash(_pdfioDictGetValue(v->value.dict, v->value.dict->pairs[i].key), ctx);
+	}
+        break;
+
+    case PDFIO_VALTYPE_INDIRECT :
+        count = ((uint64_t)v->value.indirect.number << 16) | v->value.indirect.generation;
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)&count, sizeof(count));
+        break;
+
+    case PDFIO_VALTYPE_NAME :
+    case PDFIO_VALTYPE_STRING :
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)v->value.name, strlen(v->value.name) + 1);
+        break;
+
+    case PDFIO_VALTYPE_NUMBER :
+        _pdfioCryptoSHA256Append(ctx, (uint8_t *)&v->value.number, sizeof(v->value.number));
+        break;
+  }
+}
+
+
 //
 // '_pdfioValueRead()' - Read a value from a file.
 //
@@ -654,7 +732,12 @@ _pdfioValueWrite(pdfio_file_t   *pdf,	// I - PDF file
         return (_pdfioFilePuts(pdf, " null"));
 
     case PDFIO_VALTYPE_NUMBER :
-        return (_pdfioFilePrintf(pdf, " %g", v->value.number));
+        if (v->value.number == 0.0)
+          return (_pdfioFilePuts(pdf, " 0"));	// Don't write -0
+        else if (v->value.number == floor(v->value.number) && fabs(v->value.number) < 9007199254740992.0)
+          return (_pdfioFilePrintf(pdf, " %.0f", v->value.number));
+	else
+          return (_pdfioFilePrintf(pdf, " %g", v->value.number));
 
     case PDFIO_VALTYPE_STRING :
         if (obj && pdf->encryption)
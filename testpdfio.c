@@ -10,13 +10,22 @@
 //
 //   ./testpdfio
 //
+//   ./testpdfio --bench
+//
 //   ./testpdfio [--verbose] FILENAME [OBJECT-NUMBER] [FILENAME [OBJECT-NUMBER]] ...
 //
 
 #include "pdfio-private.h"
 #include "pdfio-content.h"
+#include "ttf.h"
 #include <math.h>
 #include <locale.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <sys/utime.h>
+#else
+#  include <utime.h>
+#endif // _WIN32
 #ifndef M_PI
 #  define M_PI	3.14159265358979323846264338327950288
 #endif // M_PI
@@ -26,17 +35,30 @@
 // Local functions...
 //
 
+static int	dedup_unit_file(const char *filename, const char *outname);
+static int	do_bench_tests(void);
 static int	do_crypto_tests(void);
 static int	do_test_file(const char *filename, int objnum, const char *password, bool verbose);
 static int	do_unit_tests(void);
 static int	draw_image(pdfio_stream_t *st, const char *name, double x, double y, double w, double h, const char *label);
 static bool	error_cb(pdfio_file_t *pdf, const char *message, bool *error);
+static int	font_cache_unit_file(const char *outname);
+static int	font_unit_file(const char *outname);
 static bool	iterate_cb(pdfio_dict_t *dict, const char *key, void *cb_data);
+static int	linearize_unit_file(const char *filename, const char *outname, size_t num_pages);
+static int	merge_unit_file(const char *srcname, const char *outname, size_t num_files, size_t num_pages);
 static ssize_t	output_cb(int *fd, const void *buffer, size_t bytes);
 static const char *password_cb(void *data, const char *filename);
 static int	read_unit_file(const char *filename, size_t num_pages, size_t first_image, bool is_output);
+static bool	repair_cb(pdfio_file_t *pdf, const char *message, size_t *count);
+static int	repair_unit_file(const char *filename, const char *outname);
+static int	subset_unit_file(const char *outname);
+static int	text_bench_file(const char *outname);
+static int	text_unit_file(const char *outname);
 static ssize_t	token_consume_cb(const char **s, size_t bytes);
 static ssize_t	token_peek_cb(const char **s, char *buffer, size_t bytes);
+static int	tree_unit_file(const char *filename);
+static int	update_unit_file(const char *filename, size_t *num_pages);
 static int	usage(FILE *fp);
 static int	verify_image(pdfio_file_t *pdf, size_t number);
 static int	write_alpha_test(pdfio_file_t *pdf, int number, pdfio_obj_t *font);
@@ -71,7 +93,11 @@ main(int  argc,				// I - Number of command-line arguments
 
     for (i = 1; i < argc; i ++)
     {
-      if (!strcmp(argv[i], "--help"))
+      if (!strcmp(argv[i], "--bench"))
+      {
+        return (do_bench_tests());
+      }
+      else if (!strcmp(argv[i], "--help"))
       {
         return (usage(stdout));
       }
@@ -128,6 +154,231 @@ main(int  argc,				// I - Number of command-line arguments
 }
 
 
+//
+// 'dedup_unit_file()' - Merge two copies of a PDF file with deduplication.
+//
+
+static int				// O - Exit status
+dedup_unit_file(const char *filename,	// I - File to copy
+                const char *outname)	// I - Merged file
+{
+  pdfio_file_t	*inpdfs[2] = { NULL, NULL },
+					// Input PDF files
+		*outpdf = NULL;		// Output PDF file
+  size_t	i,			// Looping var
+		j,			// Looping var
+		num_pages,		// Number of pages
+		num_objs[2];		// Number of objects after each copy
+  bool		error = false;		// Error callback data
+
+
+  // Open the same file twice so that none of the objects are mapped...
+  for (i = 0; i < 2; i ++)
+  {
+    printf("pdfioFileOpen(\"%s\", ...): ", filename);
+    if ((inpdfs[i] = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+      puts("PASS");
+    else
+      goto fail;
+  }
+
+  num_pages = pdfioFileGetNumPages(inpdfs[0]);
+
+  printf("pdfioFileCreate(\"%s\", ...): ", outname);
+  if ((outpdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    goto fail;
+
+  pdfioFileSetDeduplicate(outpdf, true);
+
+  // Copy the pages from each file...
+  for (i = 0; i < 2; i ++)
+  {
+    printf("pdfioPageCopy(copy %u): ", (unsigned)i + 1);
+    for (j = 0; j < num_pages; j ++)
+    {
+      if (!pdfioPageCopy(outpdf, pdfioFileGetPage(inpdfs[i], j)))
+        break;
+    }
+
+    if (j < num_pages)
+    {
+      printf("FAIL (page %u)\n", (unsigned)j + 1);
+      goto fail;
+    }
+
+    num_objs[i] = pdfioFileGetNumObjs(outpdf);
+    printf("PASS (%u objects)\n", (unsigned)num_objs[i]);
+  }
+
+  // The second copy should only add the pages and page tree...
+  fputs("pdfioFileSetDeduplicate: ", stdout);
+  if ((num_objs[1] - num_objs[0]) < num_objs[0] / 2)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%u new objects for second copy)\n", (unsigned)(num_objs[1] - num_objs[0]));
+    goto fail;
+  }
+
+  for (i = 0; i < 2; i ++)
+    pdfioFileClose(inpdfs[i]);
+
+  fputs("pdfioFileClose(...): ", stdout);
+  if (pdfioFileClose(outpdf))
+    puts("PASS");
+  else
+    return (1);
+
+  // Make sure the merged file has all of the pages...
+  printf("pdfioFileOpen(\"%s\", ...): ", outname);
+  if ((outpdf = pdfioFileOpen(outname, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  fputs("pdfioFileGetNumPages: ", stdout);
+  if (pdfioFileGetNumPages(outpdf) == 2 * num_pages)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%u pages, expected %u)\n", (unsigned)pdfioFileGetNumPages(outpdf), (unsigned)(2 * num_pages));
+    pdfioFileClose(outpdf);
+    return (1);
+  }
+
+  pdfioFileClose(outpdf);
+
+  return (0);
+
+  fail:
+
+  for (i = 0; i < 2; i ++)
+    pdfioFileClose(inpdfs[i]);
+
+  pdfioFileClose(outpdf);
+
+  return (1);
+}
+
+
+//
+// 'do_bench_tests()' - Run the (slow) benchmarks.
+//
+
+static int				// O - Exit status
+do_bench_tests(void)
+{
+  size_t	i;			// Looping var
+  _pdfio_aes_t	aes;			// AES context
+  _pdfio_aes_accel_t accel;		// AES acceleration
+  _pdfio_sha256_t sha256;		// SHA-256 context
+  int		shani;			// Use SHA-NI instructions?
+  uint8_t	*bigbuffer,		// Benchmark buffer
+		key[32],		// Encryption/decryption key
+		hash[32],		// SHA-256 hash
+		iv[16];			// Initialization vector
+  size_t	bigsize;		// Size of benchmark data
+  clock_t	start;			// Start time for benchmark
+  double	secs;			// Benchmark time in seconds
+  static const char * const aes_accels[] =
+  {					// AES acceleration names
+    "portable",
+    "AES-NI",
+    "VAES"
+  };
+
+
+  fprintf(stderr, "testpdfio: Test locale is \"%s\".\n", setlocale(LC_ALL, getenv("LANG")));
+
+#if _WIN32
+  // Windows puts executables in Platform/Configuration subdirs...
+  if (!_access("../../testfiles", 0))
+    _chdir("../..");
+#endif // _WIN32
+
+  if ((bigbuffer = (uint8_t *)malloc(16 * 1024 * 1024)) == NULL)
+  {
+    puts("Unable to allocate memory for benchmarks.");
+    return (1);
+  }
+
+  for (i = 0; i < sizeof(key); i ++)
+    key[i] = (uint8_t)i + 1;
+  for (i = 0; i < sizeof(iv); i ++)
+    iv[i] = (uint8_t)(0xff - i);
+
+  // Benchmark AES decryption with each supported acceleration (the portable
+  // code is a lot slower)...
+  for (accel = _PDFIO_AES_ACCEL_NONE; accel <= _PDFIO_AES_ACCEL_VAES; accel ++)
+  {
+    if (_pdfioCryptoAESSetAccel(accel) != accel)
+      break;
+
+    bigsize = accel == _PDFIO_AES_ACCEL_NONE ? 1024 * 1024 : 16 * 1024 * 1024;
+
+    printf("_pdfioAESDecrypt(%uMiB 256-bit CBC, %s): ", (unsigned)(bigsize / 1024 / 1024), aes_accels[accel]);
+    memset(bigbuffer, 0x5a, bigsize);
+
+    _pdfioCryptoAESInit(&aes, key, sizeof(key), iv);
+    start = clock();
+    _pdfioCryptoAESDecrypt(&aes, bigbuffer, bigbuffer, bigsize);
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (secs > 0.0)
+      printf("PASS (%.3f GB/s)\n", (double)bigsize / secs / 1000000000.0);
+    else
+      puts("PASS");
+  }
+
+  _pdfioCryptoAESSetAccel(_PDFIO_AES_ACCEL_VAES);
+
+  // Benchmark SHA-256 hashing with and without SHA-NI...
+  memset(bigbuffer, 'a', 16 * 1024 * 1024);
+
+  for (shani = 0; shani < 2; shani ++)
+  {
+    if (_pdfioCryptoSHA256SetAccel(shani != 0) != (shani != 0))
+      break;
+
+    printf("_pdfioSHA256Append(16MiB, %s): ", shani ? "SHA-NI" : "portable");
+    _pdfioCryptoSHA256Init(&sha256);
+    start = clock();
+    _pdfioCryptoSHA256Append(&sha256, bigbuffer, 16 * 1024 * 1024);
+    _pdfioCryptoSHA256Finish(&sha256, hash);
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (secs > 0.0)
+      printf("PASS (%.3f GB/s)\n", 16.0 * 1024.0 * 1024.0 / secs / 1000000000.0);
+    else
+      puts("PASS");
+  }
+
+  _pdfioCryptoSHA256SetAccel(true);
+
+  free(bigbuffer);
+
+  // Merge pages from many PDF files...
+  if (merge_unit_file("testpdfio-src.pdf", "testpdfio-merge.pdf", 100, 1000))
+    return (1);
+
+  // Embed the same fonts in many PDF files...
+  if (font_unit_file("testpdfio-fonts.pdf"))
+    return (1);
+
+  // Write lots of text...
+  if (text_bench_file("testpdfio-text.pdf"))
+    return (1);
+
+  return (0);
+}
+
+
 //
 // 'do_crypto_tests()' - Test the various cryptographic functions in PDFio.
 //
@@ -138,9 +389,12 @@ do_crypto_tests(void)
   int		ret = 0;		// Return value
   size_t	i;			// Looping var
   _pdfio_aes_t	aes;			// AES context
+  _pdfio_aes_accel_t accel;		// AES acceleration
+  uint8_t	*bigbuffer;		// Large test buffer
   _pdfio_md5_t	md5;			// MD5 context
   _pdfio_rc4_t	rc4;			// RC4 context
   _pdfio_sha256_t sha256;		// SHA256 context
+  int		shani;			// Use SHA-NI instructions?
   uint8_t	key[32],		// Encryption/decryption key
 	        iv[32],			// Initialization vector
 	        buffer[256],		// Output buffer
@@ -155,12 +409,32 @@ do_crypto_tests(void)
 					// Expected AES-128 CBC result
   static uint8_t aes256text[] =  { 0x2b, 0x94, 0x45, 0x9e, 0xed, 0xa0, 0x89, 0x7b, 0x35, 0x4e, 0xde, 0x06, 0x00, 0x4d, 0xda, 0x6b, 0x61, 0x2f, 0xb9, 0x06, 0xd5, 0x0f, 0x22, 0xed, 0xd2, 0xe3, 0x6b, 0x39, 0x5a, 0xa1, 0xe3, 0x7d, 0xa1, 0xcc, 0xd4, 0x0b, 0x6b, 0xa4, 0xff, 0xe9, 0x9c, 0x89, 0x0c, 0xc7, 0x95, 0x47, 0x19, 0x9b, 0x06, 0xdc, 0xc8, 0x7c, 0x5c, 0x5d, 0x56, 0x99, 0x1e, 0x90, 0x7d, 0x99, 0xc5, 0x7b, 0xc4, 0xe4, 0xfb, 0x02, 0x15, 0x50, 0x23, 0x2a, 0xe4, 0xc1, 0x20, 0xfd, 0xf4, 0x03, 0xfe, 0x6f, 0x15, 0x48, 0xd8, 0x62, 0x36, 0x98, 0x2a, 0x62, 0xf5, 0x2c, 0xa6, 0xfa, 0x7a, 0x43, 0x53, 0xcd, 0xad, 0x18 };
 					// Expected AES-256 CBC result
+  static const char * const aes_accels[] =
+  {					// AES acceleration names
+    "portable",
+    "AES-NI",
+    "VAES"
+  };
+  static uint8_t sp80038a_iv[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+					// SP 800-38A CBC initialization vector
+  static uint8_t sp80038a_plain[64] = { 0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51, 0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef, 0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10 };
+					// SP 800-38A CBC plaintext
+  static uint8_t sp80038a_key256[32] = { 0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81, 0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4 };
+					// SP 800-38A CBC-AES256 key
+  static uint8_t sp80038a_cbc128[64] = { 0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d, 0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2, 0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16, 0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7 };
+					// SP 800-38A CBC-AES128 ciphertext
+  static uint8_t sp80038a_cbc256[64] = { 0xf5, 0x8c, 0x4c, 0x04, 0xd6, 0xe5, 0xf1, 0xba, 0x77, 0x9e, 0xab, 0xfb, 0x5f, 0x7b, 0xfb, 0xd6, 0x9c, 0xfc, 0x4e, 0x96, 0x7e, 0xdb, 0x80, 0x8d, 0x67, 0x9f, 0x77, 0x7b, 0xc6, 0x70, 0x2c, 0x7d, 0x39, 0xf2, 0x33, 0x69, 0xa9, 0xd9, 0xba, 0xcf, 0xa5, 0x30, 0xe2, 0x63, 0x04, 0x23, 0x14, 0x61, 0xb2, 0xeb, 0x05, 0xe2, 0xc3, 0x9b, 0xe9, 0xfc, 0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b };
+					// SP 800-38A CBC-AES256 ciphertext
   static uint8_t md5text[16] = { 0x74, 0x0c, 0x2c, 0xea, 0xe1, 0xab, 0x06, 0x7c, 0xdb, 0x1d, 0x49, 0x1d, 0x2d, 0x66, 0xf2, 0x93 };
 					// Expected MD5 hash result
   static uint8_t rc4text[] = { 0xd2, 0xa2, 0xa0, 0xf6, 0x0f, 0xb1, 0x3e, 0xa0, 0xdd, 0xe1, 0x44, 0xfd, 0xec, 0xc4, 0x55, 0xf8, 0x25, 0x68, 0xad, 0xe6, 0xb0, 0x60, 0x7a, 0x0f, 0x4e, 0xfe, 0xed, 0x9c, 0x78, 0x3a, 0xf8, 0x73, 0x79, 0xbd, 0x82, 0x88, 0x39, 0x01, 0xc7, 0xd0, 0x34, 0xfe, 0x40, 0x16, 0x93, 0x5a, 0xec, 0x81, 0xda, 0x34, 0xdf, 0x5b, 0xd1, 0x47, 0x2c, 0xfa, 0xe0, 0x13, 0xc5, 0xe2, 0xb0, 0x57, 0x5c, 0x17, 0x62, 0xaa, 0x83, 0x1c, 0x4f, 0xa0, 0x0a, 0xed, 0x6c, 0x42, 0x41, 0x8a, 0x45, 0x03, 0xb8, 0x72, 0xa8, 0x99, 0xd7, 0x06 };
 					// Expected RC4 result
   static uint8_t sha256text[32] = { 0x19, 0x71, 0x9b, 0xf0, 0xc6, 0xd8, 0x34, 0xc9, 0x6e, 0x8a, 0x56, 0xcc, 0x34, 0x45, 0xb7, 0x1d, 0x5b, 0x74, 0x9c, 0x52, 0x40, 0xcd, 0x30, 0xa2, 0xc2, 0x84, 0x53, 0x83, 0x16, 0xf8, 0x1a, 0xbb };
 					// Expected SHA-256 hash result
+  static uint8_t sha256abc[32] = { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad };
+					// FIPS 180-2 SHA-256 hash of "abc"
+  static uint8_t sha256million[32] = { 0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0 };
+					// FIPS 180-2 SHA-256 hash of one million "a"s
 
 
   fputs("_pdfioAESInit(128-bit sample key): ", stdout);
@@ -288,6 +562,102 @@ do_crypto_tests(void)
     ret = 1;
   }
 
+  // Run known-answer and consistency tests with each supported AES
+  // acceleration...
+  if ((bigbuffer = (uint8_t *)malloc(1000000)) == NULL)
+  {
+    puts("Unable to allocate memory for crypto tests.");
+    return (1);
+  }
+
+  for (accel = _PDFIO_AES_ACCEL_NONE; accel <= _PDFIO_AES_ACCEL_VAES; accel ++)
+  {
+    if (_pdfioCryptoAESSetAccel(accel) != accel)
+      break;
+
+    printf("_pdfioAESEncrypt(SP 800-38A 128-bit CBC, %s): ", aes_accels[accel]);
+    _pdfioCryptoAESInit(&aes, aes128key, sizeof(aes128key), sp80038a_iv);
+    _pdfioCryptoAESEncrypt(&aes, buffer, sp80038a_plain, sizeof(sp80038a_plain));
+
+    if (!memcmp(buffer, sp80038a_cbc128, sizeof(sp80038a_cbc128)))
+    {
+      puts("PASS");
+    }
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+
+    printf("_pdfioAESDecrypt(SP 800-38A 128-bit CBC, %s): ", aes_accels[accel]);
+    _pdfioCryptoAESInit(&aes, aes128key, sizeof(aes128key), sp80038a_iv);
+    _pdfioCryptoAESDecrypt(&aes, buffer2, sp80038a_cbc128, sizeof(sp80038a_cbc128));
+
+    if (!memcmp(buffer2, sp80038a_plain, sizeof(sp80038a_plain)))
+    {
+      puts("PASS");
+    }
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+
+    printf("_pdfioAESEncrypt(SP 800-38A 256-bit CBC, %s): ", aes_accels[accel]);
+    _pdfioCryptoAESInit(&aes, sp80038a_key256, sizeof(sp80038a_key256), sp80038a_iv);
+    _pdfioCryptoAESEncrypt(&aes, buffer, sp80038a_plain, sizeof(sp80038a_plain));
+
+    if (!memcmp(buffer, sp80038a_cbc256, sizeof(sp80038a_cbc256)))
+    {
+      puts("PASS");
+    }
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+
+    printf("_pdfioAESDecrypt(SP 800-38A 256-bit CBC, %s): ", aes_accels[accel]);
+    _pdfioCryptoAESInit(&aes, sp80038a_key256, sizeof(sp80038a_key256), sp80038a_iv);
+    _pdfioCryptoAESDecrypt(&aes, buffer2, sp80038a_cbc256, sizeof(sp80038a_cbc256));
+
+    if (!memcmp(buffer2, sp80038a_plain, sizeof(sp80038a_plain)))
+    {
+      puts("PASS");
+    }
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+
+    // Decrypt in place, in pieces, and compare against the plain text...
+    printf("_pdfioAESDecrypt(in-place 256-bit CBC, %s): ", aes_accels[accel]);
+    for (i = 0; i < 4096; i ++)
+      bigbuffer[i] = (uint8_t)(i * 7 + (i >> 8));
+
+    memcpy(bigbuffer + 8192, bigbuffer, 4096);
+
+    _pdfioCryptoAESInit(&aes, sp80038a_key256, sizeof(sp80038a_key256), sp80038a_iv);
+    _pdfioCryptoAESEncrypt(&aes, bigbuffer, bigbuffer, 4096);
+    _pdfioCryptoAESInit(&aes, sp80038a_key256, sizeof(sp80038a_key256), sp80038a_iv);
+    _pdfioCryptoAESDecrypt(&aes, bigbuffer, bigbuffer, 272);
+    _pdfioCryptoAESDecrypt(&aes, bigbuffer + 272, bigbuffer + 272, 48);
+    _pdfioCryptoAESDecrypt(&aes, bigbuffer + 320, bigbuffer + 320, 4096 - 320);
+
+    if (!memcmp(bigbuffer, bigbuffer + 8192, 4096))
+    {
+      puts("PASS");
+    }
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+  }
+
+  _pdfioCryptoAESSetAccel(_PDFIO_AES_ACCEL_VAES);
+
   fputs("_pdfioMD5Init/Append/Finish: ", stdout);
   _pdfioCryptoMD5Init(&md5);
   _pdfioCryptoMD5Append(&md5, (uint8_t *)text, strlen(text));
@@ -367,6 +737,46 @@ do_crypto_tests(void)
     ret = 1;
   }
 
+  // Run known-answer tests with and without SHA-NI...
+  for (shani = 0; shani < 2; shani ++)
+  {
+    if (_pdfioCryptoSHA256SetAccel(shani != 0) != (shani != 0))
+      break;
+
+    printf("_pdfioSHA256Init/Append/Finish(\"abc\", %s): ", shani ? "SHA-NI" : "portable");
+    _pdfioCryptoSHA256Init(&sha256);
+    _pdfioCryptoSHA256Append(&sha256, (uint8_t *)"abc", 3);
+    _pdfioCryptoSHA256Finish(&sha256, buffer);
+
+    if (!memcmp(sha256abc, buffer, sizeof(sha256abc)))
+      puts("PASS");
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+
+    // Hash one million "a"s in odd sizes to test the partial blocks...
+    printf("_pdfioSHA256Init/Append/Finish(1000000 \"a\", %s): ", shani ? "SHA-NI" : "portable");
+    memset(bigbuffer, 'a', 1000000);
+    _pdfioCryptoSHA256Init(&sha256);
+    for (i = 0; i < 1000000; i += 997)
+      _pdfioCryptoSHA256Append(&sha256, bigbuffer, i + 997 > 1000000 ? 1000000 - i : 997);
+    _pdfioCryptoSHA256Finish(&sha256, buffer);
+
+    if (!memcmp(sha256million, buffer, sizeof(sha256million)))
+      puts("PASS");
+    else
+    {
+      puts("FAIL");
+      ret = 1;
+    }
+  }
+
+  free(bigbuffer);
+
+  _pdfioCryptoSHA256SetAccel(true);
+
   return (ret);
 }
 
@@ -1066,6 +1476,45 @@ do_unit_tests(void)
   if (read_unit_file("testpdfio-out.pdf", num_pages, first_image, false))
     goto fail;
 
+  // Append an incremental update to the new PDF file...
+  if (update_unit_file("testpdfio-out.pdf", &num_pages))
+    goto fail;
+
+  if (read_unit_file("testpdfio-out.pdf", num_pages, first_image, false))
+    goto fail;
+
+  // Write a linearized copy of the new PDF file...
+  if (linearize_unit_file("testpdfio-out.pdf", "testpdfio-lin.pdf", num_pages))
+    goto fail;
+
+  // Repair a copy of the new PDF file with a bad startxref offset...
+  if (repair_unit_file("testpdfio-out.pdf", "testpdfio-repair.pdf"))
+    goto fail;
+
+  // Read pages from a nested page tree...
+  if (tree_unit_file("testpdfio-tree.pdf"))
+    goto fail;
+
+  // Merge two copies of the new PDF file with deduplication...
+  if (dedup_unit_file("testpdfio-out.pdf", "testpdfio-dedup.pdf"))
+    goto fail;
+
+  // Merge pages from a few PDF files...
+  if (merge_unit_file("testpdfio-src.pdf", "testpdfio-merge.pdf", 4, 5))
+    goto fail;
+
+  // Embed the same font in two PDF files using the font cache...
+  if (font_cache_unit_file("testpdfio-fonts.pdf"))
+    goto fail;
+
+  // Embed font subsets...
+  if (subset_unit_file("testpdfio-subset.pdf"))
+    goto fail;
+
+  // Lay out paragraphs of text...
+  if (text_unit_file("testpdfio-text.pdf"))
+    goto fail;
+
   // Stream a new PDF file...
   if ((outfd = open("testpdfio-out2.pdf", O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0666)) < 0)
   {
@@ -1161,6 +1610,12 @@ do_unit_tests(void)
   if (read_unit_file("testpdfio-aesp.pdf", num_pages, first_image, false))
     return (1);
 
+  if (update_unit_file("testpdfio-aesp.pdf", &num_pages))
+    return (1);
+
+  if (read_unit_file("testpdfio-aesp.pdf", num_pages, first_image, false))
+    return (1);
+
   fputs("pdfioFileCreateTemporary: ", stdout);
   if ((outpdf = pdfioFileCreateTemporary(temppdf, sizeof(temppdf), NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
     printf("PASS (%s)\n", temppdf);
@@ -1266,42 +1721,498 @@ error_cb(pdfio_file_t *pdf,		// I  - PDF file
 
 
 //
-// 'iterate_cb()' - Test pdfioDictIterateKeys function.
+// 'font_cache_unit_file()' - Verify that a cached font is reused.
+//
+// The font file is replaced with zeroes (keeping the same size and
+// modification time) after it is first embedded, so the second PDF file can
+// only embed the font if the cached copy is used.
 //
 
-static bool				// O - `true` to continue, `false` to stop
-iterate_cb(pdfio_dict_t *dict,		// I - Dictionary
-           const char   *key,		// I - Key
-           void         *cb_data)	// I - Callback data
+static int				// O - Exit status
+font_cache_unit_file(
+    const char *outname)		// I - File to create
 {
-  int	*count = (int *)cb_data;	// Pointer to counter
+  const char	*fontname = "testpdfio-font.ttf";
+					// Copy of font file
+  int		fd;			// File descriptor
+  struct stat	fileinfo;		// Font file information
+  struct utimbuf times;			// Font file times
+  unsigned char	*data = NULL;		// Font file data
+  pdfio_file_t	*outpdf;		// Output PDF file
+  pdfio_obj_t	*font;			// Font object
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_stream_t *st;			// Page stream
+  int		i;			// Looping var
+  bool		error = false;		// Error callback data
 
 
-  if (!dict || !key || !cb_data)
-    return (false);
+  // Make a copy of the font file...
+  fputs("Copy \"testfiles/OpenSans-Regular.ttf\": ", stdout);
+  if ((fd = open("testfiles/OpenSans-Regular.ttf", O_RDONLY | O_BINARY)) < 0 || fstat(fd, &fileinfo) || (data = (unsigned char *)malloc((size_t)fileinfo.st_size)) == NULL || read(fd, data, (size_t)fileinfo.st_size) != (ssize_t)fileinfo.st_size)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
 
-  (*count)++;
+    if (fd >= 0)
+      close(fd);
 
-  return (true);
-}
+    goto fail;
+  }
 
+  close(fd);
 
-//
-// 'output_cb()' - Write output to a file.
-//
+  if ((fd = open(fontname, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0666)) < 0 || write(fd, data, (size_t)fileinfo.st_size) != (ssize_t)fileinfo.st_size || close(fd) || stat(fontname, &fileinfo))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    goto fail;
+  }
 
-static ssize_t				// O - Number of bytes written
-output_cb(int        *fd,		// I - File descriptor
-          const void *buffer,		// I - Output buffer
-          size_t     bytes)		// I - Number of bytes to write
-{
-  return (write(*fd, buffer, bytes));
-}
+  puts("PASS");
 
+  for (i = 0; i < 2; i ++)
+  {
+    printf("pdfioFileCreateFontObjFromFile(\"%s\", %s): ", fontname, i ? "cached" : "uncached");
 
-//
-// 'password_cb()' - Password callback for PDF file.
-//
+    if ((outpdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+      goto fail;
+
+    if ((font = pdfioFileCreateFontObjFromFile(outpdf, fontname, false)) == NULL)
+    {
+      pdfioFileClose(outpdf);
+      goto fail;
+    }
+
+    dict = pdfioDictCreate(outpdf);
+    pdfioPageDictAddFont(dict, "F1", font);
+
+    if ((st = pdfioFileCreatePage(outpdf, dict)) == NULL)
+    {
+      pdfioFileClose(outpdf);
+      goto fail;
+    }
+
+    pdfioContentTextBegin(st);
+    pdfioContentSetTextFont(st, "F1", 24.0);
+    pdfioContentTextMoveTo(st, 72.0, 720.0);
+    pdfioContentTextShowf(st, false, "Document %d", i + 1);
+    pdfioContentTextEnd(st);
+    pdfioStreamClose(st);
+
+    if (!pdfioFileClose(outpdf))
+      goto fail;
+
+    puts("PASS");
+
+    if (i == 0)
+    {
+      // Zero the font file without changing its size or modification time...
+      memset(data, 0, (size_t)fileinfo.st_size);
+
+      times.actime  = fileinfo.st_atime;
+      times.modtime = fileinfo.st_mtime;
+
+      if ((fd = open(fontname, O_WRONLY | O_BINARY)) < 0 || write(fd, data, (size_t)fileinfo.st_size) != (ssize_t)fileinfo.st_size || close(fd) || utime(fontname, &times))
+      {
+        printf("Zero \"%s\": FAIL (%s)\n", fontname, strerror(errno));
+        goto fail;
+      }
+    }
+  }
+
+  free(data);
+  unlink(fontname);
+
+  return (0);
+
+  fail:
+
+  free(data);
+  unlink(fontname);
+
+  return (1);
+}
+
+
+//
+// 'font_unit_file()' - Benchmark embedding the same fonts in many PDF files.
+//
+
+static int				// O - Exit status
+font_unit_file(const char *outname)	// I - File to create
+{
+  pdfio_file_t	*outpdf;		// Output PDF file
+  pdfio_obj_t	*latin,			// CP1252 font object
+		*cjk;			// Unicode font object
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_stream_t *st;			// Page stream
+  int		i;			// Looping var
+  clock_t	start;			// Start time for benchmark
+  double	secs;			// Benchmark time in seconds
+  bool		error = false;		// Error callback data
+
+
+  printf("pdfioFileCreateFontObjFromFile(50 files): ");
+  fflush(stdout);
+
+  start = clock();
+
+  for (i = 0; i < 50; i ++)
+  {
+    if ((outpdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+      return (1);
+
+    if ((latin = pdfioFileCreateFontObjFromFile(outpdf, "testfiles/OpenSans-Regular.ttf", false)) == NULL || (cjk = pdfioFileCreateFontObjFromFile(outpdf, "testfiles/NotoSansJP-Regular.otf", true)) == NULL)
+    {
+      pdfioFileClose(outpdf);
+      return (1);
+    }
+
+    dict = pdfioDictCreate(outpdf);
+    pdfioPageDictAddFont(dict, "F1", latin);
+    pdfioPageDictAddFont(dict, "F2", cjk);
+
+    if ((st = pdfioFileCreatePage(outpdf, dict)) == NULL)
+    {
+      pdfioFileClose(outpdf);
+      return (1);
+    }
+
+    pdfioContentTextBegin(st);
+    pdfioContentSetTextFont(st, "F1", 24.0);
+    pdfioContentTextMoveTo(st, 72.0, 720.0);
+    pdfioContentTextShowf(st, false, "Document %d", i + 1);
+    pdfioContentSetTextFont(st, "F2", 24.0);
+    pdfioContentTextMoveTo(st, 0.0, -36.0);
+    pdfioContentTextShow(st, true, "\xE3\x81\x93\xE3\x82\x93\xE3\x81\xAB\xE3\x81\xA1\xE3\x81\xAF");
+    pdfioContentTextEnd(st);
+    pdfioStreamClose(st);
+
+    if (!pdfioFileClose(outpdf))
+      return (1);
+  }
+
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("PASS (%.3f seconds, %.1f files/second)\n", secs, 50.0 / secs);
+
+  return (0);
+}
+
+
+//
+// 'iterate_cb()' - Test pdfioDictIterateKeys function.
+//
+
+static bool				// O - `true` to continue, `false` to stop
+iterate_cb(pdfio_dict_t *dict,		// I - Dictionary
+           const char   *key,		// I - Key
+           void         *cb_data)	// I - Callback data
+{
+  int	*count = (int *)cb_data;	// Pointer to counter
+
+
+  if (!dict || !key || !cb_data)
+    return (false);
+
+  (*count)++;
+
+  return (true);
+}
+
+
+//
+// 'linearize_unit_file()' - Write and verify a linearized copy of a unit test
+//                           file.
+//
+
+static int				// O - 1 on failure, 0 on success
+linearize_unit_file(
+    const char *filename,		// I - File to linearize
+    const char *outname,		// I - Linearized file
+    size_t     num_pages)		// I - Expected number of pages
+{
+  pdfio_file_t	*inpdf,			// Input PDF file
+		*outpdf = NULL;		// Linearized PDF file
+  pdfio_stream_t *inst,			// Input page stream
+		*outst;			// Linearized page stream
+  size_t	i;			// Looping var
+  int		fd;			// File descriptor
+  ssize_t	bytes;			// Bytes read
+  off_t		length;			// Length of linearized file
+  const char	*s;			// String
+  char		buffer[1024],		// Read buffer
+		outbuffer[1024];	// Read buffer for linearized file
+  bool		error = false;		// Error callback data
+
+
+  // Linearize the file...
+  printf("pdfioFileOpen(\"%s\", ...): ", filename);
+  if ((inpdf = pdfioFileOpen(filename, password_cb, (void *)"user", (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  printf("pdfioFileLinearize(\"%s\"): ", outname);
+  if (pdfioFileLinearize(inpdf, outname))
+    puts("PASS");
+  else
+    goto fail;
+
+  // Check the linearization dictionary at the start of the file...
+  if ((fd = open(outname, O_RDONLY | O_BINARY)) < 0)
+  {
+    perror(outname);
+    goto fail;
+  }
+
+  bytes  = read(fd, buffer, sizeof(buffer) - 1);
+  length = lseek(fd, 0, SEEK_END);
+  close(fd);
+
+  fputs("Linearization dictionary: ", stdout);
+  if (bytes > 0)
+    buffer[bytes] = '\0';
+  else
+    buffer[0] = '\0';
+
+  if ((s = strstr(buffer, "/Linearized 1/L ")) != NULL && strtol(s + 16, NULL, 10) == (long)length)
+  {
+    printf("PASS (%ld bytes)\n", (long)length);
+  }
+  else
+  {
+    puts("FAIL");
+    goto fail;
+  }
+
+  // Verify the pages...
+  printf("pdfioFileOpen(\"%s\", ...): ", outname);
+  if ((outpdf = pdfioFileOpen(outname, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    goto fail;
+
+  fputs("pdfioFileGetNumPages: ", stdout);
+  if (pdfioFileGetNumPages(outpdf) == num_pages)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%lu pages, expected %lu)\n", (unsigned long)pdfioFileGetNumPages(outpdf), (unsigned long)num_pages);
+    goto fail;
+  }
+
+  fputs("pdfioFileGetPage(0) from first page xref: ", stdout);
+  if (pdfioFileGetPage(outpdf, 0) && outpdf->lazy_xref)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    puts("FAIL");
+    goto fail;
+  }
+
+  fputs("pdfioDictGetName(PageLayout): ", stdout);
+  if ((s = pdfioDictGetName(pdfioFileGetCatalog(outpdf), "PageLayout")) != NULL && !strcmp(s, "SinglePage"))
+  {
+    puts("PASS");
+  }
+  else
+  {
+    puts("FAIL");
+    goto fail;
+  }
+
+  for (i = 0; i < num_pages; i ++)
+  {
+    printf("pdfioPageOpenStream(%lu): ", (unsigned long)i);
+
+    if ((inst = pdfioPageOpenStream(pdfioFileGetPage(inpdf, i), 0, true)) == NULL)
+    {
+      puts("FAIL (input)");
+      goto fail;
+    }
+
+    if ((outst = pdfioPageOpenStream(pdfioFileGetPage(outpdf, i), 0, true)) == NULL)
+    {
+      pdfioStreamClose(inst);
+      puts("FAIL (output)");
+      goto fail;
+    }
+
+    bytes = pdfioStreamRead(inst, buffer, sizeof(buffer));
+
+    if (pdfioStreamRead(outst, outbuffer, sizeof(outbuffer)) != bytes || (bytes > 0 && memcmp(buffer, outbuffer, (size_t)bytes)))
+    {
+      pdfioStreamClose(inst);
+      pdfioStreamClose(outst);
+      puts("FAIL (content differs)");
+      goto fail;
+    }
+
+    pdfioStreamClose(inst);
+    pdfioStreamClose(outst);
+
+    puts("PASS");
+  }
+
+  pdfioFileClose(inpdf);
+  pdfioFileClose(outpdf);
+
+  return (0);
+
+  fail:
+
+  pdfioFileClose(inpdf);
+  pdfioFileClose(outpdf);
+
+  return (1);
+}
+
+
+//
+// 'merge_unit_file()' - Merge the pages from many PDF files.
+//
+
+static int				// O - Exit status
+merge_unit_file(const char *srcname,	// I - Source file to create
+                const char *outname,	// I - Merged file to create
+                size_t     num_files,	// I - Number of copies to merge (max 100)
+                size_t     num_pages)	// I - Number of pages in source file
+{
+  pdfio_file_t	*srcpdf,		// Source PDF file
+		*inpdfs[100],		// Input PDF files
+		*outpdf;		// Merged PDF file
+  pdfio_obj_t	*font;			// Font object
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_stream_t *st;			// Page stream
+  size_t	i,			// Looping var
+		j,			// Looping var
+		num_inpdfs = 0;		// Number of input PDF files
+  clock_t	start;			// Start time for benchmark
+  double	secs;			// Benchmark time in seconds
+  bool		error = false;		// Error callback data
+  int		ret = 1;		// Return value
+
+
+  // Create a source file with small pages...
+  printf("pdfioFileCreate(\"%s\", ...): ", srcname);
+  if ((srcpdf = pdfioFileCreate(srcname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+    return (1);
+
+  if ((font = pdfioFileCreateFontObjFromBase(srcpdf, "Helvetica")) == NULL)
+  {
+    pdfioFileClose(srcpdf);
+    return (1);
+  }
+
+  for (i = 0; i < num_pages; i ++)
+  {
+    dict = pdfioDictCreate(srcpdf);
+    pdfioPageDictAddFont(dict, "F1", font);
+
+    if ((st = pdfioFileCreatePage(srcpdf, dict)) == NULL)
+      break;
+
+    pdfioStreamPrintf(st, "BT /F1 12 Tf 72 720 Td (Page %u) Tj ET\n", (unsigned)i + 1);
+    pdfioStreamClose(st);
+  }
+
+  if (!pdfioFileClose(srcpdf) || i < num_pages)
+    return (1);
+
+  puts("PASS");
+
+  // Open the source file many times so that each copy has its own object map
+  // entries...
+  if (num_files > (sizeof(inpdfs) / sizeof(inpdfs[0])))
+    num_files = sizeof(inpdfs) / sizeof(inpdfs[0]);
+
+  printf("pdfioFileOpen(\"%s\", ...) x %u: ", srcname, (unsigned)num_files);
+  for (num_inpdfs = 0; num_inpdfs < num_files; num_inpdfs ++)
+  {
+    if ((inpdfs[num_inpdfs] = pdfioFileOpen(srcname, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+      goto done;
+  }
+
+  puts("PASS");
+
+  printf("pdfioFileCreate(\"%s\", ...): ", outname);
+  if ((outpdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    goto done;
+
+  // Copy all of the pages...
+  printf("pdfioPageCopy(%u x %u pages): ", (unsigned)num_files, (unsigned)num_pages);
+  fflush(stdout);
+
+  start = clock();
+
+  for (i = 0; i < num_inpdfs; i ++)
+  {
+    for (j = 0; j < num_pages; j ++)
+    {
+      if (!pdfioPageCopy(outpdf, pdfioFileGetPage(inpdfs[i], j)))
+      {
+        printf("FAIL (file %u, page %u)\n", (unsigned)i + 1, (unsigned)j + 1);
+        pdfioFileClose(outpdf);
+        goto done;
+      }
+    }
+  }
+
+  if (!pdfioFileClose(outpdf))
+    goto done;
+
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("PASS (%.3f seconds, %.0f pages/second)\n", secs, (double)(num_files * num_pages) / secs);
+
+  // Make sure the merged file has all of the pages...
+  printf("pdfioFileOpen(\"%s\", ...): ", outname);
+  if ((outpdf = pdfioFileOpen(outname, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    goto done;
+
+  fputs("pdfioFileGetNumPages: ", stdout);
+  if (pdfioFileGetNumPages(outpdf) == (num_files * num_pages))
+  {
+    puts("PASS");
+    ret = 0;
+  }
+  else
+  {
+    printf("FAIL (%u pages, expected %u)\n", (unsigned)pdfioFileGetNumPages(outpdf), (unsigned)(num_files * num_pages));
+  }
+
+  pdfioFileClose(outpdf);
+
+  done:
+
+  for (i = 0; i < num_inpdfs; i ++)
+    pdfioFileClose(inpdfs[i]);
+
+  return (ret);
+}
+
+
+//
+// 'output_cb()' - Write output to a file.
+//
+
+static ssize_t				// O - Number of bytes written
+output_cb(int        *fd,		// I - File descriptor
+          const void *buffer,		// I - Output buffer
+          size_t     bytes)		// I - Number of bytes to write
+{
+  return (write(*fd, buffer, bytes));
+}
+
+
+//
+// 'password_cb()' - Password callback for PDF file.
+//
 
 static const char *			// O - Password string
 password_cb(void       *data,		// I - Callback data
@@ -1362,216 +2273,1380 @@ read_unit_file(const char *filename,	// I - File to read
   }
   else
   {
-    puts("FAIL (got NULL, expected 'SinglePage')");
+    puts("FAIL (got NULL, expected 'SinglePage')");
+    return (1);
+  }
+
+  fputs("pdfioDictGetName(PageLayout): ", stdout);
+  if ((s = pdfioDictGetName(catalog, "PageLayout")) != NULL && !strcmp(s, "SinglePage"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'SinglePage')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'SinglePage')");
+    return (1);
+  }
+
+  fputs("pdfioDictGetName(PageMode): ", stdout);
+  if ((s = pdfioDictGetName(catalog, "PageMode")) != NULL && !strcmp(s, "UseThumbs"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'UseThumbs')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'UseThumbs')");
+    return (1);
+  }
+
+  fputs("pdfioDictGetString(Lang): ", stdout);
+  if ((s = pdfioDictGetString(catalog, "Lang")) != NULL && !strcmp(s, "en"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'en')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'en')");
+    return (1);
+  }
+
+  // Verify metadata...
+  fputs("pdfioFileGetAuthor: ", stdout);
+  if ((s = pdfioFileGetAuthor(pdf)) != NULL && !strcmp(s, "Michael R Sweet"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'Michael R Sweet')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'Michael R Sweet')");
+    return (1);
+  }
+
+  fputs("pdfioFileGetCreator: ", stdout);
+  if ((s = pdfioFileGetCreator(pdf)) != NULL && !strcmp(s, "testpdfio"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'testpdfio')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'testpdfio')");
+    return (1);
+  }
+
+  fputs("pdfioFileGetKeywords: ", stdout);
+  if ((s = pdfioFileGetKeywords(pdf)) != NULL && !strcmp(s, "one fish,two fish,red fish,blue fish"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'one fish,two fish,red fish,blue fish')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'one fish,two fish,red fish,blue fish')");
+    return (1);
+  }
+
+  fputs("pdfioFileGetSubject: ", stdout);
+  if ((s = pdfioFileGetSubject(pdf)) != NULL && !strcmp(s, "Unit test document"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'Unit test document')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'Unit test document')");
+    return (1);
+  }
+
+  fputs("pdfioFileGetTitle: ", stdout);
+  if ((s = pdfioFileGetTitle(pdf)) != NULL && !strcmp(s, "Test Document"))
+  {
+    puts("PASS");
+  }
+  else if (s)
+  {
+    printf("FAIL (got '%s', expected 'Test Document')\n", s);
+    return (1);
+  }
+  else
+  {
+    puts("FAIL (got NULL, expected 'Test Document')");
+    return (1);
+  }
+
+  // Verify the number of pages is the same...
+  fputs("pdfioFileGetNumPages: ", stdout);
+  if (num_pages == pdfioFileGetNumPages(pdf))
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%lu != %lu)\n", (unsigned long)num_pages, (unsigned long)pdfioFileGetNumPages(pdf));
+    return (1);
+  }
+
+  // Verify the images
+  for (i = 0; i < 7; i ++)
+  {
+    if (is_output)
+    {
+      if (verify_image(pdf, first_image + (size_t)i * 2))
+        return (1);
+    }
+    else if (verify_image(pdf, first_image + (size_t)i))
+      return (1);
+  }
+
+  // Close the new PDF file...
+  fputs("pdfioFileClose(\"testpdfio-out.pdf\"): ", stdout);
+  if (pdfioFileClose(pdf))
+    puts("PASS");
+  else
+    return (1);
+
+  return (0);
+}
+
+
+//
+// 'repair_cb()' - Count error messages and continue.
+//
+
+static bool				// O  - `true` to continue
+repair_cb(pdfio_file_t *pdf,		// I  - PDF file
+          const char   *message,	// I  - Error message
+          size_t       *count)		// IO - Number of messages
+{
+  (void)pdf;
+  (void)message;
+
+  (*count) ++;
+
+  return (true);
+}
+
+
+//
+// 'repair_unit_file()' - Damage a copy of a unit test file and repair it.
+//
+
+static int				// O - 1 on failure, 0 on success
+repair_unit_file(const char *filename,	// I - File to damage
+                 const char *outname)	// I - Damaged file
+{
+  FILE		*fp;			// File
+  pdfio_file_t	*inpdf,			// Original PDF file
+		*outpdf = NULL;		// Repaired PDF file
+  pdfio_obj_t	*inobj,			// Original object
+		*outobj;		// Repaired object
+  size_t	i,			// Looping var
+		count = 0;		// Number of error messages
+  long		length;			// Length of file
+  char		*data = NULL,		// File data
+		*ptr;			// Pointer into data
+  bool		error = false;		// Error callback data
+
+
+  // Make a copy of the file with a bad startxref offset...
+  printf("Damaging \"%s\": ", filename);
+  if ((fp = fopen(filename, "rb")) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  if (fseek(fp, 0, SEEK_END) || (length = ftell(fp)) < 10 || (data = malloc((size_t)length + 1)) == NULL || fseek(fp, 0, SEEK_SET) || fread(data, 1, (size_t)length, fp) != (size_t)length)
+  {
+    puts("FAIL (unable to read file)");
+    fclose(fp);
+    free(data);
+    return (1);
+  }
+
+  fclose(fp);
+
+  for (ptr = data + length - 9; ptr > data; ptr --)
+  {
+    if (!memcmp(ptr, "startxref", 9))
+      break;
+  }
+
+  if (ptr == data)
+  {
+    puts("FAIL (no startxref)");
+    free(data);
+    return (1);
+  }
+
+  if ((fp = fopen(outname, "wb")) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    free(data);
+    return (1);
+  }
+
+  fwrite(data, 1, (size_t)(ptr - data), fp);
+  fputs("startxref\n0\n%%EOF\n", fp);
+  fclose(fp);
+  free(data);
+
+  puts("PASS");
+
+  // Open the original and damaged files...
+  printf("pdfioFileOpen(\"%s\", ...): ", filename);
+  if ((inpdf = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  printf("pdfioFileOpen(\"%s\", ...): ", outname);
+  if ((outpdf = pdfioFileOpen(outname, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)repair_cb, &count)) != NULL && count > 0)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%s)\n", outpdf ? "no errors reported" : "unable to repair");
+    goto fail;
+  }
+
+  // Compare the objects and pages...
+  fputs("pdfioFileGetNumObjs: ", stdout);
+  if (pdfioFileGetNumObjs(outpdf) == pdfioFileGetNumObjs(inpdf))
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%u objects, expected %u)\n", (unsigned)pdfioFileGetNumObjs(outpdf), (unsigned)pdfioFileGetNumObjs(inpdf));
+    goto fail;
+  }
+
+  fputs("pdfioFileGetCatalog: ", stdout);
+  if (pdfioObjGetNumber(outpdf->root_obj) == pdfioObjGetNumber(inpdf->root_obj))
+  {
+    puts("PASS");
+  }
+  else
+  {
+    puts("FAIL (wrong catalog object)");
+    goto fail;
+  }
+
+  fputs("pdfioFileGetNumPages: ", stdout);
+  if (pdfioFileGetNumPages(outpdf) == pdfioFileGetNumPages(inpdf))
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%u pages, expected %u)\n", (unsigned)pdfioFileGetNumPages(outpdf), (unsigned)pdfioFileGetNumPages(inpdf));
+    goto fail;
+  }
+
+  fputs("pdfioFileGetPage: ", stdout);
+  for (i = 0; i < pdfioFileGetNumPages(inpdf); i ++)
+  {
+    inobj  = pdfioFileGetPage(inpdf, i);
+    outobj = pdfioFileGetPage(outpdf, i);
+
+    if (!inobj || !outobj || pdfioObjGetNumber(inobj) != pdfioObjGetNumber(outobj) || pdfioObjGetNumber(pdfioDictGetObj(pdfioObjGetDict(inobj), "Contents")) != pdfioObjGetNumber(pdfioDictGetObj(pdfioObjGetDict(outobj), "Contents")))
+      break;
+  }
+
+  if (i >= pdfioFileGetNumPages(inpdf))
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (page %u differs)\n", (unsigned)i + 1);
+    goto fail;
+  }
+
+  pdfioFileClose(inpdf);
+  pdfioFileClose(outpdf);
+
+  return (0);
+
+  fail:
+
+  pdfioFileClose(inpdf);
+  pdfioFileClose(outpdf);
+
+  return (1);
+}
+
+
+//
+// 'subset_unit_file()' - Write and check font subsets.
+//
+
+static int				// O - 1 on failure, 0 on success
+subset_unit_file(const char *outname)	// I - File to create
+{
+  int		i,			// Looping var
+		ret = 1;		// Return value
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*font,			// TrueType font object
+		*cff,			// CFF font object
+		*cjk,			// Unicode CFF font object
+		*obj;			// Font file object
+  pdfio_dict_t	*dict;			// Page/font dictionary
+  pdfio_stream_t *st;			// Page/font stream
+  unsigned char	*data[2] = { NULL, NULL };
+					// Font file data
+  size_t	datasize[2] = { 0, 0 };	// Size of font file data
+  ssize_t	bytes;			// Bytes read
+  const char	*basefont;		// BaseFont name
+  const char	*ptr;			// Pointer into string
+  FILE		*fp;			// Subset font file
+  ttf_t		*full,			// Full font
+		*subfont;		// Subset font
+  bool		error = false;		// Error callback data
+  static const char *text = "Hello, World!";
+					// Text to show
+
+
+  for (i = 0; i < 2; i ++)
+  {
+    // Write a page with and without subsetting...
+    printf("pdfioFileCreate(\"%s\", ...): ", outname);
+    if ((pdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+      puts("PASS");
+    else
+      goto done;
+
+    printf("pdfioFileSetSubsetFonts(%s): ", i ? "true" : "false");
+    pdfioFileSetSubsetFonts(pdf, i != 0);
+    puts("PASS");
+
+    if ((font = pdfioFileCreateFontObjFromFile(pdf, "testfiles/OpenSans-Regular.ttf", false)) == NULL || (cff = pdfioFileCreateFontObjFromFile(pdf, "testfiles/NotoSansJP-Regular.otf", false)) == NULL || (cjk = pdfioFileCreateFontObjFromFile(pdf, "testfiles/NotoSansJP-Regular.otf", true)) == NULL)
+    {
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    dict = pdfioDictCreate(pdf);
+    pdfioPageDictAddFont(dict, "F1", font);
+    pdfioPageDictAddFont(dict, "F2", cff);
+    pdfioPageDictAddFont(dict, "F3", cjk);
+
+    if ((st = pdfioFileCreatePage(pdf, dict)) == NULL)
+    {
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    pdfioContentTextBegin(st);
+    pdfioContentSetTextFont(st, "F1", 24.0);
+    pdfioContentTextMoveTo(st, 72.0, 720.0);
+    pdfioContentTextShow(st, false, text);
+    pdfioContentSetTextFont(st, "F2", 24.0);
+    pdfioContentTextMoveTo(st, 0.0, -36.0);
+    pdfioContentTextShow(st, false, text);
+    pdfioContentSetTextFont(st, "F3", 24.0);
+    pdfioContentTextMoveTo(st, 0.0, -36.0);
+    pdfioContentTextShow(st, true, "\xE3\x81\x93\xE3\x82\x93\xE3\x81\xAB\xE3\x81\xA1\xE3\x81\xAF");
+    pdfioContentTextEnd(st);
+    pdfioStreamClose(st);
+
+    if (!pdfioFileClose(pdf))
+      goto done;
+
+    // Read back the embedded fonts...
+    printf("pdfioFileOpen(\"%s\", ...): ", outname);
+    if ((pdf = pdfioFileOpen(outname, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+      puts("PASS");
+    else
+      goto done;
+
+    dict = pdfioDictGetDict(pdfioDictGetDict(pdfioObjGetDict(pdfioFileGetPage(pdf, 0)), "Resources"), "Font");
+
+    fputs("BaseFont(F1): ", stdout);
+    basefont = pdfioDictGetName(pdfioObjGetDict(pdfioDictGetObj(dict, "F1")), "BaseFont");
+    ptr      = basefont ? strchr(basefont, '+') : NULL;
+
+    if (!basefont || (i && ptr != basefont + 6) || (!i && ptr))
+    {
+      printf("FAIL (got \"%s\")\n", basefont ? basefont : "(null)");
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    printf("PASS (%s)\n", basefont);
+
+    // Simple CFF fonts are always embedded whole, without a subset tag...
+    fputs("BaseFont(F2): ", stdout);
+    basefont = pdfioDictGetName(pdfioObjGetDict(pdfioDictGetObj(dict, "F2")), "BaseFont");
+
+    if (!basefont || strchr(basefont, '+'))
+    {
+      printf("FAIL (got \"%s\")\n", basefont ? basefont : "(null)");
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    printf("PASS (%s)\n", basefont);
+
+    // Unicode CFF fonts are subset...
+    fputs("BaseFont(F3): ", stdout);
+    basefont = pdfioDictGetName(pdfioObjGetDict(pdfioDictGetObj(dict, "F3")), "BaseFont");
+    ptr      = basefont ? strchr(basefont, '+') : NULL;
+
+    if (!basefont || (i && ptr != basefont + 6) || (!i && ptr))
+    {
+      printf("FAIL (got \"%s\")\n", basefont ? basefont : "(null)");
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    printf("PASS (%s)\n", basefont);
+
+    fputs("FontFile2: ", stdout);
+    obj = pdfioDictGetObj(pdfioObjGetDict(pdfioDictGetObj(pdfioObjGetDict(pdfioDictGetObj(dict, "F1")), "FontDescriptor")), "FontFile2");
+
+    if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+    {
+      puts("FAIL (no font file)");
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    if ((data[i] = (unsigned char *)malloc(1024 * 1024)) == NULL)
+    {
+      puts("FAIL (out of memory)");
+      pdfioStreamClose(st);
+      pdfioFileClose(pdf);
+      goto done;
+    }
+
+    while (datasize[i] < (1024 * 1024) && (bytes = pdfioStreamRead(st, data[i] + datasize[i], 1024 * 1024 - datasize[i])) > 0)
+      datasize[i] += (size_t)bytes;
+
+    pdfioStreamClose(st);
+    pdfioFileClose(pdf);
+
+    printf("PASS (%u bytes)\n", (unsigned)datasize[i]);
+  }
+
+  // The subset must be smaller and still contain the glyphs that were used...
+  fputs("FontFile2(subset): ", stdout);
+  if (datasize[1] == 0 || datasize[1] >= datasize[0])
+  {
+    printf("FAIL (%u bytes, expected less than %u)\n", (unsigned)datasize[1], (unsigned)datasize[0]);
+    goto done;
+  }
+
+  if ((fp = fopen("testpdfio-subset.ttf", "wb")) == NULL || fwrite(data[1], 1, datasize[1], fp) != datasize[1] || fclose(fp) || (subfont = ttfCreate("testpdfio-subset.ttf", 0, NULL, NULL)) == NULL)
+  {
+    puts("FAIL (unable to load subset font)");
+    goto done;
+  }
+
+  if ((full = ttfCreate("testfiles/OpenSans-Regular.ttf", 0, NULL, NULL)) == NULL)
+  {
+    puts("FAIL (unable to load font)");
+    ttfDelete(subfont);
+    goto done;
+  }
+
+  for (ptr = text; *ptr; ptr ++)
+  {
+    if (ttfGetGlyph(subfont, *ptr) != ttfGetGlyph(full, *ptr) || ttfGetWidth(subfont, *ptr) != ttfGetWidth(full, *ptr))
+      break;
+  }
+
+  if (*ptr)
+    printf("FAIL (glyph for '%c' missing)\n", *ptr);
+  else if (ttfGetGlyph(subfont, 'Q') > 0)
+    puts("FAIL (unused glyph for 'Q' present)");
+  else
+    puts("PASS");
+
+  ret = *ptr || ttfGetGlyph(subfont, 'Q') > 0;
+
+  ttfDelete(full);
+  ttfDelete(subfont);
+  remove("testpdfio-subset.ttf");
+
+  done:
+
+  free(data[0]);
+  free(data[1]);
+
+  return (ret);
+}
+
+
+//
+// 'text_bench_file()' - Benchmark writing and laying out text strings.
+//
+
+static int				// O - Exit status
+text_bench_file(const char *outname)	// I - File to create
+{
+  pdfio_file_t	*outpdf;		// Output PDF file
+  pdfio_obj_t	*latin,			// CP1252 font object
+		*cjk;			// Unicode font object
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_stream_t *st;			// Page stream
+  int		i,			// Looping var
+		line;			// Current line
+  clock_t	start;			// Start time for benchmark
+  double	secs;			// Benchmark time in seconds
+  bool		error = false;		// Error callback data
+  char		*paragraph,		// Paragraph text
+		*bufptr;		// Pointer into paragraph buffer
+  const char	*textptr;		// Pointer into paragraph text
+  size_t	num_lines,		// Number of lines shown on page
+		total_lines;		// Total number of lines shown
+  static const char * const latin_text = "The quick brown fox jumps over the lazy dog \xE2\x80\x93 \xE2\x80\x9C(escaped)\xE2\x80\x9D text\\caf\xC3\xA9\xE2\x80\xA6";
+					// CP1252 text with escaped and mapped characters
+  static const char * const cjk_text = "\xE3\x81\x84\xE3\x82\x89\xE3\x81\xA3\xE3\x81\x97\xE3\x82\x83\xE3\x81\x84\xE3\x81\xBE\xE3\x81\x9B The quick brown fox \xE4\xB8\x96\xE7\x95\x8C";
+					// Unicode text
+
+
+  printf("pdfioContentTextShow(100 pages x 100 lines): ");
+  fflush(stdout);
+
+  if ((outpdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+    return (1);
+
+  if ((latin = pdfioFileCreateFontObjFromFile(outpdf, "testfiles/OpenSans-Regular.ttf", false)) == NULL || (cjk = pdfioFileCreateFontObjFromFile(outpdf, "testfiles/NotoSansJP-Regular.otf", true)) == NULL)
+  {
+    pdfioFileClose(outpdf);
+    return (1);
+  }
+
+  start = clock();
+
+  for (i = 0; i < 100; i ++)
+  {
+    dict = pdfioDictCreate(outpdf);
+    pdfioPageDictAddFont(dict, "F1", latin);
+    pdfioPageDictAddFont(dict, "F2", cjk);
+
+    if ((st = pdfioFileCreatePage(outpdf, dict)) == NULL)
+    {
+      pdfioFileClose(outpdf);
+      return (1);
+    }
+
+    pdfioContentTextBegin(st);
+    pdfioContentSetTextLeading(st, 7.0);
+    pdfioContentTextMoveTo(st, 36.0, 756.0);
+
+    for (line = 0; line < 100; line ++)
+    {
+      if (line & 1)
+      {
+	pdfioContentSetTextFont(st, "F2", 6.0);
+	if (!pdfioContentTextShow(st, true, cjk_text))
+	  break;
+      }
+      else
+      {
+	pdfioContentSetTextFont(st, "F1", 6.0);
+	if (!pdfioContentTextShow(st, false, latin_text))
+	  break;
+      }
+
+      pdfioContentTextNewLine(st);
+    }
+
+    pdfioContentTextEnd(st);
+    pdfioStreamClose(st);
+
+    if (line < 100)
+    {
+      pdfioFileClose(outpdf);
+      puts("FAIL");
+      return (1);
+    }
+  }
+
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  printf("PASS (%.3f seconds, %.0f strings/second)\n", secs, 10000.0 / secs);
+
+  // Lay out a long paragraph over multiple pages...
+  fputs("pdfioContentTextShowParagraph(2000 sentences): ", stdout);
+  fflush(stdout);
+
+  if ((paragraph = malloc(2000 * (strlen(latin_text) + 1) + 1)) == NULL)
+  {
+    pdfioFileClose(outpdf);
+    puts("FAIL (out of memory)");
+    return (1);
+  }
+
+  for (i = 0, bufptr = paragraph; i < 2000; i ++)
+  {
+    memcpy(bufptr, latin_text, strlen(latin_text));
+    bufptr += strlen(latin_text);
+    *bufptr++ = ' ';
+  }
+
+  *bufptr = '\0';
+  textptr = paragraph;
+  start    = clock();
+
+  for (i = 0, total_lines = 0; *textptr && i < 1000; i ++)
+  {
+    dict = pdfioDictCreate(outpdf);
+    pdfioPageDictAddFont(dict, "F1", latin);
+
+    if ((st = pdfioFileCreatePage(outpdf, dict)) == NULL)
+      break;
+
+    pdfioContentTextBegin(st);
+    pdfioContentSetTextFont(st, "F1", 6.0);
+    pdfioContentSetTextLeading(st, 7.0);
+    pdfioContentTextMoveTo(st, 36.0, 756.0);
+
+    if (!pdfioContentTextShowParagraph(st, false, 540.0, (pdfio_textalign_t)(i & 3), 100, &textptr, &num_lines) || num_lines == 0)
+      break;
+
+    total_lines += num_lines;
+
+    pdfioContentTextEnd(st);
+    pdfioStreamClose(st);
+  }
+
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  if (*textptr)
+  {
+    free(paragraph);
+    pdfioFileClose(outpdf);
+    printf("FAIL (%d pages, %lu lines)\n", i, (unsigned long)total_lines);
+    return (1);
+  }
+
+  free(paragraph);
+
+  printf("PASS (%d pages, %lu lines, %.3f seconds)\n", i, (unsigned long)total_lines, secs);
+
+  if (!pdfioFileClose(outpdf))
+    return (1);
+
+  return (0);
+}
+
+
+//
+// 'text_unit_file()' - Test laying out paragraphs of text.
+//
+// Each alignment is written to its own page, and the page streams are then
+// read back and compared against greedy line breaking done with
+// @link pdfioContentTextMeasure@.
+//
+
+static int				// O - Exit status
+text_unit_file(const char *outname)	// I - File to create
+{
+  int		ret = 1;		// Return value
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*latin,			// CP1252 font object
+		*page;			// Page object
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_stream_t *st;			// Page stream
+  pdfio_textalign_t align;		// Current alignment
+  size_t	i,			// Looping var
+		num_lines,		// Number of lines shown
+		num_expected,		// Number of expected lines
+		num_extra,		// Number of TJ adjustments in line
+		num_words;		// Number of words in line
+  const char	*textptr,		// Pointer into paragraph text
+		*line,			// Start of current line
+		*end;			// End of current word
+  char		expected[20][256],	// Expected lines
+		candidate[256],		// Line with next word
+		token[1024],		// Token from page stream
+		text[256];		// Text shown on current line
+  bool		hard[20],		// Does the expected line end the paragraph or with a newline?
+		in_array = false;	// In a TJ array?
+  double	measured,		// Measured width of line
+		offset,			// Offset or extra space from TJ array
+		extra[20],		// TJ adjustments in line
+		widths[20];		// Measured widths of expected lines
+  bool		error = false;		// Error callback data
+  static const double size = 12.0,	// Font size
+		width = 216.0;		// Paragraph width
+  static const char * const paragraph = "PDFio is a simple C library for reading and writing PDF files.  The primary goal of PDFio is to provide a library that is lightweight, portable, and thread safe.\nIt also needs to handle large files and gracefully handle errors in the files it reads.";
+					// Paragraph text
+  static const char * const aligns[] = { "left", "center", "right", "justify" };
+					// Alignment names
+
+
+  printf("pdfioFileCreate(\"%s\", ...): ", outname);
+  if ((pdf = pdfioFileCreate(outname, NULL, NULL, NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  fputs("pdfioFileCreateFontObjFromFile(OpenSans-Regular.ttf): ", stdout);
+  if ((latin = pdfioFileCreateFontObjFromFile(pdf, "testfiles/OpenSans-Regular.ttf", false)) != NULL)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  // Break the paragraph into lines using the longest run of words that fits
+  // on each line...
+  for (textptr = paragraph, num_expected = 0; *textptr && num_expected < (sizeof(expected) / sizeof(expected[0])); num_expected ++)
+  {
+    for (line = textptr, expected[num_expected][0] = '\0', widths[num_expected] = 0.0; *textptr && *textptr != '\n';)
+    {
+      for (end = textptr; *end && *end != ' ' && *end != '\n'; end ++);
+
+      snprintf(candidate, sizeof(candidate), "%.*s", (int)(end - line), line);
+
+      if (expected[num_expected][0] && pdfioContentTextMeasure(latin, candidate, size) > width)
+        break;
+
+      strncpy(expected[num_expected], candidate, sizeof(expected[0]) - 1);
+      expected[num_expected][sizeof(expected[0]) - 1] = '\0';
+      widths[num_expected] = pdfioContentTextMeasure(latin, expected[num_expected], size);
+
+      for (textptr = end; *textptr == ' '; textptr ++);
+    }
+
+    if ((hard[num_expected] = *textptr == '\n' || !*textptr) == true && *textptr)
+      textptr ++;
+  }
+
+  // Show the paragraph with each alignment...
+  for (align = PDFIO_TEXTALIGN_LEFT; align <= PDFIO_TEXTALIGN_JUSTIFY; align ++)
+  {
+    printf("pdfioContentTextShowParagraph(%s): ", aligns[align]);
+
+    dict = pdfioDictCreate(pdf);
+    pdfioPageDictAddFont(dict, "F1", latin);
+
+    if ((st = pdfioFileCreatePage(pdf, dict)) == NULL)
+      goto done;
+
+    pdfioContentTextBegin(st);
+    pdfioContentSetTextFont(st, "F1", size);
+    pdfioContentSetTextLeading(st, size * 1.2);
+    pdfioContentTextMoveTo(st, 36.0, 720.0);
+
+    textptr = paragraph;
+
+    if (!pdfioContentTextShowParagraph(st, false, width, align, 0, &textptr, &num_lines))
+    {
+      pdfioStreamClose(st);
+      goto done;
+    }
+
+    pdfioContentTextEnd(st);
+    pdfioStreamClose(st);
+
+    if (*textptr)
+    {
+      printf("FAIL (%u bytes of text not shown)\n", (unsigned)strlen(textptr));
+      goto done;
+    }
+    else if (num_lines != num_expected)
+    {
+      printf("FAIL (%u lines, expected %u)\n", (unsigned)num_lines, (unsigned)num_expected);
+      goto done;
+    }
+
+    printf("PASS (%u lines)\n", (unsigned)num_lines);
+  }
+
+  if (!pdfioFileClose(pdf))
+    return (1);
+
+  // Read the pages back and check each line...
+  printf("pdfioFileOpen(\"%s\", ...): ", outname);
+  if ((pdf = pdfioFileOpen(outname, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  for (align = PDFIO_TEXTALIGN_LEFT; align <= PDFIO_TEXTALIGN_JUSTIFY; align ++)
+  {
+    printf("pdfioContentTextShowParagraph(%s) layout: ", aligns[align]);
+
+    if ((page = pdfioFileGetPage(pdf, (size_t)align)) == NULL || (st = pdfioPageOpenStream(page, 0, true)) == NULL)
+    {
+      puts("FAIL (unable to open page stream)");
+      goto done;
+    }
+
+    for (num_lines = 0, num_extra = 0, text[0] = '\0'; pdfioStreamGetToken(st, token, sizeof(token));)
+    {
+      if (!strcmp(token, "["))
+      {
+        in_array = true;
+      }
+      else if (!strcmp(token, "]"))
+      {
+        in_array = false;
+      }
+      else if (token[0] == '(')
+      {
+        strncat(text, token + 1, sizeof(text) - strlen(text) - 1);
+      }
+      else if (in_array && strchr("-.0123456789", token[0]))
+      {
+        if (num_extra < (sizeof(extra) / sizeof(extra[0])))
+          extra[num_extra ++] = -strtod(token, NULL) * size / 1000.0;
+      }
+      else if (!strcmp(token, "Tj") || !strcmp(token, "TJ"))
+      {
+        // Check the line against the expected text, width, and alignment...
+        if (num_lines >= num_expected || strcmp(text, expected[num_lines]))
+        {
+          printf("FAIL (line %u is \"%s\", expected \"%s\")\n", (unsigned)num_lines + 1, text, num_lines < num_expected ? expected[num_lines] : "");
+          pdfioStreamClose(st);
+          goto done;
+        }
+
+        if ((measured = widths[num_lines]) > width)
+        {
+          printf("FAIL (line %u is %.2f points wide, maximum is %.2f)\n", (unsigned)num_lines + 1, measured, width);
+          pdfioStreamClose(st);
+          goto done;
+        }
+
+        for (i = 0, offset = 0.0; i < num_extra; i ++)
+          offset += extra[i];
+
+        for (textptr = text, num_words = 1; *textptr; textptr ++)
+        {
+          if (*textptr == ' ' && textptr[1] != ' ')
+            num_words ++;
+        }
+
+        switch (align)
+        {
+          case PDFIO_TEXTALIGN_LEFT :
+              if (num_extra > 0)
+                offset = -1.0;
+              break;
+
+          case PDFIO_TEXTALIGN_CENTER :
+              if (num_extra == 1)
+                offset -= (width - measured) / 2.0;
+              else
+                offset = -1.0;
+              break;
+
+          case PDFIO_TEXTALIGN_RIGHT :
+              if (num_extra == 1)
+                offset -= width - measured;
+              else
+                offset = -1.0;
+              break;
+
+          case PDFIO_TEXTALIGN_JUSTIFY :
+              if (hard[num_lines])
+              {
+                // Last line of a paragraph is left-aligned...
+                if (num_extra > 0)
+                  offset = -1.0;
+              }
+              else if (num_extra == num_words - 1 && num_extra > 0)
+              {
+                // Words are spread evenly to the right margin...
+                offset -= width - measured;
+
+                for (i = 1; i < num_extra; i ++)
+                {
+                  if (fabs(extra[i] - extra[0]) > 0.01)
+                    offset = -1.0;
+                }
+              }
+              else
+              {
+                offset = -1.0;
+              }
+              break;
+        }
+
+        if (fabs(offset) > 0.05)
+        {
+          printf("FAIL (line %u \"%s\" has %u bad adjustments)\n", (unsigned)num_lines + 1, text, (unsigned)num_extra);
+          pdfioStreamClose(st);
+          goto done;
+        }
+
+        num_lines ++;
+        num_extra = 0;
+        text[0]   = '\0';
+      }
+    }
+
+    pdfioStreamClose(st);
+
+    if (num_lines != num_expected)
+    {
+      printf("FAIL (%u lines, expected %u)\n", (unsigned)num_lines, (unsigned)num_expected);
+      goto done;
+    }
+
+    puts("PASS");
+  }
+
+  ret = 0;
+
+  done:
+
+  pdfioFileClose(pdf);
+
+  return (ret);
+}
+
+
+//
+// 'token_consume_cb()' - Consume bytes from a test string.
+//
+
+static ssize_t				// O  - Number of bytes consumed
+token_consume_cb(const char **s,	// IO - Test string
+                 size_t     bytes)	// I  - Bytes to consume
+{
+  size_t	len = strlen(*s);	// Number of bytes remaining
+
+
+  // "Consume" bytes by incrementing the string pointer, limiting to the
+  // remaining length...
+  if (bytes > len)
+    bytes = len;
+
+  *s += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+//
+// 'token_peek_cb()' - Peek bytes from a test string.
+//
+
+static ssize_t				// O  - Number of bytes peeked
+token_peek_cb(const char **s,		// IO - Test string
+              char       *buffer,	// I  - Buffer
+              size_t     bytes)		// I  - Bytes to peek
+{
+  size_t	len = strlen(*s);	// Number of bytes remaining
+
+
+  // Copy bytes from the test string as possible...
+  if (bytes > len)
+    bytes = len;
+
+  if (bytes > 0)
+    memcpy(buffer, *s, bytes);
+
+  return ((ssize_t)bytes);
+}
+
+
+//
+// 'tree_unit_file()' - Write and read PDF files with nested and flat page trees.
+//
+
+static int				// O - 1 on failure, 0 on success
+tree_unit_file(const char *filename)	// I - File to write
+{
+  FILE		*fp;			// Output file
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*page;			// Page object
+  size_t	i,			// Looping var
+		n;			// Page number
+  long		offsets[14],		// Object offsets
+		*flat;			// Object offsets for flat page tree
+  long		xref;			// Offset of xref table
+  bool		error = false;		// Error callback data
+  static const char * const objs[] =	// Objects in page tree
+  {
+    "<</Type/Catalog/Pages 2 0 R>>",
+    "<</Type/Pages/Count 7/Kids[3 0 R 4 0 R 10 0 R 5 0 R]/MediaBox[0 0 612 792]>>",
+    "<</Type/Pages/Parent 2 0 R/Count 2/Kids[6 0 R 7 0 R]>>",
+    "<</Type/Page/Parent 2 0 R/TestPage 2>>",
+    "<</Type/Pages/Parent 2 0 R/Count 4/Kids[11 0 R 8 0 R]>>",
+    "<</Type/Page/Parent 3 0 R/TestPage 0>>",
+    "<</Type/Page/Parent 3 0 R/TestPage 1>>",
+    "<</Type/Page/Parent 5 0 R/TestPage 6>>",
+    "<</Type/Page/Parent 11 0 R/TestPage 3>>",
+    "<</Type/Pages/Parent 2 0 R/Count 0/Kids[]>>",
+    "<</Type/Pages/Parent 5 0 R/Count 3/Kids[9 0 R 12 0 R 13 0 R]>>",
+    "<</Type/Page/Parent 11 0 R/TestPage 4>>",
+    "<</Type/Page/Parent 11 0 R/TestPage 5>>"
+  };
+  static const size_t lookups[] = { 5, 0, 6, 2, 3, 1, 4 };
+					// Order of page lookups
+  static const size_t num_flat = 10000;	// Number of pages in flat page tree
+
+
+  // Write the file...
+  printf("fopen(\"%s\", \"wb\"): ", filename);
+  if ((fp = fopen(filename, "wb")) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  puts("PASS");
+
+  fputs("%PDF-1.4\n", fp);
+  for (i = 0; i < (sizeof(objs) / sizeof(objs[0])); i ++)
+  {
+    offsets[i + 1] = ftell(fp);
+    fprintf(fp, "%u 0 obj\n%s\nendobj\n", (unsigned)(i + 1), objs[i]);
+  }
+
+  xref = ftell(fp);
+  fprintf(fp, "xref\n0 %u\n0000000000 65535 f \n", (unsigned)(i + 1));
+  for (i = 0; i < (sizeof(objs) / sizeof(objs[0])); i ++)
+    fprintf(fp, "%010ld 00000 n \n", offsets[i + 1]);
+  fprintf(fp, "trailer\n<</Size %u/Root 1 0 R>>\nstartxref\n%ld\n%%%%EOF\n", (unsigned)(i + 1), xref);
+  fclose(fp);
+
+  // Read it back...
+  printf("pdfioFileOpen(\"%s\", ...): ", filename);
+  if ((pdf = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  fputs("pdfioFileGetNumPages: ", stdout);
+  if ((n = pdfioFileGetNumPages(pdf)) == 7)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (%u pages, expected 7)\n", (unsigned)n);
+    goto fail;
+  }
+
+  fputs("pdfioFileGetPage (not loaded): ", stdout);
+  for (i = 0; i < n; i ++)
+  {
+    if (pdf->pages[i])
+      break;
+  }
+
+  if (i >= n)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    printf("FAIL (page %u already loaded)\n", (unsigned)i + 1);
+    goto fail;
+  }
+
+  for (i = 0; i < (sizeof(lookups) / sizeof(lookups[0])); i ++)
+  {
+    printf("pdfioFileGetPage(%u): ", (unsigned)lookups[i]);
+    if ((page = pdfioFileGetPage(pdf, lookups[i])) == NULL)
+    {
+      puts("FAIL (not found)");
+      goto fail;
+    }
+    else if ((n = (size_t)pdfioDictGetNumber(pdfioObjGetDict(page), "TestPage")) != lookups[i])
+    {
+      printf("FAIL (got page %u)\n", (unsigned)n);
+      goto fail;
+    }
+    else
+    {
+      puts("PASS");
+    }
+  }
+
+  fputs("pdfioFileGetPage(7): ", stdout);
+  if (pdfioFileGetPage(pdf, 7))
+  {
+    puts("FAIL (expected NULL)");
+    goto fail;
+  }
+  else
+  {
+    puts("PASS");
+  }
+
+  pdfioFileClose(pdf);
+
+  // Write a large flat page tree...
+  printf("fopen(\"%s\", \"wb\"): ", filename);
+  if ((fp = fopen(filename, "wb")) == NULL || (flat = (long *)calloc(num_flat + 3, sizeof(long))) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    if (fp)
+      fclose(fp);
+    return (1);
+  }
+
+  puts("PASS");
+
+  fputs("%PDF-1.4\n", fp);
+  flat[1] = ftell(fp);
+  fputs("1 0 obj\n<</Type/Catalog/Pages 2 0 R>>\nendobj\n", fp);
+  flat[2] = ftell(fp);
+  fprintf(fp, "2 0 obj\n<</Type/Pages/Count %u/MediaBox[0 0 612 792]/Kids[", (unsigned)num_flat);
+  for (i = 0; i < num_flat; i ++)
+    fprintf(fp, "%u 0 R\n", (unsigned)(i + 3));
+  fputs("]>>\nendobj\n", fp);
+  for (i = 0; i < num_flat; i ++)
+  {
+    flat[i + 3] = ftell(fp);
+    fprintf(fp, "%u 0 obj\n<</Type/Page/Parent 2 0 R/TestPage %u>>\nendobj\n", (unsigned)(i + 3), (unsigned)i);
+  }
+
+  xref = ftell(fp);
+  fprintf(fp, "xref\n0 %u\n0000000000 65535 f \n", (unsigned)(num_flat + 3));
+  for (i = 1; i < (num_flat + 3); i ++)
+    fprintf(fp, "%010ld 00000 n \n", flat[i]);
+  fprintf(fp, "trailer\n<</Size %u/Root 1 0 R>>\nstartxref\n%ld\n%%%%EOF\n", (unsigned)(num_flat + 3), xref);
+  fclose(fp);
+  free(flat);
+
+  // Walk all of the pages, which must only scan each kid once...
+  printf("pdfioFileOpen(\"%s\", ...): ", filename);
+  if ((pdf = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
+  else
+    return (1);
+
+  printf("pdfioFileGetPage(0 to %u): ", (unsigned)(num_flat - 1));
+  if ((n = pdfioFileGetNumPages(pdf)) != num_flat)
+  {
+    printf("FAIL (%u pages, expected %u)\n", (unsigned)n, (unsigned)num_flat);
+    goto fail;
+  }
+
+  for (i = 0; i < num_flat; i ++)
+  {
+    if ((page = pdfioFileGetPage(pdf, i)) == NULL || (size_t)pdfioDictGetNumber(pdfioObjGetDict(page), "TestPage") != i)
+    {
+      printf("FAIL (page %u not found)\n", (unsigned)i);
+      goto fail;
+    }
+    else if (pdf->num_pnodes != 1 || pdf->pnodes[0].num_kids != (i + 1))
+    {
+      printf("FAIL (%u kids scanned for page %u)\n", (unsigned)(pdf->num_pnodes ? pdf->pnodes[0].num_kids : 0), (unsigned)i);
+      goto fail;
+    }
+  }
+
+  puts("PASS");
+
+  pdfioFileClose(pdf);
+
+  return (0);
+
+  fail:
+
+  pdfioFileClose(pdf);
+
+  return (1);
+}
+
+
+//
+// 'update_unit_file()' - Append an incremental update to a unit test file.
+//
+
+static int				// O  - 1 on failure, 0 on success
+update_unit_file(const char *filename,	// I  - File to update
+                 size_t     *num_pages)	// IO - Number of pages
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*page,			// Page object
+		*contents;		// Contents object
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_stream_t *st;			// Page content stream
+  int		fd;			// File descriptor
+  off_t		before,			// Size before update
+		after;			// Size after update
+  char		buffer[1024];		// Read buffer
+  bool		error = false;		// Error callback data
+
+
+  // Get the size of the file before the update...
+  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+  {
+    perror(filename);
     return (1);
   }
 
-  fputs("pdfioDictGetName(PageLayout): ", stdout);
-  if ((s = pdfioDictGetName(catalog, "PageLayout")) != NULL && !strcmp(s, "SinglePage"))
-  {
+  before = lseek(fd, 0, SEEK_END);
+  close(fd);
+
+  // Open the file for updating...
+  printf("pdfioFileOpenUpdate(\"%s\", ...): ", filename);
+  if ((pdf = pdfioFileOpenUpdate(filename, password_cb, (void *)"user", (pdfio_error_cb_t)error_cb, &error)) != NULL)
     puts("PASS");
-  }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'SinglePage')\n", s);
-    return (1);
-  }
   else
-  {
-    puts("FAIL (got NULL, expected 'SinglePage')");
     return (1);
-  }
 
-  fputs("pdfioDictGetName(PageMode): ", stdout);
-  if ((s = pdfioDictGetName(catalog, "PageMode")) != NULL && !strcmp(s, "UseThumbs"))
+  // Change the first page and copy its content stream...
+  fputs("pdfioFileGetPage(0): ", stdout);
+  if ((page = pdfioFileGetPage(pdf, 0)) != NULL && (dict = pdfioObjGetDict(page)) != NULL)
   {
     puts("PASS");
   }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'UseThumbs')\n", s);
-    return (1);
-  }
   else
   {
-    puts("FAIL (got NULL, expected 'UseThumbs')");
-    return (1);
+    puts("FAIL");
+    goto fail;
   }
 
-  fputs("pdfioDictGetString(Lang): ", stdout);
-  if ((s = pdfioDictGetString(catalog, "Lang")) != NULL && !strcmp(s, "en"))
-  {
+  pdfioDictSetNumber(dict, "UserUnit", 2.0);
+
+  fputs("pdfioObjClose(page): ", stdout);
+  if (pdfioObjClose(page))
     puts("PASS");
-  }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'en')\n", s);
-    return (1);
-  }
   else
-  {
-    puts("FAIL (got NULL, expected 'en')");
-    return (1);
-  }
+    goto fail;
 
-  // Verify metadata...
-  fputs("pdfioFileGetAuthor: ", stdout);
-  if ((s = pdfioFileGetAuthor(pdf)) != NULL && !strcmp(s, "Michael R Sweet"))
-  {
+  fputs("pdfioObjClose(contents): ", stdout);
+  if ((contents = pdfioDictGetObj(dict, "Contents")) != NULL && pdfioObjClose(contents))
     puts("PASS");
-  }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'Michael R Sweet')\n", s);
-    return (1);
-  }
   else
-  {
-    puts("FAIL (got NULL, expected 'Michael R Sweet')");
-    return (1);
-  }
+    goto fail;
 
-  fputs("pdfioFileGetCreator: ", stdout);
-  if ((s = pdfioFileGetCreator(pdf)) != NULL && !strcmp(s, "testpdfio"))
-  {
+  // Add a new page...
+  fputs("pdfioFileCreatePage: ", stdout);
+  if ((st = pdfioFileCreatePage(pdf, NULL)) != NULL)
     puts("PASS");
-  }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'testpdfio')\n", s);
-    return (1);
-  }
   else
-  {
-    puts("FAIL (got NULL, expected 'testpdfio')");
-    return (1);
-  }
+    goto fail;
 
-  fputs("pdfioFileGetKeywords: ", stdout);
-  if ((s = pdfioFileGetKeywords(pdf)) != NULL && !strcmp(s, "one fish,two fish,red fish,blue fish"))
-  {
+  fputs("pdfioContentPathRect(36, 36, 72, 72): ", stdout);
+  if (pdfioContentPathRect(st, 36, 36, 72, 72))
+    puts("PASS");
+  else
+    goto fail;
+
+  fputs("pdfioContentFill(false): ", stdout);
+  if (pdfioContentFill(st, false))
+    puts("PASS");
+  else
+    goto fail;
+
+  fputs("pdfioStreamClose: ", stdout);
+  if (pdfioStreamClose(st))
+    puts("PASS");
+  else
+    goto fail;
+
+  pdfioFileSetSubject(pdf, "Unit test document");
+
+  fputs("pdfioFileClose: ", stdout);
+  if (pdfioFileClose(pdf))
     puts("PASS");
-  }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'one fish,two fish,red fish,blue fish')\n", s);
-    return (1);
-  }
   else
+    return (1);
+
+  (*num_pages) ++;
+
+  // Make sure only the changes were appended...
+  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
   {
-    puts("FAIL (got NULL, expected 'one fish,two fish,red fish,blue fish')");
+    perror(filename);
     return (1);
   }
 
-  fputs("pdfioFileGetSubject: ", stdout);
-  if ((s = pdfioFileGetSubject(pdf)) != NULL && !strcmp(s, "Unit test document"))
+  after = lseek(fd, 0, SEEK_END);
+  close(fd);
+
+  fputs("Incremental update size: ", stdout);
+  if (after > before && (after - before) < (before / 4))
   {
-    puts("PASS");
+    printf("PASS (%ld bytes)\n", (long)(after - before));
   }
-  else if (s)
+  else
   {
-    printf("FAIL (got '%s', expected 'Unit test document')\n", s);
+    printf("FAIL (%ld bytes added to %ld bytes)\n", (long)(after - before), (long)before);
     return (1);
   }
+
+  // Verify the changed page...
+  printf("pdfioFileOpen(\"%s\", ...): ", filename);
+  if ((pdf = pdfioFileOpen(filename, password_cb, (void *)"user", (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    puts("PASS");
   else
-  {
-    puts("FAIL (got NULL, expected 'Unit test document')");
     return (1);
-  }
 
-  fputs("pdfioFileGetTitle: ", stdout);
-  if ((s = pdfioFileGetTitle(pdf)) != NULL && !strcmp(s, "Test Document"))
+  fputs("pdfioDictGetNumber(UserUnit): ", stdout);
+  if ((page = pdfioFileGetPage(pdf, 0)) != NULL && (dict = pdfioObjGetDict(page)) != NULL && pdfioDictGetNumber(dict, "UserUnit") == 2.0)
   {
     puts("PASS");
   }
-  else if (s)
-  {
-    printf("FAIL (got '%s', expected 'Test Document')\n", s);
-    return (1);
-  }
   else
   {
-    puts("FAIL (got NULL, expected 'Test Document')");
-    return (1);
+    puts("FAIL");
+    goto fail;
   }
 
-  // Verify the number of pages is the same...
-  fputs("pdfioFileGetNumPages: ", stdout);
-  if (num_pages == pdfioFileGetNumPages(pdf))
+  fputs("pdfioPageOpenStream(0): ", stdout);
+  if ((st = pdfioPageOpenStream(page, 0, true)) != NULL && pdfioStreamRead(st, buffer, sizeof(buffer)) > 0)
   {
     puts("PASS");
   }
   else
   {
-    printf("FAIL (%lu != %lu)\n", (unsigned long)num_pages, (unsigned long)pdfioFileGetNumPages(pdf));
-    return (1);
-  }
-
-  // Verify the images
-  for (i = 0; i < 7; i ++)
-  {
-    if (is_output)
-    {
-      if (verify_image(pdf, first_image + (size_t)i * 2))
-        return (1);
-    }
-    else if (verify_image(pdf, first_image + (size_t)i))
-      return (1);
+    puts("FAIL");
+    goto fail;
   }
 
-  // Close the new PDF file...
-  fputs("pdfioFileClose(\"testpdfio-out.pdf\"): ", stdout);
-  if (pdfioFileClose(pdf))
-    puts("PASS");
-  else
-    return (1);
+  pdfioStreamClose(st);
+  pdfioFileClose(pdf);
 
   return (0);
-}
-
-
-//
-// 'token_consume_cb()' - Consume bytes from a test string.
-//
-
-static ssize_t				// O  - Number of bytes consumed
-token_consume_cb(const char **s,	// IO - Test string
-                 size_t     bytes)	// I  - Bytes to consume
-{
-  size_t	len = strlen(*s);	// Number of bytes remaining
-
-
-  // "Consume" bytes by incrementing the string pointer, limiting to the
-  // remaining length...
-  if (bytes > len)
-    bytes = len;
-
-  *s += bytes;
-
-  return ((ssize_t)bytes);
-}
-
 
-//
-// 'token_peek_cb()' - Peek bytes from a test string.
-//
-
-static ssize_t				// O  - Number of bytes peeked
-token_peek_cb(const char **s,		// IO - Test string
-              char       *buffer,	// I  - Buffer
-              size_t     bytes)		// I  - Bytes to peek
-{
-  size_t	len = strlen(*s);	// Number of bytes remaining
-
-
-  // Copy bytes from the test string as possible...
-  if (bytes > len)
-    bytes = len;
+  fail:
 
-  if (bytes > 0)
-    memcpy(buffer, *s, bytes);
+  pdfioFileClose(pdf);
 
-  return ((ssize_t)bytes);
+  return (1);
 }
 
 
@@ -1584,6 +3659,7 @@ usage(FILE *fp)				// I - Output file
 {
   fputs("Usage: ./testpdfio [OPTIONS] [FILENAME [OBJNUM]] ...\n", fp);
   fputs("Options:\n", fp);
+  fputs("  --bench              Run benchmarks.\n", fp);
   fputs("  --help               Show program help.\n", fp);
   fputs("  --password PASSWORD  Set PDF password.\n", fp);
   fputs("  --verbose            Be verbose.\n", fp);
@@ -1611,6 +3687,10 @@ verify_image(pdfio_file_t *pdf,		// I - PDF file
 		*bufptr,		// Pointer into buffer
 		line[768];		// Line from file
   ssize_t	bytes;			// Bytes read from stream
+  _pdfio_md5_t	md5;			// MD5 context
+  _pdfio_sha256_t sha256;		// SHA-256 context
+  unsigned char	digest[32],		// Expected digest
+		objdigest[32];		// Object digest
 
 
   printf("pdfioFileFindObj(%lu): ", (unsigned long)number);
@@ -1670,6 +3750,9 @@ verify_image(pdfio_file_t *pdf,		// I - PDF file
   else
     return (1);
 
+  _pdfioCryptoMD5Init(&md5);
+  _pdfioCryptoSHA256Init(&sha256);
+
   for (y = 0; y < 256; y ++)
   {
     for (x = 0, bufptr = buffer; x < 256; x ++, bufptr += 3)
@@ -1679,6 +3762,9 @@ verify_image(pdfio_file_t *pdf,		// I - PDF file
       bufptr[2] = (unsigned char)(y - x);
     }
 
+    _pdfioCryptoMD5Append(&md5, buffer, sizeof(buffer));
+    _pdfioCryptoSHA256Append(&sha256, buffer, sizeof(buffer));
+
     if ((bytes = pdfioStreamRead(st, line, sizeof(line))) != (ssize_t)sizeof(line))
     {
       printf("pdfioStreamRead: FAIL (got %d for line %d, expected 768)\n", y, (int)bytes);
@@ -1696,6 +3782,37 @@ verify_image(pdfio_file_t *pdf,		// I - PDF file
 
   pdfioStreamClose(st);
 
+  // Verify the digests of the decoded image data...
+  fputs("pdfioObjDigest(MD5): ", stdout);
+  _pdfioCryptoMD5Finish(&md5, digest);
+  if (pdfioObjDigest(obj, PDFIO_DIGEST_MD5, true, objdigest, sizeof(objdigest)) != 16)
+  {
+    puts("FAIL (no digest)");
+    return (1);
+  }
+  else if (memcmp(digest, objdigest, 16))
+  {
+    puts("FAIL (digest doesn't match)");
+    return (1);
+  }
+  else
+    puts("PASS");
+
+  fputs("pdfioObjDigest(SHA256): ", stdout);
+  _pdfioCryptoSHA256Finish(&sha256, digest);
+  if (pdfioObjDigest(obj, PDFIO_DIGEST_SHA256, true, objdigest, sizeof(objdigest)) != 32)
+  {
+    puts("FAIL (no digest)");
+    return (1);
+  }
+  else if (memcmp(digest, objdigest, 32))
+  {
+    puts("FAIL (digest doesn't match)");
+    return (1);
+  }
+  else
+    puts("PASS");
+
   return (0);
 }
 
@@ -2506,6 +4623,8 @@ write_font_test(
     "Ngiyakwemukela",
     "いらっしゃいませ"
   };
+  double		widths[sizeof(welcomes) / sizeof(welcomes[0])];
+					// Widths of "Welcome" strings
 
 
   printf("pdfioFileCreateFontObjFromFile(%s): ", textfontfile);
@@ -2616,6 +4735,65 @@ write_font_test(
       return (1);
   }
 
+  fputs("pdfioContentTextMeasureN(\"AVATAR Typography\", 6): ", stdout);
+  if ((width = pdfioContentTextMeasureN(textfont, "AVATAR Typography", 6, 10.0)) > 0.0 && fabs(width - pdfioContentTextMeasure(textfont, "AVATAR", 10.0)) < 0.001)
+    printf("PASS (%g)\n", width);
+  else
+    return (1);
+
+  fputs("pdfioContentTextMeasureStrings(welcomes): ", stdout);
+  if (pdfioContentTextMeasureStrings(textfont, sizeof(welcomes) / sizeof(welcomes[0]), welcomes, NULL, 10.0, widths))
+  {
+    for (i = 0; i < (int)(sizeof(welcomes) / sizeof(welcomes[0])); i ++)
+    {
+      if (fabs(widths[i] - pdfioContentTextMeasure(textfont, welcomes[i], 10.0)) >= 0.001)
+        break;
+    }
+
+    if (i < (int)(sizeof(welcomes) / sizeof(welcomes[0])))
+    {
+      printf("FAIL (width of \"%s\" is %g, expected %g)\n", welcomes[i], widths[i], pdfioContentTextMeasure(textfont, welcomes[i], 10.0));
+      return (1);
+    }
+
+    puts("PASS");
+  }
+  else
+    return (1);
+
+  // Noto Sans JP has "AV" and "To" kerning pairs, so the kerned width must be
+  // smaller than the unkerned width...
+  fputs("pdfioContentTextMeasureKerned(\"AVATAR Typography\"): ", stdout);
+  width = pdfioContentTextMeasureKerned(textfont, "AVATAR Typography", 10.0);
+
+  if (strstr(textfontfile, "NotoSansJP-Regular") ? width < pdfioContentTextMeasure(textfont, "AVATAR Typography", 10.0) : width <= pdfioContentTextMeasure(textfont, "AVATAR Typography", 10.0))
+  {
+    printf("PASS (%g)\n", width);
+  }
+  else
+  {
+    printf("FAIL (%g, unkerned width is %g)\n", width, pdfioContentTextMeasure(textfont, "AVATAR Typography", 10.0));
+    return (1);
+  }
+
+  printf("pdfioContextTextMoveTo(%g, 0.0): ", -width);
+  if (pdfioContentTextMoveTo(st, -width, 0.0))
+    puts("PASS");
+  else
+    return (1);
+
+  fputs("pdfioContentTextShowKerned(\"AVATAR Typography\"): ", stdout);
+  if (pdfioContentTextShowKerned(st, unicode, "AVATAR Typography\n"))
+    puts("PASS");
+  else
+    return (1);
+
+  printf("pdfioContextTextMoveTo(%g, 0.0): ", width);
+  if (pdfioContentTextMoveTo(st, width, 0.0))
+    puts("PASS");
+  else
+    return (1);
+
   fputs("pdfioContentTextEnd(): ", stdout);
   if (pdfioContentTextEnd(st))
     puts("PASS");
@@ -12,8 +12,13 @@
 //
 //   ./testttf [FILENAME]
 //
+//   ./testttf --bench [FILENAME]
+//
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "ttf.h"
 
 
@@ -21,10 +26,27 @@
 // Local functions...
 //
 
+static int	bench_font(const char *filename);
 static void	error_cb(void *data, const char *message);
 static int	test_font(const char *filename);
 
 
+//
+// Local globals...
+//
+
+static const char * const strings[] =	// Test strings
+{
+  "Hello, World!",			// English
+  "مرحبا بالعالم!",			// Arabic
+  "Bonjour le monde!",			// French
+  "Γειά σου Κόσμε!",			// Greek
+  "שלום עולם!",				// Hebrew
+  "Привет мир!",			// Russian
+  "こんにちは世界！"			// Japanese
+};
+
+
 //
 // 'main()' - Main entry for unit tests.
 //
@@ -35,19 +57,29 @@ main(int  argc,				// I - Number of command-line arguments
 {
   int		i;			// Looping var
   int		errors = 0;		// Number of errors
+  int		(*func)(const char *filename) = test_font;
+					// Test or benchmark function
+
 
+  if (argc > 1 && !strcmp(argv[1], "--bench"))
+  {
+    // Run benchmarks instead of unit tests...
+    func = bench_font;
+    argc --;
+    argv ++;
+  }
 
   if (argc > 1)
   {
     for (i = 1; i < argc; i ++)
-      errors += test_font(argv[i]);
+      errors += (func)(argv[i]);
   }
   else
   {
     // Test with the bundled TrueType files...
-    errors += test_font("testfiles/OpenSans-Bold.ttf");
-    errors += test_font("testfiles/OpenSans-Regular.ttf");
-    errors += test_font("testfiles/NotoSansJP-Regular.otf");
+    errors += (func)("testfiles/OpenSans-Bold.ttf");
+    errors += (func)("testfiles/OpenSans-Regular.ttf");
+    errors += (func)("testfiles/NotoSansJP-Regular.otf");
   }
 
   if (!errors)
@@ -59,6 +91,55 @@ main(int  argc,				// I - Number of command-line arguments
 }
 
 
+//
+// 'bench_font()' - Benchmark measuring text with a font file.
+//
+
+static int				// O - Number of errors
+bench_font(const char *filename)	// I - Font filename
+{
+  int		i;			// Looping var
+  ttf_t		*font;			// Font
+  ttf_rect_t	extents;		// Extents
+  clock_t	start;			// Start time
+  double	secs;			// Elapsed time
+
+
+  printf("ttfCreate(\"%s\"): ", filename);
+  fflush(stdout);
+  if ((font = ttfCreate(filename, 0, error_cb, NULL)) != NULL)
+  {
+    puts("PASS");
+  }
+  else
+  {
+    return (1);
+  }
+
+  fputs("ttfGetExtents(benchmark): ", stdout);
+  fflush(stdout);
+  for (i = 0, start = clock(); i < 100000; i ++)
+  {
+    if (!ttfGetExtents(font, 12.0f, strings[i % (int)(sizeof(strings) / sizeof(strings[0]))], &extents))
+      break;
+  }
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  if (i < 100000)
+  {
+    puts("FAIL");
+    ttfDelete(font);
+    return (1);
+  }
+
+  printf("PASS (%.0f strings/sec)\n", secs > 0.0 ? i / secs : 0.0);
+
+  ttfDelete(font);
+
+  return (0);
+}
+
+
 //
 // 'error_cb()' - Error callback.
 //
@@ -89,6 +170,14 @@ test_font(const char *filename)		// I - Font filename
   size_t	num_fonts;		// Number of fonts
   ttf_style_t	style;			// Font style
   ttf_weight_t	weight;			// Font weight
+  unsigned char	*subset;		// Font subset
+  size_t	subsize;		// Size of font subset
+  const int	*cmap;			// Unicode to glyph map
+  size_t	num_cmap;		// Number of map entries
+  static const int chars[] =		// Subset characters
+  {
+    ' ', '!', ',', 'H', 'W', 'd', 'e', 'l', 'o', 'r'
+  };
   static const char * const stretches[] =
   {					// Font stretch strings
     "TTF_STRETCH_NORMAL",		// normal
@@ -101,16 +190,6 @@ test_font(const char *filename)		// I - Font filename
     "TTF_STRETCH_EXTRA_EXPANDED",	// extra-expanded
     "TTF_STRETCH_ULTRA_EXPANDED"	// ultra-expanded
   };
-  static const char * const strings[] =	// Test strings
-  {
-    "Hello, World!",			// English
-    "مرحبا بالعالم!",			// Arabic
-    "Bonjour le monde!",		// French
-    "Γειά σου Κόσμε!",			// Greek
-    "שלום עולם!",			// Hebrew
-    "Привет мир!",			// Russian
-    "こんにちは世界！"			// Japanese
-  };
   static const char * const styles[] =	// Font style names
   {
     "TTF_STYLE_NORMAL",
@@ -126,6 +205,17 @@ test_font(const char *filename)		// I - Font filename
   else
     errors ++;
 
+  fputs("ttfGetAdvance(' '): ", stdout);
+  if ((intvalue = ttfGetAdvance(font, ' ')) > 0)
+  {
+    printf("PASS (%d)\n", intvalue);
+  }
+  else
+  {
+    printf("FAIL (%d)\n", intvalue);
+    errors ++;
+  }
+
   fputs("ttfGetAscent: ", stdout);
   if ((intvalue = ttfGetAscent(font)) > 0)
   {
@@ -194,6 +284,58 @@ test_font(const char *filename)		// I - Font filename
     errors ++;
   }
 
+  fputs("ttfGetGlyph: ", stdout);
+  cmap = ttfGetCMap(font, &num_cmap);
+  for (i = 0; i < (int)num_cmap; i ++)
+  {
+    if (ttfGetGlyph(font, i) != cmap[i])
+      break;
+  }
+
+  if (!cmap || i < (int)num_cmap)
+  {
+    printf("FAIL (%d)\n", i);
+    errors ++;
+  }
+  else if ((intvalue = ttfGetGlyph(font, 'A')) <= 0)
+  {
+    printf("FAIL ('A' maps to %d)\n", intvalue);
+    errors ++;
+  }
+  else
+  {
+    printf("PASS ('A' maps to %d)\n", intvalue);
+  }
+
+  fputs("ttfGetKerning: ", stdout);
+  if (strstr(filename, "NotoSansJP-Regular"))
+  {
+    // Check known GPOS pair adjustments...
+    int	to = ttfGetKerning(font, 'T', 'o'),
+	av = ttfGetKerning(font, 'A', 'V'),
+	lt = ttfGetKerning(font, 'L', 'T');
+					// Kerning values
+
+    if (to == -74 && av == -15 && lt == -134)
+    {
+      printf("PASS (To=%d, AV=%d, LT=%d)\n", to, av, lt);
+    }
+    else
+    {
+      printf("FAIL (To=%d, AV=%d, LT=%d, expected -74, -15, -134)\n", to, av, lt);
+      errors ++;
+    }
+  }
+  else if ((intvalue = ttfGetKerning(font, 'T', 'o')) <= 0)
+  {
+    printf("PASS (To=%d, AV=%d)\n", intvalue, ttfGetKerning(font, 'A', 'V'));
+  }
+  else
+  {
+    printf("FAIL (To=%d)\n", intvalue);
+    errors ++;
+  }
+
   fputs("ttfGetItalicAngle: ", stdout);
   if ((realvalue = ttfGetItalicAngle(font)) >= -180.0 && realvalue <= 180.0)
   {
@@ -249,6 +391,17 @@ test_font(const char *filename)		// I - Font filename
     errors ++;
   }
 
+  fputs("ttfGetUnitsPerEm: ", stdout);
+  if ((intvalue = ttfGetUnitsPerEm(font)) > 0)
+  {
+    printf("PASS (%d)\n", intvalue);
+  }
+  else
+  {
+    printf("FAIL (%d)\n", intvalue);
+    errors ++;
+  }
+
   fputs("ttfGetVersion: ", stdout);
   if ((value = ttfGetVersion(font)) != NULL)
   {
@@ -299,6 +452,82 @@ test_font(const char *filename)		// I - Font filename
   else
     puts("PASS (false)");
 
+  fputs("ttfCreateSubset: ", stdout);
+  if ((subset = ttfCreateSubset(font, sizeof(chars) / sizeof(chars[0]), chars, &subsize)) != NULL)
+  {
+    FILE	*fp;			// Subset file
+    ttf_t	*subfont;		// Subset font
+
+    printf("PASS (%lu bytes)\n", (unsigned long)subsize);
+
+    fputs("ttfCreate(subset): ", stdout);
+    if ((fp = fopen("testttf-subset.ttf", "wb")) != NULL && fwrite(subset, 1, subsize, fp) == subsize && !fclose(fp) && (subfont = ttfCreate("testttf-subset.ttf", 0, error_cb, NULL)) != NULL)
+    {
+      for (i = 0; i < (int)(sizeof(chars) / sizeof(chars[0])); i ++)
+      {
+        if (ttfGetWidth(subfont, chars[i]) != ttfGetWidth(font, chars[i]))
+          break;
+      }
+
+      if (i < (int)(sizeof(chars) / sizeof(chars[0])))
+      {
+        printf("FAIL (width of '%c' is %d, expected %d)\n", chars[i], ttfGetWidth(subfont, chars[i]), ttfGetWidth(font, chars[i]));
+        errors ++;
+      }
+      else
+      {
+        puts("PASS");
+      }
+
+      ttfDelete(subfont);
+    }
+    else
+    {
+      puts("FAIL");
+      errors ++;
+    }
+
+    remove("testttf-subset.ttf");
+    free(subset);
+  }
+  else
+  {
+    puts("FAIL");
+    errors ++;
+  }
+
+  fputs("ttfIsCFF: ", stdout);
+  if (ttfIsCFF(font))
+  {
+    puts("PASS (true)");
+
+    fputs("ttfCreateCFF: ", stdout);
+    if ((subset = ttfCreateCFF(font, sizeof(chars) / sizeof(chars[0]), chars, &subsize)) != NULL)
+    {
+      // Check the CFF header (version 1.0, 4 byte header)...
+      if (subsize > 4 && subset[0] == 1 && subset[1] == 0 && subset[2] == 4)
+      {
+        printf("PASS (%lu bytes)\n", (unsigned long)subsize);
+      }
+      else
+      {
+        puts("FAIL (bad CFF header)");
+        errors ++;
+      }
+
+      free(subset);
+    }
+    else
+    {
+      puts("FAIL");
+      errors ++;
+    }
+  }
+  else
+  {
+    puts("PASS (false)");
+  }
+
   ttfDelete(font);
 
   return (errors);
@@ -64,8 +64,12 @@
 
 typedef __int64 ssize_t;		// POSIX type not present on Windows... @private@
 
+#  include <windows.h>
+
 #else
 #  include <unistd.h>
+#  include <sys/mman.h>
+#  include <pthread.h>
 #  define O_BINARY	0
 #endif // _WIN32
 
@@ -99,6 +103,7 @@ typedef __int64 ssize_t;		// POSIX type not present on Windows... @private@
 //
 
 #define TTF_FONT_MAX_CHAR	262144	// Maximum number of character values
+#define TTF_GLYPH_NONE		0xffff	// No glyph for character
 #define TTF_FONT_MAX_GROUPS	65536	// Maximum number of sub-groups
 #define TTF_FONT_MAX_NAMES	16777216// Maximum size of names table we support
 
@@ -107,14 +112,22 @@ typedef __int64 ssize_t;		// POSIX type not present on Windows... @private@
 // TTF/OFF tag constants...
 //
 
+#define TTF_OFF_CFF	0x43464620	// Compact Font Format outlines
 #define TTF_OFF_cmap	0x636d6170	// Character to glyph mapping
+#define TTF_OFF_cvt	0x63767420	// Control value table
+#define TTF_OFF_fpgm	0x6670676d	// Font program
+#define TTF_OFF_glyf	0x676c7966	// Glyph data
+#define TTF_OFF_GPOS	0x47504f53	// Glyph positioning
 #define TTF_OFF_head	0x68656164	// Font header
 #define TTF_OFF_hhea	0x68686561	// Horizontal header
 #define TTF_OFF_hmtx	0x686d7478	// Horizontal metrics
+#define TTF_OFF_kern	0x6b65726e	// Kerning
+#define TTF_OFF_loca	0x6c6f6361	// Index to location
 #define TTF_OFF_maxp	0x6d617870	// Maximum profile
 #define TTF_OFF_name	0x6e616d65	// Naming table
 #define TTF_OFF_OS_2	0x4f532f32	// OS/2 and Windows specific metrics
 #define TTF_OFF_post	0x706f7374	// PostScript information
+#define TTF_OFF_prep	0x70726570	// Control value program
 
 #define TTF_OFF_Unicode	0	// Unicode platform ID
 
@@ -134,11 +147,83 @@ typedef __int64 ssize_t;		// POSIX type not present on Windows... @private@
 #define TTF_OFF_FontVersion	5	// Font version number
 #define TTF_OFF_PostScriptName	6	// Font PostScript name
 
+#define TTF_OFF_ARG_1_AND_2_ARE_WORDS	0x0001	// Composite glyph flags
+#define TTF_OFF_WE_HAVE_A_SCALE		0x0008
+#define TTF_OFF_MORE_COMPONENTS		0x0020
+#define TTF_OFF_WE_HAVE_AN_X_AND_Y_SCALE 0x0040
+#define TTF_OFF_WE_HAVE_A_TWO_BY_TWO	0x0080
+
+#define TTF_CFF_MAX_FDS		256	// Maximum number of CFF font dicts
+#define TTF_CFF_MAX_OPS		64	// Maximum number of operators in a CFF DICT
+#define TTF_CFF_MAX_STACK	48	// Maximum depth of the charstring operand stack
+#define TTF_CFF_MAX_SUBRS	10	// Maximum charstring subroutine nesting
+
 
 //
 // Local types...
 //
 
+typedef struct _ttf_cff_buf_s		// CFF output buffer
+{
+  unsigned char	*data;			// Buffer data
+  size_t	length,			// Length of data
+		alloc;			// Allocated size of buffer
+} _ttf_cff_buf_t;
+
+typedef struct _ttf_cff_dict_s		// Parsed CFF DICT
+{
+  size_t	num_ops;		// Number of operators
+  struct
+  {
+    unsigned		op;		// Operator (1200 + op for escaped operators)
+    const unsigned char	*start,		// Start of operands
+			*end;		// End of operator
+    int			num_values,	// Number of operands
+			values[4];	// Integer values of first operands
+  }		ops[TTF_CFF_MAX_OPS];	// Operators
+} _ttf_cff_dict_t;
+
+typedef struct _ttf_cff_index_s		// CFF INDEX
+{
+  unsigned		count,		// Number of objects
+			off_size;	// Size of offsets
+  const unsigned char	*offsets,	// Offset array
+			*data,		// Object data (offset 1)
+			*end;		// End of INDEX
+} _ttf_cff_index_t;
+
+typedef struct _ttf_cff_subrs_s		// CFF subroutine usage state
+{
+  const _ttf_cff_index_t *gsubrs,	// Global subroutines
+			*lsubrs;	// Local subroutines
+  unsigned char		*gused,		// Used global subroutines
+			*lused;		// Used local subroutines
+  int			stack[TTF_CFF_MAX_STACK],
+					// Operand stack
+			num_stack,	// Number of operands
+			num_stems;	// Number of stem hints
+} _ttf_cff_subrs_t;
+
+typedef struct _ttf_kclass_s		// Class-based kerning subtable
+{
+  unsigned	seq;			// Subtable sequence number
+  int		first1,			// First glyph in class1 array
+		num1,			// Number of glyphs in class1 array
+		first2,			// First glyph in class2 array
+		num2,			// Number of glyphs in class2 array
+		num_classes2;		// Number of second glyph classes
+  unsigned short *class1,		// First glyph classes (`TTF_GLYPH_NONE` if not covered)
+		*class2;		// Second glyph classes
+  short		*adjust;		// Adjustments in font units
+} _ttf_kclass_t;
+
+typedef struct _ttf_kpair_s		// Kerning pair
+{
+  unsigned	pair;			// First glyph << 16 | second glyph
+  short		adjust;			// Adjustment in font units
+  unsigned short seq;			// Subtable sequence number
+} _ttf_kpair_t;
+
 typedef struct _ttf_metric_s		//*** Font metric information ****/
 {
   short		width,			// Advance width
@@ -179,7 +264,10 @@ typedef struct _ttf_off_names_s		// OFF/TTF naming table
 
 struct _ttf_s
 {
-  int		fd;			// File descriptor
+  unsigned char	*data;			// Font file data
+  size_t	datasize,		// Size of font file data
+		dataoff;		// Current offset in font file data
+  bool		mapped;			// Is the font file data memory-mapped?
   size_t	idx;			// Font number in file
   ttf_err_cb_t	err_cb;			// Error callback, if any
   void		*err_data;		// Error callback data
@@ -190,13 +278,23 @@ struct _ttf_s
   char		*family;		// Font family string
   char		*postscript_name;	// PostScript name string
   char		*version;		// Font version string
+  bool		is_cff;			// Does this font use CFF outlines?
   bool		is_fixed;		// Is this a fixed-width font?
   int		max_char,		// Last character in font
-		min_char;		// First character in font
+		min_char,		// First character in font
+		num_glyphs;		// Number of glyphs in font
   size_t	num_cmap;		// Number of entries in glyph map
-  int		*cmap;			// Unicode character to glyph map
-  _ttf_metric_t	*widths[TTF_FONT_MAX_CHAR / 256];
-					// Character metrics (sparse array)
+  unsigned short *cmap_pages[TTF_FONT_MAX_CHAR / 256];
+					// Unicode character to glyph map (sparse array)
+  int		*cmap;			// Flat glyph map for @link ttfGetCMap@, if any
+  int		num_metrics;		// Number of glyph metrics
+  _ttf_metric_t	*metrics;		// Glyph metrics
+  unsigned	kseq;			// Next kerning subtable sequence number
+  size_t	num_kpairs,		// Number of kerning pairs
+		alloc_kpairs;		// Allocated kerning pairs
+  _ttf_kpair_t	*kpairs;		// Kerning pairs, sorted by glyphs
+  size_t	num_kclasses;		// Number of class-based kerning subtables
+  _ttf_kclass_t	*kclasses;		// Class-based kerning subtables
   float		units;			// Width units
   short		ascent,			// Maximum ascent above baseline
 		descent,		// Maximum descent below baseline
@@ -281,21 +379,60 @@ typedef struct _ttf_off_post_s		// PostScript information
 // Local functions...
 //
 
+static bool	add_kpair(ttf_t *font, unsigned first, unsigned second, int adjust);
+static bool	cff_add(ttf_t *font, _ttf_cff_buf_t *buf, const void *data, size_t length);
+static bool	cff_add_index(ttf_t *font, _ttf_cff_buf_t *buf, size_t count, const unsigned char * const *objs, const size_t *lengths);
+static bool	cff_add_int(ttf_t *font, _ttf_cff_buf_t *buf, int value);
+static bool	cff_add_op(ttf_t *font, _ttf_cff_buf_t *buf, unsigned op);
+static const int *cff_get_op(const _ttf_cff_dict_t *dict, unsigned op, int num_values);
+static const unsigned char *cff_get_object(const _ttf_cff_index_t *idx, unsigned n, size_t *length);
+static bool	cff_mark_subrs(_ttf_cff_subrs_t *state, const unsigned char *cs, size_t length, int depth);
+static bool	cff_read_dict(const unsigned char *start, const unsigned char *end, _ttf_cff_dict_t *dict);
+static const unsigned char *cff_read_index(const unsigned char *start, const unsigned char *end, _ttf_cff_index_t *idx);
+static int	compare_kpairs(_ttf_kpair_t *a, _ttf_kpair_t *b);
 static char	*copy_name(ttf_t *font, unsigned name_id);
+static unsigned char *copy_table(ttf_t *font, unsigned tag, unsigned *length);
 static void	errorf(ttf_t *font, const char *message, ...) TTF_FORMAT_ARGS(2,3);
+static int	get_glyph(ttf_t *font, int ch);
+static const _ttf_metric_t *get_metric(ttf_t *font, int ch);
+static unsigned	get_ulong(const unsigned char *ptr);
+static unsigned	get_ushort(const unsigned char *ptr);
+static void	put_ulong(unsigned char *ptr, unsigned value);
+static void	put_ushort(unsigned char *ptr, unsigned value);
+static ssize_t	read_bytes(ttf_t *font, void *buffer, size_t bytes);
+static unsigned short *read_classdef(ttf_t *font, const unsigned char *table, size_t length, size_t offset, int *first, int *num);
 static bool	read_cmap(ttf_t *font);
+static unsigned short *read_coverage(ttf_t *font, const unsigned char *table, size_t length, size_t offset, int *num);
+static bool	read_file(ttf_t *font, const char *filename);
+static bool	read_gpos(ttf_t *font);
 static bool	read_head(ttf_t *font, _ttf_off_head_t *head);
 static bool	read_hhea(ttf_t *font, _ttf_off_hhea_t *hhea);
 static _ttf_metric_t *read_hmtx(ttf_t *font, _ttf_off_hhea_t *hhea);
+static bool	read_kern(ttf_t *font);
 static int	read_maxp(ttf_t *font);
 static bool	read_names(ttf_t *font);
 static bool	read_os_2(ttf_t *font, _ttf_off_os_2_t *os_2);
+static bool	read_pairpos(ttf_t *font, const unsigned char *table, size_t length, size_t offset);
 static bool	read_post(ttf_t *font, _ttf_off_post_t *post);
 static int	read_short(ttf_t *font);
 static bool	read_table(ttf_t *font);
 static unsigned	read_ulong(ttf_t *font);
 static int	read_ushort(ttf_t *font);
 static unsigned	seek_table(ttf_t *font, unsigned tag, unsigned offset, bool required);
+static bool	set_glyph(ttf_t *font, unsigned ch, unsigned glyph);
+
+
+//
+// Local globals...
+//
+
+#ifdef _WIN32
+static SRWLOCK		cmap_mutex = SRWLOCK_INIT;
+					// Mutex for flat glyph maps
+#else
+static pthread_mutex_t	cmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+					// Mutex for flat glyph maps
+#endif // _WIN32
 
 
 //
@@ -330,8 +467,7 @@ ttfCreate(const char   *filename,	// I - Filename
           void         *err_data)	// I - Error callback data
 {
   ttf_t			*font = NULL;	// New font object
-  size_t		i;		// Looping var
-  _ttf_metric_t		*widths = NULL;	// Glyph metrics
+  size_t		i, j;		// Looping vars
   _ttf_off_head_t	head;		// head table
   _ttf_off_hhea_t	hhea;		// hhea table
   _ttf_off_os_2_t	os_2;		// OS/2 table
@@ -355,14 +491,11 @@ ttfCreate(const char   *filename,	// I - Filename
   font->err_cb   = err_cb;
   font->err_data = err_data;
 
-  // Open the font file...
-  if ((font->fd = open(filename, O_RDONLY | O_BINARY)) < 0)
-  {
-    errorf(font, "Unable to open '%s': %s", filename, strerror(errno));
+  // Load the font file...
+  if (!read_file(font, filename))
     goto error;
-  }
 
-  TTF_DEBUG("ttfCreate: fd=%d\n", font->fd);
+  TTF_DEBUG("ttfCreate: data=%p, datasize=%u, mapped=%s\n", (void *)font->data, (unsigned)font->datasize, font->mapped ? "true" : "false");
 
   // Read the table of contents and the identifying names...
   if (!read_table(font))
@@ -397,6 +530,8 @@ ttfCreate(const char   *filename,	// I - Filename
   if (!read_cmap(font))
     goto error;
 
+  font->is_cff = seek_table(font, TTF_OFF_CFF, 0, false) != 0;
+
   if (!read_head(font, &head))
     goto error;
 
@@ -422,13 +557,15 @@ ttfCreate(const char   *filename,	// I - Filename
   font->ascent  = hhea.ascender;
   font->descent = hhea.descender;
 
-  if (read_maxp(font) < 0)
+  if ((font->num_glyphs = read_maxp(font)) < 0)
     goto error;
 
   if (hhea.numberOfHMetrics > 0)
   {
-    if ((widths = read_hmtx(font, &hhea)) == NULL)
+    if ((font->metrics = read_hmtx(font, &hhea)) == NULL)
       goto error;
+
+    font->num_metrics = hhea.numberOfHMetrics;
   }
   else
   {
@@ -436,6 +573,18 @@ ttfCreate(const char   *filename,	// I - Filename
     goto error;
   }
 
+  // Read the kerning pairs, preferring GPOS over the older kern table...
+  if (!read_gpos(font))
+    goto error;
+
+  if (font->num_kpairs == 0 && font->num_kclasses == 0 && !read_kern(font))
+    goto error;
+
+  if (font->num_kpairs > 1)
+    qsort(font->kpairs, font->num_kpairs, sizeof(_ttf_kpair_t), (int (*)(const void *, const void *))compare_kpairs);
+
+  TTF_DEBUG("ttfCreate: num_kpairs=%u, num_kclasses=%u\n", (unsigned)font->num_kpairs, (unsigned)font->num_kclasses);
+
   if (read_os_2(font, &os_2))
   {
     // Copy key values from OS/2 table...
@@ -473,49 +622,36 @@ ttfCreate(const char   *filename,	// I - Filename
   if (font->x_height == 0)
     font->x_height = 3 * font->ascent / 5;
 
-  // Build a sparse glyph widths table...
+  // Find the first and last mapped characters...
   font->min_char = -1;
 
-  for (i = 0; i < font->num_cmap; i ++)
+  for (i = 0; i < (TTF_FONT_MAX_CHAR / 256); i ++)
   {
-    if (font->cmap[i] >= 0)
-    {
-      int	bin = (int)i / 256,	// Sub-array bin
-		glyph = font->cmap[i];	// Glyph index
-
-      // Update min/max...
-      if (font->min_char < 0)
-        font->min_char = (int)i;
+    if (!font->cmap_pages[i])
+      continue;
 
-      font->max_char = (int)i;
-
-      // Allocate a sub-array as needed...
-      if (!font->widths[bin])
-        font->widths[bin] = (_ttf_metric_t *)calloc(256, sizeof(_ttf_metric_t));
+    for (j = 0; j < 256; j ++)
+    {
+      if (font->cmap_pages[i][j] != TTF_GLYPH_NONE)
+      {
+        if (font->min_char < 0)
+          font->min_char = (int)(i * 256 + j);
 
-      // Copy the width of the specified glyph or the last one if we are past
-      // the end of the table...
-      if (glyph >= hhea.numberOfHMetrics)
-	font->widths[bin][i & 255] = widths[hhea.numberOfHMetrics - 1];
-      else
-	font->widths[bin][i & 255] = widths[glyph];
+        font->max_char = (int)(i * 256 + j);
+      }
     }
+  }
 
 #ifdef DEBUG
-    if (i >= ' ' && i < 127 && font->widths[0])
-      TTF_DEBUG("ttfCreate: width['%c']=%d(%d)\n", (char)i, font->widths[0][i].width, font->widths[0][i].left_bearing);
+  for (i = ' '; i < 127; i ++)
+    TTF_DEBUG("ttfCreate: width['%c']=%d(%d)\n", (char)i, get_metric(font, (int)i)->width, get_metric(font, (int)i)->left_bearing);
 #endif // DEBUG
-  }
-
-  // Cleanup and return the font...
-  free(widths);
 
   return (font);
 
   // If we get here something bad happened...
   error:
 
-  free(widths);
   ttfDelete(font);
 
   return (NULL);
@@ -523,394 +659,2176 @@ ttfCreate(const char   *filename,	// I - Filename
 
 
 //
-// 'ttfDelete()' - Free all memory used for a font family object.
+// 'ttfCreateCFF()' - Create a CID-keyed CFF font program for some characters.
 //
-
-void
-ttfDelete(ttf_t *font)			// I - Font
-{
-  int	i;				// Looping var
-
-
-  // Range check input...
-  if (!font)
-    return;
-
-  // Close the font file...
-  if (font->fd >= 0)
-    close(font->fd);
-
-  // Free all memory used...
-  free(font->copyright);
-  free(font->family);
-  free(font->postscript_name);
-  free(font->version);
-
-  free(font->table.entries);
-  free(font->names.names);
-  free(font->names.storage);
-
-  free(font->cmap);
-
-  for (i = 0; i < 256; i ++)
-    free(font->widths[i]);
-
-  free(font);
-}
-
-
+// This function creates a CID-keyed Compact Font Format (CFF) font program
+// from a font with CFF outlines, containing only the glyphs needed for the
+// "num_chars" Unicode characters in the "chars" array, which must be sorted.
+// The CID of each glyph is the Unicode character, so the font program can be
+// used with the "Identity-H" encoding and the Adobe-Identity-0 character
+// collection.  Glyphs used by more than one character are copied for each
+// character.  The subroutines used by the glyphs are kept, while unused
+// subroutines are emptied so that the subroutine numbers do not change.
 //
-// 'ttfGetAscent()' - Get the maximum height of non-accented characters.
+// The "datasize" argument receives the size of the returned font data, which
+// must be freed using the `free` function.  `NULL` is returned if the font
+// does not use CFF outlines - see @link ttfIsCFF@.
 //
 
-int					// O - Ascent in 1000ths
-ttfGetAscent(ttf_t *font)		// I - Font
+unsigned char *				// O - CFF data or `NULL` on error
+ttfCreateCFF(ttf_t     *font,		// I - Font
+             size_t    num_chars,	// I - Number of characters
+             const int *chars,		// I - Unicode characters
+             size_t    *datasize)	// O - Size of CFF data
 {
-  return (font ? (int)(1000 * font->ascent / font->units) : 0);
-}
+  unsigned char		*data = NULL,	// CFF data
+			*fdsel = NULL,	// Font dict for each source glyph
+			*gused = NULL,	// Used global subroutines
+			*lused[TTF_CFF_MAX_FDS],
+					// Used local subroutines
+			newfd[TTF_CFF_MAX_FDS],
+					// New font dict numbers
+			temp[8];	// Temporary buffer
+  const unsigned char	*cff,		// CFF table
+			*cffend,	// End of CFF table
+			*ptr,		// Pointer into CFF table
+			**objs = NULL;	// Objects for INDEX
+  size_t		*lengths = NULL,// Lengths of objects for INDEX
+			length,		// Length of object
+			i,		// Looping var
+			num_objs,	// Number of objects
+			num_glyphs = 0,	// Number of glyphs in new font
+			num_fds,	// Number of source font dicts
+			num_newfds = 0,	// Number of new font dicts
+			priv_offsets[TTF_CFF_MAX_FDS],
+					// Offsets of new Private DICTs
+			priv_sizes[TTF_CFF_MAX_FDS];
+					// Sizes of new Private DICTs
+  unsigned		cfflen;		// Length of CFF table
+  int			*gids = NULL,	// Source glyph for each new glyph
+			*cids = NULL,	// CID for each new glyph
+			gid,		// Current glyph
+			pass,		// Current layout pass
+			charset_offset = 0,
+					// Offset of charset
+			fdselect_offset = 0,
+					// Offset of FDSelect
+			cs_offset = 0,	// Offset of CharStrings INDEX
+			fdarray_offset = 0,
+					// Offset of FDArray INDEX
+			priv_offset = 0;// Offset of Private DICTs
+  const int		*values;	// DICT operands
+  bool			is_cid,		// Source font is CID-keyed?
+			fd_used[TTF_CFF_MAX_FDS];
+					// Font dict used?
+  _ttf_cff_index_t	names,		// Name INDEX
+			tops,		// Top DICT INDEX
+			strings,	// String INDEX
+			gsubrs,		// Global Subr INDEX
+			charstrings,	// CharStrings INDEX
+			fdarray,	// FDArray INDEX
+			lsubrs[TTF_CFF_MAX_FDS];
+					// Local Subr INDEXes
+  _ttf_cff_dict_t	top,		// Top DICT
+			dict;		// Font or Private DICT
+  struct
+  {
+    const unsigned char	*dict,		// Font DICT, if any
+			*priv;		// Private DICT, if any
+    size_t		dict_len,	// Length of font DICT
+			priv_len;	// Length of Private DICT
+  }			fds[TTF_CFF_MAX_FDS];
+					// Source font dicts
+  _ttf_cff_subrs_t	state;		// Subroutine usage state
+  _ttf_cff_buf_t	strbuf,		// String INDEX
+			gsubrbuf,	// Global Subr INDEX
+			charset,	// charset
+			fdselect,	// FDSelect
+			csbuf,		// CharStrings INDEX
+			privbuf,	// Private DICTs and Local Subr INDEXes
+			topbuf,		// Top DICT
+			fdbuf,		// Font DICTs
+			fdindex,	// FDArray INDEX
+			out;		// Output CFF data
+  static const unsigned char header[4] = { 1, 0, 4, 4 };
+					// CFF header
+  static const unsigned	top_skip[] =	// Top DICT operators that are replaced
+  {
+    13, 14, 15, 16, 17, 18, 1220, 1230, 1234, 1235, 1236, 1237
+  };
 
 
-//
-// 'ttfGetBounds()' - Get the bounds of all characters in a font.
-//
-// This function gets the bounds of all characters in a font.  The "bounds"
-// argument is a pointer to a `ttf_rect_t` structure that will be filled with
-// the limits for characters in the font scaled to a 1000x1000 unit square.
-//
+  TTF_DEBUG("ttfCreateCFF(font=%p, num_chars=%u, chars=%p, datasize=%p)\n", (void *)font, (unsigned)num_chars, (void *)chars, (void *)datasize);
 
-ttf_rect_t *				// O - Bounds or `NULL` on error
-ttfGetBounds(ttf_t      *font,		// I - Font
-             ttf_rect_t *bounds)	// I - Bounds buffer
-{
   // Range check input...
-  if (!font || !bounds)
-  {
-    if (bounds)
-      memset(bounds, 0, sizeof(ttf_rect_t));
+  if (datasize)
+    *datasize = 0;
 
+  if (!font || (num_chars > 0 && !chars) || !datasize)
+  {
+    errno = EINVAL;
     return (NULL);
   }
 
-  bounds->left   = 1000.0f * font->x_min / font->units;
-  bounds->right  = 1000.0f * font->x_max / font->units;
-  bounds->bottom = 1000.0f * font->y_min / font->units;
-  bounds->top    = 1000.0f * font->y_max / font->units;
-
-  return (bounds);
-}
-
+  if ((cfflen = seek_table(font, TTF_OFF_CFF, 0, true)) == 0)
+    return (NULL);
 
-//
-// 'ttfGetCapHeight()' - Get the height of capital letters.
-//
+  memset(lused, 0, sizeof(lused));
+  memset(lsubrs, 0, sizeof(lsubrs));
+  memset(fd_used, 0, sizeof(fd_used));
+  memset(fds, 0, sizeof(fds));
+  memset(&strbuf, 0, sizeof(strbuf));
+  memset(&gsubrbuf, 0, sizeof(gsubrbuf));
+  memset(&charset, 0, sizeof(charset));
+  memset(&fdselect, 0, sizeof(fdselect));
+  memset(&csbuf, 0, sizeof(csbuf));
+  memset(&privbuf, 0, sizeof(privbuf));
+  memset(&topbuf, 0, sizeof(topbuf));
+  memset(&fdbuf, 0, sizeof(fdbuf));
+  memset(&fdindex, 0, sizeof(fdindex));
+  memset(&out, 0, sizeof(out));
 
-int					// O - Capital letter height in 1000ths
-ttfGetCapHeight(ttf_t *font)		// I - Font
-{
-  return (font ? (int)(1000 * font->cap_height / font->units) : 0);
-}
+  if (cfflen > (font->datasize - font->dataoff))
+    cfflen = (unsigned)(font->datasize - font->dataoff);
 
+  cff    = font->data + font->dataoff;
+  cffend = cff + cfflen;
 
-//
-// 'ttfGetCMap()' - Get the Unicode to glyph mapping table.
-//
+  // Read the header, Name INDEX, Top DICT INDEX, String INDEX, and Global Subr
+  // INDEX...
+  if (cfflen < 4 || cff[0] != 1 || cff[2] < 4 || cff[2] > cfflen)
+    goto bad_cff;
 
-const int *				// O - CMap table
-ttfGetCMap(ttf_t  *font,		// I - Font
-           size_t *num_cmap)		// O - Number of entries in table
-{
-  // Range check input...
-  if (!font || !num_cmap)
-  {
-    if (num_cmap)
-      *num_cmap = 0;
+  if ((ptr = cff_read_index(cff + cff[2], cffend, &names)) == NULL || names.count < 1)
+    goto bad_cff;
 
-    return (NULL);
-  }
+  if ((ptr = cff_read_index(ptr, cffend, &tops)) == NULL || tops.count < 1)
+    goto bad_cff;
 
-  *num_cmap = font->num_cmap;
-  return (font->cmap);
-}
+  if ((ptr = cff_read_index(ptr, cffend, &strings)) == NULL || strings.count > (65535 - 391 - 2))
+    goto bad_cff;
 
+  if (cff_read_index(ptr, cffend, &gsubrs) == NULL)
+    goto bad_cff;
 
-//
-// 'ttfGetCopyright()' - Get the copyright text for a font.
-//
+  if ((ptr = cff_get_object(&tops, 0, &length)) == NULL || !cff_read_dict(ptr, ptr + length, &top))
+    goto bad_cff;
 
-const char *				// O - Copyright text
-ttfGetCopyright(ttf_t *font)		// I - Font
-{
-  return (font ? font->copyright : NULL);
-}
+  if ((values = cff_get_op(&top, 1206, 1)) != NULL && values[0] != 2)
+  {
+    errorf(font, "Unsupported CFF charstring type %d.", values[0]);
+    goto done;
+  }
 
+  // Read the CharStrings INDEX...
+  if ((values = cff_get_op(&top, 17, 1)) == NULL || values[0] <= 0 || values[0] >= (int)cfflen || cff_read_index(cff + values[0], cffend, &charstrings) == NULL || charstrings.count < 1)
+    goto bad_cff;
 
-//
-// 'ttfGetDescent()' - Get the maximum depth of non-accented characters.
-//
+  // Read the font dicts, treating a name-keyed font as a single font dict...
+  if ((fdsel = calloc(charstrings.count, 1)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for CFF font dicts.");
+    goto done;
+  }
 
-int					// O - Descent in 1000ths
-ttfGetDescent(ttf_t *font)		// I - Font
-{
-  return (font ? (int)(1000 * font->descent / font->units) : 0);
-}
+  is_cid = cff_get_op(&top, 1230, 3) != NULL;
 
+  if (is_cid)
+  {
+    if ((values = cff_get_op(&top, 1236, 1)) == NULL || values[0] <= 0 || values[0] >= (int)cfflen || cff_read_index(cff + values[0], cffend, &fdarray) == NULL || fdarray.count < 1 || fdarray.count > TTF_CFF_MAX_FDS)
+      goto bad_cff;
 
-//
-// 'ttfGetExtents()' - Get the extents of a UTF-8 string.
-//
-// This function computes the extents of the UTF-8 string "s" when rendered
-// using the specified font "font" and size "size".  The "extents" argument is
-// a pointer to a `ttf_rect_t` structure that is filled with the extents of a
-// simple rendering of the string with no kerning or rewriting applied.  The
-// values are scaled using the specified font size.
-//
+    num_fds = fdarray.count;
 
-ttf_rect_t *				// O - Pointer to extents or `NULL` on error
-ttfGetExtents(
-    ttf_t      *font,			// I - Font
-    float      size,			// I - Font size
-    const char *s,			// I - String
-    ttf_rect_t *extents)		// O - Extents of the string
-{
-  bool		first = true;		// First character?
-  int		ch,			// Current character
-		width = 0;		// Width
-  _ttf_metric_t	*widths;		// Widths
+    for (i = 0; i < num_fds; i ++)
+    {
+      if ((fds[i].dict = cff_get_object(&fdarray, (unsigned)i, &fds[i].dict_len)) == NULL || !cff_read_dict(fds[i].dict, fds[i].dict + fds[i].dict_len, &dict))
+        goto bad_cff;
 
+      if ((values = cff_get_op(&dict, 18, 2)) != NULL)
+      {
+        if (values[0] < 0 || values[1] <= 0 || values[1] > (int)cfflen || values[0] > (int)(cfflen - (unsigned)values[1]))
+          goto bad_cff;
 
-  TTF_DEBUG("ttfGetExtents(font=%p, size=%.2f, s=\"%s\", extents=%p)\n", (void *)font, size, s, (void *)extents);
+	fds[i].priv     = cff + values[1];
+	fds[i].priv_len = (size_t)values[0];
+      }
+    }
 
-  // Make sure extents is zeroed out...
-  if (extents)
-    memset(extents, 0, sizeof(ttf_rect_t));
+    // Read the FDSelect table...
+    if ((values = cff_get_op(&top, 1237, 1)) == NULL || values[0] <= 0 || values[0] >= (int)cfflen)
+      goto bad_cff;
 
-  // Range check input...
-  if (!font || size <= 0.0f || !s || !extents)
-    return (NULL);
+    ptr = cff + values[0];
 
-  // Loop through the string...
-  while (*s)
-  {
-    // Get the next Unicode character...
-    if ((*s & 0xe0) == 0xc0 && (s[1] & 0xc0) == 0x80)
-    {
-      // Two byte UTF-8
-      ch = ((*s & 0x1f) << 6) | (s[1] & 0x3f);
-      s += 2;
-    }
-    else if ((*s & 0xf0) == 0xe0 && (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80)
+    if (*ptr == 0)
     {
-      // Three byte UTF-8
-      ch = ((*s & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
-      s += 3;
+      // Format 0 - one font dict per glyph...
+      if ((size_t)(cffend - ptr - 1) < charstrings.count)
+        goto bad_cff;
+
+      memcpy(fdsel, ptr + 1, charstrings.count);
     }
-    else if ((*s & 0xf8) == 0xf0 && (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80 && (s[3] & 0xc0) == 0x80)
+    else if (*ptr == 3 && (ptr + 3) <= cffend)
     {
-      // Four byte UTF-8
-      ch = ((*s & 0x07) << 18) | ((s[1] & 0x3f) << 12) | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
-      s += 4;
+      // Format 3 - ranges of glyphs...
+      unsigned	num_ranges = get_ushort(ptr + 1),
+					// Number of ranges
+		first,			// First glyph in range
+		last;			// First glyph in next range
+
+      if ((ptr + 3 + 3 * num_ranges + 2) > cffend)
+        goto bad_cff;
+
+      for (ptr += 3; num_ranges > 0; num_ranges --, ptr += 3)
+      {
+        first = get_ushort(ptr);
+        last  = get_ushort(ptr + 3);
+
+        while (first < last && first < charstrings.count)
+          fdsel[first ++] = ptr[2];
+      }
     }
-    else if (*s & 0x80)
+    else
     {
-      // Invalid UTF-8
-      errorf(font, "Invalid UTF-8 sequence starting with 0x%02X.", *s & 255);
-      return (NULL);
+      goto bad_cff;
     }
-    else
+
+    for (i = 0; i < charstrings.count; i ++)
     {
-      // ASCII...
-      ch = *s++;
+      if (fdsel[i] >= num_fds)
+        goto bad_cff;
     }
+  }
+  else
+  {
+    // Name-keyed font...
+    num_fds = 1;
 
-    // Find its width...
-    if ((widths = font->widths[ch / 256]) != NULL)
+    if ((values = cff_get_op(&top, 18, 2)) != NULL)
     {
-      if (first)
-      {
-        extents->left = -widths[ch & 255].left_bearing / font->units;
-        first         = false;
-      }
+      if (values[0] < 0 || values[1] <= 0 || values[1] > (int)cfflen || values[0] > (int)(cfflen - (unsigned)values[1]))
+	goto bad_cff;
 
-      width += widths[ch & 255].width;
+      fds[0].priv     = cff + values[1];
+      fds[0].priv_len = (size_t)values[0];
     }
-    else if ((widths = font->widths[0]) != NULL)
+  }
+
+  // Read the local subroutines for each font dict...
+  for (i = 0; i < num_fds; i ++)
+  {
+    if (!fds[i].priv)
+      continue;
+
+    if (!cff_read_dict(fds[i].priv, fds[i].priv + fds[i].priv_len, &dict))
+      goto bad_cff;
+
+    if ((values = cff_get_op(&dict, 19, 1)) != NULL && values[0] > 0)
     {
-      // Use the ".notdef" (0) glyph width...
-      if (first)
+      if ((size_t)values[0] >= (size_t)(cffend - fds[i].priv) || cff_read_index(fds[i].priv + values[0], cffend, lsubrs + i) == NULL)
+        goto bad_cff;
+
+      if (lsubrs[i].count > 0 && (lused[i] = calloc(lsubrs[i].count, 1)) == NULL)
       {
-        extents->left = -widths[0].left_bearing / font->units;
-        first         = false;
+	errorf(font, "Unable to allocate memory for CFF subroutines.");
+	goto done;
       }
-
-      width += widths[0].width;
     }
   }
 
-  // Calculate the bounding box for the text and return...
-  TTF_DEBUG("ttfGetExtents: width=%d\n", width);
-
-  extents->bottom = size * font->y_min / font->units;
-  extents->right  = size * width / font->units + extents->left;
-  extents->top    = size * font->y_max / font->units;
+  // Build the list of glyphs, starting with .notdef...
+  if ((gids = calloc(num_chars + 1, sizeof(int))) == NULL || (cids = calloc(num_chars + 1, sizeof(int))) == NULL || (gsubrs.count > 0 && (gused = calloc(gsubrs.count, 1)) == NULL))
+  {
+    errorf(font, "Unable to allocate memory for glyphs.");
+    goto done;
+  }
 
-  return (extents);
-}
+  num_glyphs = 1;
 
+  for (i = 0; i < num_chars; i ++)
+  {
+    if (chars[i] <= cids[num_glyphs - 1] || chars[i] > 0xffff || (gid = get_glyph(font, chars[i])) <= 0 || gid >= (int)charstrings.count)
+      continue;				// Not sorted, not a CID, or not mapped
 
-//
-// 'ttfGetFamily()' - Get the family name of a font.
-//
+    gids[num_glyphs]   = gid;
+    cids[num_glyphs ++] = chars[i];
+  }
 
-const char *				// O - Family name
-ttfGetFamily(ttf_t *font)		// I - Font
-{
-  return (font ? font->family : NULL);
-}
+  // Mark the font dicts and subroutines that are used...
+  memset(&state, 0, sizeof(state));
+  state.gsubrs = &gsubrs;
+  state.gused  = gused;
 
+  for (i = 0; i < num_glyphs; i ++)
+  {
+    gid = gids[i];
 
-//
-// 'ttfGetItalicAngle()' - Get the italic angle.
-//
+    fd_used[fdsel[gid]] = true;
 
-float					// O - Angle in degrees
-ttfGetItalicAngle(ttf_t *font)		// I - Font
-{
-  return (font ? font->italic_angle : 0.0f);
-}
+    state.lsubrs    = lused[fdsel[gid]] ? lsubrs + fdsel[gid] : NULL;
+    state.lused     = lused[fdsel[gid]];
+    state.num_stack = 0;
+    state.num_stems = 0;
+
+    if ((ptr = cff_get_object(&charstrings, (unsigned)gid, &length)) != NULL)
+      cff_mark_subrs(&state, ptr, length, 0);
+  }
+
+  for (i = 0; i < num_fds; i ++)
+  {
+    if (fd_used[i])
+      newfd[i] = (unsigned char)num_newfds ++;
+  }
+
+  // Allocate the object arrays for the largest INDEX...
+  for (i = 0, num_objs = num_glyphs; i < num_fds; i ++)
+  {
+    if (lsubrs[i].count > num_objs)
+      num_objs = lsubrs[i].count;
+  }
+
+  if (gsubrs.count > num_objs)
+    num_objs = gsubrs.count;
+  if ((strings.count + 2) > num_objs)
+    num_objs = strings.count + 2;
+  if (num_fds > num_objs)
+    num_objs = num_fds;
+
+  if ((objs = calloc(num_objs, sizeof(unsigned char *))) == NULL || (lengths = calloc(num_objs, sizeof(size_t))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for CFF objects.");
+    goto done;
+  }
+
+  // Copy the strings, adding "Adobe" and "Identity" for the ROS operator...
+  for (i = 0; i < strings.count; i ++)
+  {
+    if ((objs[i] = cff_get_object(&strings, (unsigned)i, lengths + i)) == NULL)
+      goto bad_cff;
+  }
+
+  objs[i]    = (const unsigned char *)"Adobe";
+  lengths[i] = 5;
+  i ++;
+  objs[i]    = (const unsigned char *)"Identity";
+  lengths[i] = 8;
+
+  if (!cff_add_index(font, &strbuf, strings.count + 2, objs, lengths))
+    goto done;
+
+  // Copy the global subroutines that are used...
+  for (i = 0; i < gsubrs.count; i ++)
+  {
+    if (!gused[i] || (objs[i] = cff_get_object(&gsubrs, (unsigned)i, lengths + i)) == NULL)
+      objs[i] = NULL;
+  }
+
+  if (!cff_add_index(font, &gsubrbuf, gsubrs.count, objs, lengths))
+    goto done;
+
+  // Write the charset (format 2) mapping glyphs to CIDs...
+  temp[0] = 2;
+  if (!cff_add(font, &charset, temp, 1))
+    goto done;
+
+  for (i = 1; i < num_glyphs; i += length + 1)
+  {
+    for (length = 0; (i + length + 1) < num_glyphs && cids[i + length + 1] == (cids[i + length] + 1) && length < 65535; length ++);
+
+    put_ushort(temp, (unsigned)cids[i]);
+    put_ushort(temp + 2, (unsigned)length);
+
+    if (!cff_add(font, &charset, temp, 4))
+      goto done;
+  }
+
+  // Write the FDSelect table (format 3)...
+  for (i = 0, num_objs = 0; i < num_glyphs; i ++)
+  {
+    if (i == 0 || fdsel[gids[i]] != fdsel[gids[i - 1]])
+      num_objs ++;
+  }
+
+  temp[0] = 3;
+  put_ushort(temp + 1, (unsigned)num_objs);
+  if (!cff_add(font, &fdselect, temp, 3))
+    goto done;
+
+  for (i = 0; i < num_glyphs; i ++)
+  {
+    if (i == 0 || fdsel[gids[i]] != fdsel[gids[i - 1]])
+    {
+      put_ushort(temp, (unsigned)i);
+      temp[2] = newfd[fdsel[gids[i]]];
+
+      if (!cff_add(font, &fdselect, temp, 3))
+        goto done;
+    }
+  }
+
+  put_ushort(temp, (unsigned)num_glyphs);
+  if (!cff_add(font, &fdselect, temp, 2))
+    goto done;
+
+  // Copy the charstrings...
+  for (i = 0; i < num_glyphs; i ++)
+  {
+    if ((objs[i] = cff_get_object(&charstrings, (unsigned)gids[i], lengths + i)) == NULL)
+      goto bad_cff;
+  }
+
+  if (!cff_add_index(font, &csbuf, num_glyphs, objs, lengths))
+    goto done;
+
+  // Copy the Private DICTs that are used, each followed by its local
+  // subroutines...
+  for (i = 0; i < num_fds; i ++)
+  {
+    size_t	start = privbuf.length,	// Start of Private DICT
+		j;			// Looping var
+
+    if (!fd_used[i])
+      continue;
+
+    if (fds[i].priv)
+    {
+      if (!cff_read_dict(fds[i].priv, fds[i].priv + fds[i].priv_len, &dict))
+        goto bad_cff;
+
+      for (j = 0; j < dict.num_ops; j ++)
+      {
+        if (dict.ops[j].op != 19 && !cff_add(font, &privbuf, dict.ops[j].start, (size_t)(dict.ops[j].end - dict.ops[j].start)))
+          goto done;
+      }
+
+      if (lused[i])
+      {
+        // Local subroutines follow the Private DICT...
+        if (!cff_add_int(font, &privbuf, (int)(privbuf.length - start + 6)) || !cff_add_op(font, &privbuf, 19))
+          goto done;
+      }
+    }
+
+    priv_offsets[newfd[i]] = start;
+    priv_sizes[newfd[i]]   = privbuf.length - start;
+
+    if (lused[i])
+    {
+      for (j = 0; j < lsubrs[i].count; j ++)
+      {
+	if (!lused[i][j] || (objs[j] = cff_get_object(lsubrs + i, (unsigned)j, lengths + j)) == NULL)
+	  objs[j] = NULL;
+      }
+
+      if (!cff_add_index(font, &privbuf, lsubrs[i].count, objs, lengths))
+        goto done;
+    }
+  }
+
+  // Lay out the Top DICT and FDArray INDEX, first with placeholder offsets and
+  // then with the final offsets (all offsets use the same 5-byte form)...
+  for (pass = 0; pass < 2; pass ++)
+  {
+    size_t	j,			// Looping var
+		start;			// Start of font DICT
+
+    topbuf.length = 0;
+    fdbuf.length  = 0;
+    fdindex.length = 0;
+
+    // Top DICT, which must start with the ROS operator...
+    if (!cff_add_int(font, &topbuf, 391 + (int)strings.count) || !cff_add_int(font, &topbuf, 392 + (int)strings.count) || !cff_add_int(font, &topbuf, 0) || !cff_add_op(font, &topbuf, 1230))
+      goto done;
+
+    for (i = 0; i < top.num_ops; i ++)
+    {
+      for (j = 0; j < (sizeof(top_skip) / sizeof(top_skip[0])); j ++)
+      {
+        if (top.ops[i].op == top_skip[j])
+          break;
+      }
+
+      if (j >= (sizeof(top_skip) / sizeof(top_skip[0])) && !cff_add(font, &topbuf, top.ops[i].start, (size_t)(top.ops[i].end - top.ops[i].start)))
+        goto done;
+    }
+
+    if (!cff_add_int(font, &topbuf, cids[num_glyphs - 1] + 1) || !cff_add_op(font, &topbuf, 1234))
+      goto done;
+    if (!cff_add_int(font, &topbuf, charset_offset) || !cff_add_op(font, &topbuf, 15))
+      goto done;
+    if (!cff_add_int(font, &topbuf, fdselect_offset) || !cff_add_op(font, &topbuf, 1237))
+      goto done;
+    if (!cff_add_int(font, &topbuf, cs_offset) || !cff_add_op(font, &topbuf, 17))
+      goto done;
+    if (!cff_add_int(font, &topbuf, fdarray_offset) || !cff_add_op(font, &topbuf, 1236))
+      goto done;
+
+    // Font DICTs, with the Private DICTs following the FDArray INDEX...
+    for (i = 0, num_objs = 0; i < num_fds; i ++)
+    {
+      if (!fd_used[i])
+        continue;
+
+      start = fdbuf.length;
+
+      if (fds[i].dict)
+      {
+        if (!cff_read_dict(fds[i].dict, fds[i].dict + fds[i].dict_len, &dict))
+          goto bad_cff;
+
+	for (j = 0; j < dict.num_ops; j ++)
+	{
+	  if (dict.ops[j].op != 18 && !cff_add(font, &fdbuf, dict.ops[j].start, (size_t)(dict.ops[j].end - dict.ops[j].start)))
+	    goto done;
+	}
+      }
+
+      if (!cff_add_int(font, &fdbuf, (int)priv_sizes[num_objs]) || !cff_add_int(font, &fdbuf, priv_offset + (int)priv_offsets[num_objs]) || !cff_add_op(font, &fdbuf, 18))
+        goto done;
+
+      lengths[num_objs ++] = fdbuf.length - start;
+    }
+
+    for (i = 0, start = 0; i < num_objs; start += lengths[i], i ++)
+      objs[i] = fdbuf.data + start;
+
+    if (!cff_add_index(font, &fdindex, num_objs, objs, lengths))
+      goto done;
+
+    // Compute the offsets of everything after the Top DICT INDEX...
+    charset_offset  = (int)(sizeof(header) + (size_t)(names.end - cff - cff[2]) + 2 + 1 + 2 * 4 + topbuf.length + strbuf.length + gsubrbuf.length);
+    fdselect_offset = charset_offset + (int)charset.length;
+    cs_offset       = fdselect_offset + (int)fdselect.length;
+    fdarray_offset  = cs_offset + (int)csbuf.length;
+    priv_offset     = fdarray_offset + (int)fdindex.length;
+  }
+
+  // Write the CFF data...
+  if (!cff_add(font, &out, header, sizeof(header)))
+    goto done;
+
+  // Name INDEX (copied)...
+  if (!cff_add(font, &out, cff + cff[2], (size_t)(names.end - cff - cff[2])))
+    goto done;
+
+  // Top DICT INDEX (using 4-byte offsets)...
+  temp[0] = 0;
+  temp[1] = 1;
+  temp[2] = 4;
+  if (!cff_add(font, &out, temp, 3))
+    goto done;
+
+  put_ulong(temp, 1);
+  put_ulong(temp + 4, (unsigned)topbuf.length + 1);
+  if (!cff_add(font, &out, temp, 8) || !cff_add(font, &out, topbuf.data, topbuf.length))
+    goto done;
+
+  // Strings, global subroutines, charset, FDSelect, charstrings, FDArray,
+  // Private DICTs and local subroutines...
+  if (!cff_add(font, &out, strbuf.data, strbuf.length) || !cff_add(font, &out, gsubrbuf.data, gsubrbuf.length) || !cff_add(font, &out, charset.data, charset.length) || !cff_add(font, &out, fdselect.data, fdselect.length) || !cff_add(font, &out, csbuf.data, csbuf.length) || !cff_add(font, &out, fdindex.data, fdindex.length))
+    goto done;
+
+  if (out.length != (size_t)priv_offset)
+  {
+    errorf(font, "Bad CFF layout.");
+    goto done;
+  }
+
+  if (!cff_add(font, &out, privbuf.data, privbuf.length))
+    goto done;
+
+  data      = out.data;
+  *datasize = out.length;
+  out.data  = NULL;
+
+  goto done;
+
+  // If we get here the CFF table is bad...
+  bad_cff:
+
+  errorf(font, "Bad CFF table.");
+
+  // Free temporary memory and return...
+  done:
+
+  for (i = 0; i < TTF_CFF_MAX_FDS; i ++)
+    free(lused[i]);
+
+  free(fdsel);
+  free(gused);
+  free(gids);
+  free(cids);
+  free(objs);
+  free(lengths);
+  free(strbuf.data);
+  free(gsubrbuf.data);
+  free(charset.data);
+  free(fdselect.data);
+  free(csbuf.data);
+  free(privbuf.data);
+  free(topbuf.data);
+  free(fdbuf.data);
+  free(fdindex.data);
+  free(out.data);
+
+  return (data);
+}
+
+
+//
+// 'ttfCreateSubset()' - Create a subset of a font for the given characters.
+//
+// This function creates an in-memory copy of the font containing only the
+// glyphs needed for the "num_chars" Unicode characters in the "chars" array.
+// Glyph numbers are preserved so that existing glyph mappings remain valid,
+// but the outlines of unused glyphs are removed and the "cmap" table only maps
+// the listed characters, which must be sorted.  The "datasize" argument
+// receives the size of the returned font data, which must be freed using the
+// `free` function.
+//
+// Fonts using CFF outlines are returned unchanged - use @link ttfCreateCFF@ to
+// create a subset CFF font program for them.
+//
+
+unsigned char *				// O - Font data or `NULL` on error
+ttfCreateSubset(ttf_t     *font,	// I - Font
+                size_t    num_chars,	// I - Number of characters
+                const int *chars,	// I - Unicode characters
+                size_t    *datasize)	// O - Size of font data
+{
+  unsigned char	*data = NULL,		// Font data
+		*dataptr,		// Pointer into font data
+		*head = NULL,		// head table
+		*loca = NULL,		// Original loca table
+		*glyf = NULL,		// New glyf table
+		*glyfptr,		// Pointer into glyf table
+		*nloca = NULL,		// New loca table
+		*cmap = NULL,		// New cmap table
+		*cmapptr,		// Pointer into cmap table
+		*used = NULL,		// Used glyphs
+		*adjptr = NULL;		// Pointer to checksum adjustment
+  int		*glyphs = NULL,		// Glyphs to copy
+		num_glyphs = 0,		// Number of glyphs to copy
+		gid,			// Current glyph
+		i,			// Looping var
+		num_tables = 0;		// Number of tables in subset
+  size_t	j,			// Looping var
+		num_segs,		// Number of cmap segments
+		num_mapped;		// Number of characters to map
+  unsigned	length,			// Length of table
+		loca_length,		// Length of loca table
+		glyf_offset = 0,	// Offset of glyf table
+		glyf_length,		// Length of glyf table
+		glyf_size = 0,		// Size of new glyf table
+		start,			// Start of glyph data
+		end,			// End of glyph data
+		cmap_length,		// Length of cmap table
+		checksum,		// Table checksum
+		offset;			// Offset in font data
+  bool		long_loca;		// Long loca offsets?
+  struct
+  {
+    unsigned		tag;		// Table tag
+    unsigned char	*data;		// Table data
+    unsigned		length;		// Table length
+    bool		allocated;	// Free table data?
+  }		tables[13];		// Subset tables
+  static const unsigned copied[] =	// Tables copied unchanged, sorted by tag
+  {
+    TTF_OFF_OS_2,
+    TTF_OFF_cvt,
+    TTF_OFF_fpgm,
+    TTF_OFF_hhea,
+    TTF_OFF_hmtx,
+    TTF_OFF_maxp,
+    TTF_OFF_name,
+    TTF_OFF_post,
+    TTF_OFF_prep
+  };
+
+
+  TTF_DEBUG("ttfCreateSubset(font=%p, num_chars=%u, chars=%p, datasize=%p)\n", (void *)font, (unsigned)num_chars, (void *)chars, (void *)datasize);
+
+  // Range check input...
+  if (datasize)
+    *datasize = 0;
+
+  if (!font || (num_chars > 0 && !chars) || !datasize)
+  {
+    errno = EINVAL;
+    return (NULL);
+  }
+
+  if (seek_table(font, TTF_OFF_glyf, 0, false) == 0)
+  {
+    // CFF outlines, copy the whole font...
+    if ((data = malloc(font->datasize)) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for font: %s", strerror(errno));
+      return (NULL);
+    }
+
+    memcpy(data, font->data, font->datasize);
+    *datasize = font->datasize;
+
+    return (data);
+  }
+
+  // Load the header and glyph locations...
+  memset(tables, 0, sizeof(tables));
+
+  if ((head = copy_table(font, TTF_OFF_head, &length)) == NULL || length < 54)
+  {
+    errorf(font, "Unable to read head table.");
+    goto done;
+  }
+
+  long_loca = get_ushort(head + 50) != 0;
+
+  if ((loca = copy_table(font, TTF_OFF_loca, &loca_length)) == NULL || loca_length < (unsigned)(font->num_glyphs + 1) * (long_loca ? 4 : 2))
+  {
+    errorf(font, "Unable to read loca table.");
+    goto done;
+  }
+
+  glyf_length = seek_table(font, TTF_OFF_glyf, 0, true);
+  glyf_offset = (unsigned)font->dataoff;
+
+  if (glyf_length > (font->datasize - glyf_offset))
+    glyf_length = (unsigned)(font->datasize - glyf_offset);
+
+  // Figure out which glyphs are used, including .notdef and the components of
+  // composite glyphs...
+  if ((used = calloc((size_t)font->num_glyphs, 1)) == NULL || (glyphs = calloc((size_t)font->num_glyphs, sizeof(int))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyphs.");
+    goto done;
+  }
+
+  used[0]                 = 1;
+  glyphs[num_glyphs ++] = 0;
+
+  for (j = 0; j < num_chars; j ++)
+  {
+    if ((gid = get_glyph(font, chars[j])) > 0 && gid < font->num_glyphs && !used[gid])
+    {
+      used[gid]               = 1;
+      glyphs[num_glyphs ++] = gid;
+    }
+  }
+
+  for (i = 0; i < num_glyphs; i ++)
+  {
+    const unsigned char	*bufptr,	// Pointer into glyph data
+			*bufend;	// End of glyph data
+    unsigned		flags;		// Component flags
+
+    gid = glyphs[i];
+
+    if (long_loca)
+    {
+      start = get_ulong(loca + 4 * gid);
+      end   = get_ulong(loca + 4 * gid + 4);
+    }
+    else
+    {
+      start = 2 * get_ushort(loca + 2 * gid);
+      end   = 2 * get_ushort(loca + 2 * gid + 2);
+    }
+
+    if (end <= start || end > glyf_length)
+      continue;
+
+    glyf_size += (end - start + 3) & ~3U;
+
+    if ((end - start) < 12)
+      continue;
+
+    bufptr = font->data + glyf_offset + start;
+    bufend = font->data + glyf_offset + end;
+
+    if (!(bufptr[0] & 0x80))
+      continue;				// Not a composite glyph
+
+    for (bufptr += 10; (bufptr + 4) <= bufend; )
+    {
+      flags = get_ushort(bufptr);
+      gid   = (int)get_ushort(bufptr + 2);
+
+      if (gid < font->num_glyphs && !used[gid])
+      {
+        used[gid]               = 1;
+        glyphs[num_glyphs ++] = gid;
+      }
+
+      bufptr += (flags & TTF_OFF_ARG_1_AND_2_ARE_WORDS) ? 8 : 6;
+
+      if (flags & TTF_OFF_WE_HAVE_A_SCALE)
+        bufptr += 2;
+      else if (flags & TTF_OFF_WE_HAVE_AN_X_AND_Y_SCALE)
+        bufptr += 4;
+      else if (flags & TTF_OFF_WE_HAVE_A_TWO_BY_TWO)
+        bufptr += 8;
+
+      if (!(flags & TTF_OFF_MORE_COMPONENTS))
+        break;
+    }
+  }
+
+  // Build new glyf and loca tables with (long) offsets for every glyph...
+  if ((glyf = malloc(glyf_size > 0 ? glyf_size : 1)) == NULL || (nloca = malloc(4 * (size_t)(font->num_glyphs + 1))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyphs.");
+    goto done;
+  }
+
+  for (gid = 0, glyfptr = glyf; gid < font->num_glyphs; gid ++)
+  {
+    put_ulong(nloca + 4 * gid, (unsigned)(glyfptr - glyf));
+
+    if (!used[gid])
+      continue;
+
+    if (long_loca)
+    {
+      start = get_ulong(loca + 4 * gid);
+      end   = get_ulong(loca + 4 * gid + 4);
+    }
+    else
+    {
+      start = 2 * get_ushort(loca + 2 * gid);
+      end   = 2 * get_ushort(loca + 2 * gid + 2);
+    }
+
+    if (end <= start || end > glyf_length)
+      continue;
+
+    memcpy(glyfptr, font->data + glyf_offset + start, end - start);
+
+    // Pad glyph data to 32-bits...
+    glyfptr += end - start;
+    while ((glyfptr - glyf) & 3)
+      *glyfptr++ = 0;
+  }
+
+  put_ulong(nloca + 4 * font->num_glyphs, (unsigned)(glyfptr - glyf));
+  glyf_size = (unsigned)(glyfptr - glyf);
+
+  // Build a Windows Unicode cmap table for the characters...
+  for (j = 0, num_segs = 1, start = 0, end = 0; j < num_chars; j ++)
+  {
+    // Count consecutive runs of characters and glyphs...
+    if (chars[j] > 0xfffe || (gid = get_glyph(font, chars[j])) <= 0)
+      continue;
+
+    if (num_segs == 1 || (unsigned)chars[j] != end + 1 || gid != get_glyph(font, (int)end) + 1)
+    {
+      if (num_segs > 1 && (unsigned)chars[j] <= end)
+        continue;			// Not sorted or duplicate
+
+      num_segs ++;
+    }
+
+    end = (unsigned)chars[j];
+  }
+
+  if (num_segs > 8000)
+  {
+    // Too many characters for a format 4 table, leave the cmap empty since
+    // the glyphs are then only accessed by glyph number...
+    num_segs   = 1;
+    num_mapped = 0;
+  }
+  else
+  {
+    num_mapped = num_chars;
+  }
+
+  cmap_length = 12 + 16 + 8 * (unsigned)num_segs;
+  if ((cmap = calloc(1, cmap_length)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for cmap table.");
+    goto done;
+  }
+
+  put_ushort(cmap + 2, 1);		// numTables
+  put_ushort(cmap + 4, TTF_OFF_Windows);// platformID
+  put_ushort(cmap + 6, TTF_OFF_Windows_UCS2);
+					// encodingID
+  put_ulong(cmap + 8, 12);		// offset
+
+  cmapptr = cmap + 12;
+  put_ushort(cmapptr, 4);		// format
+  put_ushort(cmapptr + 2, cmap_length - 12);
+					// length
+  put_ushort(cmapptr + 6, 2 * (unsigned)num_segs);
+					// segCountX2
+  for (length = 1, i = 0; (length * 2) <= num_segs; length *= 2, i ++);
+  put_ushort(cmapptr + 8, 2 * length);	// searchRange
+  put_ushort(cmapptr + 10, (unsigned)i);// entrySelector
+  put_ushort(cmapptr + 12, 2 * ((unsigned)num_segs - length));
+					// rangeShift
+
+  for (j = 0, i = -1, end = 0; j < num_mapped; j ++)
+  {
+    if (chars[j] > 0xfffe || (gid = get_glyph(font, chars[j])) <= 0)
+      continue;
+
+    if (i < 0 || (unsigned)chars[j] != end + 1 || gid != get_glyph(font, (int)end) + 1)
+    {
+      if (i >= 0 && (unsigned)chars[j] <= end)
+        continue;
+
+      i ++;
+      put_ushort(cmapptr + 16 + 2 * num_segs + 2 * (size_t)i, (unsigned)chars[j]);
+					// startCode
+      put_ushort(cmapptr + 16 + 4 * num_segs + 2 * (size_t)i, (unsigned)(gid - chars[j]) & 0xffff);
+					// idDelta
+    }
+
+    end = (unsigned)chars[j];
+    put_ushort(cmapptr + 14 + 2 * (size_t)i, end);
+					// endCode
+  }
+
+  // Final 0xFFFF segment...
+  i ++;
+  put_ushort(cmapptr + 14 + 2 * (size_t)i, 0xffff);
+  put_ushort(cmapptr + 16 + 2 * num_segs + 2 * (size_t)i, 0xffff);
+  put_ushort(cmapptr + 16 + 4 * num_segs + 2 * (size_t)i, 1);
+
+  // Collect the tables for the subset font, sorted by tag...
+  for (i = 0; i < (int)(sizeof(copied) / sizeof(copied[0])); i ++)
+  {
+    if (copied[i] == TTF_OFF_hhea)
+    {
+      // Insert the cmap, glyf, and head tables before hhea...
+      tables[num_tables].tag    = TTF_OFF_glyf;
+      tables[num_tables].data   = glyf;
+      tables[num_tables].length = glyf_size;
+      num_tables ++;
+
+      tables[num_tables].tag    = TTF_OFF_head;
+      tables[num_tables].data   = head;
+      tables[num_tables].length = 54;
+      num_tables ++;
+    }
+    else if (copied[i] == TTF_OFF_maxp)
+    {
+      // Insert the loca table before maxp...
+      tables[num_tables].tag    = TTF_OFF_loca;
+      tables[num_tables].data   = nloca;
+      tables[num_tables].length = 4 * (unsigned)(font->num_glyphs + 1);
+      num_tables ++;
+    }
+    else if (copied[i] == TTF_OFF_cvt)
+    {
+      // Insert the cmap table before cvt...
+      tables[num_tables].tag    = TTF_OFF_cmap;
+      tables[num_tables].data   = cmap;
+      tables[num_tables].length = cmap_length;
+      num_tables ++;
+    }
+
+    if ((tables[num_tables].data = copy_table(font, copied[i], &tables[num_tables].length)) != NULL)
+    {
+      tables[num_tables].tag       = copied[i];
+      tables[num_tables].allocated = true;
+
+      if (copied[i] == TTF_OFF_post && tables[num_tables].length >= 32)
+      {
+        // Drop the glyph names from the PostScript table (version 3.0)...
+        put_ulong(tables[num_tables].data, 0x30000);
+        tables[num_tables].length = 32;
+      }
+
+      num_tables ++;
+    }
+  }
+
+  // Use long loca offsets and clear the checksum adjustment...
+  put_ulong(head + 8, 0);
+  put_ushort(head + 50, 1);
+
+  // Write the offset table and table data...
+  for (i = 0, *datasize = 12 + 16 * (size_t)num_tables; i < num_tables; i ++)
+    *datasize += (tables[i].length + 3) & ~3U;
+
+  if ((data = calloc(1, *datasize)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for font.");
+    *datasize = 0;
+    goto done;
+  }
+
+  for (length = 1, i = 0; (length * 2) <= (unsigned)num_tables; length *= 2, i ++);
+
+  put_ulong(data, 0x10000);		// sfntVersion
+  put_ushort(data + 4, (unsigned)num_tables);
+  put_ushort(data + 6, 16 * length);	// searchRange
+  put_ushort(data + 8, (unsigned)i);	// entrySelector
+  put_ushort(data + 10, 16 * ((unsigned)num_tables - length));
+					// rangeShift
+
+  for (i = 0, offset = 12 + 16 * (unsigned)num_tables; i < num_tables; i ++)
+  {
+    memcpy(data + offset, tables[i].data, tables[i].length);
+
+    for (checksum = 0, dataptr = data + offset; dataptr < (data + offset + tables[i].length); dataptr += 4)
+      checksum += get_ulong(dataptr);
+
+    put_ulong(data + 12 + 16 * i, tables[i].tag);
+    put_ulong(data + 16 + 16 * i, checksum);
+    put_ulong(data + 20 + 16 * i, offset);
+    put_ulong(data + 24 + 16 * i, tables[i].length);
+
+    if (tables[i].tag == TTF_OFF_head)
+      adjptr = data + offset + 8;
+
+    offset += (tables[i].length + 3) & ~3U;
+  }
+
+  // Update the checksum adjustment in the head table...
+  for (checksum = 0, dataptr = data; dataptr < (data + *datasize); dataptr += 4)
+    checksum += get_ulong(dataptr);
+
+  put_ulong(adjptr, 0xb1b0afba - checksum);
+
+  // Free temporary memory and return...
+  done:
+
+  for (i = 0; i < num_tables; i ++)
+  {
+    if (tables[i].allocated)
+      free(tables[i].data);
+  }
+
+  free(head);
+  free(loca);
+  free(glyf);
+  free(nloca);
+  free(cmap);
+  free(used);
+  free(glyphs);
+
+  return (data);
+}
+
+
+//
+// 'ttfDelete()' - Free all memory used for a font family object.
+//
+
+void
+ttfDelete(ttf_t *font)			// I - Font
+{
+  int	i;				// Looping var
+
+
+  // Range check input...
+  if (!font)
+    return;
+
+  // Unmap/free the font file data...
+#ifndef _WIN32
+  if (font->mapped)
+    munmap(font->data, font->datasize);
+  else
+#endif // !_WIN32
+  free(font->data);
+
+  // Free all memory used...
+  free(font->copyright);
+  free(font->family);
+  free(font->postscript_name);
+  free(font->version);
+
+  free(font->table.entries);
+  free(font->names.names);
+  free(font->names.storage);
+
+  free(font->cmap);
+  free(font->metrics);
+  free(font->kpairs);
+
+  for (i = 0; i < font->num_kclasses; i ++)
+  {
+    free(font->kclasses[i].class1);
+    free(font->kclasses[i].class2);
+    free(font->kclasses[i].adjust);
+  }
+
+  free(font->kclasses);
+
+  for (i = 0; i < (TTF_FONT_MAX_CHAR / 256); i ++)
+    free(font->cmap_pages[i]);
+
+  free(font);
+}
+
+
+//
+// 'ttfGetAdvance()' - Get the advance width of a single character.
+//
+// This function returns the unscaled advance width of the character "ch" in
+// font units - see @link ttfGetUnitsPerEm@.  Unmapped characters use the width
+// of the ".notdef" glyph.
+//
+
+int					// O - Advance width in font units
+ttfGetAdvance(ttf_t *font,		// I - Font
+              int   ch)			// I - Unicode character
+{
+  return (font ? get_metric(font, ch)->width : 0);
+}
+
+
+//
+// 'ttfGetAscent()' - Get the maximum height of non-accented characters.
+//
+
+int					// O - Ascent in 1000ths
+ttfGetAscent(ttf_t *font)		// I - Font
+{
+  return (font ? (int)(1000 * font->ascent / font->units) : 0);
+}
+
+
+//
+// 'ttfGetBounds()' - Get the bounds of all characters in a font.
+//
+// This function gets the bounds of all characters in a font.  The "bounds"
+// argument is a pointer to a `ttf_rect_t` structure that will be filled with
+// the limits for characters in the font scaled to a 1000x1000 unit square.
+//
+
+ttf_rect_t *				// O - Bounds or `NULL` on error
+ttfGetBounds(ttf_t      *font,		// I - Font
+             ttf_rect_t *bounds)	// I - Bounds buffer
+{
+  // Range check input...
+  if (!font || !bounds)
+  {
+    if (bounds)
+      memset(bounds, 0, sizeof(ttf_rect_t));
+
+    return (NULL);
+  }
+
+  bounds->left   = 1000.0f * font->x_min / font->units;
+  bounds->right  = 1000.0f * font->x_max / font->units;
+  bounds->bottom = 1000.0f * font->y_min / font->units;
+  bounds->top    = 1000.0f * font->y_max / font->units;
+
+  return (bounds);
+}
+
+
+//
+// 'ttfGetCapHeight()' - Get the height of capital letters.
+//
+
+int					// O - Capital letter height in 1000ths
+ttfGetCapHeight(ttf_t *font)		// I - Font
+{
+  return (font ? (int)(1000 * font->cap_height / font->units) : 0);
+}
+
+
+//
+// 'ttfGetCMap()' - Get the Unicode to glyph mapping table.
+//
+// This function returns a flat array of glyph indices for every character up
+// to the last character in the font, with `-1` for unmapped characters.  The
+// array is built from the font's sparse map on first use, so this function can
+// be called from multiple threads for the same font - use the
+// @link ttfGetGlyph@ function to look up individual characters.
+//
+
+const int *				// O - CMap table
+ttfGetCMap(ttf_t  *font,		// I - Font
+           size_t *num_cmap)		// O - Number of entries in table
+{
+  size_t	i;			// Looping var
+  int		*cmap;			// Flat glyph map
+
+
+  // Range check input...
+  if (!font || !num_cmap)
+  {
+    if (num_cmap)
+      *num_cmap = 0;
+
+    return (NULL);
+  }
+
+  // Expand the sparse map as needed while holding the mutex, since the same
+  // font can be shared by multiple threads...
+#ifdef _WIN32
+  AcquireSRWLockExclusive(&cmap_mutex);
+#else
+  pthread_mutex_lock(&cmap_mutex);
+#endif // _WIN32
+
+  if (!font->cmap && font->num_cmap > 0 && (font->cmap = (int *)malloc(font->num_cmap * sizeof(int))) != NULL)
+  {
+    for (i = 0; i < font->num_cmap; i ++)
+      font->cmap[i] = get_glyph(font, (int)i);
+  }
+
+  cmap = font->cmap;
+
+#ifdef _WIN32
+  ReleaseSRWLockExclusive(&cmap_mutex);
+#else
+  pthread_mutex_unlock(&cmap_mutex);
+#endif // _WIN32
+
+  *num_cmap = cmap ? font->num_cmap : 0;
+
+  return (cmap);
+}
+
+
+//
+// 'ttfGetCopyright()' - Get the copyright text for a font.
+//
+
+const char *				// O - Copyright text
+ttfGetCopyright(ttf_t *font)		// I - Font
+{
+  return (font ? font->copyright : NULL);
+}
+
+
+//
+// 'ttfGetDescent()' - Get the maximum depth of non-accented characters.
+//
+
+int					// O - Descent in 1000ths
+ttfGetDescent(ttf_t *font)		// I - Font
+{
+  return (font ? (int)(1000 * font->descent / font->units) : 0);
+}
+
+
+//
+// 'ttfGetExtents()' - Get the extents of a UTF-8 string.
+//
+// This function computes the extents of the UTF-8 string "s" when rendered
+// using the specified font "font" and size "size".  The "extents" argument is
+// a pointer to a `ttf_rect_t` structure that is filled with the extents of a
+// simple rendering of the string with no kerning or rewriting applied.  The
+// values are scaled using the specified font size.
+//
+
+ttf_rect_t *				// O - Pointer to extents or `NULL` on error
+ttfGetExtents(
+    ttf_t      *font,			// I - Font
+    float      size,			// I - Font size
+    const char *s,			// I - String
+    ttf_rect_t *extents)		// O - Extents of the string
+{
+  bool		first = true;		// First character?
+  int		ch,			// Current character
+		width = 0;		// Width
+  const _ttf_metric_t *metric;		// Character metrics
+
+
+  TTF_DEBUG("ttfGetExtents(font=%p, size=%.2f, s=\"%s\", extents=%p)\n", (void *)font, size, s, (void *)extents);
+
+  // Make sure extents is zeroed out...
+  if (extents)
+    memset(extents, 0, sizeof(ttf_rect_t));
+
+  // Range check input...
+  if (!font || size <= 0.0f || !s || !extents)
+    return (NULL);
+
+  // Loop through the string...
+  while (*s)
+  {
+    // Get the next Unicode character...
+    if ((*s & 0xe0) == 0xc0 && (s[1] & 0xc0) == 0x80)
+    {
+      // Two byte UTF-8
+      ch = ((*s & 0x1f) << 6) | (s[1] & 0x3f);
+      s += 2;
+    }
+    else if ((*s & 0xf0) == 0xe0 && (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80)
+    {
+      // Three byte UTF-8
+      ch = ((*s & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
+      s += 3;
+    }
+    else if ((*s & 0xf8) == 0xf0 && (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80 && (s[3] & 0xc0) == 0x80)
+    {
+      // Four byte UTF-8
+      ch = ((*s & 0x07) << 18) | ((s[1] & 0x3f) << 12) | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
+      s += 4;
+    }
+    else if (*s & 0x80)
+    {
+      // Invalid UTF-8
+      errorf(font, "Invalid UTF-8 sequence starting with 0x%02X.", *s & 255);
+      return (NULL);
+    }
+    else
+    {
+      // ASCII...
+      ch = *s++;
+    }
+
+    // Find its width...
+    metric = get_metric(font, ch);
+
+    if (first)
+    {
+      extents->left = -metric->left_bearing / font->units;
+      first         = false;
+    }
+
+    width += metric->width;
+  }
+
+  // Calculate the bounding box for the text and return...
+  TTF_DEBUG("ttfGetExtents: width=%d\n", width);
+
+  extents->bottom = size * font->y_min / font->units;
+  extents->right  = size * width / font->units + extents->left;
+  extents->top    = size * font->y_max / font->units;
+
+  return (extents);
+}
+
+
+//
+// 'ttfGetFamily()' - Get the family name of a font.
+//
+
+const char *				// O - Family name
+ttfGetFamily(ttf_t *font)		// I - Font
+{
+  return (font ? font->family : NULL);
+}
+
+
+//
+// 'ttfGetGlyph()' - Get the glyph index for a character.
+//
+
+int					// O - Glyph index or `-1` if not mapped
+ttfGetGlyph(ttf_t *font,		// I - Font
+            int   ch)			// I - Unicode character
+{
+  return (font ? get_glyph(font, ch) : -1);
+}
+
+
+//
+// 'ttfGetItalicAngle()' - Get the italic angle.
+//
+
+float					// O - Angle in degrees
+ttfGetItalicAngle(ttf_t *font)		// I - Font
+{
+  return (font ? font->italic_angle : 0.0f);
+}
+
+
+//
+// 'ttfGetKerning()' - Get the kerning adjustment for a pair of characters.
+//
+// This function returns the adjustment to the advance width of the first
+// character when it is followed by the second character.  Negative values move
+// the characters closer together.  Adjustments come from the "kern" feature of
+// the "GPOS" table or, if the font has no GPOS kerning, the "kern" table.
+//
+
+int					// O - Adjustment in 1000ths
+ttfGetKerning(ttf_t *font,		// I - Font
+              int   ch1,		// I - First Unicode character
+              int   ch2)		// I - Second Unicode character
+{
+  int		glyph1,			// First glyph
+		glyph2,			// Second glyph
+		class1,			// First glyph class
+		class2,			// Second glyph class
+		g;			// Index into class array
+  unsigned	pair;			// Glyph pair
+  size_t	i,			// Looping var
+		left,			// Left side of search
+		right;			// Right side of search
+  _ttf_kpair_t	*kpair = NULL;		// Matching pair, if any
+  _ttf_kclass_t	*kclass;		// Current class subtable
+
+
+  // Range check input...
+  if (!font || (glyph1 = get_glyph(font, ch1)) < 0 || (glyph2 = get_glyph(font, ch2)) < 0)
+    return (0);
+
+  // Find the first matching pair...
+  pair = ((unsigned)glyph1 << 16) | (unsigned)glyph2;
+
+  for (left = 0, right = font->num_kpairs; left < right;)
+  {
+    i = (left + right) / 2;
+
+    if (font->kpairs[i].pair < pair)
+      left = i + 1;
+    else
+      right = i;
+  }
+
+  if (left < font->num_kpairs && font->kpairs[left].pair == pair)
+    kpair = font->kpairs + left;
+
+  // Class-based subtables that come before the pair's subtable take
+  // precedence, just as the first matching subtable of a lookup is used...
+  for (i = font->num_kclasses, kclass = font->kclasses; i > 0; i --, kclass ++)
+  {
+    if (kpair && kclass->seq > kpair->seq)
+      break;
+
+    if ((g = glyph1 - kclass->first1) < 0 || g >= kclass->num1 || (class1 = kclass->class1[g]) == TTF_GLYPH_NONE)
+      continue;
+
+    if ((g = glyph2 - kclass->first2) < 0 || g >= kclass->num2)
+      class2 = 0;
+    else if ((class2 = kclass->class2[g]) == TTF_GLYPH_NONE)
+      continue;
+
+    return ((int)(1000.0f * kclass->adjust[class1 * kclass->num_classes2 + class2] / font->units));
+  }
+
+  return (kpair ? (int)(1000.0f * kpair->adjust / font->units) : 0);
+}
+
+
+//
+// 'ttfGetMaxChar()' - Get the last character in the font.
+//
+
+int					// O - Last character in font
+ttfGetMaxChar(ttf_t *font)		// I - Font
+{
+  return (font ? font->max_char : 0);
+}
+
+
+//
+// 'ttfGetMinChar()' - Get the first character in the font.
+//
+
+int					// O - First character in font
+ttfGetMinChar(ttf_t *font)		// I - Font
+{
+  return (font ? font->min_char : 0);
+}
+
+
+//
+// 'ttfGetNumFonts()' - Get the number of fonts in this collection.
+//
+
+size_t					// O - Number of fonts
+ttfGetNumFonts(ttf_t *font)		// I - Font
+{
+  return (font ? font->num_fonts : 0);
+}
+
+
+//
+// 'ttfGetPostScriptName()' - Get the PostScript name of a font.
+//
+
+const char *				// O - PostScript name
+ttfGetPostScriptName(
+    ttf_t *font)			// I - Font
+{
+  return (font ? font->postscript_name : NULL);
+}
+
+
+//
+// 'ttfGetStretch()' - Get the font "stretch" value...
+//
+
+ttf_stretch_t				// O - Stretch value
+ttfGetStretch(ttf_t *font)		// I - Font
+{
+  return (font ? font->stretch : TTF_STRETCH_NORMAL);
+}
 
 
 //
-// 'ttfGetMaxChar()' - Get the last character in the font.
+// 'ttfGetStyle()' - Get the font style.
+//
+
+ttf_style_t				// O - Style
+ttfGetStyle(ttf_t *font)		// I - Font
+{
+  return (font ? font->style : TTF_STYLE_NORMAL);
+}
+
+
+//
+// 'ttfGetUnitsPerEm()' - Get the number of font units per em.
+//
+
+int					// O - Font units per em
+ttfGetUnitsPerEm(ttf_t *font)		// I - Font
+{
+  return (font ? (int)font->units : 0);
+}
+
+
+//
+// 'ttfGetVersion()' - Get the version number of a font.
+//
+
+const char *				// O - Version number
+ttfGetVersion(ttf_t *font)		// I - Font
+{
+  return (font ? font->version : NULL);
+}
+
+
+//
+// 'ttfGetWeight()' - Get the weight of a font.
+//
+
+ttf_weight_t				// O - Weight
+ttfGetWeight(ttf_t *font)		// I - Font
+{
+  return (font ? (ttf_weight_t)font->weight : TTF_WEIGHT_400);
+}
+
+
+//
+// 'ttfGetWidth()' - Get the width of a single character.
+//
+
+int					// O - Width in 1000ths
+ttfGetWidth(ttf_t *font,		// I - Font
+            int   ch)			// I - Unicode character
+{
+  // Range check input...
+  if (!font || ch < ' ' || ch == 0x7f)
+    return (0);
+
+  return ((int)(1000.0f * get_metric(font, ch)->width / font->units));
+}
+
+
+//
+// 'ttfGetXHeight()' - Get the height of lowercase letters.
+//
+
+int					// O - Lowercase letter height in 1000ths
+ttfGetXHeight(ttf_t *font)		// I - Font
+{
+  return (font ? (int)(1000 * font->x_height / font->units) : 0);
+}
+
+
+//
+// 'ttfIsCFF()' - Determine whether a font uses CFF outlines.
+//
+// Fonts with CFF outlines (typically with the ".otf" extension) can be
+// embedded using @link ttfCreateCFF@.
+//
+
+bool					// O - `true` if the font uses CFF outlines, `false` otherwise
+ttfIsCFF(ttf_t *font)			// I - Font
+{
+  return (font ? font->is_cff : false);
+}
+
+
+//
+// 'ttfIsFixedPitch()' - Determine whether a font is fixedpitch.
+//
+
+bool					// O - `true` if fixed pitch, `false` otherwise
+ttfIsFixedPitch(ttf_t *font)		// I - Font
+{
+  return (font ? font->is_fixed : false);
+}
+
+
+//
+// 'add_kpair()' - Add a kerning pair.
+//
+
+static bool				// O - `true` on success, `false` on error
+add_kpair(ttf_t    *font,		// I - Font
+          unsigned first,		// I - First glyph
+          unsigned second,		// I - Second glyph
+          int      adjust)		// I - Adjustment in font units
+{
+  _ttf_kpair_t	*kpair;			// New kerning pair
+
+
+  if (font->num_kpairs >= font->alloc_kpairs)
+  {
+    size_t alloc_kpairs = font->alloc_kpairs ? 2 * font->alloc_kpairs : 256;
+					// New allocation
+
+    if ((kpair = (_ttf_kpair_t *)realloc(font->kpairs, alloc_kpairs * sizeof(_ttf_kpair_t))) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for kerning pairs.");
+      return (false);
+    }
+
+    font->kpairs       = kpair;
+    font->alloc_kpairs = alloc_kpairs;
+  }
+
+  kpair = font->kpairs + font->num_kpairs;
+  font->num_kpairs ++;
+
+  kpair->pair   = (first << 16) | second;
+  kpair->adjust = (short)adjust;
+  kpair->seq    = (unsigned short)font->kseq;
+
+  return (true);
+}
+
+
+//
+// 'cff_add()' - Add data to a CFF output buffer.
+//
+
+static bool				// O - `true` on success, `false` on error
+cff_add(ttf_t          *font,		// I - Font
+        _ttf_cff_buf_t *buf,		// I - Buffer
+        const void     *data,		// I - Data to add
+        size_t         length)		// I - Length of data
+{
+  if ((buf->length + length) > buf->alloc)
+  {
+    // Grow the buffer...
+    unsigned char	*temp;		// New buffer
+    size_t		alloc = buf->alloc ? 2 * buf->alloc : 1024;
+					// New allocation size
+
+    while (alloc < (buf->length + length))
+      alloc *= 2;
+
+    if ((temp = realloc(buf->data, alloc)) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for CFF data.");
+      return (false);
+    }
+
+    buf->data  = temp;
+    buf->alloc = alloc;
+  }
+
+  if (length > 0)
+  {
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+  }
+
+  return (true);
+}
+
+
+//
+// 'cff_add_index()' - Add a CFF INDEX to a CFF output buffer.
+//
+// `NULL` objects are written with a length of 0.
+//
+
+static bool				// O - `true` on success, `false` on error
+cff_add_index(
+    ttf_t                      *font,	// I - Font
+    _ttf_cff_buf_t             *buf,	// I - Buffer
+    size_t                     count,	// I - Number of objects
+    const unsigned char * const *objs,	// I - Objects
+    const size_t               *lengths)// I - Lengths of objects
+{
+  size_t	i,			// Looping var
+		total;			// Total length of objects
+  unsigned	off_size,		// Size of offsets
+		offset;			// Current offset
+  unsigned char	temp[4];		// Temporary buffer
+
+
+  if (count > 65535)
+  {
+    errorf(font, "Too many objects for CFF INDEX.");
+    return (false);
+  }
+
+  put_ushort(temp, (unsigned)count);
+  if (!cff_add(font, buf, temp, 2) || count == 0)
+    return (count == 0);
+
+  for (i = 0, total = 0; i < count; i ++)
+    total += objs[i] ? lengths[i] : 0;
+
+  if (total >= 0xffffff)
+    off_size = 4;
+  else if (total >= 0xffff)
+    off_size = 3;
+  else if (total >= 0xff)
+    off_size = 2;
+  else
+    off_size = 1;
+
+  temp[0] = (unsigned char)off_size;
+  if (!cff_add(font, buf, temp, 1))
+    return (false);
+
+  for (i = 0, offset = 1; i <= count; i ++)
+  {
+    put_ulong(temp, offset);
+    if (!cff_add(font, buf, temp + 4 - off_size, off_size))
+      return (false);
+
+    if (i < count && objs[i])
+      offset += (unsigned)lengths[i];
+  }
+
+  for (i = 0; i < count; i ++)
+  {
+    if (objs[i] && !cff_add(font, buf, objs[i], lengths[i]))
+      return (false);
+  }
+
+  return (true);
+}
+
+
+//
+// 'cff_add_int()' - Add a 32-bit integer operand to a CFF DICT.
+//
+// The 5-byte form is always used so that offsets can be updated without
+// changing the size of the DICT.
+//
+
+static bool				// O - `true` on success, `false` on error
+cff_add_int(ttf_t          *font,	// I - Font
+            _ttf_cff_buf_t *buf,	// I - Buffer
+            int            value)	// I - Value
+{
+  unsigned char	temp[5];		// Encoded value
+
+
+  temp[0] = 29;
+  put_ulong(temp + 1, (unsigned)value);
+
+  return (cff_add(font, buf, temp, 5));
+}
+
+
+//
+// 'cff_add_op()' - Add an operator to a CFF DICT.
+//
+
+static bool				// O - `true` on success, `false` on error
+cff_add_op(ttf_t          *font,	// I - Font
+           _ttf_cff_buf_t *buf,		// I - Buffer
+           unsigned       op)		// I - Operator (1200 + op for escaped operators)
+{
+  unsigned char	temp[2];		// Encoded operator
+
+
+  if (op >= 1200)
+  {
+    temp[0] = 12;
+    temp[1] = (unsigned char)(op - 1200);
+
+    return (cff_add(font, buf, temp, 2));
+  }
+  else
+  {
+    temp[0] = (unsigned char)op;
+
+    return (cff_add(font, buf, temp, 1));
+  }
+}
+
+
+//
+// 'cff_get_object()' - Get an object from a CFF INDEX.
+//
+
+static const unsigned char *		// O - Object data or `NULL` if out of range
+cff_get_object(
+    const _ttf_cff_index_t *idx,	// I - INDEX
+    unsigned               n,		// I - Object number (0-based)
+    size_t                 *length)	// O - Length of object
+{
+  unsigned		i,		// Looping var
+			start = 0,	// Start offset
+			end = 0;	// End offset
+  const unsigned char	*ptr;		// Pointer into offsets
+
+
+  *length = 0;
+
+  if (n >= idx->count)
+    return (NULL);
+
+  for (i = 0, ptr = idx->offsets + n * idx->off_size; i < idx->off_size; i ++, ptr ++)
+  {
+    start = (start << 8) | ptr[0];
+    end   = (end << 8) | ptr[idx->off_size];
+  }
+
+  if (start < 1 || end < start || (size_t)(end - 1) > (size_t)(idx->end - idx->data))
+    return (NULL);
+
+  *length = end - start;
+
+  return (idx->data + start - 1);
+}
+
+
+//
+// 'cff_get_op()' - Get the integer operands of a CFF DICT operator.
+//
+
+static const int *			// O - Operand values or `NULL` if not present
+cff_get_op(const _ttf_cff_dict_t *dict,	// I - DICT
+           unsigned              op,	// I - Operator
+           int                   num_values)
+					// I - Number of values required
+{
+  size_t	i;			// Looping var
+
+
+  for (i = 0; i < dict->num_ops; i ++)
+  {
+    if (dict->ops[i].op == op)
+      return (dict->ops[i].num_values >= num_values ? dict->ops[i].values : NULL);
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'cff_mark_subrs()' - Mark the subroutines used by a Type 2 charstring.
 //
+// The charstring is interpreted just enough to follow subroutine calls, which
+// requires tracking the operand stack and the number of stem hints (to skip
+// the mask bytes of the hintmask and cntrmask operators).
+//
+
+static bool				// O - `true` at endchar, `false` otherwise
+cff_mark_subrs(
+    _ttf_cff_subrs_t    *state,		// I - Subroutine usage state
+    const unsigned char *cs,		// I - Charstring
+    size_t              length,		// I - Length of charstring
+    int                 depth)		// I - Subroutine nesting depth
+{
+  const unsigned char	*ptr = cs,	// Pointer into charstring
+			*end = cs + length;
+					// End of charstring
+  int			value,		// Operand value
+			num;		// Subroutine number
+  const _ttf_cff_index_t *subrs;	// Subroutine INDEX
+  unsigned char		*used;		// Subroutine usage
+  const unsigned char	*subr;		// Subroutine charstring
+  size_t		subrlen;	// Length of subroutine
+
+
+  while (ptr < end)
+  {
+    if (*ptr >= 32 || *ptr == 28)
+    {
+      // Operand...
+      if (*ptr == 28)
+      {
+        if ((ptr + 2) >= end)
+          break;
+
+        value = (short)get_ushort(ptr + 1);
+        ptr += 3;
+      }
+      else if (*ptr <= 246)
+      {
+        value = *ptr - 139;
+        ptr ++;
+      }
+      else if (*ptr <= 254)
+      {
+        if ((ptr + 1) >= end)
+          break;
+
+        value = *ptr <= 250 ? (*ptr - 247) * 256 + ptr[1] + 108 : -(*ptr - 251) * 256 - ptr[1] - 108;
+        ptr += 2;
+      }
+      else
+      {
+        // 16.16 fixed point, keep the integer part...
+        if ((ptr + 4) >= end)
+          break;
+
+        value = (int)get_ulong(ptr + 1) >> 16;
+        ptr += 5;
+      }
+
+      if (state->num_stack < TTF_CFF_MAX_STACK)
+        state->stack[state->num_stack ++] = value;
+
+      continue;
+    }
+
+    switch (*ptr)
+    {
+      case 1 :				// hstem
+      case 3 :				// vstem
+      case 18 :				// hstemhm
+      case 23 :				// vstemhm
+          state->num_stems += state->num_stack / 2;
+          state->num_stack = 0;
+          ptr ++;
+          break;
+
+      case 19 :				// hintmask
+      case 20 :				// cntrmask
+          // Any operands are an implied vstem...
+          state->num_stems += state->num_stack / 2;
+          state->num_stack = 0;
+          ptr += 1 + (state->num_stems + 7) / 8;
+          break;
+
+      case 10 :				// callsubr
+      case 29 :				// callgsubr
+          if (*ptr == 10)
+          {
+            subrs = state->lsubrs;
+            used  = state->lused;
+          }
+          else
+          {
+            subrs = state->gsubrs;
+            used  = state->gused;
+          }
+
+          ptr ++;
+
+          if (state->num_stack < 1 || !subrs || depth >= TTF_CFF_MAX_SUBRS)
+            return (false);
+
+          // Subroutine numbers are biased based on the number of subroutines...
+          num = state->stack[-- state->num_stack] + (subrs->count < 1240 ? 107 : subrs->count < 33900 ? 1131 : 32768);
 
-int					// O - Last character in font
-ttfGetMaxChar(ttf_t *font)		// I - Font
-{
-  return (font ? font->max_char : 0);
-}
+          if (num < 0 || (subr = cff_get_object(subrs, (unsigned)num, &subrlen)) == NULL)
+            return (false);
 
+          used[num] = 1;
 
-//
-// 'ttfGetMinChar()' - Get the first character in the font.
-//
+          if (cff_mark_subrs(state, subr, subrlen, depth + 1))
+            return (true);
+          break;
 
-int					// O - First character in font
-ttfGetMinChar(ttf_t *font)		// I - Font
-{
-  return (font ? font->min_char : 0);
-}
+      case 11 :				// return
+          return (false);
 
+      case 14 :				// endchar
+          return (true);
 
-//
-// 'ttfGetNumFonts()' - Get the number of fonts in this collection.
-//
+      case 12 :				// Escaped operators
+          state->num_stack = 0;
+          ptr += 2;
+          break;
 
-size_t					// O - Number of fonts
-ttfGetNumFonts(ttf_t *font)		// I - Font
-{
-  return (font ? font->num_fonts : 0);
+      default :				// Other operators
+          state->num_stack = 0;
+          ptr ++;
+          break;
+    }
+  }
+
+  return (false);
 }
 
 
 //
-// 'ttfGetPostScriptName()' - Get the PostScript name of a font.
+// 'cff_read_dict()' - Parse a CFF DICT.
 //
 
-const char *				// O - PostScript name
-ttfGetPostScriptName(
-    ttf_t *font)			// I - Font
+static bool				// O - `true` on success, `false` on error
+cff_read_dict(const unsigned char *start,// I - Start of DICT
+              const unsigned char *end,	// I - End of DICT
+              _ttf_cff_dict_t     *dict)// O - Parsed DICT
 {
-  return (font ? font->postscript_name : NULL);
-}
+  const unsigned char	*ptr,		// Pointer into DICT
+			*opstart;	// Start of operands
+  int			num_values = 0,	// Number of operands
+			values[4] = { 0, 0, 0, 0 };
+					// Operand values
 
 
-//
-// 'ttfGetStretch()' - Get the font "stretch" value...
-//
+  dict->num_ops = 0;
 
-ttf_stretch_t				// O - Stretch value
-ttfGetStretch(ttf_t *font)		// I - Font
-{
-  return (font ? font->stretch : TTF_STRETCH_NORMAL);
-}
+  for (ptr = opstart = start; ptr < end;)
+  {
+    if (*ptr <= 21)
+    {
+      // Operator...
+      if (dict->num_ops >= TTF_CFF_MAX_OPS)
+        return (false);
 
+      if (*ptr == 12)
+      {
+        if ((ptr + 1) >= end)
+          return (false);
 
-//
-// 'ttfGetStyle()' - Get the font style.
-//
+        dict->ops[dict->num_ops].op = 1200 + ptr[1];
+        ptr += 2;
+      }
+      else
+      {
+        dict->ops[dict->num_ops].op = *ptr++;
+      }
 
-ttf_style_t				// O - Style
-ttfGetStyle(ttf_t *font)		// I - Font
-{
-  return (font ? font->style : TTF_STYLE_NORMAL);
-}
+      dict->ops[dict->num_ops].start      = opstart;
+      dict->ops[dict->num_ops].end        = ptr;
+      dict->ops[dict->num_ops].num_values = num_values;
+      memcpy(dict->ops[dict->num_ops].values, values, sizeof(values));
+      dict->num_ops ++;
 
+      opstart    = ptr;
+      num_values = 0;
+      continue;
+    }
 
-//
-// 'ttfGetVersion()' - Get the version number of a font.
-//
+    // Operand...
+    if (*ptr == 30)
+    {
+      // Real number, skip the nibbles through the end marker...
+      for (ptr ++; ptr < end; ptr ++)
+      {
+        if ((*ptr & 0x0f) == 0x0f || (*ptr & 0xf0) == 0xf0)
+          break;
+      }
 
-const char *				// O - Version number
-ttfGetVersion(ttf_t *font)		// I - Font
-{
-  return (font ? font->version : NULL);
-}
+      if (ptr >= end)
+        return (false);
 
+      ptr ++;
 
-//
-// 'ttfGetWeight()' - Get the weight of a font.
-//
+      if (num_values < 4)
+        values[num_values] = 0;
+    }
+    else if (*ptr >= 32 && *ptr <= 246)
+    {
+      if (num_values < 4)
+        values[num_values] = *ptr - 139;
 
-ttf_weight_t				// O - Weight
-ttfGetWeight(ttf_t *font)		// I - Font
-{
-  return (font ? (ttf_weight_t)font->weight : TTF_WEIGHT_400);
-}
+      ptr ++;
+    }
+    else if (*ptr >= 247 && *ptr <= 254)
+    {
+      if ((ptr + 1) >= end)
+        return (false);
 
+      if (num_values < 4)
+        values[num_values] = *ptr <= 250 ? (*ptr - 247) * 256 + ptr[1] + 108 : -(*ptr - 251) * 256 - ptr[1] - 108;
 
-//
-// 'ttfGetWidth()' - Get the width of a single character.
-//
+      ptr += 2;
+    }
+    else if (*ptr == 28)
+    {
+      if ((ptr + 2) >= end)
+        return (false);
 
-int					// O - Width in 1000ths
-ttfGetWidth(ttf_t *font,		// I - Font
-            int   ch)			// I - Unicode character
-{
-  int	bin =  ch >> 8;			// Bin in widths array
+      if (num_values < 4)
+        values[num_values] = (short)get_ushort(ptr + 1);
 
+      ptr += 3;
+    }
+    else if (*ptr == 29)
+    {
+      if ((ptr + 4) >= end)
+        return (false);
 
-  // Range check input...
-  if (!font || ch < ' ' || ch == 0x7f)
-    return (0);
+      if (num_values < 4)
+        values[num_values] = (int)get_ulong(ptr + 1);
 
-  if (font->widths[bin])
-    return ((int)(1000.0f * font->widths[bin][ch & 255].width / font->units));
-  else if (font->widths[0])		// .notdef
-    return ((int)(1000.0f * font->widths[0][0].width / font->units));
-  else
-    return (0);
+      ptr += 5;
+    }
+    else
+    {
+      return (false);
+    }
+
+    num_values ++;
+  }
+
+  return (true);
 }
 
 
 //
-// 'ttfGetXHeight()' - Get the height of lowercase letters.
+// 'cff_read_index()' - Read a CFF INDEX.
 //
 
-int					// O - Lowercase letter height in 1000ths
-ttfGetXHeight(ttf_t *font)		// I - Font
+static const unsigned char *		// O - End of INDEX or `NULL` on error
+cff_read_index(const unsigned char *start,// I - Start of INDEX
+               const unsigned char *end,// I - End of CFF data
+               _ttf_cff_index_t    *idx)// O - INDEX
 {
-  return (font ? (int)(1000 * font->x_height / font->units) : 0);
+  unsigned		i,		// Looping var
+			last = 0;	// Last offset
+  const unsigned char	*ptr;		// Pointer into last offset
+
+
+  memset(idx, 0, sizeof(_ttf_cff_index_t));
+
+  if ((start + 2) > end)
+    return (NULL);
+
+  if ((idx->count = get_ushort(start)) == 0)
+  {
+    idx->end = start + 2;
+    return (idx->end);
+  }
+
+  if ((start + 3) > end || (idx->off_size = start[2]) < 1 || idx->off_size > 4)
+    return (NULL);
+
+  idx->offsets = start + 3;
+  idx->data    = idx->offsets + (idx->count + 1) * idx->off_size;
+
+  if (idx->data > end)
+    return (NULL);
+
+  for (i = 0, ptr = idx->data - idx->off_size; i < idx->off_size; i ++, ptr ++)
+    last = (last << 8) | *ptr;
+
+  if (last < 1 || (size_t)(last - 1) > (size_t)(end - idx->data))
+    return (NULL);
+
+  idx->end = idx->data + last - 1;
+
+  return (idx->end);
 }
 
 
 //
-// 'ttfIsFixedPitch()' - Determine whether a font is fixedpitch.
+// 'compare_kpairs()' - Compare two kerning pairs.
 //
 
-bool					// O - `true` if fixed pitch, `false` otherwise
-ttfIsFixedPitch(ttf_t *font)		// I - Font
+static int				// O - Result of comparison
+compare_kpairs(_ttf_kpair_t *a,		// I - First kerning pair
+               _ttf_kpair_t *b)		// I - Second kerning pair
 {
-  return (font ? font->is_fixed : false);
+  if (a->pair < b->pair)
+    return (-1);
+  else if (a->pair > b->pair)
+    return (1);
+  else
+    return ((int)a->seq - (int)b->seq);
 }
 
 
@@ -1026,47 +2944,291 @@ copy_name(ttf_t    *font,		// I - Font
 
       TTF_DEBUG("copy_name: name_id(%d) = \"%s\"\n", name_id, temp);
 
-      return (strdup(temp));
-    }
-  }
+      return (strdup(temp));
+    }
+  }
+
+  TTF_DEBUG("copy_name: No English name string for %d.\n", name_id);
+#ifdef DEBUG
+  for (i = font->names.num_names, name = font->names.names; i > 0; i --, name ++)
+  {
+    if (name->name_id == name_id)
+      TTF_DEBUG("copy_name: Found name_id=%d, platform_id=%d, language_id=%d(0x%04x)\n", name_id, name->platform_id, name->language_id, name->language_id);
+  }
+#endif // DEBUG
+
+  return (NULL);
+}
+
+
+//
+// 'copy_table()' - Copy the contents of a table in a font.
+//
+
+static unsigned char *			// O - Table data or `NULL` if not found
+copy_table(ttf_t    *font,		// I - Font
+           unsigned tag,		// I - Tag to find
+           unsigned *length)		// O - Length of table
+{
+  unsigned char	*data;			// Table data
+
+
+  if ((*length = seek_table(font, tag, 0, false)) == 0)
+    return (NULL);
+
+  if ((data = malloc(*length)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for %c%c%c%c table.", (tag >> 24) & 255, (tag >> 16) & 255, (tag >> 8) & 255, tag & 255);
+    *length = 0;
+    return (NULL);
+  }
+
+  if (read_bytes(font, data, *length) != (ssize_t)*length)
+  {
+    errorf(font, "Unable to read %c%c%c%c table.", (tag >> 24) & 255, (tag >> 16) & 255, (tag >> 8) & 255, tag & 255);
+    free(data);
+    *length = 0;
+    return (NULL);
+  }
+
+  return (data);
+}
+
+
+//
+// 'errorf()' - Show an error message.
+//
+
+static void
+errorf(ttf_t      *font,		// I - Font
+       const char *message,		// I - `printf`-style message string
+       ...)				// I - Addition arguments as needed
+{
+  va_list	ap;			// Argument pointer
+  char		buffer[2048];		// Message buffer
+
+
+  // Format the message...
+  va_start(ap, message);
+  vsnprintf(buffer, sizeof(buffer), message, ap);
+  va_end(ap);
+
+  // If an error callback is set, sent the message there.  Otherwise write it
+  // to stderr...
+  if (font && font->err_cb)
+    (font->err_cb)(font->err_data, buffer);
+  else
+    fprintf(stderr, "%s\n", message);
+}
+
+
+//
+// 'get_glyph()' - Get the glyph index for a character.
+//
+
+static int				// O - Glyph index or `-1` if not mapped
+get_glyph(ttf_t *font,			// I - Font
+          int   ch)			// I - Unicode character
+{
+  unsigned short	*page;		// Page in sparse map
+
+
+  if (ch < 0 || ch >= TTF_FONT_MAX_CHAR || (page = font->cmap_pages[ch >> 8]) == NULL || page[ch & 255] == TTF_GLYPH_NONE)
+    return (-1);
+  else
+    return (page[ch & 255]);
+}
+
+
+//
+// 'get_metric()' - Get the metrics for a character.
+//
+// Unmapped characters use the metrics of the ".notdef" (0) glyph, and glyphs
+// past the end of the "hmtx" table use the last entry.
+//
+
+static const _ttf_metric_t *		// O - Metrics
+get_metric(ttf_t *font,			// I - Font
+           int   ch)			// I - Unicode character
+{
+  int	glyph = get_glyph(font, ch);	// Glyph index
+
+
+  if (glyph < 0)
+    glyph = 0;
+  else if (glyph >= font->num_metrics)
+    glyph = font->num_metrics - 1;
+
+  return (font->metrics + glyph);
+}
+
+
+//
+// 'get_ulong()' - Get a 32-bit big-endian unsigned integer.
+//
+
+static unsigned				// O - Value
+get_ulong(const unsigned char *ptr)	// I - Pointer to value
+{
+  return ((unsigned)(((unsigned)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3]));
+}
+
+
+//
+// 'get_ushort()' - Get a 16-bit big-endian unsigned integer.
+//
+
+static unsigned				// O - Value
+get_ushort(const unsigned char *ptr)	// I - Pointer to value
+{
+  return ((unsigned)((ptr[0] << 8) | ptr[1]));
+}
+
+
+//
+// 'put_ulong()' - Put a 32-bit big-endian unsigned integer.
+//
+
+static void
+put_ulong(unsigned char *ptr,		// I - Pointer to value
+          unsigned      value)		// I - Value
+{
+  ptr[0] = (unsigned char)(value >> 24);
+  ptr[1] = (unsigned char)(value >> 16);
+  ptr[2] = (unsigned char)(value >> 8);
+  ptr[3] = (unsigned char)value;
+}
+
+
+//
+// 'put_ushort()' - Put a 16-bit big-endian unsigned integer.
+//
+
+static void
+put_ushort(unsigned char *ptr,		// I - Pointer to value
+           unsigned      value)		// I - Value
+{
+  ptr[0] = (unsigned char)(value >> 8);
+  ptr[1] = (unsigned char)value;
+}
+
+
+//
+// 'read_bytes()' - Read bytes from the font file data.
+//
+
+static ssize_t				// O - Number of bytes read
+read_bytes(ttf_t  *font,		// I - Font
+           void   *buffer,		// I - Buffer
+           size_t bytes)		// I - Number of bytes to read
+{
+  if (font->dataoff >= font->datasize)
+    return (0);
+
+  if (bytes > (font->datasize - font->dataoff))
+    bytes = font->datasize - font->dataoff;
 
-  TTF_DEBUG("copy_name: No English name string for %d.\n", name_id);
-#ifdef DEBUG
-  for (i = font->names.num_names, name = font->names.names; i > 0; i --, name ++)
-  {
-    if (name->name_id == name_id)
-      TTF_DEBUG("copy_name: Found name_id=%d, platform_id=%d, language_id=%d(0x%04x)\n", name_id, name->platform_id, name->language_id, name->language_id);
-  }
-#endif // DEBUG
+  memcpy(buffer, font->data + font->dataoff, bytes);
+  font->dataoff += bytes;
 
-  return (NULL);
+  return ((ssize_t)bytes);
 }
 
 
 //
-// 'errorf()' - Show an error message.
+// 'read_classdef()' - Read an OpenType class definition table.
+//
+// The returned array holds the class of each glyph from "first" to
+// "first + num - 1" - all other glyphs are class 0.  Malformed tables are
+// treated as empty.
 //
 
-static void
-errorf(ttf_t      *font,		// I - Font
-       const char *message,		// I - `printf`-style message string
-       ...)				// I - Addition arguments as needed
+static unsigned short *			// O - Glyph classes or `NULL` on error
+read_classdef(ttf_t               *font,// I - Font
+              const unsigned char *table,// I - Table data
+              size_t              length,// I - Length of table
+              size_t              offset,// I - Offset to class definition
+              int                 *first,// O - First glyph
+              int                 *num)	// O - Number of glyphs
 {
-  va_list	ap;			// Argument pointer
-  char		buffer[2048];		// Message buffer
+  unsigned short	*classes;	// Glyph classes
+  const unsigned char	*ptr;		// Pointer into table
+  unsigned		i,		// Looping var
+			count = 0,	// Number of glyphs or ranges
+			start,		// First glyph in range
+			end,		// Last glyph in range
+			minglyph = 0,	// Minimum glyph
+			maxglyph = 0;	// Maximum glyph
+  int			format = 0;	// Table format
+
+
+  if ((offset + 6) <= length)
+  {
+    ptr    = table + offset;
+    format = (int)get_ushort(ptr);
 
+    if (format == 1)
+    {
+      // Format 1: Class array for a range of glyphs
+      minglyph = get_ushort(ptr + 2);
+      count    = get_ushort(ptr + 4);
 
-  // Format the message...
-  va_start(ap, message);
-  vsnprintf(buffer, sizeof(buffer), message, ap);
-  va_end(ap);
+      if ((offset + 6 + 2 * count) > length)
+        count = 0;
 
-  // If an error callback is set, sent the message there.  Otherwise write it
-  // to stderr...
-  if (font && font->err_cb)
-    (font->err_cb)(font->err_data, buffer);
-  else
-    fprintf(stderr, "%s\n", message);
+      maxglyph = minglyph + count - 1;
+    }
+    else if (format == 2)
+    {
+      // Format 2: Class ranges
+      count = get_ushort(ptr + 2);
+
+      if ((offset + 4 + 6 * count) > length)
+        count = 0;
+
+      for (i = 0, ptr += 4, minglyph = 65535; i < count; i ++, ptr += 6)
+      {
+        if ((start = get_ushort(ptr)) > (end = get_ushort(ptr + 2)))
+          continue;
+
+        if (start < minglyph)
+          minglyph = start;
+        if (end > maxglyph)
+          maxglyph = end;
+      }
+
+      if (minglyph > maxglyph)
+        count = 0;
+    }
+  }
+
+  if (count == 0)
+    minglyph = maxglyph = 0;
+
+  if ((classes = (unsigned short *)calloc(maxglyph - minglyph + 1, sizeof(unsigned short))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyph classes.");
+    return (NULL);
+  }
+
+  if (count > 0 && format == 1)
+  {
+    for (i = 0, ptr = table + offset + 6; i < count; i ++, ptr += 2)
+      classes[i] = (unsigned short)get_ushort(ptr);
+  }
+  else if (count > 0)
+  {
+    for (i = 0, ptr = table + offset + 4; i < count; i ++, ptr += 6)
+    {
+      for (start = get_ushort(ptr), end = get_ushort(ptr + 2); start <= end; start ++)
+        classes[start - minglyph] = (unsigned short)get_ushort(ptr + 4);
+    }
+  }
+
+  *first = (int)minglyph;
+  *num   = count > 0 ? (int)(maxglyph - minglyph + 1) : 0;
+
+  return (classes);
 }
 
 
@@ -1087,7 +3249,6 @@ read_cmap(ttf_t *font)			// I - Font
   unsigned	clength,		// Length of cmap data
 		coffset = 0,		// Offset to cmap data
 		roman_offset = 0;	// MacRoman offset
-  int		*cmapptr;		// Pointer into cmap
 #if 0
   const int	*unimap = NULL;		// Unicode character map, if any
   static const int romanmap[256] =	// MacRoman to Unicode map
@@ -1213,13 +3374,7 @@ read_cmap(ttf_t *font)			// I - Font
 
 	  font->num_cmap = length - 6;
 
-	  if ((font->cmap = (int *)malloc(font->num_cmap * sizeof(int))) == NULL)
-	  {
-	    errorf(font, "Unable to allocate cmap table.");
-	    return (false);
-	  }
-
-          if (read(font->fd, bmap, font->num_cmap) != (ssize_t)font->num_cmap)
+          if (read_bytes(font, bmap, font->num_cmap) != (ssize_t)font->num_cmap)
           {
 	    errorf(font, "Unable to read cmap table length at offset %u.", coffset);
 	    return (false);
@@ -1227,7 +3382,10 @@ read_cmap(ttf_t *font)			// I - Font
 
 	  // Copy into the actual cmap table...
 	  for (j = 0; j < font->num_cmap; j ++)
-	    font->cmap[j] = bmap[j];
+	  {
+	    if (!set_glyph(font, (unsigned)j, bmap[j]))
+	      return (false);
+	  }
         }
         break;
 
@@ -1329,18 +3487,6 @@ read_cmap(ttf_t *font)			// I - Font
 	    return (false);
 	  }
 
-	  font->cmap = cmapptr = (int *)malloc(font->num_cmap * sizeof(int));
-
-	  if (!font->cmap)
-          {
-            errorf(font, "Unable to allocate memory for cmap.");
-            free(segments);
-            free(glyphIdArray);
-            return (false);
-	  }
-
-          memset(cmapptr, -1, font->num_cmap * sizeof(int));
-
           // Now loop through the segments and assign glyph indices from the
           // array...
           for (seg = segCount, segment = segments; seg > 0; seg --, segment ++)
@@ -1365,7 +3511,12 @@ read_cmap(ttf_t *font)			// I - Font
                 glyph = (ch + segment->idDelta) & 65535;
 	      }
 
-	      cmapptr[ch] = glyph;
+	      if (glyph >= 0 && !set_glyph(font, (unsigned)ch, (unsigned)glyph))
+	      {
+		free(segments);
+		free(glyphIdArray);
+		return (false);
+	      }
             }
 	  }
 
@@ -1425,146 +3576,410 @@ read_cmap(ttf_t *font)			// I - Font
 	      return (false);
             }
 
-            if (group->endCharCode >= font->num_cmap)
-              font->num_cmap = group->endCharCode + 1;
-	  }
+            if (group->endCharCode >= font->num_cmap)
+              font->num_cmap = group->endCharCode + 1;
+	  }
+
+	  // Based on the end code of the segent table, allocate space for the
+	  // uncompressed cmap table...
+          TTF_DEBUG("read_cmap: num_cmap=%u\n", (unsigned)font->num_cmap);
+
+	  if (font->num_cmap == 0 || font->num_cmap > TTF_FONT_MAX_CHAR)
+	  {
+	    errorf(font, "Invalid cmap table with %u characters.", (unsigned)font->num_cmap);
+	    return (false);
+	  }
+
+	  // Now loop through the groups and assign glyph indices from the
+	  // array...
+	  for (gidx = 0, group = groups; gidx < nGroups; gidx ++, group ++)
+	  {
+            for (ch = group->startCharCode; ch <= group->endCharCode && ch < TTF_FONT_MAX_CHAR; ch ++)
+            {
+              if (!set_glyph(font, ch, group->startGlyphID + ch - group->startCharCode))
+              {
+                free(groups);
+                return (false);
+	      }
+            }
+          }
+
+	  // Free the group data...
+	  free(groups);
+	}
+        break;
+
+    case 13 :
+	{
+	  // Format 13: Many-to-one range mappings
+	  //
+	  // Typically used for fonts of last resort where multiple characters
+	  // map to the same glyph.
+	  unsigned	ch,		// Current character
+			gidx,		// Current group
+			nGroups;	// Number of groups
+	  _ttf_off_cmap13_t *groups,	// Groups
+			*group;		// This group
+
+	  // Read the table...
+          /* reserved */ read_ushort(font);
+
+	  if (read_ulong(font) == 0)
+	  {
+	    errorf(font, "Unable to read cmap table length at offset %u.", coffset);
+	    return (false);
+	  }
+
+	  /* language = */ read_ulong(font);
+	  nGroups        = read_ulong(font);
+
+	  TTF_DEBUG("read_cmap: nGroups=%u\n", nGroups);
+
+	  if (nGroups > TTF_FONT_MAX_GROUPS)
+	  {
+	    errorf(font, "Invalid cmap table with %u groups.", nGroups);
+	    return (false);
+	  }
+
+	  if ((groups = (_ttf_off_cmap13_t *)calloc(nGroups, sizeof(_ttf_off_cmap13_t))) == NULL)
+	  {
+	    errorf(font, "Unable to allocate memory for cmap.");
+	    return (false);
+	  }
+
+	  for (gidx = 0, group = groups, font->num_cmap = 0; gidx < nGroups; gidx ++, group ++)
+	  {
+	    group->startCharCode = read_ulong(font);
+	    group->endCharCode   = read_ulong(font);
+	    group->glyphID       = read_ulong(font);
+	    TTF_DEBUG("read_cmap: [%u] startCharCode=%u, endCharCode=%u, glyphID=%u\n", gidx, group->startCharCode, group->endCharCode, group->glyphID);
+
+            if (group->startCharCode > group->endCharCode)
+            {
+	      errorf(font, "Bad cmap table segment %u to %u.", group->startCharCode, group->endCharCode);
+	      return (false);
+            }
+
+            if (group->endCharCode >= font->num_cmap)
+              font->num_cmap = group->endCharCode + 1;
+	  }
+
+	  // Based on the end code of the segent table, allocate space for the
+	  // uncompressed cmap table...
+          TTF_DEBUG("read_cmap: num_cmap=%u\n", (unsigned)font->num_cmap);
+
+	  if (font->num_cmap == 0 || font->num_cmap > TTF_FONT_MAX_CHAR)
+	  {
+	    errorf(font, "Invalid cmap table with %u characters.", (unsigned)font->num_cmap);
+	    return (false);
+	  }
+
+	  // Now loop through the groups and assign glyph indices from the
+	  // array...
+	  for (gidx = 0, group = groups; gidx < nGroups; gidx ++, group ++)
+	  {
+            for (ch = group->startCharCode; ch <= group->endCharCode && ch < TTF_FONT_MAX_CHAR; ch ++)
+            {
+              if (!set_glyph(font, ch, group->glyphID))
+              {
+                free(groups);
+                return (false);
+	      }
+            }
+          }
+
+	  // Free the group data...
+	  free(groups);
+	}
+        break;
+
+    default :
+        errorf(font, "Format %d cmap tables are not yet supported.", cformat);
+        return (false);
+  }
+
+#ifdef DEBUG
+  for (i = 0; i < (int)font->num_cmap && i < 127; i ++)
+  {
+    if (get_glyph(font, i) >= 0)
+      TTF_DEBUG("read_cmap; cmap[%d]=%d\n", i, get_glyph(font, i));
+  }
+#endif // DEBUG
+
+  return (true);
+}
+
+
+//
+// 'read_coverage()' - Read an OpenType coverage table.
+//
+// The returned array holds the glyph for each coverage index, with
+// `TTF_GLYPH_NONE` for missing indices.  Malformed tables are treated as empty.
+//
+
+static unsigned short *			// O - Covered glyphs or `NULL` on error
+read_coverage(ttf_t               *font,// I - Font
+              const unsigned char *table,// I - Table data
+              size_t              length,// I - Length of table
+              size_t              offset,// I - Offset to coverage table
+              int                 *num)	// O - Number of coverage indices
+{
+  unsigned short	*glyphs;	// Covered glyphs
+  const unsigned char	*ptr;		// Pointer into table
+  unsigned		i,		// Looping var
+			count = 0,	// Number of glyphs or ranges
+			start,		// First glyph in range
+			end,		// Last glyph in range
+			index,		// Coverage index
+			total = 0;	// Number of coverage indices
+  int			format = 0;	// Table format
+
+
+  if ((offset + 4) <= length)
+  {
+    ptr    = table + offset;
+    format = (int)get_ushort(ptr);
+    count  = get_ushort(ptr + 2);
+
+    if (format == 1 && (offset + 4 + 2 * count) <= length)
+    {
+      // Format 1: Array of glyphs
+      total = count;
+    }
+    else if (format == 2 && (offset + 4 + 6 * count) <= length)
+    {
+      // Format 2: Glyph ranges
+      for (i = 0, ptr += 4; i < count; i ++, ptr += 6)
+      {
+        start = get_ushort(ptr);
+        end   = get_ushort(ptr + 2);
+        index = get_ushort(ptr + 4);
+
+        if (start <= end && (index + end - start + 1) > total)
+          total = index + end - start + 1;
+      }
+
+      if (total > 65536)
+        total = 65536;
+    }
+  }
+
+  if ((glyphs = (unsigned short *)malloc((total > 0 ? total : 1) * sizeof(unsigned short))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyph coverage.");
+    return (NULL);
+  }
+
+  memset(glyphs, 0xff, (total > 0 ? total : 1) * sizeof(unsigned short));
+
+  if (total > 0 && format == 1)
+  {
+    for (i = 0, ptr = table + offset + 4; i < count; i ++, ptr += 2)
+      glyphs[i] = (unsigned short)get_ushort(ptr);
+  }
+  else if (total > 0)
+  {
+    for (i = 0, ptr = table + offset + 4; i < count; i ++, ptr += 6)
+    {
+      for (start = get_ushort(ptr), end = get_ushort(ptr + 2), index = get_ushort(ptr + 4); start <= end && index < total; start ++, index ++)
+        glyphs[index] = (unsigned short)start;
+    }
+  }
+
+  *num = (int)total;
+
+  return (glyphs);
+}
+
+
+//
+// 'read_file()' - Map or load a font file into memory.
+//
+
+static bool				// O - `true` on success, `false` on error
+read_file(ttf_t      *font,		// I - Font
+          const char *filename)		// I - Filename
+{
+  int		fd;			// File descriptor
+  off_t		size;			// Size of file
+  unsigned char	*ptr;			// Pointer into file data
+  size_t	remaining;		// Remaining bytes
+  ssize_t	bytes;			// Bytes read
+
+
+  // Open the font file and get its size...
+  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+  {
+    errorf(font, "Unable to open '%s': %s", filename, strerror(errno));
+    return (false);
+  }
+
+  if ((size = lseek(fd, 0, SEEK_END)) <= 0 || lseek(fd, 0, SEEK_SET) != 0)
+  {
+    errorf(font, "Unable to read '%s': %s", filename, strerror(errno));
+    close(fd);
+    return (false);
+  }
+
+  font->datasize = (size_t)size;
+
+#ifndef _WIN32
+  // Map the file into memory...
+  if ((font->data = mmap(NULL, font->datasize, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+  {
+    font->mapped = true;
+    close(fd);
+    return (true);
+  }
+
+  font->data = NULL;
+#endif // !_WIN32
+
+  // Read the file into memory...
+  if ((font->data = malloc(font->datasize)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for '%s'.", filename);
+    close(fd);
+    return (false);
+  }
+
+  for (ptr = font->data, remaining = font->datasize; remaining > 0; ptr += bytes, remaining -= (size_t)bytes)
+  {
+    if ((bytes = read(fd, ptr, remaining)) <= 0)
+    {
+      errorf(font, "Unable to read '%s': %s", filename, bytes < 0 ? strerror(errno) : "Unexpected end of file");
+      close(fd);
+      return (false);
+    }
+  }
 
-	  // Based on the end code of the segent table, allocate space for the
-	  // uncompressed cmap table...
-          TTF_DEBUG("read_cmap: num_cmap=%u\n", (unsigned)font->num_cmap);
+  close(fd);
 
-	  if (font->num_cmap == 0 || font->num_cmap > TTF_FONT_MAX_CHAR)
-	  {
-	    errorf(font, "Invalid cmap table with %u characters.", (unsigned)font->num_cmap);
-	    return (false);
-	  }
+  return (true);
+}
 
-	  font->cmap = cmapptr = (int *)malloc(font->num_cmap * sizeof(int));
 
-	  if (!font->cmap)
-          {
-            errorf(font, "Unable to allocate memory for cmap.");
-            free(groups);
-            return (false);
-	  }
+//
+// 'read_gpos()' - Read the kerning pairs from the GPOS table.
+//
+// Only the pair adjustment lookups of the "kern" feature are used.  Since most
+// fonts use a single kerning lookup, the subtables of all kerning lookups are
+// treated as one lookup.
+//
 
-	  memset(cmapptr, -1, font->num_cmap * sizeof(int));
+static bool				// O - `true` on success, `false` on error
+read_gpos(ttf_t *font)			// I - Font
+{
+  const unsigned char	*table;		// GPOS table
+  size_t		length,		// Length of table
+			features,	// Offset to FeatureList
+			lookups,	// Offset to LookupList
+			offset,		// Offset to feature or lookup
+			suboffset;	// Offset to subtable
+  unsigned		i, j,		// Looping vars
+			num_features,	// Number of features
+			num_lookups,	// Number of lookups
+			num_indices,	// Number of lookup indices
+			num_subtables,	// Number of subtables
+			type;		// Lookup type
+  unsigned char		*kern_lookups;	// Lookups used for kerning
+
+
+  // Find the GPOS table...
+  if ((length = seek_table(font, TTF_OFF_GPOS, 0, false)) < 10)
+    return (true);
+
+  table = font->data + font->dataoff;
+
+  if (get_ushort(table) != 1)
+  {
+    TTF_DEBUG("read_gpos: Unsupported GPOS version %u.\n", get_ushort(table));
+    return (true);
+  }
 
-	  // Now loop through the groups and assign glyph indices from the
-	  // array...
-	  for (gidx = 0, group = groups; gidx < nGroups; gidx ++, group ++)
-	  {
-            for (ch = group->startCharCode; ch <= group->endCharCode && ch < TTF_FONT_MAX_CHAR; ch ++)
-              cmapptr[ch] = (int)(group->startGlyphID + ch - group->startCharCode);
-          }
+  features = get_ushort(table + 6);
+  lookups  = get_ushort(table + 8);
 
-	  // Free the group data...
-	  free(groups);
-	}
-        break;
+  if ((features + 2) > length || (lookups + 2) > length)
+    return (true);
 
-    case 13 :
-	{
-	  // Format 13: Many-to-one range mappings
-	  //
-	  // Typically used for fonts of last resort where multiple characters
-	  // map to the same glyph.
-	  unsigned	ch,		// Current character
-			gidx,		// Current group
-			nGroups;	// Number of groups
-	  _ttf_off_cmap13_t *groups,	// Groups
-			*group;		// This group
+  num_features = get_ushort(table + features);
+  num_lookups  = get_ushort(table + lookups);
 
-	  // Read the table...
-          /* reserved */ read_ushort(font);
+  if ((features + 2 + 6 * num_features) > length || (lookups + 2 + 2 * num_lookups) > length || num_lookups == 0)
+    return (true);
 
-	  if (read_ulong(font) == 0)
-	  {
-	    errorf(font, "Unable to read cmap table length at offset %u.", coffset);
-	    return (false);
-	  }
+  // Mark the lookups used by the "kern" features...
+  if ((kern_lookups = (unsigned char *)calloc(num_lookups, 1)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for GPOS lookups.");
+    return (false);
+  }
 
-	  /* language = */ read_ulong(font);
-	  nGroups        = read_ulong(font);
+  for (i = 0; i < num_features; i ++)
+  {
+    if (get_ulong(table + features + 2 + 6 * i) != TTF_OFF_kern)
+      continue;
 
-	  TTF_DEBUG("read_cmap: nGroups=%u\n", nGroups);
+    offset = features + get_ushort(table + features + 6 + 6 * i);
 
-	  if (nGroups > TTF_FONT_MAX_GROUPS)
-	  {
-	    errorf(font, "Invalid cmap table with %u groups.", nGroups);
-	    return (false);
-	  }
+    if ((offset + 4) > length)
+      continue;
 
-	  if ((groups = (_ttf_off_cmap13_t *)calloc(nGroups, sizeof(_ttf_off_cmap13_t))) == NULL)
-	  {
-	    errorf(font, "Unable to allocate memory for cmap.");
-	    return (false);
-	  }
+    num_indices = get_ushort(table + offset + 2);
 
-	  for (gidx = 0, group = groups, font->num_cmap = 0; gidx < nGroups; gidx ++, group ++)
-	  {
-	    group->startCharCode = read_ulong(font);
-	    group->endCharCode   = read_ulong(font);
-	    group->glyphID       = read_ulong(font);
-	    TTF_DEBUG("read_cmap: [%u] startCharCode=%u, endCharCode=%u, glyphID=%u\n", gidx, group->startCharCode, group->endCharCode, group->glyphID);
+    for (j = 0; j < num_indices && (offset + 6 + 2 * j) <= length; j ++)
+    {
+      unsigned lookup = get_ushort(table + offset + 4 + 2 * j);
+					// Lookup index
 
-            if (group->startCharCode > group->endCharCode)
-            {
-	      errorf(font, "Bad cmap table segment %u to %u.", group->startCharCode, group->endCharCode);
-	      return (false);
-            }
+      if (lookup < num_lookups)
+        kern_lookups[lookup] = 1;
+    }
+  }
 
-            if (group->endCharCode >= font->num_cmap)
-              font->num_cmap = group->endCharCode + 1;
-	  }
+  // Read the pair adjustment subtables of the kerning lookups...
+  for (i = 0; i < num_lookups; i ++)
+  {
+    if (!kern_lookups[i])
+      continue;
 
-	  // Based on the end code of the segent table, allocate space for the
-	  // uncompressed cmap table...
-          TTF_DEBUG("read_cmap: num_cmap=%u\n", (unsigned)font->num_cmap);
+    offset = lookups + get_ushort(table + lookups + 2 + 2 * i);
 
-	  if (font->num_cmap == 0 || font->num_cmap > TTF_FONT_MAX_CHAR)
-	  {
-	    errorf(font, "Invalid cmap table with %u characters.", (unsigned)font->num_cmap);
-	    return (false);
-	  }
+    if ((offset + 6) > length)
+      continue;
 
-	  font->cmap = cmapptr = (int *)malloc(font->num_cmap * sizeof(int));
+    type          = get_ushort(table + offset);
+    num_subtables = get_ushort(table + offset + 4);
 
-	  if (!font->cmap)
-	  {
-	    errorf(font, "Unable to allocate cmap.");
-	    free(groups);
-	    return (false);
-	  }
+    TTF_DEBUG("read_gpos: lookup[%u] type=%u, num_subtables=%u\n", i, type, num_subtables);
 
-	  memset(cmapptr, -1, font->num_cmap * sizeof(int));
+    for (j = 0; j < num_subtables && (offset + 8 + 2 * j) <= length; j ++)
+    {
+      suboffset = offset + get_ushort(table + offset + 6 + 2 * j);
 
-	  // Now loop through the groups and assign glyph indices from the
-	  // array...
-	  for (gidx = 0, group = groups; gidx < nGroups; gidx ++, group ++)
-	  {
-            for (ch = group->startCharCode; ch <= group->endCharCode && ch < TTF_FONT_MAX_CHAR; ch ++)
-              cmapptr[ch] = (int)group->glyphID;
-          }
+      if (type == 9)
+      {
+        // Extension subtable, only pair adjustments are supported...
+        if ((suboffset + 8) > length || get_ushort(table + suboffset) != 1 || get_ushort(table + suboffset + 2) != 2)
+          continue;
 
-	  // Free the group data...
-	  free(groups);
-	}
-        break;
+        suboffset += get_ulong(table + suboffset + 4);
+      }
+      else if (type != 2)
+      {
+        continue;
+      }
 
-    default :
-        errorf(font, "Format %d cmap tables are not yet supported.", cformat);
+      if (!read_pairpos(font, table, length, suboffset))
+      {
+        free(kern_lookups);
         return (false);
+      }
+    }
   }
 
-#ifdef DEBUG
-  cmapptr = font->cmap;
-  for (i = 0; i < (int)font->num_cmap && i < 127; i ++)
-  {
-    if (cmapptr[i] >= 0)
-      TTF_DEBUG("read_cmap; cmap[%d]=%d\n", i, cmapptr[i]);
-  }
-#endif // DEBUG
+  free(kern_lookups);
 
   return (true);
 }
@@ -1675,6 +4090,65 @@ read_hmtx(ttf_t           *font,	// I - Font
 }
 
 
+//
+// 'read_kern()' - Read the kerning pairs from the kern table.
+//
+// Only format 0 horizontal kerning subtables are supported.
+//
+
+static bool				// O - `true` on success, `false` on error
+read_kern(ttf_t *font)			// I - Font
+{
+  const unsigned char	*table;		// kern table
+  size_t		length,		// Length of table
+			offset,		// Offset to subtable
+			pairoff;	// Offset to kerning pair
+  unsigned		i, j,		// Looping vars
+			num_tables,	// Number of subtables
+			num_pairs,	// Number of kerning pairs
+			sublength;	// Length of subtable
+
+
+  // Find the kern table...
+  if ((length = seek_table(font, TTF_OFF_kern, 0, false)) < 4)
+    return (true);
+
+  table = font->data + font->dataoff;
+
+  if (get_ushort(table) != 0)
+  {
+    TTF_DEBUG("read_kern: Unsupported kern version %u.\n", get_ushort(table));
+    return (true);
+  }
+
+  num_tables = get_ushort(table + 2);
+
+  for (i = 0, offset = 4; i < num_tables && (offset + 14) <= length; i ++, offset += sublength)
+  {
+    sublength = get_ushort(table + offset + 2);
+
+    // Use format 0 horizontal kerning values...
+    if ((get_ushort(table + offset + 4) & 0xff07) == 0x0001)
+    {
+      num_pairs = get_ushort(table + offset + 6);
+
+      for (j = 0, pairoff = offset + 14; j < num_pairs && (pairoff + 6) <= length; j ++, pairoff += 6)
+      {
+        if (!add_kpair(font, get_ushort(table + pairoff), get_ushort(table + pairoff + 2), (short)get_ushort(table + pairoff + 4)))
+          return (false);
+      }
+
+      font->kseq ++;
+    }
+
+    if (sublength < 14)
+      break;
+  }
+
+  return (true);
+}
+
+
 //
 // 'read_maxp()' - Read the number of glyphs in the font.
 //
@@ -1766,9 +4240,9 @@ read_names(ttf_t *font)			// I - Font
 
   length -= (unsigned)offset;
 
-  if (read(font->fd, font->names.storage, length) < 0)
+  if (read_bytes(font, font->names.storage, length) < 0)
   {
-    errorf(font, "Unable to read name table: %s", strerror(errno));
+    errorf(font, "Unable to read name table.");
     return (false);
   }
 
@@ -1815,7 +4289,7 @@ read_os_2(ttf_t           *font,	// I - Font
   /* yStrikeoutOffset */    read_short(font);
   /* sFamilyClass */        read_short(font);
   /* panose[10] */
-  if (read(font->fd, panose, sizeof(panose)) != (ssize_t)sizeof(panose))
+  if (read_bytes(font, panose, sizeof(panose)) != (ssize_t)sizeof(panose))
     return (false);
   /* ulUnicodeRange1 */     read_ulong(font);
   /* ulUnicodeRange2 */     read_ulong(font);
@@ -1844,6 +4318,173 @@ read_os_2(ttf_t           *font,	// I - Font
 }
 
 
+//
+// 'read_pairpos()' - Read a GPOS pair adjustment subtable.
+//
+// Only the X advance of the first glyph is used.  Malformed subtables are
+// ignored.
+//
+
+static bool				// O - `true` on success, `false` on error
+read_pairpos(ttf_t               *font,	// I - Font
+             const unsigned char *table,// I - GPOS table
+             size_t              length,// I - Length of table
+             size_t              offset)// I - Offset to subtable
+{
+  bool			ret = true;	// Return value
+  unsigned		format,		// Subtable format
+			vformat1,	// Value format for first glyph
+			vformat2,	// Value format for second glyph
+			xadvance,	// Offset to X advance in value record
+			recsize,	// Size of value records
+			bit,		// Current value format bit
+			i, j,		// Looping vars
+			count,		// Number of pair sets or pairs
+			num_classes1,	// Number of first glyph classes
+			num_classes2;	// Number of second glyph classes
+  size_t		setoff,		// Offset to pair set
+			recoff;		// Offset to value record
+  unsigned short	*glyphs,	// Covered glyphs
+			*classes1 = NULL;// First glyph classes
+  int			num_glyphs,	// Number of covered glyphs
+			first1,		// First glyph in class definition
+			num1,		// Number of glyphs in class definition
+			minglyph,	// Minimum covered glyph
+			maxglyph;	// Maximum covered glyph
+  _ttf_kclass_t		*kclass;	// Class-based subtable
+
+
+  if ((offset + 10) > length)
+    return (true);
+
+  format   = get_ushort(table + offset);
+  vformat1 = get_ushort(table + offset + 4);
+  vformat2 = get_ushort(table + offset + 6);
+
+  if (!(vformat1 & 0x0004))
+    return (true);			// No X advance for first glyph
+
+  for (bit = 1, xadvance = 0; bit < 0x0004; bit <<= 1)
+  {
+    if (vformat1 & bit)
+      xadvance += 2;
+  }
+
+  for (bit = 1, recsize = 0; bit < 0x0100; bit <<= 1)
+  {
+    if (vformat1 & bit)
+      recsize += 2;
+    if (vformat2 & bit)
+      recsize += 2;
+  }
+
+  if ((glyphs = read_coverage(font, table, length, offset + get_ushort(table + offset + 2), &num_glyphs)) == NULL)
+    return (false);
+
+  TTF_DEBUG("read_pairpos: format=%u, vformat1=0x%04x, vformat2=0x%04x, num_glyphs=%d\n", format, vformat1, vformat2, num_glyphs);
+
+  if (format == 1)
+  {
+    // Format 1: Individual glyph pairs, one pair set per covered glyph...
+    count = get_ushort(table + offset + 8);
+
+    for (i = 0; i < count && (int)i < num_glyphs && (offset + 12 + 2 * i) <= length && ret; i ++)
+    {
+      setoff = offset + get_ushort(table + offset + 10 + 2 * i);
+
+      if (glyphs[i] == TTF_GLYPH_NONE || (setoff + 2) > length)
+        continue;
+
+      for (j = get_ushort(table + setoff), recoff = setoff + 2; j > 0 && (recoff + 2 + recsize) <= length && ret; j --, recoff += 2 + recsize)
+        ret = add_kpair(font, glyphs[i], get_ushort(table + recoff), (short)get_ushort(table + recoff + 2 + xadvance));
+    }
+  }
+  else if (format == 2 && (offset + 16) <= length)
+  {
+    // Format 2: Class pairs...
+    num_classes1 = get_ushort(table + offset + 12);
+    num_classes2 = get_ushort(table + offset + 14);
+    recoff       = offset + 16;
+
+    for (i = 0, minglyph = 65535, maxglyph = -1; (int)i < num_glyphs; i ++)
+    {
+      if (glyphs[i] == TTF_GLYPH_NONE)
+        continue;
+
+      if (glyphs[i] < minglyph)
+        minglyph = glyphs[i];
+      if (glyphs[i] > maxglyph)
+        maxglyph = glyphs[i];
+    }
+
+    if (num_classes1 == 0 || num_classes2 == 0 || maxglyph < minglyph || (recoff + (size_t)num_classes1 * num_classes2 * recsize) > length)
+    {
+      free(glyphs);
+      return (true);
+    }
+
+    if ((kclass = (_ttf_kclass_t *)realloc(font->kclasses, (font->num_kclasses + 1) * sizeof(_ttf_kclass_t))) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for kerning classes.");
+      free(glyphs);
+      return (false);
+    }
+
+    font->kclasses = kclass;
+    kclass         += font->num_kclasses;
+    font->num_kclasses ++;
+
+    memset(kclass, 0, sizeof(_ttf_kclass_t));
+
+    kclass->seq          = font->kseq;
+    kclass->first1       = minglyph;
+    kclass->num1         = maxglyph - minglyph + 1;
+    kclass->num_classes2 = (int)num_classes2;
+
+    if ((classes1 = read_classdef(font, table, length, offset + get_ushort(table + offset + 8), &first1, &num1)) == NULL || (kclass->class2 = read_classdef(font, table, length, offset + get_ushort(table + offset + 10), &kclass->first2, &kclass->num2)) == NULL || (kclass->class1 = (unsigned short *)malloc((size_t)kclass->num1 * sizeof(unsigned short))) == NULL || (kclass->adjust = (short *)malloc((size_t)num_classes1 * num_classes2 * sizeof(short))) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for kerning classes.");
+      ret = false;
+    }
+    else
+    {
+      // Map covered glyphs to their classes...
+      memset(kclass->class1, 0xff, (size_t)kclass->num1 * sizeof(unsigned short));
+
+      for (i = 0; (int)i < num_glyphs; i ++)
+      {
+        int	g = glyphs[i] - first1,	// Index into class definition
+		c;			// Class
+
+        if (glyphs[i] == TTF_GLYPH_NONE)
+          continue;
+
+        if ((c = (g >= 0 && g < num1) ? classes1[g] : 0) < (int)num_classes1)
+          kclass->class1[glyphs[i] - minglyph] = (unsigned short)c;
+      }
+
+      // Second glyph classes outside the table don't match anything...
+      for (i = 0; (int)i < kclass->num2; i ++)
+      {
+        if (kclass->class2[i] >= num_classes2)
+          kclass->class2[i] = TTF_GLYPH_NONE;
+      }
+
+      // Copy the adjustments...
+      for (i = 0; i < num_classes1 * num_classes2; i ++, recoff += recsize)
+        kclass->adjust[i] = (short)get_ushort(table + recoff + xadvance);
+    }
+  }
+
+  free(classes1);
+  free(glyphs);
+
+  font->kseq ++;
+
+  return (ret);
+}
+
+
 //
 // 'read_post()' - Read the PostScript table.
 //
@@ -1874,15 +4515,19 @@ read_post(ttf_t           *font,	// I - Font
 static int				// O - 16-bit signed integer value or EOF
 read_short(ttf_t *font)			// I - Font
 {
-  unsigned char	buffer[2];		// Read buffer
+  int	value;				// Value
 
 
-  if (read(font->fd, buffer, sizeof(buffer)) != sizeof(buffer))
+  if ((font->dataoff + 2) > font->datasize)
     return (EOF);
-  else if (buffer[0] & 0x80)
-    return (((buffer[0] << 8) | buffer[1]) - 65536);
+
+  value = (int)get_ushort(font->data + font->dataoff);
+  font->dataoff += 2;
+
+  if (value & 0x8000)
+    return (value - 65536);
   else
-    return ((buffer[0] << 8) | buffer[1]);
+    return (value);
 }
 
 
@@ -1950,11 +4595,13 @@ read_table(ttf_t  *font)		// I - Font
 
     TTF_DEBUG("read_table: Offset for font %u is %u.\n", (unsigned)font->idx, temp);
 
-    if (lseek(font->fd, temp + 4, SEEK_SET) < 0)
+    if (((size_t)temp + 4) > font->datasize)
     {
-      errorf(font, "Unable to seek to font %u: %s", (unsigned)font->idx, strerror(errno));
+      errorf(font, "Unable to seek to font %u.", (unsigned)font->idx);
       return (false);
     }
+
+    font->dataoff = (size_t)temp + 4;
   }
   else
   {
@@ -2023,13 +4670,16 @@ read_table(ttf_t  *font)		// I - Font
 static unsigned				// O - 32-bit unsigned integer value or EOF
 read_ulong(ttf_t *font)			// I - Font
 {
-  unsigned char	buffer[4];		// Read buffer
+  unsigned	value;			// Value
 
 
-  if (read(font->fd, buffer, sizeof(buffer)) != sizeof(buffer))
+  if ((font->dataoff + 4) > font->datasize)
     return ((unsigned)EOF);
-  else
-    return ((unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]));
+
+  value = get_ulong(font->data + font->dataoff);
+  font->dataoff += 4;
+
+  return (value);
 }
 
 
@@ -2040,13 +4690,16 @@ read_ulong(ttf_t *font)			// I - Font
 static int				// O - 16-bit unsigned integer value or EOF
 read_ushort(ttf_t *font)		// I - Font
 {
-  unsigned char	buffer[2];		// Read buffer
+  int	value;				// Value
 
 
-  if (read(font->fd, buffer, sizeof(buffer)) != sizeof(buffer))
+  if ((font->dataoff + 2) > font->datasize)
     return (EOF);
-  else
-    return ((buffer[0] << 8) | buffer[1]);
+
+  value = (int)get_ushort(font->data + font->dataoff);
+  font->dataoff += 2;
+
+  return (value);
 }
 
 
@@ -2070,15 +4723,17 @@ seek_table(ttf_t    *font,		// I - Font
     if (current->tag == tag)
     {
       // Found it, seek and return...
-      if (lseek(font->fd, current->offset + offset, SEEK_SET) == (current->offset + offset))
+      if (((size_t)current->offset + offset) <= font->datasize)
       {
         // Successful seek...
+        font->dataoff = (size_t)current->offset + offset;
+
         return (current->length - offset);
       }
       else
       {
         // Seek failed...
-        errorf(font, "Unable to seek to %c%c%c%c table: %s", (tag >> 24) & 255, (tag >> 16) & 255, (tag >> 8) & 255, tag & 255, strerror(errno));
+        errorf(font, "Unable to seek to %c%c%c%c table.", (tag >> 24) & 255, (tag >> 16) & 255, (tag >> 8) & 255, tag & 255);
         return (0);
       }
     }
@@ -2090,3 +4745,41 @@ seek_table(ttf_t    *font,		// I - Font
 
   return (0);
 }
+
+
+//
+// 'set_glyph()' - Set the glyph index for a character.
+//
+// Characters and glyphs that cannot be represented in the sparse map are
+// silently ignored.
+//
+
+static bool				// O - `true` on success, `false` on error
+set_glyph(ttf_t    *font,		// I - Font
+          unsigned ch,			// I - Unicode character
+          unsigned glyph)		// I - Glyph index
+{
+  unsigned short	**page;		// Page in sparse map
+
+
+  if (ch >= TTF_FONT_MAX_CHAR || glyph >= TTF_GLYPH_NONE)
+    return (true);
+
+  page = font->cmap_pages + (ch >> 8);
+
+  if (!*page)
+  {
+    // Allocate a new page with no glyphs...
+    if ((*page = (unsigned short *)malloc(256 * sizeof(unsigned short))) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for cmap.");
+      return (false);
+    }
+
+    memset(*page, 0xff, 256 * sizeof(unsigned short));
+  }
+
+  (*page)[ch & 255] = (unsigned short)glyph;
+
+  return (true);
+}
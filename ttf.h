@@ -80,7 +80,10 @@ typedef struct ttf_rect_s	// Bounding rectangle
 //
 
 extern ttf_t		*ttfCreate(const char *filename, size_t idx, ttf_err_cb_t err_cb, void *err_data);
+extern unsigned char	*ttfCreateCFF(ttf_t *font, size_t num_chars, const int *chars, size_t *datasize);
+extern unsigned char	*ttfCreateSubset(ttf_t *font, size_t num_chars, const int *chars, size_t *datasize);
 extern void		ttfDelete(ttf_t *font);
+extern int		ttfGetAdvance(ttf_t *font, int ch);
 extern int		ttfGetAscent(ttf_t *font);
 extern ttf_rect_t	*ttfGetBounds(ttf_t *font, ttf_rect_t *bounds);
 extern const int	*ttfGetCMap(ttf_t *font, size_t *num_cmap);
@@ -89,17 +92,21 @@ extern const char	*ttfGetCopyright(ttf_t *font);
 extern int		ttfGetDescent(ttf_t *font);
 extern ttf_rect_t	*ttfGetExtents(ttf_t *font, float size, const char *s, ttf_rect_t *extents);
 extern const char	*ttfGetFamily(ttf_t *font);
+extern int		ttfGetGlyph(ttf_t *font, int ch);
 extern float		ttfGetItalicAngle(ttf_t *font);
+extern int		ttfGetKerning(ttf_t *font, int ch1, int ch2);
 extern int		ttfGetMaxChar(ttf_t *font);
 extern int		ttfGetMinChar(ttf_t *font);
 extern size_t		ttfGetNumFonts(ttf_t *font);
 extern const char	*ttfGetPostScriptName(ttf_t *font);
 extern ttf_stretch_t	ttfGetStretch(ttf_t *font);
 extern ttf_style_t	ttfGetStyle(ttf_t *font);
+extern int		ttfGetUnitsPerEm(ttf_t *font);
 extern const char	*ttfGetVersion(ttf_t *font);
 extern int		ttfGetWidth(ttf_t *font, int ch);
 extern ttf_weight_t	ttfGetWeight(ttf_t *font);
 extern int		ttfGetXHeight(ttf_t *font);
+extern bool		ttfIsCFF(ttf_t *font);
 extern bool		ttfIsFixedPitch(ttf_t *font);
 
 